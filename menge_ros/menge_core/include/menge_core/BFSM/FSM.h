@@ -348,6 +348,14 @@ namespace Menge {
 			 *	@returns	A reference to the goal set map.
 			 */
 			std::map< size_t, GoalSet * > & getGoalSets() { return _goalSets; }
+			/*!
+			 *	@brief		Rebuilds the agent's table of ray directions if its scan layout
+			 *				changed. Called for every external agent before the scans are
+			 *				computed in parallel, which only read the tables.
+			 *
+			 *	@param		agent		The agent whose scan layout is checked.
+			 */
+			void updateRayDirections( Agents::BaseAgent * agent );
 			/*!
 			 *	@brief		Returns a simulated laser scan.
 			 *
@@ -360,8 +368,16 @@ namespace Menge {
 			 *	@returns	Distance to the obstacles as a float variable
 			 */
 			float distanceFromObstacle(float angle, float range_max, Agents::BaseAgent * agent);
+			/*!
+			 *	@brief		Computes the distance from the obstacle along a ray.
+			 *
+			 *	@param		dir		Unit vector of the ray in world coordinates
+			 *	@returns	Distance to the obstacles as a float variable
+			 */
+			float distanceFromObstacle(const Vector2 & dir, float range_max, Agents::BaseAgent * agent);
 
 			float distanceFromAgent(float angle, float range_max, Agents::BaseAgent * agent);
+			float distanceFromAgent(const Vector2 & dir, float range_max, Agents::BaseAgent * agent);
 			float nearAgentDistance(Vector2 start, Vector2 end);
 			float intersect(Vector2 start, Vector2 end, Vector2 circle, float radius);
 			bool in_between(Vector2 start, Vector2 point, Vector2 end);
@@ -457,6 +473,21 @@ namespace Menge {
 			ros::Publisher _pub_endpoints;
 			Agents::PrefVelocity prefVelMsg;
 			std::vector< size_t > _robotIDList;
+			/*!
+			 *	@brief		The layout of an agent's simulated scan and the direction of each
+			 *				ray relative to the agent's heading.
+			 */
+			struct RayLayout {
+				RayLayout() : start(0.f), increment(0.f) {}
+				float start;
+				float increment;
+				std::vector< Vector2 > directions;
+			};
+			/*!
+			 *	@brief		Ray layout of each external agent, keyed by agent id. Rebuilt only
+			 *				when the agent's first angle, increment or ray count change.
+			 */
+			std::map< size_t, RayLayout > _rayLayouts;
 		};
 
 		/////////////////////////////////////////////////////////////////////
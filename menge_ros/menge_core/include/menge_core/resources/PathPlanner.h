@@ -49,6 +49,8 @@ Any questions or comments should be sent to the authors {menge,geom}@cs.unc.edu
 #include "ReadersWriterLock.h"
 #include <map>
 #include <list>
+#include <vector>
+#include <string>
 
 namespace Menge {
 
@@ -159,6 +161,19 @@ namespace Menge {
 		 */
 		PortalRoute * getRoute( unsigned int startID, unsigned int endID, float minWidth );	
 
+		/*!
+		 *	@brief		Writes every cached route to the route cache file next to the
+		 *				navigation mesh, so later runs on the same mesh start with them.
+		 *
+		 *	The routes computed here are merged with those of the file that was mapped
+		 *	when the planner was created.  The file is written under a temporary name
+		 *	and renamed, so processes that have the old file mapped keep reading it.
+		 *	This is called as routes are computed and when the planner is destroyed.
+		 *
+		 *	@returns	True if the file was written.
+		 */
+		bool saveRouteCache();
+
 	protected:
 		/*!
 		 *	@brief		Computes a route (and adds it to the cache) between start
@@ -204,6 +219,40 @@ namespace Menge {
 		 */
 		PortalRoute * cacheRoute( unsigned int startID, unsigned int endID, PortalRoute * route );
 
+		/*!
+		 *	@brief		Builds the route that passes through the given sequence of nodes.
+		 *
+		 *	@param		startID		The index of the start node.
+		 *	@param		endID		The index of the end node.
+		 *	@param		nodes		The nodes of the route, from startID to endID.
+		 *	@returns	The route, or NULL if the nodes aren't a connected path from
+		 *				startID to endID in this navigation mesh.
+		 */
+		PortalRoute * buildRoute( unsigned int startID, unsigned int endID, const std::vector< unsigned int > & nodes );
+
+		/*!
+		 *	@brief		Maps the route cache file of the navigation mesh, if there is
+		 *				one written for this mesh's contents.  Its routes are only read
+		 *				when they are first requested.
+		 */
+		void openRouteCache();
+
+		/*!
+		 *	@brief		Unmaps the route cache file.
+		 */
+		void closeRouteCache();
+
+		/*!
+		 *	@brief		Looks for a route between start and end with the minimum clearance
+		 *				given in the route cache file and adds it to the cache.
+		 *
+		 *	@param		startID		The index of the start node.
+		 *	@param		endID		The index of the end node.
+		 *	@param		minWidth	The minimum passable width required for the route.
+		 *	@returns	The route, or NULL if the file doesn't have one.
+		 */
+		PortalRoute * loadCachedRoute( unsigned int startID, unsigned int endID, float minWidth );
+
 		/*!
 		 *	@brief		A mapping from RouteKeys (a size_t) to to a list of routes.
 		 *				The list consists of routes between the points in the
@@ -217,6 +266,48 @@ namespace Menge {
 		 */
 		ReadersWriterLock _routeLock;
 
+		/*!
+		 *	@brief		The route cache file, the navigation mesh file name with ".routes"
+		 *				appended.
+		 */
+		std::string _cacheFile;
+
+		/*!
+		 *	@brief		Hash of the navigation mesh file's contents, which the route cache
+		 *				file must have been written for.  Zero disables the route cache.
+		 */
+		unsigned long long _meshHash;
+
+		/*!
+		 *	@brief		The mapped route cache file and its size in bytes.
+		 */
+		const char * _cacheData;
+		size_t _cacheSize;
+
+		/*!
+		 *	@brief		The contents of the route cache file, where it is read rather
+		 *				than mapped.
+		 */
+		std::vector< char > _cacheBuffer;
+
+		/*!
+		 *	@brief		The number of routes in the route cache file.
+		 */
+		size_t _cacheCount;
+
+		/*!
+		 *	@brief		The number of routes computed since the route cache file was last
+		 *				written and the number at which it is written next.  The interval
+		 *				doubles after every write.
+		 */
+		size_t _unsavedRoutes;
+		size_t _nextCacheSave;
+
+		/*!
+		 *	@brief		Lock for writing the route cache file from one thread at a time.
+		 */
+		ReadersWriterLock _saveLock;
+
 		/*!
 		 *	@brief		The navigation mesh for planning on.
 		 */
@@ -247,32 +247,53 @@ namespace Menge {
 		}
 
 
+		void FSM::updateRayDirections( Agents::BaseAgent * agent ) {
+			float start_angle = agent->_start_angle;
+			float end_angle = agent->_end_angle;
+			float increment = agent->_increment;
+			int rays = increment > 0.f ? (int)floor( ( end_angle - start_angle ) / increment + 0.5f ) : 0;
+			RayLayout & layout = _rayLayouts[ agent->_id ];
+			if ( rays != (int)layout.directions.size() || start_angle != layout.start || increment != layout.increment ) {
+				layout.directions.resize( rays );
+				for ( int i = 0; i < rays; i++ ) {
+					float angle = start_angle + ( increment * i );
+					layout.directions[ i ] = Vector2( cos( angle ), sin( angle ) );
+				}
+				layout.start = start_angle;
+				layout.increment = increment;
+			}
+		}
+
 		void FSM::computeRayScan( Agents::BaseAgent * agent, sensor_msgs::LaserScan& ls) {
 			const size_t ID = agent->_id;
 			// Evalute the new state's velocity
 			
 			Vector2 pos = agent->_pos;
-			//In radians to represent a 220 degree scan with 1/3 degree increment for a total of 660 ray scans
+			//In radians, by default a 220 degree scan with 1/3 degree increment for a total of 660 ray scans
 			float start_angle = agent->_start_angle; 
 			float end_angle = agent->_end_angle;
 			float increment = agent->_increment;
 			float range_max = agent->_range_max; 
 			//In meters 
-			float angles[660];			
-
-			for(int i = 0;i < 660;i++){
-				ls.ranges.push_back(0);
-				angles[i] = start_angle + (increment * i);
-			}
+			// Built by updateRayDirections before the agents are scanned in parallel, only read here
+			const std::vector< Vector2 > & rayDirections = _rayLayouts.find( ID )->second.directions;
+			int rays = (int)rayDirections.size();
+			// Turn the rays to the agent's heading, one sin and cos per scan
+			float agent_dir_angle = atan2(agent->_orient._y, agent->_orient._x);
+			float c = cos( agent_dir_angle );
+			float s = sin( agent_dir_angle );
+			ls.ranges.assign( rays, 0.f );
 
 			// parallel implementati
 			//std::cout << "Parallelization " << ls.ranges.size() << std::endl; 
 			#pragma omp parallel for
-			for(int i = 0; i < 660; i++){
+			for(int i = 0; i < rays; i++){
 				//std::cout << "Generating obstacle distance " << angle; 
 				//for each angle compute the distance from the obstacle
-				float distance =  distanceFromObstacle(angles[i],range_max, agent);
-				float distance_agent = distanceFromAgent(angles[i],range_max, agent);
+				const Vector2 & ray = rayDirections[ i ];
+				Vector2 dir( c * ray._x - s * ray._y, s * ray._x + c * ray._y );
+				float distance =  distanceFromObstacle(dir, range_max, agent);
+				float distance_agent = distanceFromAgent(dir, range_max, agent);
 				if(distance > distance_agent){
 					distance = distance_agent;
 				}
@@ -287,35 +308,32 @@ namespace Menge {
 		}
 
 		float FSM::distanceFromAgent(float angle, float range_max, Agents::BaseAgent * agent){
+			float new_angle = atan2(agent->_orient._y, agent->_orient._x) + angle;
+			return distanceFromAgent(Vector2(cos(new_angle), sin(new_angle)), range_max, agent);
+		}
+
+		float FSM::distanceFromAgent(const Vector2 & dir, float range_max, Agents::BaseAgent * agent){
 			// find the vector to represent the ray 
-			float min_range = 0.01;
-			float width = 0.1;
-			
-			float agent_dir_angle = atan2(agent->_orient._y, agent->_orient._x);
-			//std::cout << "Calculate laser:Agent orient x:" << agent->_orient._x << " y:" << agent->_orient._y << std::endl;
-			//std::cout << "Calculate Agent direction : " << agent_dir_angle << std::endl;
-			float new_angle = agent_dir_angle + angle;
-			//
 			Vector2 laser_begin = agent->_pos;
 			Vector2 laser_end = laser_begin;
-			laser_end._x += cos(new_angle) * range_max;
-			laser_end._y += sin(new_angle) * range_max;
+			laser_end._x += dir._x * range_max;
+			laser_end._y += dir._y * range_max;
 			return nearAgentDistance(laser_begin, laser_end);
 		}
 	
 		float FSM::distanceFromObstacle(float angle, float range_max, Agents::BaseAgent * agent){
+			float new_angle = atan2(agent->_orient._y, agent->_orient._x) + angle;
+			return distanceFromObstacle(Vector2(cos(new_angle), sin(new_angle)), range_max, agent);
+		}
+
+		float FSM::distanceFromObstacle(const Vector2 & dir, float range_max, Agents::BaseAgent * agent){
 			// find the vector to represent the ray 
 			float min_range = 0.01;
 			float width = 0.0001;			
-			float agent_dir_angle = atan2(agent->_orient._y, agent->_orient._x);
-			//std::cout << "Calculate laser:Agent orient x:" << agent->_orient._x << " y:" << agent->_orient._y << std::endl;
-			//std::cout << "Calculate Agent direction : " << agent_dir_angle << std::endl;
-			float new_angle = agent_dir_angle + angle;
-			//
 			Vector2 laser_begin = agent->_pos;
 			Vector2 laser_end = laser_begin;
-			laser_end._x += cos(new_angle) * range_max;
-			laser_end._y += sin(new_angle) * range_max;
+			laser_end._x += dir._x * range_max;
+			laser_end._y += dir._y * range_max;
 			Vector2 laser_mid;
 			if(_sim->queryVisibility(laser_begin,laser_end, width)){
 				return range_max;	
@@ -519,6 +537,15 @@ namespace Menge {
 				}
 			}
 			
+			// The scans below run in parallel and only read the ray tables, so they are brought
+			// up to date here first
+			for ( int a = 0; a < agtCount; ++a ) {
+				Agents::BaseAgent * agt = this->_sim->getAgent( a );
+				if ( agt->_isExternal ) {
+					updateRayDirections( agt );
+				}
+			}
+
 			// Compute the robot laser scan and position  	
 			#pragma omp parallel for reduction(+:exceptionCount)		
 			for(int a = 0; a < agtCount; ++a){
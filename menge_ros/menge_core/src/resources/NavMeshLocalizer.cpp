@@ -116,6 +116,8 @@ namespace Menge {
 
 	NavMeshLocalizer::~NavMeshLocalizer() {
 		delete [] _nodeOccupants;
+		// The planner saves its route cache as it goes away
+		if ( _planner ) delete _planner;
 	}
 
 	/////////////////////////////////////////////////////////////////////
@@ -42,13 +42,26 @@ Any questions or comments should be sent to the authors {menge,geom}@cs.unc.edu
 #include "MinHeap.h"
 #include "NavMeshNode.h"
 #include <iostream>
+#include <fstream>
 #include <cassert>
 #include <sstream>
+#include <algorithm>
+#include <iterator>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 namespace Menge {
 
 	/////////////////////////////////////////////////////////////////////
@@ -74,18 +87,196 @@ namespace Menge {
 		return ( (size_t)start << SHIFT ) | ( (size_t)end & MASK );
 	}
 
+	/////////////////////////////////////////////////////////////////////
+	//					Implementation of PathPlanner - ROUTE CACHE
+	/////////////////////////////////////////////////////////////////////
+
+	/*
+	 *	A route cache file is a RouteCacheHeader, an index of RouteCacheHeader::routeCount
+	 *	RouteCacheEntry sorted by key, and one record per route.  A record is the route's
+	 *	_bestSmallest and _maxWidth (two floats), the number of nodes on the route and the
+	 *	nodes from start to end (unsigned 32-bit ints).  Fields are in the byte order of
+	 *	the machine that wrote the file.
+	 */
+
+	/*!
+	 *	@brief		The tag at the start of every route cache file.
+	 */
+	const char ROUTE_CACHE_TAG[4] = { 'M', 'R', 'T', 'C' };
+
+	/*!
+	 *	@brief		The layout of the route cache file.  Files of another version are
+	 *				ignored, so this must change whenever the layout does.
+	 */
+	const uint32_t ROUTE_CACHE_VERSION = 1;
+
+	/*!
+	 *	@brief		The header of a route cache file.
+	 */
+	struct RouteCacheHeader {
+		char		tag[4];
+		uint32_t	version;
+		uint64_t	meshHash;
+		uint64_t	nodeCount;
+		uint64_t	routeCount;
+	};
+
+	/*!
+	 *	@brief		An entry of the route cache file's index.
+	 */
+	struct RouteCacheEntry {
+		uint64_t	key;		///< The RouteKey of the route's start and end nodes.
+		uint64_t	offset;		///< The offset of the route's record in the file.
+	};
+
+	/*!
+	 *	@brief		Orders route cache entries by key.
+	 */
+	bool entryKeyLess( const RouteCacheEntry & a, const RouteCacheEntry & b ) {
+		return a.key < b.key;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	/*!
+	 *	@brief		Computes the 64-bit FNV-1a hash of a file's contents.
+	 *
+	 *	@param		fileName	The file to hash.
+	 *	@returns	The hash, or zero if the file can't be read.
+	 */
+	unsigned long long hashFileContents( const std::string & fileName ) {
+		std::ifstream in( fileName.c_str(), std::ios::in | std::ios::binary );
+		if ( !in.is_open() ) return 0;
+		unsigned long long hash = 14695981039346656037ULL;
+		char buffer[ 65536 ];
+		while ( in.good() ) {
+			in.read( buffer, sizeof( buffer ) );
+			std::streamsize count = in.gcount();
+			for ( std::streamsize i = 0; i < count; ++i ) {
+				hash ^= (unsigned char)buffer[ i ];
+				hash *= 1099511628211ULL;
+			}
+		}
+		return hash;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	/*!
+	 *	@brief		Reads an entry of a route cache file's index.
+	 *
+	 *	@param		data		The route cache file.
+	 *	@param		i			The index of the entry.
+	 *	@returns	The entry.
+	 */
+	RouteCacheEntry readCacheEntry( const char * data, size_t i ) {
+		RouteCacheEntry entry;
+		memcpy( &entry, data + sizeof( RouteCacheHeader ) + i * sizeof( RouteCacheEntry ), sizeof( RouteCacheEntry ) );
+		return entry;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	/*!
+	 *	@brief		Finds the first entry of a route cache file's index whose key is
+	 *				not less than the given key.
+	 *
+	 *	@param		data		The route cache file.
+	 *	@param		count		The number of entries in the index.
+	 *	@param		key			The key to look for.
+	 *	@returns	The index of the entry, count if every key is less.
+	 */
+	size_t findCacheEntry( const char * data, size_t count, RouteKey key ) {
+		size_t lo = 0;
+		size_t hi = count;
+		while ( lo < hi ) {
+			size_t mid = lo + ( hi - lo ) / 2;
+			if ( readCacheEntry( data, mid ).key < key ) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	/*!
+	 *	@brief		Reads a route's record from a route cache file.
+	 *
+	 *	@param		data			The route cache file.
+	 *	@param		size			The size of the file in bytes.
+	 *	@param		offset			The offset of the record.
+	 *	@param		bestSmallest	Set to the route's _bestSmallest.
+	 *	@param		maxWidth		Set to the route's _maxWidth.
+	 *	@param		nodes			Set to the route's nodes.
+	 *	@returns	False if the record runs past the end of the file.
+	 */
+	bool readCacheRecord( const char * data, size_t size, uint64_t offset, float & bestSmallest, float & maxWidth, std::vector< unsigned int > & nodes ) {
+		uint32_t nodeCount;
+		if ( offset > size || size - offset < 12 ) return false;
+		memcpy( &bestSmallest, data + offset, 4 );
+		memcpy( &maxWidth, data + offset + 4, 4 );
+		memcpy( &nodeCount, data + offset + 8, 4 );
+		if ( nodeCount > ( size - offset - 12 ) / 4 ) return false;
+		nodes.resize( nodeCount );
+		for ( uint32_t i = 0; i < nodeCount; ++i ) {
+			uint32_t node;
+			memcpy( &node, data + offset + 12 + 4 * i, 4 );
+			nodes[ i ] = node;
+		}
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	/*!
+	 *	@brief		Appends a route's record to the records of a route cache file
+	 *				being written and its entry to the index.
+	 *
+	 *	@param		index			The index being written.
+	 *	@param		records			The records being written.  The entry's offset
+	 *								is relative to their start.
+	 *	@param		key				The RouteKey of the route.
+	 *	@param		bestSmallest	The route's _bestSmallest.
+	 *	@param		maxWidth		The route's _maxWidth.
+	 *	@param		nodes			The route's nodes.
+	 */
+	void appendCacheRecord( std::vector< RouteCacheEntry > & index, std::vector< char > & records, RouteKey key, float bestSmallest, float maxWidth, const std::vector< unsigned int > & nodes ) {
+		RouteCacheEntry entry;
+		entry.key = key;
+		entry.offset = records.size();
+		index.push_back( entry );
+		uint32_t nodeCount = (uint32_t)nodes.size();
+		records.resize( records.size() + 12 + 4 * nodes.size() );
+		char * record = &records[ entry.offset ];
+		memcpy( record, &bestSmallest, 4 );
+		memcpy( record + 4, &maxWidth, 4 );
+		memcpy( record + 8, &nodeCount, 4 );
+		for ( size_t i = 0; i < nodes.size(); ++i ) {
+			uint32_t node = nodes[ i ];
+			memcpy( record + 12 + 4 * i, &node, 4 );
+		}
+	}
+
 	/////////////////////////////////////////////////////////////////////
 	//					Implementation of PathPlanner
 	/////////////////////////////////////////////////////////////////////
 
-	PathPlanner::PathPlanner( NavMeshPtr ptr ):_navMesh(ptr), DATA_SIZE(0), STATE_SIZE(0), _HEAP(0x0), _DATA(0x0), _STATE(0x0) {
+	PathPlanner::PathPlanner( NavMeshPtr ptr ):_meshHash(0), _cacheData(0x0), _cacheSize(0), _cacheCount(0), _unsavedRoutes(0), _nextCacheSave(64), _navMesh(ptr), DATA_SIZE(0), STATE_SIZE(0), _HEAP(0x0), _DATA(0x0), _STATE(0x0) {
 		size_t nCount = _navMesh->getNodeCount();
 		initHeapMemory( nCount );
+		openRouteCache();
 	}
 
 	/////////////////////////////////////////////////////////////////////
 
 	PathPlanner::~PathPlanner() {
+		if ( _unsavedRoutes > 0 ) {
+			saveRouteCache();
+		}
+		closeRouteCache();
 		initHeapMemory( 0 );
 	}
 
@@ -110,7 +301,10 @@ namespace Menge {
 		} 
 		_routeLock.releaseRead();
 
-		// Compute a new path
+		// Take it from the route cache file, or compute a new path
+		if ( route == 0x0 ) {
+			route = loadCachedRoute( startID, endID, minWidth );
+		}
 		if ( route == 0x0 ) {
 			return computeRoute( startID, endID, minWidth );
 		} else {
@@ -225,11 +419,212 @@ namespace Menge {
 	#pragma warning( default : 4267 )
 	#endif
 		cacheRoute( startID, endID, route );
+
+		_routeLock.lockWrite();
+		bool save = ++_unsavedRoutes >= _nextCacheSave;
+		if ( save ) {
+			_unsavedRoutes = 0;
+			_nextCacheSave *= 2;
+		}
+		_routeLock.releaseWrite();
+		if ( save ) {
+			saveRouteCache();
+		}
 		return route;
 	}
 
 	/////////////////////////////////////////////////////////////////////
 
+	PortalRoute * PathPlanner::buildRoute( unsigned int startID, unsigned int endID, const std::vector< unsigned int > & nodes ) {
+		const size_t N = _navMesh->getNodeCount();
+		if ( nodes.empty() || nodes.front() != startID || nodes.back() != endID ) {
+			return 0x0;
+		}
+		PortalRoute * route = new PortalRoute( startID, endID );
+		for ( size_t i = 1; i < nodes.size(); ++i ) {
+			NavMeshNode & prevNode = _navMesh->_nodes[ nodes[ i - 1 ] ];
+			NavMeshEdge * edge = nodes[ i ] < N ? prevNode.getConnection( nodes[ i ] ) : 0x0;
+			if ( edge == 0x0 ) {
+				delete route;
+				return 0x0;
+			}
+			route->appendWayPortal( edge, prevNode.getID() );
+		}
+		return route;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	void PathPlanner::openRouteCache() {
+		_cacheFile = _navMesh->getName() + ".routes";
+		_meshHash = hashFileContents( _navMesh->getName() );
+		if ( _meshHash == 0 ) {
+			return;
+		}
+	#ifdef _WIN32
+		std::ifstream in( _cacheFile.c_str(), std::ios::in | std::ios::binary );
+		if ( !in.is_open() ) return;
+		_cacheBuffer.assign( std::istreambuf_iterator< char >( in ), std::istreambuf_iterator< char >() );
+		if ( _cacheBuffer.empty() ) return;
+		_cacheData = &_cacheBuffer[ 0 ];
+		_cacheSize = _cacheBuffer.size();
+	#else
+		// Mapped shared and read-only, so concurrent simulations of the same scene share the pages
+		int fd = ::open( _cacheFile.c_str(), O_RDONLY );
+		if ( fd < 0 ) return;
+		struct stat info;
+		void * mapping = MAP_FAILED;
+		if ( fstat( fd, &info ) == 0 && info.st_size > 0 ) {
+			mapping = mmap( 0x0, info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+		}
+		::close( fd );
+		if ( mapping == MAP_FAILED ) return;
+		_cacheData = (const char *)mapping;
+		_cacheSize = info.st_size;
+	#endif
+		RouteCacheHeader header;
+		bool valid = _cacheSize >= sizeof( RouteCacheHeader );
+		if ( valid ) {
+			memcpy( &header, _cacheData, sizeof( RouteCacheHeader ) );
+			valid = memcmp( header.tag, ROUTE_CACHE_TAG, 4 ) == 0 && header.version == ROUTE_CACHE_VERSION &&
+					header.meshHash == _meshHash && header.nodeCount == _navMesh->getNodeCount() &&
+					header.routeCount <= ( _cacheSize - sizeof( RouteCacheHeader ) ) / sizeof( RouteCacheEntry );
+		}
+		if ( !valid ) {
+			logger << Logger::WARN_MSG << "Ignoring route cache " << _cacheFile << ", it was written for another navigation mesh or version.\n";
+			closeRouteCache();
+			return;
+		}
+		_cacheCount = (size_t)header.routeCount;
+		logger << Logger::INFO_MSG << "Mapped " << _cacheCount << " cached routes from " << _cacheFile << "\n";
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	void PathPlanner::closeRouteCache() {
+	#ifdef _WIN32
+		_cacheBuffer.clear();
+	#else
+		if ( _cacheData ) {
+			munmap( (void *)_cacheData, _cacheSize );
+		}
+	#endif
+		_cacheData = 0x0;
+		_cacheSize = 0;
+		_cacheCount = 0;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	PortalRoute * PathPlanner::loadCachedRoute( unsigned int startID, unsigned int endID, float minWidth ) {
+		if ( _cacheCount == 0 ) {
+			return 0x0;
+		}
+		RouteKey key = makeRouteKey( startID, endID );
+		std::vector< unsigned int > nodes;
+		for ( size_t i = findCacheEntry( _cacheData, _cacheCount, key ); i < _cacheCount; ++i ) {
+			RouteCacheEntry entry = readCacheEntry( _cacheData, i );
+			if ( entry.key != key ) break;
+			float bestSmallest, maxWidth;
+			if ( !readCacheRecord( _cacheData, _cacheSize, entry.offset, bestSmallest, maxWidth, nodes ) ) continue;
+			// The same test getRoute applies to the routes already in memory
+			if ( maxWidth > minWidth && bestSmallest <= minWidth * 1.05f ) {
+				PortalRoute * route = buildRoute( startID, endID, nodes );
+				if ( route == 0x0 ) continue;
+				route->_bestSmallest = bestSmallest;
+				cacheRoute( startID, endID, route );
+				return route;
+			}
+		}
+		return 0x0;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
+	bool PathPlanner::saveRouteCache() {
+		if ( _meshHash == 0 ) {
+			return false;
+		}
+		_saveLock.lockWrite();
+		std::vector< RouteCacheEntry > index;
+		std::vector< char > records;
+		std::vector< unsigned int > nodes;
+		_routeLock.lockRead();
+		for ( PRouteMapCItr itr = _routes.begin(); itr != _routes.end(); ++itr ) {
+			for ( PRouteListCItr rItr = itr->second.begin(); rItr != itr->second.end(); ++rItr ) {
+				const PortalRoute * route = *rItr;
+				nodes.clear();
+				for ( size_t i = 0; i < route->getPortalCount(); ++i ) {
+					nodes.push_back( route->getPortalNode( i ) );
+				}
+				nodes.push_back( route->getEndNode() );
+				appendCacheRecord( index, records, itr->first, route->_bestSmallest, route->_maxWidth, nodes );
+			}
+		}
+		// Keep the routes of the mapped file that this simulation never asked for
+		for ( size_t i = 0; i < _cacheCount; ++i ) {
+			RouteCacheEntry entry = readCacheEntry( _cacheData, i );
+			float bestSmallest, maxWidth;
+			if ( !readCacheRecord( _cacheData, _cacheSize, entry.offset, bestSmallest, maxWidth, nodes ) ) continue;
+			bool known = false;
+			PRouteMapCItr itr = _routes.find( (RouteKey)entry.key );
+			if ( itr != _routes.end() ) {
+				for ( PRouteListCItr rItr = itr->second.begin(); rItr != itr->second.end() && !known; ++rItr ) {
+					known = (*rItr)->_bestSmallest == bestSmallest && (*rItr)->_maxWidth == maxWidth;
+				}
+			}
+			if ( !known ) {
+				appendCacheRecord( index, records, (RouteKey)entry.key, bestSmallest, maxWidth, nodes );
+			}
+		}
+		_routeLock.releaseRead();
+
+		std::stable_sort( index.begin(), index.end(), entryKeyLess );
+		RouteCacheHeader header;
+		memcpy( header.tag, ROUTE_CACHE_TAG, 4 );
+		header.version = ROUTE_CACHE_VERSION;
+		header.meshHash = _meshHash;
+		header.nodeCount = _navMesh->getNodeCount();
+		header.routeCount = index.size();
+		const uint64_t recordStart = sizeof( RouteCacheHeader ) + index.size() * sizeof( RouteCacheEntry );
+		for ( size_t i = 0; i < index.size(); ++i ) {
+			index[ i ].offset += recordStart;
+		}
+
+		// Written aside and renamed into place, so a reader never maps a partial file
+		std::stringstream temporary;
+		temporary << _cacheFile << ".tmp";
+	#ifndef _WIN32
+		temporary << "." << getpid();
+	#endif
+		std::ofstream out( temporary.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		bool written = out.is_open();
+		if ( written ) {
+			out.write( (const char *)&header, sizeof( RouteCacheHeader ) );
+			if ( !index.empty() ) out.write( (const char *)&index[ 0 ], index.size() * sizeof( RouteCacheEntry ) );
+			if ( !records.empty() ) out.write( &records[ 0 ], records.size() );
+			out.close();
+			written = !out.fail();
+		}
+	#ifdef _WIN32
+		// rename doesn't replace an existing file here
+		if ( written ) remove( _cacheFile.c_str() );
+	#endif
+		if ( written && rename( temporary.str().c_str(), _cacheFile.c_str() ) != 0 ) {
+			remove( temporary.str().c_str() );
+			written = false;
+		}
+		if ( written ) {
+			logger << Logger::INFO_MSG << "Saved " << index.size() << " routes to " << _cacheFile << "\n";
+		} else {
+			logger << Logger::WARN_MSG << "Couldn't write the route cache " << _cacheFile << "\n";
+		}
+		_saveLock.releaseWrite();
+		return written;
+	}
+
+	/////////////////////////////////////////////////////////////////////
+
 	void PathPlanner::initHeapMemory( size_t nodeCount ) {
 		int threadCount = 1;
 	#ifdef _OPENMP
@@ -14,6 +14,8 @@
 #include "FORRAction.h"
 #include "Position.h"
 #include "FORRGeometry.h"
+#include "LaserGeometry.h"
+#include "SpatialModelSnapshot.h"
 
 #include <time.h>
 #include <unistd.h>
@@ -28,6 +30,7 @@
 #include <sensor_msgs/LaserScan.h>
 #include <geometry_msgs/PoseArray.h>
 #include <tf/transform_datatypes.h>
+#include <boost/make_shared.hpp>
 
 using namespace std;
 
@@ -75,7 +78,11 @@ public:
     for(int i = 0 ; i < numRotates ; i++) rotate[i] = arrRotate[i];
     all_position_trace = new vector<Position>();
     all_laser_history = new vector< vector<CartesianPoint> >();
-    all_laserscan_history = new vector< sensor_msgs::LaserScan >();
+    all_laserscan_history = new vector< sensor_msgs::LaserScan::ConstPtr >();
+    currentLaserScan = boost::make_shared<sensor_msgs::LaserScan>();
+    currentCrowd = boost::make_shared<geometry_msgs::PoseArray>();
+    allCrowd = boost::make_shared<geometry_msgs::PoseArray>();
+    crowdModel = boost::make_shared<semaforr::CrowdModel>();
     killBecauseStuck = false;
   }
   
@@ -106,9 +113,11 @@ public:
   }
 
   Position getCurrentPosition() { return currentPosition; }
-  vector<CartesianPoint> getCurrentLaserEndpoints() { return laserEndpoints; }
+  const vector<CartesianPoint> &getCurrentLaserEndpoints() { return laserEndpoints; }
 
-  void setCurrentSensor(Position p, sensor_msgs::LaserScan scan) { 
+  // The scan is shared, not copied, by the agent state and the histories. The endpoints are
+  // computed once here.
+  void setCurrentSensor(Position p, const sensor_msgs::LaserScan::ConstPtr &scan) { 
     currentPosition = p;
     currentLaserScan = scan;
     transformToEndpoints();
@@ -121,6 +130,24 @@ public:
     }
   }
   
+  // Moves the sensing to a predicted pose and records it in the task and run histories as setCurrentSensor
+  // does, so advice that reads the histories sees them as it will at the real decision. Used to speculate on
+  // the next decision, undoSpeculativeSensor takes the prediction back out.
+  void setSpeculativeSensor(Position p, const sensor_msgs::LaserScan::ConstPtr &scan) {
+    setCurrentSensor(p, scan);
+  }
+  void undoSpeculativeSensor(Position p, const sensor_msgs::LaserScan::ConstPtr &scan) {
+    if(currentTask != NULL){
+      all_laserscan_history->pop_back();
+      all_position_trace->pop_back();
+      all_laser_history->pop_back();
+      currentTask->dropLastSensor();
+    }
+    currentPosition = p;
+    currentLaserScan = scan;
+    transformToEndpoints();
+  }
+
   Task *getCurrentTask() { return currentTask; }
   /*void setCurrentTask(Task *task, Position current, PathPlanner *planner, bool aStarOn) { 
     currentTask = task; 
@@ -206,7 +233,7 @@ public:
   vector< vector < vector<CartesianPoint> > > getAllLaserTrace(){return all_laser_trace;}
   vector< Position > *getAllPositionTrace(){return all_position_trace;}
   vector< vector<CartesianPoint> > *getAllLaserHistory(){return all_laser_history;}
-  vector< sensor_msgs::LaserScan > *getAllLaserScanHistory(){return all_laserscan_history;}
+  vector< sensor_msgs::LaserScan::ConstPtr > *getAllLaserScanHistory(){return all_laserscan_history;}
 
   vector< vector<CartesianPoint> > getInitialExitTraces(){return initial_exit_traces;}
   void setInitialExitTraces(vector< vector<CartesianPoint> > exit_traces){initial_exit_traces = exit_traces;}
@@ -231,9 +258,13 @@ public:
 	return status;
   }
 
-  sensor_msgs::LaserScan getCurrentLaserScan(){return currentLaserScan;}
+  const sensor_msgs::LaserScan &getCurrentLaserScan(){return *currentLaserScan;}
+  sensor_msgs::LaserScan::ConstPtr getCurrentLaserScanPtr(){return currentLaserScan;}
+
+  vector<CartesianPoint> transformToEndpoints(Position p, const sensor_msgs::LaserScan &scan);
 
-  vector<CartesianPoint> transformToEndpoints(Position p, sensor_msgs::LaserScan scan);
+  // Scan expected at pose to, built from what scan saw at pose from
+  sensor_msgs::LaserScan predictLaserScan(Position from, const sensor_msgs::LaserScan &scan, Position to);
   
   Position getExpectedPositionAfterAction(FORRAction action);
 
@@ -250,13 +281,13 @@ public:
   double getDistanceToObstacle(Position initialPosition, vector<CartesianPoint> initialLaser, double rotation_angle);
   double getDistanceToForwardObstacle(){
     //ROS_DEBUG("in getDistance to forward obstacle");
-    if(currentLaserScan.ranges.size() == 0)
+    if(currentLaserScan->ranges.size() == 0)
       return 25;
     double min_distance = 25;
-    int mid_index = currentLaserScan.ranges.size()/2;
+    int mid_index = currentLaserScan->ranges.size()/2;
     for(int i = mid_index-2; i < mid_index+3; i++){
-      if(currentLaserScan.ranges[i] < min_distance){
-        min_distance = currentLaserScan.ranges[i];
+      if(currentLaserScan->ranges[i] < min_distance){
+        min_distance = currentLaserScan->ranges[i];
       }
     }
     // return currentLaserScan.ranges[currentLaserScan.ranges.size()/2];
@@ -409,23 +440,32 @@ public:
   double getRobotFootPrint(){return robotFootPrint;}
  
   void setAgentStateParameters(double val1, double val2, double val3, double val4, double val5, double val6, double val7);
+
+  // Beam layout assumed until the first scan arrives, every scan then replaces it with its own
+  void setLaserGeometry(LaserGeometry geometry){ laserGeometry = geometry; }
+  LaserGeometry getLaserGeometry(){ return laserGeometry; }
   
-  geometry_msgs::PoseArray getCrowdPose(){ return currentCrowd;}
-  void setCrowdPose(geometry_msgs::PoseArray crowdpose){
+  const geometry_msgs::PoseArray &getCrowdPose(){ return *currentCrowd;}
+  geometry_msgs::PoseArray::ConstPtr getCrowdPosePtr(){ return currentCrowd;}
+  void setCrowdPose(const geometry_msgs::PoseArray::ConstPtr &crowdpose){
 	currentCrowd = crowdpose;
   }
 
-  vector <Position> getCrowdPositions(geometry_msgs::PoseArray crowdpose);
+  vector <Position> getCrowdPositions(const geometry_msgs::PoseArray &crowdpose);
 
-  geometry_msgs::PoseArray getCrowdPoseAll(){ return allCrowd;}
-  void setCrowdPoseAll(geometry_msgs::PoseArray crowdposeall){
+  const geometry_msgs::PoseArray &getCrowdPoseAll(){ return *allCrowd;}
+  void setCrowdPoseAll(const geometry_msgs::PoseArray::ConstPtr &crowdposeall){
 	allCrowd = crowdposeall;
   }
 
-  void setCrowdModel(semaforr::CrowdModel c){ 
+  void setCrowdModel(const semaforr::CrowdModel::ConstPtr &c){ 
     crowdModel = c;
   }
-  semaforr::CrowdModel getCrowdModel(){ return crowdModel;}
+  // For callers that hold the model itself, e.g. when replaying recorded decisions
+  void setCrowdModel(const semaforr::CrowdModel &c){ 
+    crowdModel = boost::make_shared<semaforr::CrowdModel>(c);
+  }
+  const semaforr::CrowdModel &getCrowdModel(){ return *crowdModel;}
 
   bool crowdModelLearned();
   bool riskModelLearned();
@@ -437,8 +477,6 @@ public:
   double getRiskExperience(double x, double y);
   double getFLowObservation(double x, double y);
 
-  void dfs(int x, int y, int current_label, vector<int> dx, vector<int> dy, int row_count, int col_count, vector< vector<int> > *label, vector< vector<int> > *m);
-
   void setPassageValues(vector< vector<int> > pg, map<int, vector< vector<int> > > pgn, map<int, vector< vector<int> > > pge, vector< vector<int> > pgr, vector< vector<int> > ap, vector< vector<CartesianPoint> > gt, vector< vector<int> > gti, vector< vector<CartesianPoint> > git){
     passage_grid = pg;
     passage_graph_nodes = pgn;
@@ -494,7 +532,77 @@ public:
     return remaining_candidates;
   }
 
+  // Traces of the finished tasks, which the learners relearn from, and the learned passages
+  void saveHistory(SnapshotWriter &out){
+    out.beginSection("TRAC");
+    out.putPointLists(all_trace);
+    out.putInt(all_laser_trace.size());
+    for(int i = 0; i < all_laser_trace.size(); i++){
+      out.putPointLists(all_laser_trace[i]);
+    }
+    out.endSection();
+    out.beginSection("PASS");
+    out.putIntGridList(passage_grid);
+    saveIntGridMap(out, passage_graph_nodes);
+    saveIntGridMap(out, passage_graph_edges);
+    out.putIntGridList(passage_graph);
+    out.putIntGridList(average_passage);
+    out.putPointLists(graph_trails);
+    out.putIntGridList(graph_through_intersections);
+    out.putPointLists(graph_intersection_trails);
+    out.endSection();
+  }
+
+  bool loadHistory(SnapshotReader &in){
+    if(!in.section("TRAC")){
+      return false;
+    }
+    vector< vector<CartesianPoint> > trace = in.getPointLists();
+    vector< vector < vector<CartesianPoint> > > laser_trace;
+    int count = in.getInt();
+    for(int i = 0; i < count and in.ok(); i++){
+      laser_trace.push_back(in.getPointLists());
+    }
+    if(!in.ok() or trace.size() != laser_trace.size()){
+      return false;
+    }
+    all_trace = trace;
+    all_laser_trace = laser_trace;
+    if(in.section("PASS")){
+      vector< vector<int> > pg = in.getIntGridList();
+      map<int, vector< vector<int> > > pgn = loadIntGridMap(in);
+      map<int, vector< vector<int> > > pge = loadIntGridMap(in);
+      vector< vector<int> > pgr = in.getIntGridList();
+      vector< vector<int> > ap = in.getIntGridList();
+      vector< vector<CartesianPoint> > gt = in.getPointLists();
+      vector< vector<int> > gti = in.getIntGridList();
+      vector< vector<CartesianPoint> > git = in.getPointLists();
+      if(in.ok()){
+        setPassageValues(pg, pgn, pge, pgr, ap, gt, gti, git);
+      }
+    }
+    return true;
+  }
+
  private:
+  void saveIntGridMap(SnapshotWriter &out, map<int, vector< vector<int> > > &values){
+    out.putInt(values.size());
+    for(map<int, vector< vector<int> > >::iterator it = values.begin(); it != values.end(); it++){
+      out.putInt(it->first);
+      out.putIntGridList(it->second);
+    }
+  }
+
+  map<int, vector< vector<int> > > loadIntGridMap(SnapshotReader &in){
+    map<int, vector< vector<int> > > values;
+    int count = in.getInt();
+    for(int i = 0; i < count and in.ok(); i++){
+      int key = in.getInt();
+      values[key] = in.getIntGridList();
+    }
+    return values;
+  }
+
 
   // Stores the move and rotate action values
   double move[300];  
@@ -514,7 +622,7 @@ public:
   // All laser history of all targets
   vector< vector < vector<CartesianPoint> > > all_laser_trace;
   vector< vector<CartesianPoint> > *all_laser_history;
-  vector< sensor_msgs::LaserScan > *all_laserscan_history;
+  vector< sensor_msgs::LaserScan::ConstPtr > *all_laserscan_history;
 
   // Decision count by task
   vector<int> task_decision_count;
@@ -557,22 +665,28 @@ public:
   Task *currentTask;
 
   // Currrent laser scan reading at the current position
-  sensor_msgs::LaserScan currentLaserScan;
+  sensor_msgs::LaserScan::ConstPtr currentLaserScan;
 
   // Current laser scan data as endpoints in the x-y coordinate frame
   vector<CartesianPoint> laserEndpoints;
 
+  // The beams from the current position to laserEndpoints, for batched intersection tests
+  SegmentSet laserSegments;
+
+  // Beam layout of the current scan and the direction of each beam
+  LaserGeometry laserGeometry;
+
   //Converts current laser range scanner to endpoints
   void transformToEndpoints();
 
   // Nearby crowd positions
-  geometry_msgs::PoseArray currentCrowd;
+  geometry_msgs::PoseArray::ConstPtr currentCrowd;
 
   // All crowd positions
-  geometry_msgs::PoseArray allCrowd;
+  geometry_msgs::PoseArray::ConstPtr allCrowd;
 
   // Current crowd model
-  semaforr::CrowdModel crowdModel;
+  semaforr::CrowdModel::ConstPtr crowdModel;
 
   //Rotate mode tells if the t3 should rotate or move
   bool rotateMode;
@@ -27,6 +27,8 @@ public:
 
   int getHallwayType() const {return hallway_type_;}
 
+  vector<int> getConnections() const {return connectedHallways;}
+
   bool pointInAggregate(CartesianPoint point){
     //cout << "Inside pointInAggregate" << endl;
     std::vector<CartesianPoint>::iterator it;
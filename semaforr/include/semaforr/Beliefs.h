@@ -52,6 +52,25 @@ public:
     }
     SpatialModel* getSpatialModel(){return spatialModel;}
 
+    /*! \brief Writes the spatial model and the traces it was learned from to fileName */
+    bool saveSnapshot(std::string fileName, uint64_t mapHash){
+        SnapshotWriter out;
+        spatialModel->save(out);
+        agentState->saveHistory(out);
+        return out.write(fileName, mapHash);
+    }
+
+    /*! \brief Restores what saveSnapshot wrote, if the snapshot was learned on the map with mapHash */
+    bool loadSnapshot(std::string fileName, uint64_t mapHash){
+        SnapshotReader in;
+        if(!in.open(fileName, mapHash)){
+            return false;
+        }
+        spatialModel->load(in);
+        agentState->loadHistory(in);
+        return true;
+    }
+
         
 private:
     
@@ -0,0 +1,50 @@
+/*
+ * BitGrid.h
+ *
+ * Grid of on/off cells indexed [x][y] like the vector< vector<int> > grids of the explorers, one
+ * bit per cell. Each x holds its cells along y in 64 bit words, so counts over a region work a
+ * word at a time.
+ *
+ */
+
+#ifndef BITGRID_H
+#define BITGRID_H
+
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+class BitGrid {
+public:
+  BitGrid() : length(0), height(0), words_per_x(0) {};
+  BitGrid(int l, int h, bool value = false) { assign(l, h, value); };
+
+  // Resizes to l x h cells, all set to value
+  void assign(int l, int h, bool value = false);
+
+  int getLength() const { return length; }
+  int getHeight() const { return height; }
+  bool inBounds(int x, int y) const { return x >= 0 and y >= 0 and x < length and y < height; }
+
+  bool get(int x, int y) const { return (bits[x * words_per_x + (y >> 6)] >> (y & 63)) & 1; }
+  void set(int x, int y) { bits[x * words_per_x + (y >> 6)] |= (uint64_t)1 << (y & 63); }
+  void clear(int x, int y) { bits[x * words_per_x + (y >> 6)] &= ~((uint64_t)1 << (y & 63)); }
+  void set(int x, int y, bool value) { if(value) set(x, y); else clear(x, y); }
+
+  void setAll(bool value);
+
+  // Number of set cells in x0..x1 by y0..y1, clipped to the grid
+  int count(int x0, int y0, int x1, int y1) const;
+
+private:
+  // Mask of the cells of the last word of each x that lie inside the grid
+  uint64_t lastWordMask() const;
+  static int popcount(uint64_t word);
+
+  int length, height;
+  int words_per_x;
+  vector<uint64_t> bits;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include <vector>
 #include "FORRAction.h"
 #include "Beliefs.h"
+#include "BitGrid.h"
 
 using namespace std;
 
@@ -26,13 +27,7 @@ public:
 		for(int i = 0 ; i < numRotates ; i++) rotate[i] = arrRotate[i];
 		beliefs = b;
 		skeleton_planner = s;
-		for(int i = 0; i < length; i++){
-			vector<int> col;
-			for(int j = 0; j < height; j ++){
-				col.push_back(-1);
-			}
-			visited_grid.push_back(col);
-		}
+		visited_grid.assign(length, height);
 		foundAlignmentPoint = false;
 		currentAlignmentPoint = Position(0,0,0);
 		gotToAlignmentPoint = false;
@@ -47,14 +42,7 @@ public:
 	~Circumnavigate(){};
 
 	void resetCircumnavigate(){
-		visited_grid.clear();
-		for(int i = 0; i < length; i++){
-			vector<int> col;
-			for(int j = 0; j < height; j ++){
-				col.push_back(-1);
-			}
-			visited_grid.push_back(col);
-		}
+		visited_grid.setAll(false);
 		foundAlignmentPoint = false;
 		currentAlignmentPoint = Position(0,0,0);
 		gotToAlignmentPoint = false;
@@ -79,19 +67,19 @@ public:
 			}
 		}
 		cout << "min_distance " << min_distance << endl;
-		visited_grid[(int)(new_pose.getX())][(int)(new_pose.getY())] = 1;
-		visited_grid[(int)(new_pose.getX()+min_distance)][(int)(new_pose.getY())] = 1;
-		visited_grid[(int)(new_pose.getX())][(int)(new_pose.getY()+min_distance)] = 1;
-		visited_grid[(int)(new_pose.getX()-min_distance)][(int)(new_pose.getY())] = 1;
-		visited_grid[(int)(new_pose.getX())][(int)(new_pose.getY()-min_distance)] = 1;
-		visited_grid[(int)(new_pose.getX()+min_distance)][(int)(new_pose.getY()+min_distance)] = 1;
-		visited_grid[(int)(new_pose.getX()+min_distance)][(int)(new_pose.getY()-min_distance)] = 1;
-		visited_grid[(int)(new_pose.getX()-min_distance)][(int)(new_pose.getY()+min_distance)] = 1;
-		visited_grid[(int)(new_pose.getX()-min_distance)][(int)(new_pose.getY()-min_distance)] = 1;
+		// The pose and the eight points min_distance away from it along x, y and the diagonals
+		for(int dx = -1; dx <= 1; dx++){
+			for(int dy = -1; dy <= 1; dy++){
+				int x = (int)(new_pose.getX()+dx*min_distance), y = (int)(new_pose.getY()+dy*min_distance);
+				if(visited_grid.inBounds(x, y)){
+					visited_grid.set(x, y);
+				}
+			}
+		}
 		cout << "Visited grid" << endl;
-		for(int i = 0; i < visited_grid[0].size(); i++){
-			for(int j = 0; j < visited_grid.size(); j++){
-				cout << visited_grid[j][i] << " ";
+		for(int i = 0; i < visited_grid.getHeight(); i++){
+			for(int j = 0; j < visited_grid.getLength(); j++){
+				cout << (visited_grid.get(j, i) ? 1 : -1) << " ";
 			}
 			cout << endl;
 		}
@@ -584,7 +572,7 @@ private:
 	double move[300];  
 	double rotate[300];
 	int numMoves, numRotates;
-	vector< vector<int> > visited_grid;
+	BitGrid visited_grid;
 	Beliefs *beliefs;
 	PathPlanner *skeleton_planner;
 	bool foundAlignmentPoint;
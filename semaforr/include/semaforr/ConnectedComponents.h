@@ -0,0 +1,45 @@
+/*
+ * ConnectedComponents.h
+ *
+ * Two pass union-find connected component labeling on flat row-major grids, shared by the
+ * passage and hallway learners. The first pass can be split into horizontal stripes that are
+ * joined on separate threads and then stitched along their borders.
+ *
+ */
+
+#ifndef CONNECTEDCOMPONENTS_H
+#define CONNECTEDCOMPONENTS_H
+
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+class ConnectedComponents {
+public:
+  // Neighbor offsets (row, col) that join two foreground cells. Only one of each offset and its
+  // reverse is needed, connectivity is always symmetric.
+  static vector< pair<int, int> > fourConnected();
+  static vector< pair<int, int> > eightConnected();
+
+  // Labels the foreground (nonzero) cells of a rows x cols row-major grid. Components are numbered
+  // 1..n in the order their first cell is met in a row-major scan, background cells get 0.
+  // Returns n.
+  static int label(const vector<unsigned char> &foreground, int rows, int cols, const vector< pair<int, int> > &offsets, vector<int> &labels);
+
+  // Same for a grid[row][col], where cells holding at least min_value are foreground. labels is
+  // resized to match and background cells get background_label.
+  static int labelGrid(const vector< vector<int> > &grid, int min_value, const vector< pair<int, int> > &offsets, vector< vector<int> > &labels, int background_label = 0);
+
+  // Number of stripes the first pass is split into, 1 keeps it on the calling thread
+  static void setStripes(int count);
+  static int getStripes();
+
+private:
+  static int find(vector<int> &parent, int cell);
+  static void join(vector<int> &parent, int a, int b);
+  static void joinRows(const vector<unsigned char> *foreground, int rows, int cols, const vector< pair<int, int> > *offsets, vector<int> *parent, int first_row, int last_row, int pair_first_row, int pair_last_row);
+  static int stripes;
+};
+
+#endif
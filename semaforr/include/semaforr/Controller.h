@@ -45,11 +45,29 @@ public:
   //main sense decide loop, receives the input messages and calls the FORRDecision function
   FORRAction decide();
 
+  //Scores the next decision from the pose the action being executed is expected to end at
+  void speculate(FORRAction action);
+
   FORRActionStats *getCurrentDecisionStats() { return decisionStats; }
   void clearCurrentDecisionStats() { decisionStats = new FORRActionStats();}
-
-  //Update state of the agent using sensor readings 
-  void updateState(Position current, sensor_msgs::LaserScan laserscan, geometry_msgs::PoseArray crowdpose, geometry_msgs::PoseArray crowdposeall);
+  string getDecisionLogFile() { return decisionLogFile; }
+  int getDecisionLogKeyframe() { return decisionLogKeyframe; }
+  string getDecisionInputFile() { return decisionInputFile; }
+  string getSpatialModelSnapshotFile() { return spatialModelSnapshotFile; }
+  // Saves the learned spatial model to spatialModelSnapshotFile, if one is set
+  void saveSpatialModelSnapshot();
+  // Bumped whenever the spatial model may have changed, so the decision log can skip unchanged sections
+  int getSpatialModelVersion() { return spatialModelVersion; }
+  double getVisualizationRate() { return visualizationRate; }
+  double getDiagnosticsRate() { return diagnosticsRate; }
+  string getInstrumentationSummaryFile() { return instrumentationSummaryFile; }
+  bool getEventDriven() { return eventDriven; }
+  bool getSpeculativeDecision() { return speculativeDecision; }
+  bool getSpeculativeCheck() { return speculativeCheck; }
+  double getCommandRate() { return commandRate; }
+
+  //Update state of the agent using sensor readings, the messages are shared with the agent state rather than copied
+  void updateState(Position current, const sensor_msgs::LaserScan::ConstPtr &laserscan, const geometry_msgs::PoseArray::ConstPtr &crowdpose, const geometry_msgs::PoseArray::ConstPtr &crowdposeall);
 
   //Returns the state of the robots mission (True 
   bool isMissionComplete();
@@ -62,7 +80,10 @@ public:
 
   std::vector<PathPlanner*> getPlanners() { return tier2Planners; }
 
-  void updatePlannersModels(semaforr::CrowdModel c) {
+  void updatePlannersModels(const semaforr::CrowdModel::ConstPtr &c) {
+    // The advisors see the new crowd model too, so advice scored before it arrived is stale
+    speculationValid = false;
+    crowdModelVersion++;
     for (planner2It it = tier2Planners.begin(); it != tier2Planners.end(); it++){
       PathPlanner *planner = *it;
       planner->setCrowdModel(c);
@@ -115,12 +136,22 @@ private:
   //Tier 2 planners are called here
   void tierTwoDecision(Position current, bool selectNextTask);
 
-  //Tier 3 advisors are called here
-  void tierThreeDecision(FORRAction *decision);
+  //Tier 3 advisors are called here, returns false if no advisor commented
+  bool tierThreeDecision(FORRAction *decision);
 
   //Check influence of tier 3 Advisors
   void tierThreeAdvisorInfluence();
 
+  //True when the sensing and task state match the speculation closely enough to reuse its advice
+  bool speculationMatches();
+
+  //Tier 1 action used when the deadline cuts tier 3 off before any advisor comments
+  void tierOneFallback(FORRAction *decision);
+
+  //Decision deadline bookkeeping, times are in seconds
+  double getCurrentTimeSec();
+  bool decisionDeadlinePassed();
+
   // learns the spatial model and updates the beliefs
   void learnSpatialModel(AgentState *agentState, bool taskStatus, bool earlyLearning);
   void updateSkeletonGraph(AgentState* agentState);
@@ -149,11 +180,57 @@ private:
   bool isAdvisorActive(string advisorName);
 
   double canSeePointEpsilon, laserScanRadianIncrement, robotFootPrint, robotFootPrintBuffer, maxLaserRange, maxForwardActionBuffer, maxForwardActionSweepAngle, highwayDistanceThreshold, highwayTimeThreshold, highwayDecisionThreshold;
+  // Beams in a scan, with laserScanRadianIncrement and maxLaserRange the laser layout assumed until the first scan arrives
+  int laserBeamCount;
   double arrMove[300];
   double arrRotate[300];
   int moveArrMax, rotateArrMax;
   int taskDecisionLimit;
   int planLimit;
+  // Per decision time budget (0 disables it), initial weighted A* inflation and start of the current decision
+  double decisionDeadline, anytimeWeight, decisionStartTime;
+  // Set when the deadline cut tier 3 off before every advisor was heard this decision
+  bool tierThreeCutOff;
+  // Planners that search with jump point search where their graph allows it
+  vector<string> jumpPointPlanners;
+  // Plans each planner keeps for reuse (0 disables the cache) and crowd model change counter
+  int planCacheSize, crowdModelVersion;
+  // Width (m) of the band around a plan that its waypoints may cut corners in, 0 keeps every node
+  double stringPullWidth;
+  // Binary decision log path, empty when only the decision_log topic is used
+  string decisionLogFile;
+  // Decisions between full spatial model keyframes in the decision log (0 only writes the first) and spatial model change counter
+  int decisionLogKeyframe, spatialModelVersion;
+  // Records the sensing of every decision for semaforr_replay, empty to disable
+  string decisionInputFile;
+  // Spatial model loaded at startup and rewritten after every task, empty to disable, and the hash of the map it belongs to
+  string spatialModelSnapshotFile;
+  uint64_t mapHash;
+  // Highest rate in Hz at which each visualization layer is republished (0 for no limit)
+  double visualizationRate;
+  // Rate in Hz of the stage latency and counter messages on the diagnostics topic (0 to disable), and the
+  // file the same figures are written to at the end of the run (empty to disable)
+  double diagnosticsRate;
+  string instrumentationSummaryFile;
+  // Horizontal stripes labeled on separate threads by the passage and hallway learners
+  int labelingStripes;
+  // Decide as soon as new sensor data completes an action instead of polling at 30 Hz, and the rate cmd_vel is republished at meanwhile
+  bool eventDriven;
+  double commandRate;
+  // Tier 3 advice scored from the predicted end pose while an action executes, reused by the next decision
+  // when the real pose, laser and crowd are within speculativeTolerance of the prediction
+  bool speculativeDecision, speculationValid, speculationCommitted;
+  double speculativeTolerance;
+  // Also recompute committed advice on the real sensing and count the advisors whose comments differ
+  bool speculativeCheck;
+  Task *speculativeTask;
+  int speculativeDecisionCount, speculativeModelVersion;
+  double speculativeWaypointX, speculativeWaypointY;
+  Position speculativePose;
+  sensor_msgs::LaserScan::ConstPtr speculativeScan;
+  geometry_msgs::PoseArray::ConstPtr speculativeCrowd;
+  std::map<Tier3Advisor*, bool> speculativeCommenting;
+  std::map<Tier3Advisor*, std::map<FORRAction, double> > speculativeAdvice;
   bool trailsOn;
   bool conveyorsOn;
   bool regionsOn;
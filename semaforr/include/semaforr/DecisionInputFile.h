@@ -0,0 +1,24 @@
+/*!
+ * DecisionInputFile.h
+ *
+ * Decision input recording: a record file (see RecordFile.h) of semaforr::DecisionInput
+ * tagged "SFDI", one record per decision
+ *
+ */
+#ifndef DECISIONINPUTFILE_H
+#define DECISIONINPUTFILE_H
+
+#include <semaforr/DecisionInput.h>
+#include "RecordFile.h"
+
+class DecisionInputWriter : public RecordFileWriter<semaforr::DecisionInput> {
+  public:
+    DecisionInputWriter() : RecordFileWriter<semaforr::DecisionInput>("SFDI") {};
+};
+
+class DecisionInputReader : public RecordFileReader<semaforr::DecisionInput> {
+  public:
+    DecisionInputReader() : RecordFileReader<semaforr::DecisionInput>("SFDI") {};
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*!
+ * DecisionLogFile.h
+ *
+ * Binary decision log: a record file (see RecordFile.h) of semaforr::DecisionLog
+ * tagged "SFDL", plus the helpers used to delta encode and rebuild its spatial
+ * model sections
+ *
+ */
+#ifndef DECISIONLOGFILE_H
+#define DECISIONLOGFILE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <semaforr/DecisionLog.h>
+#include "RecordFile.h"
+
+// Copies the spatial model sections selected by the sections mask from one log to another
+inline void copyDecisionLogSections(const semaforr::DecisionLog &from, semaforr::DecisionLog &to, uint8_t sections){
+  if(sections & semaforr::DecisionLog::SECTION_REGIONS){
+    to.region_circles = from.region_circles;
+    to.region_exit_offsets = from.region_exit_offsets;
+    to.region_exits = from.region_exits;
+  }
+  if(sections & semaforr::DecisionLog::SECTION_TRAILS){
+    to.trail_offsets = from.trail_offsets;
+    to.trail_points = from.trail_points;
+  }
+  if(sections & semaforr::DecisionLog::SECTION_DOORS){
+    to.door_region = from.door_region;
+    to.door_points = from.door_points;
+    to.door_strength = from.door_strength;
+  }
+  if(sections & semaforr::DecisionLog::SECTION_CONVEYORS){
+    to.conveyor_rows = from.conveyor_rows;
+    to.conveyor_cols = from.conveyor_cols;
+    to.conveyor_cells = from.conveyor_cells;
+  }
+  if(sections & semaforr::DecisionLog::SECTION_HALLWAYS){
+    to.hallway_type = from.hallway_type;
+    to.hallway_offsets = from.hallway_offsets;
+    to.hallway_points = from.hallway_points;
+  }
+  if(sections & semaforr::DecisionLog::SECTION_PASSAGES){
+    to.passage_rows = from.passage_rows;
+    to.passage_cols = from.passage_cols;
+    to.passage_cells = from.passage_cells;
+  }
+}
+
+// FNV-1a over the raw contents of a vector, used to tell whether a section changed
+template <class T>
+inline uint64_t hashDecisionLogField(const std::vector<T> &field, uint64_t hash){
+  const unsigned char *bytes = field.empty() ? NULL : (const unsigned char*)&field[0];
+  for(size_t i = 0; i < field.size() * sizeof(T); i++){
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  // Mix in the length so that moving a value between neighbouring fields changes the hash
+  return (hash ^ field.size()) * 1099511628211ULL;
+}
+
+// Hash of a single spatial model section, section is one of the SECTION_* bits
+inline uint64_t hashDecisionLogSection(const semaforr::DecisionLog &log, uint8_t section){
+  uint64_t hash = 14695981039346656037ULL;
+  switch(section){
+    case semaforr::DecisionLog::SECTION_REGIONS:
+      hash = hashDecisionLogField(log.region_circles, hash);
+      hash = hashDecisionLogField(log.region_exit_offsets, hash);
+      return hashDecisionLogField(log.region_exits, hash);
+    case semaforr::DecisionLog::SECTION_TRAILS:
+      hash = hashDecisionLogField(log.trail_offsets, hash);
+      return hashDecisionLogField(log.trail_points, hash);
+    case semaforr::DecisionLog::SECTION_DOORS:
+      hash = hashDecisionLogField(log.door_region, hash);
+      hash = hashDecisionLogField(log.door_points, hash);
+      return hashDecisionLogField(log.door_strength, hash);
+    case semaforr::DecisionLog::SECTION_CONVEYORS:
+      hash = (hash ^ log.conveyor_cols) * 1099511628211ULL;
+      return hashDecisionLogField(log.conveyor_cells, hash);
+    case semaforr::DecisionLog::SECTION_HALLWAYS:
+      hash = hashDecisionLogField(log.hallway_type, hash);
+      hash = hashDecisionLogField(log.hallway_offsets, hash);
+      return hashDecisionLogField(log.hallway_points, hash);
+    case semaforr::DecisionLog::SECTION_PASSAGES:
+      hash = (hash ^ log.passage_cols) * 1099511628211ULL;
+      return hashDecisionLogField(log.passage_cells, hash);
+  }
+  return hash;
+}
+
+// Rebuilds the full spatial model at every decision of a delta encoded log. Decisions
+// have to be applied in order, starting at the first record or at any keyframe.
+class DecisionLogReplay {
+  public:
+    DecisionLogReplay() : synced(false) {};
+
+    // Fills the sections missing from log with the last copy seen and remembers the ones it carries.
+    // Returns false while no keyframe has been seen, the spatial sections of log are then incomplete.
+    bool apply(semaforr::DecisionLog &log){
+      if(log.keyframe){
+        synced = true;
+      }
+      copyDecisionLogSections(log, state, log.sections);
+      copyDecisionLogSections(state, log, semaforr::DecisionLog::SECTION_ALL & ~log.sections);
+      return synced;
+    }
+
+    void reset() { synced = false; state = semaforr::DecisionLog(); }
+
+  private:
+    bool synced;
+    semaforr::DecisionLog state;
+};
+
+class DecisionLogWriter : public RecordFileWriter<semaforr::DecisionLog> {
+  public:
+    DecisionLogWriter() : RecordFileWriter<semaforr::DecisionLog>("SFDL") {};
+};
+
+class DecisionLogReader : public RecordFileReader<semaforr::DecisionLog> {
+  public:
+    DecisionLogReader() : RecordFileReader<semaforr::DecisionLog>("SFDL") {};
+};
+
+#endif
@@ -11,23 +11,39 @@
 #include <string>
 #include <iostream>
 #include <set>
+#include <vector>
+#include "FORRAction.h"
 
 class FORRActionStats {
 
   public:
     double decisionTier;
-    std::string vetoedActions;
-    std::string advisors;
-    std::string advisorComments;
+    // Tier 1 vetoes with the tag letter of the advisor that vetoed them
+    std::vector<FORRAction> vetoedActions;
+    std::vector<char> vetoSources;
+    // Tier 3 advisors, commentAdvisor indexes advisorNames
+    std::vector<std::string> advisorNames;
+    std::vector<double> advisorWeights;
+    std::vector<bool> advisorActive;
+    std::vector<bool> advisorCommenting;
+    std::vector<int> commentAdvisor;
+    std::vector<FORRAction> commentActions;
+    std::vector<double> commentStrengths;
     std::string advisorInfluence;
     double planningComputationTime;
     double learningComputationTime;
     double graphingComputationTime;
     std::string chosenPlanner;
-    std::string plannerComments;
+    // Tier 2 plans, planPlanner indexes plannerNames, planCosts is row-major with planCostColumns per plan
+    std::vector<std::string> plannerNames;
+    std::vector<int> planPlanner;
+    std::vector<double> planCosts;
+    int planCostColumns;
+    // Stages stopped by the decision deadline, "stage value value;" per entry
+    std::string cutoffStages;
 
-    FORRActionStats(double decTier, std::string vActions, std::string adv, std::string advComments, std::string advInfluence, double planTime, double learnTime, double graphTime, std::string chsPlan, std::string plnComments) : decisionTier(decTier), vetoedActions(vActions), advisors(adv), advisorComments(advComments), advisorInfluence(advInfluence), planningComputationTime(planTime), learningComputationTime(learnTime), graphingComputationTime(graphTime), chosenPlanner(chsPlan), plannerComments(plnComments) {};
-    FORRActionStats(): decisionTier(0), vetoedActions(" "), advisors(" "), advisorComments(" "), advisorInfluence(" "), planningComputationTime(0), learningComputationTime(0), graphingComputationTime(0), chosenPlanner(" "), plannerComments(" ") {};
+    FORRActionStats(double decTier, std::string advInfluence, double planTime, double learnTime, double graphTime, std::string chsPlan, std::string cutStages) : decisionTier(decTier), advisorInfluence(advInfluence), planningComputationTime(planTime), learningComputationTime(learnTime), graphingComputationTime(graphTime), chosenPlanner(chsPlan), planCostColumns(0), cutoffStages(cutStages) {};
+    FORRActionStats(): decisionTier(0), advisorInfluence(" "), planningComputationTime(0), learningComputationTime(0), graphingComputationTime(0), chosenPlanner(" "), planCostColumns(0), cutoffStages(" ") {};
 
 };
 
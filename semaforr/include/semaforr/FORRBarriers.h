@@ -9,6 +9,7 @@ Written by Raj Korpan, adapted from Sarah Mathew and Gil Dekel, 2018
 #define FORRBARRIERS_H
 
 #include <FORRGeometry.h>
+#include "SpatialModelSnapshot.h"
 #include <vector>
 #include <string>
 #include <math.h>
@@ -39,6 +40,35 @@ public:
         barriers.clear();
     }
 
+    void save(SnapshotWriter &out){
+        out.beginSection("BARR");
+        out.putInt(barriers.size());
+        for(int i = 0; i < barriers.size(); i++){
+            pair<CartesianPoint, CartesianPoint> endpoints = barriers[i].get_endpoints();
+            out.putPoint(endpoints.first);
+            out.putPoint(endpoints.second);
+        }
+        out.endSection();
+    }
+
+    bool load(SnapshotReader &in){
+        if(!in.section("BARR")){
+            return false;
+        }
+        vector<LineSegment> loaded;
+        int count = in.getInt();
+        for(int i = 0; i < count and in.ok(); i++){
+            CartesianPoint first = in.getPoint();
+            CartesianPoint second = in.getPoint();
+            loaded.push_back(LineSegment(first, second));
+        }
+        if(!in.ok()){
+            return false;
+        }
+        barriers = loaded;
+        return true;
+    }
+
     void updateBarriers(vector< vector<CartesianPoint> > *laser_hist, vector<CartesianPoint> pos_hist) {
         laser_history.clear();
         for(int i = 0 ; i < laser_hist->size() ; i++){
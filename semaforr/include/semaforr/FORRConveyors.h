@@ -13,6 +13,7 @@ Written by Matthew Evanusa, November 2014 , Edited by Anoop Aroor March 2017
 
 #include <FORRGeometry.h>
 #include "Position.h"
+#include "SpatialModelSnapshot.h"
 
 #include <vector>
 #include <utility>
@@ -82,6 +83,26 @@ class FORRConveyors{
   int getBoxWidth(){return boxes_width;}
   vector< vector<int> > getConveyors(){return conveyors;}
 
+  void save(SnapshotWriter &out){
+    out.beginSection("CONV");
+    out.putInt(granularity);
+    out.putIntGrid(conveyors);
+    out.endSection();
+  }
+
+  //keeps the current grid unless the saved one was made with the same granularity and size
+  bool load(SnapshotReader &in){
+    if(!in.section("CONV") or in.getInt() != granularity){
+      return false;
+    }
+    vector< vector<int> > loaded = in.getIntGrid();
+    if(!in.ok() or loaded.size() != conveyors.size() or (loaded.size() > 0 and loaded[0].size() != conveyors[0].size())){
+      return false;
+    }
+    conveyors = loaded;
+    return true;
+  }
+
   private:
   	//the grid overlay itself that stores the counter of frequented points along cleaned paths
   	vector< vector<int> > conveyors;
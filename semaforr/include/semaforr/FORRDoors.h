@@ -77,6 +77,45 @@ public:
     void setDoors(std::vector< std::vector<Door> > doors_para) { doors = doors_para; }
     ~FORRDoors(){};
 
+    void save(SnapshotWriter &out){
+        out.beginSection("DOOR");
+        out.putInt(doors.size());
+        for(int i = 0; i < doors.size(); i++){
+            out.putInt(doors[i].size());
+            for(int j = 0; j < doors[i].size(); j++){
+                doors[i][j].startPoint.save(out);
+                doors[i][j].endPoint.save(out);
+                out.putInt(doors[i][j].str);
+            }
+        }
+        out.endSection();
+    }
+
+    bool load(SnapshotReader &in){
+        if(!in.section("DOOR")){
+            return false;
+        }
+        std::vector< std::vector<Door> > loaded;
+        int count = in.getInt();
+        for(int i = 0; i < count and in.ok(); i++){
+            std::vector<Door> region_doors;
+            int region_count = in.getInt();
+            for(int j = 0; j < region_count and in.ok(); j++){
+                Door door;
+                door.startPoint.load(in);
+                door.endPoint.load(in);
+                door.str = in.getInt();
+                region_doors.push_back(door);
+            }
+            loaded.push_back(region_doors);
+        }
+        if(!in.ok()){
+            return false;
+        }
+        doors = loaded;
+        return true;
+    }
+
     void clearAllDoors(){
         doors.clear();
     }
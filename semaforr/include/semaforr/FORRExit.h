@@ -11,6 +11,7 @@ Written by Anoop Aroor, 2014
 #include <iostream>
 #include <FORRGeometry.h>
 #include <FORRRegion.h>
+#include <SpatialModelSnapshot.h>
 
 class FORRExit{
  public:
@@ -56,6 +57,26 @@ class FORRExit{
   void setConnectionPoints(vector<CartesianPoint> cp){ connectionPoints = cp;}
   vector<CartesianPoint> getConnectionPoints(){ return connectionPoints; }
 
+  void save(SnapshotWriter &out){
+    out.putPoint(exitPoint);
+    out.putPoint(middlePoint);
+    out.putPoint(exitRegionPoint);
+    out.putInt(exitRegion);
+    out.putDouble(exitDistance);
+    out.putInt(connectionPath);
+    out.putPoints(connectionPoints);
+  }
+
+  void load(SnapshotReader &in){
+    exitPoint = in.getPoint();
+    middlePoint = in.getPoint();
+    exitRegionPoint = in.getPoint();
+    exitRegion = in.getInt();
+    exitDistance = in.getDouble();
+    connectionPath = in.getInt();
+    connectionPoints = in.getPoints();
+  }
+
   bool operator < (const FORRExit &exit) const{
     return false;
   }
@@ -28,6 +28,10 @@
 // we are comfortable with
 #define ERROR 0.01
 
+// is_point_in_segment calls the C abs(int), so its triangle difference is
+// truncated to int and anything strictly inside (-1, 1) counts as on the segment
+#define POINT_IN_SEGMENT_TOLERANCE 1.0
+
 using std::pair;
 
 // forward declaration of this class
@@ -209,6 +213,9 @@ class LineSegment: public Line{
   CartesianPoint end_point_2;
 };
 
+// canAccessPoint for a caller that already knows which beam of the scan points closest to point
+bool canAccessPoint(const std::vector<CartesianPoint> &givenLaserEndpoints, CartesianPoint laserPos, CartesianPoint point, double distanceLimit, int nearest_beam);
+
 
 
 /***********************************************************************
@@ -275,4 +282,47 @@ class Circle{
 };
 
 
+
+/***********************************************************************
+                    Class SegmentSet
+ - many segments stored as structure of arrays, so one query segment or
+   point can be tested against all of them a few at a time with SIMD
+ - uses AVX2 when compiled for it, SSE2 otherwise, scalar loop as fallback
+***********************************************************************/
+class SegmentSet{
+ public:
+  /********************************************************************
+                          Constructors
+  ********************************************************************/
+  SegmentSet(){};
+  // fan of segments from origin to each endpoint, e.g. the laser beams of a scan
+  SegmentSet(CartesianPoint origin, const std::vector<CartesianPoint>& endpoints);
+
+  /********************************************************************
+                     accessors and mutators
+  *********************************************************************/
+  void add(CartesianPoint first, CartesianPoint second);
+  void clear();
+  int size() const { return x1.size(); }
+
+  /********************************************************************
+                     batched queries
+  *********************************************************************/
+  // index of the first segment for which do_intersect(segment, query, point) is true, -1 if none
+  int first_intersecting(LineSegment query) const;
+
+  // distance from point to the closest segment, projection clamped to the segment ends,
+  // infinity for an empty set
+  double min_distance(CartesianPoint point) const;
+
+  /********************************************************************
+                       data members
+  *********************************************************************/
+ private:
+  std::vector<double> x1, y1, x2, y2;
+  // line coefficients and length as LineSegment computes them
+  std::vector<double> a, b, c, length;
+};
+
+
 #endif
@@ -11,6 +11,7 @@ Written by Raj Korpan, adapted from Sarah Mathew and Gil Dekel, 2018
 #include <AgentState.h>
 #include <FORRGeometry.h>
 #include <Aggregate.h>
+#include <SpatialModelSnapshot.h>
 #include <vector>
 #include <string>
 #include <math.h>
@@ -151,6 +152,71 @@ public:
         hallways.clear();
     }
 
+    // Saves the learned hallways and everything learnHallways adds to on the next task
+    void save(SnapshotWriter &out){
+        out.beginSection("HALL");
+        out.putInt(hallways.size());
+        for(int i = 0; i < hallways.size(); i++){
+          out.putPoints(hallways[i].getPoints());
+          out.putInt(hallways[i].getHallwayType());
+          out.putInts(hallways[i].getConnections());
+        }
+        out.putPoints(trails_coordinates);
+        out.putPointLists(laser_history);
+        out.putInt(hallway_sections.size());
+        for(int i = 0; i < hallway_sections.size(); i++){
+          out.putInt(hallway_sections[i].size());
+          for(int j = 0; j < hallway_sections[i].size(); j++){
+            out.putPoint(hallway_sections[i][j].GetLeftPoint());
+            out.putPoint(hallway_sections[i][j].GetRightPoint());
+            out.putPoints(hallway_sections[i][j].GetLeftLaser());
+            out.putPoints(hallway_sections[i][j].GetRightLaser());
+          }
+        }
+        out.endSection();
+    }
+
+    bool load(SnapshotReader &in){
+        if(!in.section("HALL")){
+          return false;
+        }
+        vector<Aggregate> loaded;
+        int count = in.getInt();
+        for(int i = 0; i < count and in.ok(); i++){
+          vector<CartesianPoint> points = in.getPoints();
+          int type = in.getInt();
+          vector<int> connections = in.getInts();
+          loaded.push_back(Aggregate(points, type));
+          for(int j = 0; j < connections.size(); j++){
+            loaded.back().addConnection(connections[j]);
+          }
+        }
+        vector<CartesianPoint> loaded_coordinates = in.getPoints();
+        vector<vector<CartesianPoint> > loaded_lasers = in.getPointLists();
+        vector<vector<Segment> > loaded_sections;
+        int sections = in.getInt();
+        for(int i = 0; i < sections and in.ok(); i++){
+          vector<Segment> section;
+          int segments = in.getInt();
+          for(int j = 0; j < segments and in.ok(); j++){
+            CartesianPoint left = in.getPoint();
+            CartesianPoint right = in.getPoint();
+            vector<CartesianPoint> left_laser = in.getPoints();
+            vector<CartesianPoint> right_laser = in.getPoints();
+            section.push_back(Segment(left, right, left_laser, right_laser, step));
+          }
+          loaded_sections.push_back(section);
+        }
+        if(!in.ok() or loaded_sections.size() != hallway_sections.size()){
+          return false;
+        }
+        hallways = loaded;
+        trails_coordinates = loaded_coordinates;
+        laser_history = loaded_lasers;
+        hallway_sections = loaded_sections;
+        return true;
+    }
+
     void learnHallways(AgentState *agentState, vector<CartesianPoint> trails_trace, vector< vector<CartesianPoint> > *laser_hist) {
         vector<CartesianPoint> new_trails_coordinates;
         vector<vector<CartesianPoint> > new_laser_history;
@@ -321,8 +387,6 @@ private:
     void Interpolate(vector<vector<double> > &frequency_map,double left_x, double left_y, double right_x, double right_y);
     void BinarizeImage(vector<vector<int> > &binarized,const vector<vector<double> > &original,  double threshold);
     //void ConvertMatrixToImage(const vector<vector<int> > &binary_map, string image_name);
-    void doUnion(int x, int y, int x2, int y2, vector<vector<int> > &labeled_image);
-    void unionCoords(int x, int y, int x2, int y2, const vector<vector<int> > &binary_map, vector<vector<int> > &labeled_image);
     void LabelImage(const vector<vector<int> > &binary_map, vector<vector<int> > &labeled_image);
     void ListGroups(vector<vector< pair<int,int> > > &aggregates_and_points, const vector<vector<int> > &labeled_image);
     void ConvertPairToCartesianPoint(vector<vector<CartesianPoint> > &trails, const vector<vector< pair<int,int> > > &input);
@@ -16,6 +16,7 @@ Written by Raj Korpan, 2020
 #include <utility>      //for exit
 #include <algorithm>
 #include "FORRGeometry.h"
+#include "ConnectedComponents.h"
 
 /* FORRPassages class
  *
@@ -53,158 +54,22 @@ public:
 
     void learnPassages(vector<CartesianPoint> stepped_history, vector < vector<CartesianPoint> > stepped_laser_history) {
         int min_passage_length = 7;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j ++){
-            col.push_back(0);
+        int rows = highway_grid.size();
+        int cols = highway_grid[0].size();
+        addSteps(stepped_history);
+        vector< vector<int> > passage_grid(rows, vector<int>(cols, -1));
+        for(int i = 0; i < rows; i++){
+          for(int j = 0; j < cols; j++){
+            passage_grid[i][j] = passageCellValue(i, j);
           }
-          decisions_grid.push_back(col);
         }
-        // for(int i = 0; i < highway_grid.size(); i++){
-        //   vector<int> col;
-        //   for(int j = 0; j < highway_grid[i].size(); j ++){
-        //     col.push_back(0);
-        //   }
-        //   decisions_only_grid.push_back(col);
-        // }
-        // vector< vector< vector<int> > > laser_grid_connections;
-        // for(int i = 0; i < highway_grid.size(); i++){
-        //   vector< vector<int> > col_connect;
-        //   for(int j = 0; j < highway_grid[i].size(); j ++){
-        //     vector<int> connections;
-        //     connections.push_back(0);
-        //     connections.push_back(0);
-        //     connections.push_back(0);
-        //     connections.push_back(0);
-        //     connections.push_back(0);
-        //     connections.push_back(0);
-        //     connections.push_back(0);
-        //     connections.push_back(0);
-        //     col_connect.push_back(connections); // N Incoming, S Incoming, E Incoming, W Incoming, N Outgoing, S Outgoing, E Outgoing, W Outgoing
-        //   }
-        //   laser_grid_connections.push_back(col_connect);
-        // }
-        double step_length = 1;
-        for(int k = 0; k < stepped_history.size()-1 ; k++){
-          double start_x = stepped_history[k].get_x();
-          if(int(start_x) < 0)
-            start_x = 0;
-          if(int(start_x) >= decisions_grid.size())
-            start_x = decisions_grid.size()-1;
-          double start_y = stepped_history[k].get_y();
-          if(int(start_y) < 0)
-            start_y = 0;
-          if(int(start_y) >= decisions_grid[0].size())
-            start_y = decisions_grid[0].size()-1;
-          double end_x = stepped_history[k+1].get_x();
-          if(int(end_x) < 0)
-            end_x = 0;
-          if(int(end_x) >= decisions_grid.size())
-            end_x = decisions_grid.size()-1;
-          double end_y = stepped_history[k+1].get_y();
-          if(int(end_y) < 0)
-            end_y = 0;
-          if(int(end_y) >= decisions_grid[0].size())
-            end_y = decisions_grid[0].size()-1;
-          decisions_grid[int(start_x)][int(start_y)] = 1;
-          decisions_grid[int(end_x)][int(end_y)] = 1;
-          // decisions_only_grid[int(start_x)][int(start_y)] = 1;
-          // decisions_only_grid[int(end_x)][int(end_y)] = 1;
-          // decisions_grid[floor(start_y)][floor(start_x)] = 1;
-          // decisions_grid[floor(end_y)][floor(end_x)] = 1;
-          // decisions_grid[ceil(start_y)][ceil(start_x)] = 1;
-          // decisions_grid[ceil(end_y)][ceil(end_x)] = 1;
-          // decisions_grid[floor(start_y)][ceil(start_x)] = 1;
-          // decisions_grid[floor(end_y)][ceil(end_x)] = 1;
-          // decisions_grid[ceil(start_y)][floor(start_x)] = 1;
-          // decisions_grid[ceil(end_y)][floor(end_x)] = 1;
-          // vector< vector< vector<int> > > decision_laser_grid_connections;
-          // for(int i = 0; i < highway_grid.size(); i++){
-          //   vector< vector<int> > col_connect;
-          //   for(int j = 0; j < highway_grid[i].size(); j ++){
-          //     vector<int> connections;
-          //     connections.push_back(0);
-          //     connections.push_back(0);
-          //     connections.push_back(0);
-          //     connections.push_back(0);
-          //     connections.push_back(0);
-          //     connections.push_back(0);
-          //     connections.push_back(0);
-          //     connections.push_back(0);
-          //     col_connect.push_back(connections); // N Incoming, S Incoming, E Incoming, W Incoming, N Outgoing, S Outgoing, E Outgoing, W Outgoing
-          //   }
-          //   decision_laser_grid_connections.push_back(col_connect);
-          // }
-          double length = sqrt((start_x - end_x) * (start_x - end_x) + (start_y - end_y) * (start_y - end_y));
-          // cout << k << " " << start_x << " " << start_y << " " << end_x << " " << end_y << " length " << length << endl;
-          if(length >= step_length or int(start_x) != int(end_x) or int(start_y) != int(end_y)){
-            double step_size = step_length / length;
-            if(step_size > 0.1){
-              step_size = 0.1;
-            }
-            double tx, ty;
-            // cout << "step_size " << step_size << endl;
-            for(double j = 0; j <= 1; j += step_size){
-              tx = (end_x * j) + (start_x * (1 - j));
-              ty = (end_y * j) + (start_y * (1 - j));
-              if(int(tx) >= 0 and int(ty) >= 0 and int(tx) < decisions_grid.size() and int(ty) < decisions_grid[0].size()){
-                // cout << tx << " " << ty << endl;
-                decisions_grid[int(tx)][int(ty)] = 1;
-                // decisions_only_grid[int(tx)][int(ty)] = 1;
-                // if(int(start_x) > int(end_x) and int(start_y) == int(end_y)){
-                //   if(int(tx) != int(start_x)){
-                //     // cout << "update 2" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][2] = 1;
-                //   }
-                //   if(int(tx) != int(end_x)){
-                //     // cout << "update 7" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][7] = 1;
-                //   }
-                // }
-                // else if(int(start_x) == int(end_x) and int(start_y) > int(end_y)){
-                //   if(int(ty) != int(start_y)){
-                //     // cout << "update 0" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][0] = 1;
-                //   }
-                //   if(int(ty) != int(end_y)){
-                //     // cout << "update 5" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][5] = 1;
-                //   }
-                // }
-                // else if(int(start_x) < int(end_x) and int(start_y) == int(end_y)){
-                //   if(int(tx) != int(start_x)){
-                //     // cout << "update 3" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][3] = 1;
-                //   }
-                //   if(int(tx) != int(end_x)){
-                //     // cout << "update 6" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][6] = 1;
-                //   }
-                // }
-                // else if(int(start_x) == int(end_x) and int(start_y) < int(end_y)){
-                //   if(int(ty) != int(start_y)){
-                //     // cout << "update 1" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][1] = 1;
-                //   }
-                //   if(int(ty) != int(end_y)){
-                //     // cout << "update 4" << endl;
-                //     decision_laser_grid_connections[int(tx)][int(ty)][4] = 1;
-                //   }
-                // }
-              }
-              // decisions_grid[floor(ty)][floor(tx)] = 1
-              // decisions_grid[ceil(ty)][ceil(tx)] = 1
-              // decisions_grid[floor(ty)][ceil(tx)] = 1
-              // decisions_grid[ceil(ty)][floor(tx)] = 1
-            }
-          }
-          // for(int i = 0; i < decision_laser_grid_connections.size(); i++){
-          //   for(int j = 0; j < decision_laser_grid_connections[0].size(); j ++){
-          //     for(int l = 0; l < decision_laser_grid_connections[0][0].size(); l++){
-          //       laser_grid_connections[i][j][l] += decision_laser_grid_connections[i][j][l];
-          //     }
-          //   }
-          // }
+        vector< vector<int> > horizontal_passages_filled(rows, vector<int>(cols, -1));
+        for(int i = 0; i < rows; i++){
+          fillHorizontalRuns(passage_grid, i, min_passage_length, horizontal_passages_filled);
+        }
+        vector< vector<int> > vertical_passages_filled(rows, vector<int>(cols, -1));
+        for(int j = 0; j < cols; j++){
+          fillVerticalRuns(passage_grid, j, min_passage_length, vertical_passages_filled);
         }
         // cout << "After decisions_grid" << endl;
         // for(int i = 0; i < decisions_grid.size(); i++){
@@ -430,101 +295,6 @@ public:
         //   }
         //   // cout << endl;
         // }
-        vector< vector<int> > passage_grid;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j ++){
-            // if(highway_grid[i][j] < 0){
-            //   vector<int> values;
-            //   if(i > 0){
-            //     if(highway_grid[i-1][j] >= 0)
-            //       values.push_back(highway_grid[i-1][j]);
-            //   }
-            //   if(j > 0){
-            //     if(highway_grid[i][j-1] >= 0)
-            //       values.push_back(highway_grid[i][j-1]);
-            //   }
-            //   if(i < highway_grid.size()-1){
-            //     if(highway_grid[i+1][j] >= 0)
-            //       values.push_back(highway_grid[i+1][j]);
-            //   }
-            //   if(j < highway_grid[0].size()-1){
-            //     if(highway_grid[i][j+1] >= 0)
-            //       values.push_back(highway_grid[i][j+1]);
-            //   }
-            //   if(values.size() >= 3){
-            //     col.push_back(1);
-            //   }
-            //   else if(decisions_grid[i][j] > 0){
-            //     col.push_back(1);
-            //   }
-            //   else{
-            //     col.push_back(-1);
-            //   }
-            // }
-            // else{
-            //   col.push_back(highway_grid[i][j]);
-            // }
-            if(decisions_grid[i][j] > 0){
-              col.push_back(1);
-            }
-            // else if(highway_grid[i][j] >= 0){
-            //   vector<int> values;
-            //   if(i > 0){
-            //     if(decisions_grid[i-1][j] > 0)
-            //       values.push_back(1);
-            //   }
-            //   if(j > 0){
-            //     if(decisions_grid[i][j-1] > 0)
-            //       values.push_back(1);
-            //   }
-            //   if(i < highway_grid.size()-1){
-            //     if(decisions_grid[i+1][j] > 0)
-            //       values.push_back(1);
-            //   }
-            //   if(j < highway_grid[0].size()-1){
-            //     if(decisions_grid[i][j+1] > 0)
-            //       values.push_back(1);
-            //   }
-            //   if(values.size() >= 2){
-            //     col.push_back(1);
-            //   }
-            //   else{
-            //     col.push_back(-1);
-            //   }
-            // }
-            else if(decisions_grid[i][j] == 0){
-              vector<int> values;
-              if(i > 0){
-                if(decisions_grid[i-1][j] > 0)
-                  values.push_back(1);
-              }
-              if(j > 0){
-                if(decisions_grid[i][j-1] > 0)
-                  values.push_back(1);
-              }
-              if(i < highway_grid.size()-1){
-                if(decisions_grid[i+1][j] > 0)
-                  values.push_back(1);
-              }
-              if(j < highway_grid[0].size()-1){
-                if(decisions_grid[i][j+1] > 0)
-                  values.push_back(1);
-              }
-              // if(values.size() >= 3 and ((laser_grid_connections[i][j][0] > 1 and laser_grid_connections[i][j][5] > 1 and laser_grid_connections[i][j][1] > 1 and laser_grid_connections[i][j][4] > 1) or (laser_grid_connections[i][j][2] > 1 and laser_grid_connections[i][j][7] > 1 and laser_grid_connections[i][j][3] > 1 and laser_grid_connections[i][j][6] > 1))){
-              if(values.size() >= 3){
-                col.push_back(1);
-              }
-              else{
-                col.push_back(-1);
-              }
-            }
-            else{
-              col.push_back(-1);
-            }
-          }
-          passage_grid.push_back(col);
-        }
         // cout << "After passage_grid" << endl;
         // for(int i = 0; i < passage_grid.size(); i++){
         //   for(int j = 0; j < passage_grid[0].size(); j++){
@@ -617,52 +387,6 @@ public:
         //   }
         //   cout << endl;
         // }
-        vector < vector < pair<int, int> > > horizontals;
-        vector < vector <int> > horizontal_lengths;
-        for(int i = 0; i < passage_grid.size(); i++){
-          vector < pair<int, int> > row;
-          vector <int> row_lengths;
-          int start = -1;
-          int stop = -1;
-          for(int j = 0; j < passage_grid[i].size(); j++){
-            if(passage_grid[i][j] >= 0 and start == -1){
-              start = j;
-              stop = j;
-            }
-            else if(passage_grid[i][j] >= 0 and start > -1){
-              stop = j;
-            }
-            else if(passage_grid[i][j] < 0 and start > -1 and stop > -1){
-              // cout << "row " << i << " start " << start << " stop " << stop << " length " << stop-start+1 << endl;
-              row.push_back(make_pair(start, stop));
-              row_lengths.push_back(stop-start+1);
-              start = -1;
-              stop = -1;
-            }
-          }
-          horizontals.push_back(row);
-          horizontal_lengths.push_back(row_lengths);
-        }
-        vector< vector<int> > horizontal_passages;
-        vector< vector<int> > horizontal_passages_filled;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j++){
-            col.push_back(-1);
-          }
-          horizontal_passages.push_back(col);
-          horizontal_passages_filled.push_back(col);
-        }
-        for(int i = 0; i < horizontals.size(); i++){
-          for(int j = 0; j < horizontals[i].size(); j++){
-            if(horizontal_lengths[i][j] >= min_passage_length){
-              for(int k = horizontals[i][j].first; k <= horizontals[i][j].second; k++){
-                horizontal_passages[i][k] = 1;
-                horizontal_passages_filled[i][k] = 1;
-              }
-            }
-          }
-        }
         // cout << "After horizontal_passages" << endl;
         // for(int i = 0; i < horizontal_passages.size(); i++){
         //   for(int j = 0; j < horizontal_passages[0].size(); j++){
@@ -698,45 +422,8 @@ public:
         //   }
         //   cout << endl;
         // }
-        vector<int> dx;
-        dx.push_back(1);
-        dx.push_back(0);
-        dx.push_back(-1);
-        dx.push_back(0);
-        // dx.push_back(1);
-        // dx.push_back(1);
-        // dx.push_back(-1);
-        // dx.push_back(-1);
-        vector<int> dy;
-        dy.push_back(0);
-        dy.push_back(1);
-        dy.push_back(0);
-        dy.push_back(-1);
-        // dy.push_back(1);
-        // dy.push_back(-1);
-        // dy.push_back(1);
-        // dy.push_back(-1);
-
-        // const int dx[] = {+1, 0, -1, 0, +1, +1, -1, -1};
-        // const int dy[] = {0, +1, 0, -1, +1, -1, +1, -1};
-        int row_count = horizontal_passages_filled.size();
-        int col_count = horizontal_passages_filled[0].size();
         vector< vector<int> > final_horizontal;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j++){
-            col.push_back(0);
-          }
-          final_horizontal.push_back(col);
-        }
-        int horizontal_component = 0;
-        for(int i = 0; i < row_count; ++i){
-          for(int j = 0; j < col_count; ++j){
-            if(final_horizontal[i][j] == 0 && horizontal_passages_filled[i][j] >= 0){
-              agentState->dfs(i, j, ++horizontal_component, dx, dy, row_count, col_count, &final_horizontal, &horizontal_passages_filled);
-            }
-          }
-        }
+        int horizontal_component = ConnectedComponents::labelGrid(horizontal_passages_filled, 0, ConnectedComponents::fourConnected(), final_horizontal);
         // cout << "final horizontal_component " << horizontal_component << endl;
         // cout << "After final_horizontal" << endl;
         // for(int i = 0; i < final_horizontal.size(); i++){
@@ -753,24 +440,22 @@ public:
         //   }
         // }
         vector < vector<int> > horizontal_ends;
-        for(int i = 1; i <= horizontal_component; i++){
-          // cout << "horizontal_component " << i << endl;
-          int right = -1;
-          int left = final_horizontal[0].size();
-          // cout << right << " " << left << endl;
-          for(int j = 0; j < final_horizontal.size(); j++){
-            for(int k = 0; k < final_horizontal[j].size(); k++){
-              if(final_horizontal[j][k] == i){
-                if(k > right){
-                  right = k;
-                }
-                if(k < left){
-                  left = k;
-                }
-                // cout << right << " " << left << endl;
-              }
+        // Leftmost and rightmost column of every component, in one pass over the grid
+        vector<int> rights(horizontal_component+1, -1);
+        vector<int> lefts(horizontal_component+1, final_horizontal[0].size());
+        for(int j = 0; j < final_horizontal.size(); j++){
+          for(int k = 0; k < final_horizontal[j].size(); k++){
+            int component = final_horizontal[j][k];
+            if(component > 0){
+              rights[component] = max(rights[component], k);
+              lefts[component] = min(lefts[component], k);
             }
           }
+        }
+        for(int i = 1; i <= horizontal_component; i++){
+          // cout << "horizontal_component " << i << endl;
+          int right = rights[i];
+          int left = lefts[i];
           for(int j = 0; j < final_horizontal.size(); j++){
             if(final_horizontal[j][right] == i){
               vector<int> point;
@@ -820,53 +505,6 @@ public:
         //   }
         // }
         // cout << "After horizontal_unconnected " << horizontal_unconnected.size() << endl;
-        vector < vector < pair<int, int> > > verticals;
-        vector < vector <int> > vertical_lengths;
-        for(int j = 0; j < passage_grid[0].size(); j++){
-          vector < pair<int, int> > col;
-          vector <int> col_lengths;
-          int start = -1;
-          int stop = -1;
-          for(int i = 0; i < passage_grid.size(); i++){
-            if(passage_grid[i][j] >= 0 and start == -1){
-              start = i;
-              stop = i;
-            }
-            else if(passage_grid[i][j] >= 0 and start > -1){
-              stop = i;
-            }
-            else if(passage_grid[i][j] < 0 and start > -1 and stop > -1){
-              // cout << "col " << i << " start " << start << " stop " << stop << " length " << stop-start+1 << endl;
-              col.push_back(make_pair(start, stop));
-              col_lengths.push_back(stop-start+1);
-              start = -1;
-              stop = -1;
-            }
-          }
-          verticals.push_back(col);
-          vertical_lengths.push_back(col_lengths);
-        }
-        vector< vector<int> > vertical_passages;
-        vector< vector<int> > vertical_passages_filled;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j++){
-            col.push_back(-1);
-          }
-          vertical_passages.push_back(col);
-          vertical_passages_filled.push_back(col);
-        }
-
-        for(int i = 0; i < verticals.size(); i++){
-          for(int j = 0; j < verticals[i].size(); j++){
-            if(vertical_lengths[i][j] >= min_passage_length){
-              for(int k = verticals[i][j].first; k <= verticals[i][j].second; k++){
-                vertical_passages[k][i] = 1;
-                vertical_passages_filled[k][i] = 1;
-              }
-            }
-          }
-        }
         // cout << "After vertical_passages" << endl;
         // for(int i = 0; i < vertical_passages.size(); i++){
         //   for(int j = 0; j < vertical_passages[0].size(); j++){
@@ -902,24 +540,8 @@ public:
         //   }
         //   cout << endl;
         // }
-        row_count = vertical_passages_filled.size();
-        col_count = vertical_passages_filled[0].size();
         vector< vector<int> > final_vertical;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j++){
-            col.push_back(0);
-          }
-          final_vertical.push_back(col);
-        }
-        int vertical_component = 0;
-        for(int i = 0; i < row_count; ++i){
-          for(int j = 0; j < col_count; ++j){
-            if(final_vertical[i][j] == 0 && vertical_passages_filled[i][j] >= 0){
-              agentState->dfs(i, j, ++vertical_component, dx, dy, row_count, col_count, &final_vertical, &vertical_passages_filled);
-            }
-          }
-        }
+        int vertical_component = ConnectedComponents::labelGrid(vertical_passages_filled, 0, ConnectedComponents::fourConnected(), final_vertical);
         // cout << "final vertical_component " << vertical_component << endl;
         // cout << "After final_vertical" << endl;
         // for(int i = 0; i < final_vertical.size(); i++){
@@ -936,24 +558,22 @@ public:
         //   }
         // }
         vector < vector<int> > vertical_ends;
-        for(int i = 1; i <= vertical_component; i++){
-          // cout << "vertical_component " << i << endl;
-          int bottom = -1;
-          int top = final_vertical[0].size();
-          // cout << bottom << " " << top << endl;
-          for(int j = 0; j < final_vertical.size(); j++){
-            for(int k = 0; k < final_vertical[j].size(); k++){
-              if(final_vertical[j][k] == i){
-                if(j > bottom){
-                  bottom = j;
-                }
-                if(j < top){
-                  top = j;
-                }
-                // cout << bottom << " " << top << endl;
-              }
+        // Lowest and highest row of every component, in one pass over the grid
+        vector<int> bottoms(vertical_component+1, -1);
+        vector<int> tops(vertical_component+1, final_vertical[0].size());
+        for(int j = 0; j < final_vertical.size(); j++){
+          for(int k = 0; k < final_vertical[j].size(); k++){
+            int component = final_vertical[j][k];
+            if(component > 0){
+              bottoms[component] = max(bottoms[component], j);
+              tops[component] = min(tops[component], j);
             }
           }
+        }
+        for(int i = 1; i <= vertical_component; i++){
+          // cout << "vertical_component " << i << endl;
+          int bottom = bottoms[i];
+          int top = tops[i];
           for(int k = 0; k < final_vertical[0].size(); k++){
             if(final_vertical[bottom][k] == i){
               vector<int> point;
@@ -1059,24 +679,8 @@ public:
         // dy.push_back(1);
         // dy.push_back(0);
         // dy.push_back(-1);
-        row_count = final_combined.size();
-        col_count = final_combined[0].size();
         vector< vector<int> > intersections;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j++){
-            col.push_back(0);
-          }
-          intersections.push_back(col);
-        }
-        int intersection_component = 0;
-        for(int i = 0; i < row_count; ++i){
-          for(int j = 0; j < col_count; ++j){
-            if(intersections[i][j] == 0 && final_combined[i][j] >= 0){
-              agentState->dfs(i, j, ++intersection_component, dx, dy, row_count, col_count, &intersections, &final_combined);
-            }
-          }
-        }
+        int intersection_component = ConnectedComponents::labelGrid(final_combined, 0, ConnectedComponents::fourConnected(), intersections);
         // cout << "final intersection_component " << intersection_component << endl;
         // cout << "After intersections" << endl;
         // for(int i = 0; i < intersections.size(); i++){
@@ -1106,24 +710,8 @@ public:
         //   }
         //   cout << endl;
         // }
-        row_count = passages_without_intersections.size();
-        col_count = passages_without_intersections[0].size();
         vector< vector<int> > pass_wo_int;
-        for(int i = 0; i < highway_grid.size(); i++){
-          vector<int> col;
-          for(int j = 0; j < highway_grid[i].size(); j++){
-            col.push_back(0);
-          }
-          pass_wo_int.push_back(col);
-        }
-        int passage_component = 0;
-        for(int i = 0; i < row_count; ++i){
-          for(int j = 0; j < col_count; ++j){
-            if(pass_wo_int[i][j] == 0 && passages_without_intersections[i][j] >= 0){
-              agentState->dfs(i, j, ++passage_component, dx, dy, row_count, col_count, &pass_wo_int, &passages_without_intersections);
-            }
-          }
-        }
+        int passage_component = ConnectedComponents::labelGrid(passages_without_intersections, 0, ConnectedComponents::fourConnected(), pass_wo_int);
         // cout << "final passage_component " << passage_component << endl;
         // cout << "After pass_wo_int" << endl;
         // for(int i = 0; i < pass_wo_int.size(); i++){
@@ -1276,13 +864,11 @@ public:
         //   cout << graph[i][0] << " " << graph[i][1] << " " << graph[i][2] << endl;
         // }
         // cout << "one_sided_edges " << one_sided_edges.size() << endl;
-        for(int i = 0; i < one_sided_edges.size(); i++){
-          // cout << one_sided_edges[i] << endl;
-          for(int j = 0; j < intersections.size(); j++){
-            for(int k = 0; k < intersections[0].size(); k++){
-              if(intersections[j][k] == one_sided_edges[i]){
-                intersections[j][k] = 0;
-              }
+        set<int> one_sided(one_sided_edges.begin(), one_sided_edges.end());
+        for(int j = 0; j < intersections.size(); j++){
+          for(int k = 0; k < intersections[0].size(); k++){
+            if(one_sided.find(intersections[j][k]) != one_sided.end()){
+              intersections[j][k] = 0;
             }
           }
         }
@@ -1416,42 +1002,41 @@ public:
         // }
 
         // cout << "before missing_labels" << endl;
-        vector<int> missing_labels;
-        for(int i = 1; i <= max_component; i++){
-          bool found = false;
-          for(int j = 0; j < intersections.size(); j++){
-            for(int k = 0; k < intersections[0].size(); k++){
-              if(intersections[j][k] == i){
-                found = true;
-                break;
-              }
-            }
-            if(found == true){
-              break;
+        vector<bool> label_found(max_component+1, false);
+        for(int j = 0; j < intersections.size(); j++){
+          for(int k = 0; k < intersections[0].size(); k++){
+            if(intersections[j][k] > 0 and intersections[j][k] <= max_component){
+              label_found[intersections[j][k]] = true;
             }
           }
-          if(found == false){
+        }
+        vector<int> missing_labels;
+        for(int i = 1; i <= max_component; i++){
+          if(label_found[i] == false){
             // cout << "missing " << i << endl;
             missing_labels.push_back(i);
           }
         }
         // cout << "missing_labels " << missing_labels.size() << " new_ind " << new_ind << endl;
         if(missing_labels.size() > 0){
-          for(int i = missing_labels.size()-1; i >= 0; i--){
-            int current_ind = missing_labels[i];
-            // cout << "current_ind " << current_ind << endl;
-            for(int j = 0; j < intersections.size(); j++){
-              for(int k = 0; k < intersections[0].size(); k++){
-                if(intersections[j][k] > current_ind){
-                  intersections[j][k] = intersections[j][k] - 1;
-                }
+          // Close the gaps, every label moves down by the number of missing labels below it
+          vector<int> renumbered(max_component+1, 0);
+          int missing_below = 0;
+          for(int i = 1; i <= max_component; i++){
+            if(label_found[i] == false){
+              missing_below++;
+            }
+            renumbered[i] = i - missing_below;
+          }
+          for(int j = 0; j < intersections.size(); j++){
+            for(int k = 0; k < intersections[0].size(); k++){
+              if(intersections[j][k] > 0 and intersections[j][k] <= max_component){
+                intersections[j][k] = renumbered[intersections[j][k]];
               }
             }
-            if(current_ind <= new_ind){
-              new_ind = new_ind - 1;
-            }
-            max_component = max_component - 1;
           }
+          new_ind = renumbered[new_ind];
+          max_component = max_component - missing_labels.size();
           // cout << "new_ind " << new_ind << endl;
           // cout << "After fixed missing_labels" << endl;
           // for(int i = 0; i < intersections.size(); i++){
@@ -1660,32 +1245,17 @@ public:
 
     void learnPassageTrails(vector<CartesianPoint> stepped_history, vector < vector<CartesianPoint> > stepped_laser_history) {
         // cout << "creating trails between intersections" << endl;
-        vector<double> dist_between_steps;
-        for(int k = 0; k < stepped_history.size(); k++){
-          double start_x = stepped_history[k].get_x();
-          if(int(start_x) < 0)
-            start_x = 0;
-          if(int(start_x) >= decisions_grid.size())
-            start_x = decisions_grid.size()-1;
-          double start_y = stepped_history[k].get_y();
-          if(int(start_y) < 0)
-            start_y = 0;
-          if(int(start_y) >= decisions_grid[0].size())
-            start_y = decisions_grid[0].size()-1;
-          map<int, vector< vector<int> > >::iterator it;
-          for(it = graph_nodes.begin(); it != graph_nodes.end(); it++){
-            vector< vector<int> > points = it->second;
-            for(int i = 0; i < points.size(); i++){
-              if(((int)(start_x) == points[i][0] and (int)(start_y) == points[i][1])){
-                node_steps[it->first].push_back(k);
-              }
-            }
-          }
-          if(k != stepped_history.size()-1){
-            dist_between_steps.push_back(stepped_history[k].get_distance(stepped_history[k+1]));
+        // Steps that started in each intersection's cells, in order, from the index kept by addSteps
+        int cols = decisions_grid[0].size();
+        for(map<int, vector< vector<int> > >::iterator it = graph_nodes.begin(); it != graph_nodes.end(); it++){
+          vector<int> steps;
+          for(int i = 0; i < (it->second).size(); i++){
+            vector<int> &cell = cell_steps[(it->second)[i][0] * cols + (it->second)[i][1]];
+            steps.insert(steps.end(), cell.begin(), cell.end());
           }
+          sort(steps.begin(), steps.end());
+          node_steps[it->first] = steps;
         }
-        dist_between_steps.push_back(0.0);
         for(map<int, vector<int> >::iterator it = node_steps.begin(); it != node_steps.end(); it++){
           // cout << "intersection " << it->first << " " << (it->second).size() << endl;
           double dist_limit = 0.25;
@@ -1780,7 +1350,7 @@ public:
               }
             }
             for(int k = start_ind[j]; k < end_ind[j]; k++){
-              trailLength = trailLength + dist_between_steps[k];
+              trailLength = trailLength + step_distances[k];
             }
             // cout << "trailLength " << trailLength << " count_overlap " << count_overlap << " passage12_points.size() " << passage12_points.size() << endl;
             if(trailLength < min_length and count_overlap / passage12_points.size() >= max_overlap and count_overlap / passage12_points.size() >= 0.6){
@@ -2241,10 +1811,133 @@ public:
     }
 
 private:
+    // Rasterizes every step into decisions_grid, indexes the steps by the cell they start in for
+    // learnPassageTrails and keeps the distance of each step to the next
+    void addSteps(vector<CartesianPoint> &stepped_history){
+        int rows = highway_grid.size();
+        int cols = highway_grid[0].size();
+        decisions_grid.assign(rows, vector<int>(cols, 0));
+        cell_steps.assign(rows * cols, vector<int>());
+        step_distances.clear();
+        double step_length = 1;
+        for(int k = 0; k < (int)(stepped_history.size()) - 1; k++){
+          double start_x = stepped_history[k].get_x();
+          if(int(start_x) < 0)
+            start_x = 0;
+          if(int(start_x) >= decisions_grid.size())
+            start_x = decisions_grid.size()-1;
+          double start_y = stepped_history[k].get_y();
+          if(int(start_y) < 0)
+            start_y = 0;
+          if(int(start_y) >= decisions_grid[0].size())
+            start_y = decisions_grid[0].size()-1;
+          double end_x = stepped_history[k+1].get_x();
+          if(int(end_x) < 0)
+            end_x = 0;
+          if(int(end_x) >= decisions_grid.size())
+            end_x = decisions_grid.size()-1;
+          double end_y = stepped_history[k+1].get_y();
+          if(int(end_y) < 0)
+            end_y = 0;
+          if(int(end_y) >= decisions_grid[0].size())
+            end_y = decisions_grid[0].size()-1;
+          decisions_grid[int(start_x)][int(start_y)] = 1;
+          decisions_grid[int(end_x)][int(end_y)] = 1;
+          double length = sqrt((start_x - end_x) * (start_x - end_x) + (start_y - end_y) * (start_y - end_y));
+          if(length >= step_length or int(start_x) != int(end_x) or int(start_y) != int(end_y)){
+            double step_size = step_length / length;
+            if(step_size > 0.1){
+              step_size = 0.1;
+            }
+            double tx, ty;
+            for(double j = 0; j <= 1; j += step_size){
+              tx = (end_x * j) + (start_x * (1 - j));
+              ty = (end_y * j) + (start_y * (1 - j));
+              if(int(tx) >= 0 and int(ty) >= 0 and int(tx) < decisions_grid.size() and int(ty) < decisions_grid[0].size()){
+                decisions_grid[int(tx)][int(ty)] = 1;
+              }
+            }
+          }
+        }
+        for(int k = 0; k < stepped_history.size(); k++){
+          double start_x = stepped_history[k].get_x();
+          if(int(start_x) < 0)
+            start_x = 0;
+          if(int(start_x) >= decisions_grid.size())
+            start_x = decisions_grid.size()-1;
+          double start_y = stepped_history[k].get_y();
+          if(int(start_y) < 0)
+            start_y = 0;
+          if(int(start_y) >= decisions_grid[0].size())
+            start_y = decisions_grid[0].size()-1;
+          cell_steps[(int)(start_x) * cols + (int)(start_y)].push_back(k);
+          if(k > 0){
+            step_distances.push_back(stepped_history[k-1].get_distance(stepped_history[k]));
+          }
+        }
+    }
+
+    // A cell is part of a passage when it was visited or at least three of its neighbors were
+    int passageCellValue(int i, int j){
+        if(decisions_grid[i][j] > 0){
+          return 1;
+        }
+        int values = 0;
+        if(i > 0 and decisions_grid[i-1][j] > 0)
+          values++;
+        if(j > 0 and decisions_grid[i][j-1] > 0)
+          values++;
+        if(i < decisions_grid.size()-1 and decisions_grid[i+1][j] > 0)
+          values++;
+        if(j < decisions_grid[0].size()-1 and decisions_grid[i][j+1] > 0)
+          values++;
+        return (values >= 3 ? 1 : -1);
+    }
+
+    // Marks the runs of passage cells in row i that are at least min_passage_length long. A run
+    // still open at the end of the row is not counted.
+    void fillHorizontalRuns(vector< vector<int> > &passage_grid, int i, int min_passage_length, vector< vector<int> > &filled){
+        int start = -1;
+        for(int j = 0; j < passage_grid[i].size(); j++){
+          if(passage_grid[i][j] >= 0 and start == -1){
+            start = j;
+          }
+          else if(passage_grid[i][j] < 0 and start > -1){
+            if(j - start >= min_passage_length){
+              for(int k = start; k < j; k++){
+                filled[i][k] = 1;
+              }
+            }
+            start = -1;
+          }
+        }
+    }
+
+    // Same along column j
+    void fillVerticalRuns(vector< vector<int> > &passage_grid, int j, int min_passage_length, vector< vector<int> > &filled){
+        int start = -1;
+        for(int i = 0; i < passage_grid.size(); i++){
+          if(passage_grid[i][j] >= 0 and start == -1){
+            start = i;
+          }
+          else if(passage_grid[i][j] < 0 and start > -1){
+            if(i - start >= min_passage_length){
+              for(int k = start; k < i; k++){
+                filled[k][j] = 1;
+              }
+            }
+            start = -1;
+          }
+        }
+    }
+
     vector< vector<int> > highway_grid;
     AgentState* agentState;
     vector< vector<int> > passages_grid;
     vector< vector<int> > decisions_grid;
+    // Steps that started in each cell (row * columns + column) and the distance of each step to the next
+    vector< vector<int> > cell_steps;
+    vector<double> step_distances;
     // vector< vector<int> > decisions_only_grid;
     map<int, vector< vector<int> > > graph_nodes;
     map<int, vector< vector<int> > > graph_edges_map;
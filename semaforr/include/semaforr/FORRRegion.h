@@ -12,6 +12,7 @@ Written by Anoop Aroor, 2014
 #include <iostream>
 #include "FORRGeometry.h"
 #include "FORRExit.h"
+#include "SpatialModelSnapshot.h"
 #include <algorithm>
 #include <vector>
 
@@ -476,6 +477,36 @@ class FORRRegion{
   void setIsLeaf(bool leaf){isLeaf = leaf;}
   bool getIsLeaf() {return isLeaf;}
 
+  void save(SnapshotWriter &out){
+    out.putPoint(center);
+    out.putDoubles(min_visibility);
+    out.putDoubles(max_visibility);
+    out.putDoubles(avg_visibility);
+    out.putDoubles(count_visibility);
+    out.putPoints(start_max_visibility);
+    out.putDouble(radius);
+    out.putInt(isLeaf);
+    out.putInts(passage_values);
+    saveExits(out, exits);
+    saveExits(out, ext_exits);
+    saveExits(out, min_exits);
+  }
+
+  void load(SnapshotReader &in){
+    center = in.getPoint();
+    min_visibility = in.getDoubles();
+    max_visibility = in.getDoubles();
+    avg_visibility = in.getDoubles();
+    count_visibility = in.getDoubles();
+    start_max_visibility = in.getPoints();
+    radius = in.getDouble();
+    isLeaf = in.getInt();
+    passage_values = in.getInts();
+    exits = loadExits(in);
+    ext_exits = loadExits(in);
+    min_exits = loadExits(in);
+  }
+
  private:
   CartesianPoint center;
   // vector < vector <CartesianPoint> > lasers;
@@ -491,6 +522,23 @@ class FORRRegion{
   vector<FORRExit> exits;
   vector<FORRExit> ext_exits;
   vector<FORRExit> min_exits;
+
+  void saveExits(SnapshotWriter &out, vector<FORRExit> &list){
+    out.putInt(list.size());
+    for(int i = 0; i < list.size(); i++){
+      list[i].save(out);
+    }
+  }
+
+  vector<FORRExit> loadExits(SnapshotReader &in){
+    vector<FORRExit> list;
+    int count = in.getInt();
+    for(int i = 0; i < count and in.ok(); i++){
+      list.push_back(FORRExit());
+      list.back().load(in);
+    }
+    return list;
+  }
 };
 
 struct RegionNode{
@@ -670,8 +670,36 @@ class FORRRegionList{
     return -1;
   }
 
-  
-  
+  void save(SnapshotWriter &out){
+    out.beginSection("REGN");
+    out.putInt(regions.size());
+    for(int i = 0; i < regions.size(); i++){
+      regions[i].save(out);
+    }
+    out.putPoints(regionpath);
+    out.endSection();
+  }
+
+  // Leaves the regions alone if the snapshot has none or they are cut short
+  bool load(SnapshotReader &in){
+    if(!in.section("REGN")){
+      return false;
+    }
+    vector<FORRRegion> loaded;
+    int count = in.getInt();
+    for(int i = 0; i < count and in.ok(); i++){
+      loaded.push_back(FORRRegion());
+      loaded.back().load(in);
+    }
+    vector<CartesianPoint> loaded_path = in.getPoints();
+    if(!in.ok()){
+      return false;
+    }
+    regions = loaded;
+    regionpath = loaded_path;
+    return true;
+  }
+
  private:
   vector<FORRRegion> regions;
   vector<CartesianPoint> regionpath;
@@ -16,6 +16,7 @@ Written by Matthew Evanusa, February 2015
 #include <iostream>
 #include "AgentState.h"
 #include <FORRGeometry.h>
+#include "SpatialModelSnapshot.h"
 #include <vector>
 #include <fstream>
 #include <utility>
@@ -68,6 +69,43 @@ class FORRTrails{
   }
 
   int getSize(){return trails.size();}
+
+  void save(SnapshotWriter &out){
+    out.beginSection("TRAL");
+    out.putInt(trails.size());
+    for(int i = 0; i < trails.size(); i++){
+      out.putInt(trails[i].size());
+      for(int j = 0; j < trails[i].size(); j++){
+        out.putPoint(trails[i][j].coordinates);
+        out.putPoints(trails[i][j].wallVectorEndpoints);
+      }
+    }
+    out.endSection();
+  }
+
+  bool load(SnapshotReader &in){
+    if(!in.section("TRAL")){
+      return false;
+    }
+    vector< vector< TrailMarker> > loaded;
+    int count = in.getInt();
+    for(int i = 0; i < count and in.ok(); i++){
+      vector<TrailMarker> trail;
+      int markers = in.getInt();
+      for(int j = 0; j < markers and in.ok(); j++){
+        CartesianPoint coordinates = in.getPoint();
+        vector<CartesianPoint> endpoints = in.getPoints();
+        trail.push_back(TrailMarker(coordinates, endpoints));
+      }
+      loaded.push_back(trail);
+    }
+    if(!in.ok()){
+      return false;
+    }
+    trails = loaded;
+    chosen_trail = -1;
+    return true;
+  }
   
   void setChosenTrail(int n){ chosen_trail = n;}
   
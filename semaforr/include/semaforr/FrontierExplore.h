@@ -12,7 +12,9 @@
 #include <FORRGeometry.h>
 #include <Position.h>
 #include <FORRAction.h>
+#include <BitGrid.h>
 #include <vector>
+#include <deque>
 #include <string>
 #include <math.h>
 #include <iostream>
@@ -85,42 +87,33 @@ public:
 		for(int i = 0 ; i < numMoves ; i++) move[i] = arrMove[i];
 		for(int i = 0 ; i < numRotates ; i++) rotate[i] = arrRotate[i];
 		// cout << "Frontier length " << length << " height " << height << endl;
-		// -1 for unmarked, 1 for occupied, 0 for unoccupied
+		// Every cell starts unmarked, not on the stack and not traveled
+		known_grid.assign(l, h);
+		occupied_grid.assign(l, h);
+		traveled_grid.assign(l, h);
+		stack_grid.assign(l, h);
 		for(int i = 0; i < l; i++){
 			vector<int> col;
 			for(int j = 0; j < h; j ++){
-				col.push_back(-1);
-			}
-			frontier_grid.push_back(col);
-		}
-		for(int i = 0; i < l; i++){
-			vector<int> col;
-			for(int j = 0; j < h; j ++){
-				col.push_back(-1);
-			}
-			traveled_grid.push_back(col);
-		}
-		for(int i = 0; i < l; i++){
-			vector<int> col;
-			for(int j = 0; j < h; j ++){
-				col.push_back(-1);
+				col.push_back(0);
 			}
-			stack_grid.push_back(col);
+			passed_grid.push_back(col);
 		}
 		for(int i = 0; i < l; i++){
 			vector<int> col;
 			for(int j = 0; j < h; j ++){
 				col.push_back(0);
 			}
-			passed_grid.push_back(col);
+			hit_grid.push_back(col);
 		}
 		for(int i = 0; i < l; i++){
 			vector<int> col;
 			for(int j = 0; j < h; j ++){
-				col.push_back(0);
+				col.push_back(-1);
 			}
-			hit_grid.push_back(col);
+			touched_grid.push_back(col);
 		}
+		scan_count = 0;
 		frontiers_complete = false;
 		go_to_top_point = false;
 		top_point_decisions = 0;
@@ -135,10 +128,10 @@ public:
 			frontiers_complete = true;
 			if(time <= time_threshold+10){
 				cout << "Frontier grid" << endl;
-				for(int i = 0; i < frontier_grid[0].size(); i++){
+				for(int i = 0; i < height; i++){
 					cout << "final_grid ";
-					for(int j = 0; j < frontier_grid.size(); j++){
-						cout << frontier_grid[j][i] << " ";
+					for(int j = 0; j < length; j++){
+						cout << frontierCell(j, i) << " ";
 					}
 					cout << endl;
 				}
@@ -146,7 +139,16 @@ public:
 		}
 	}
 
-	vector< vector<int> > getFrontierGrid(){return frontier_grid;}
+	// -1 for unmarked, 1 for occupied, 0 for unoccupied
+	vector< vector<int> > getFrontierGrid(){
+		vector< vector<int> > grid(length, vector<int>(height));
+		for(int i = 0; i < length; i++){
+			for(int j = 0; j < height; j++){
+				grid[i][j] = frontierCell(i, j);
+			}
+		}
+		return grid;
+	}
 
 	vector< vector<double> > getFrontierPath(){
 		if(go_to_top_point){
@@ -196,7 +198,7 @@ public:
 		Position current_position = current_point;
 		cout << "current_position " << current_position.getX() << " " << current_position.getY() << endl;
 		position_history.push_back(current_position);
-		traveled_grid[(int)(current_position.getX())][(int)(current_position.getY())] = 1;
+		traveled_grid.set((int)(current_position.getX()), (int)(current_position.getY()));
 		cout << "after traveled_grid" << endl;
 		double start_angle = current_laser.angle_min;
 		double increment = current_laser.angle_increment;
@@ -225,6 +227,9 @@ public:
 		int startx = (int)(current_position.getX());
 		int starty = (int)(current_position.getY());
 		cout << "startx " << startx << " starty " << starty << endl;
+		// Only the cells this scan passes through or hits can change, so the frontier is updated from those alone
+		scan_count++;
+		touched_cells.clear();
 		for(int j = 0; j < laserEndpoints.size(); j++){
 			int ex = (int)(laserEndpoints[j].get_x());
 			int ey = (int)(laserEndpoints[j].get_y());
@@ -237,6 +242,7 @@ public:
 					for(int i = startx; i > ex; i--){
 						if(CartesianPoint(current_position.getX(), current_position.getY()).get_distance(CartesianPoint(i, (-(ea * i + ec) / eb))) <= 20){
 							passed_grid[i][(int)(-(ea * i + ec) / eb)] = passed_grid[i][(int)(-(ea * i + ec) / eb)] + 1;
+							markTouched(i, (int)(-(ea * i + ec) / eb));
 						}
 					}
 				}
@@ -244,6 +250,7 @@ public:
 					for(int i = startx; i < ex; i++){
 						if(CartesianPoint(current_position.getX(), current_position.getY()).get_distance(CartesianPoint(i, (-(ea * i + ec) / eb))) <= 20){
 							passed_grid[i][(int)(-(ea * i + ec) / eb)] = passed_grid[i][(int)(-(ea * i + ec) / eb)] + 1;
+							markTouched(i, (int)(-(ea * i + ec) / eb));
 						}
 					}
 				}
@@ -252,6 +259,7 @@ public:
 						for(int i = starty; i > ey; i--){
 							if(CartesianPoint(current_position.getX(), current_position.getY()).get_distance(CartesianPoint((-(eb * i + ec) / ea), i)) <= 20){
 								passed_grid[(int)(-(eb * i + ec) / ea)][i] = passed_grid[(int)(-(eb * i + ec) / ea)][i] + 1;
+								markTouched((int)(-(eb * i + ec) / ea), i);
 							}
 						}
 					}
@@ -259,86 +267,53 @@ public:
 						for(int i = starty; i < ey; i++){
 							if(CartesianPoint(current_position.getX(), current_position.getY()).get_distance(CartesianPoint((-(eb * i + ec) / ea), i)) <= 20){
 								passed_grid[(int)(-(eb * i + ec) / ea)][i] = passed_grid[(int)(-(eb * i + ec) / ea)][i] + 1;
+								markTouched((int)(-(eb * i + ec) / ea), i);
 							}
 						}
 					}
 					else{
 						passed_grid[startx][starty] = passed_grid[startx][starty] + 1;
+						markTouched(startx, starty);
 					}
 				}
 				if(laserEndpoints[j].get_distance(CartesianPoint(current_position.getX(), current_position.getY())) <= 20){
 					hit_grid[ex][ey] = hit_grid[ex][ey] + 1;
+					markTouched(ex, ey);
 				}
 			}
 		}
-		cout << "before ratio_grid" << endl;
-		vector< vector<double> > ratio_grid;
-		for(int i = 0; i < length; i++){
-			vector<double> col;
-			for(int j = 0; j < height; j ++){
-				col.push_back(0.0);
+		// Cells are visited in grid order, so new frontier cells join the stack in the same order a full rescan would give
+		sort(touched_cells.begin(), touched_cells.end());
+		for(int k = 0; k < touched_cells.size(); k++){
+			int i = touched_cells[k].first;
+			int j = touched_cells[k].second;
+			double ratio = -1.0;
+			if(passed_grid[i][j] > 0 or hit_grid[i][j] > 0){
+				ratio = (double)(hit_grid[i][j]) / ((double)(hit_grid[i][j]) + (double)(passed_grid[i][j]));
 			}
-			ratio_grid.push_back(col);
-		}
-		for(int i = 0; i < passed_grid.size(); i++){
-			for(int j = 0; j < passed_grid[i].size(); j++){
-				if(passed_grid[i][j] > 0 or hit_grid[i][j] > 0){
-					ratio_grid[i][j] = (double)(hit_grid[i][j]) / ((double)(hit_grid[i][j]) + (double)(passed_grid[i][j]));
-				}
-				else{
-					ratio_grid[i][j] = -1.0;
-				}
-				// cout << i << " " << j << " passed_grid " << passed_grid[i][j] << " hit_grid " << hit_grid[i][j] << " ratio_grid " << ratio_grid[i][j] << endl;
+			int cell = frontierCell(i, j);
+			if(ratio >= 0.75 and cell == -1){
+				setFrontierCell(i, j, 1);
 			}
-		}
-		cout << "after ratio_grid" << endl;
-		for(int i = 0; i < ratio_grid.size(); i++){
-			for(int j = 0; j < ratio_grid[i].size(); j++){
-				if(ratio_grid[i][j] >= 0.75 and frontier_grid[i][j] == -1){
-					frontier_grid[i][j] = 1;
-				}
-				else if(ratio_grid[i][j] >= 0.0 and ratio_grid[i][j] <= 0.25 and frontier_grid[i][j] == -1){
-					frontier_grid[i][j] = 0;
-				}
-				else if(ratio_grid[i][j] >= 0.95 and frontier_grid[i][j] == 0){
-					frontier_grid[i][j] = 1;
-				}
-				else if(ratio_grid[i][j] >= 0 and ratio_grid[i][j] <= 0.05 and frontier_grid[i][j] == 1){
-					frontier_grid[i][j] = 0;
-				}
+			else if(ratio >= 0.0 and ratio <= 0.25 and cell == -1){
+				setFrontierCell(i, j, 0);
+			}
+			else if(ratio >= 0.95 and cell == 0){
+				setFrontierCell(i, j, 1);
+			}
+			else if(ratio >= 0 and ratio <= 0.05 and cell == 1){
+				setFrontierCell(i, j, 0);
 			}
 		}
-		cout << "updated frontier_grid" << endl;
-		for(int i = 0; i < frontier_grid.size(); i++){
-			for(int j = 0; j < frontier_grid[i].size(); j++){
-				if(stack_grid[i][j] == -1 and frontier_grid[i][j] == 0 and traveled_grid[i][j] == -1){
-					bool any_open = false;
-					if(i-1 >= 0){
-						if(frontier_grid[i-1][j] == -1){
-							any_open = true;
-						}
-					}
-					if(i+1 < frontier_grid.size()){
-						if(frontier_grid[i+1][j] == -1){
-							any_open = true;
-						}
-					}
-					if(j-1 >= 0){
-						if(frontier_grid[i][j-1] == -1){
-							any_open = true;
-						}
-					}
-					if(j+1 < frontier_grid[i].size()){
-						if(frontier_grid[i][j+1] == -1){
-							any_open = true;
-						}
-					}
-					if(any_open == true){
-						frontier_stack.push_back(Position(i,j,0));
-						frontier_stack_view.push_back(current_position);
-						stack_grid[i][j] = 1;
-					}
-				}
+		cout << "updated frontier_grid " << touched_cells.size() << endl;
+		// Cells never return to unknown, so an untouched cell cannot gain an unknown neighbor and become a frontier
+		for(int k = 0; k < touched_cells.size(); k++){
+			int i = touched_cells[k].first;
+			int j = touched_cells[k].second;
+			if(!stack_grid.get(i, j) and frontierCell(i, j) == 0 and !traveled_grid.get(i, j) and hasUnknownNeighbor(i, j)){
+				frontier_stack.push_back(Position(i,j,0));
+				frontier_stack_view.push_back(current_position);
+				stack_grid.set(i, j);
 			}
 		}
 		cout << "updated stack_grid " << frontier_stack.size() << endl;
@@ -354,8 +329,8 @@ public:
 			top_point = frontier_stack_view[0];
 			current_target = frontier_stack[0];
 			cout << "Top point " << top_point.getX() << " " << top_point.getY() << endl;
-			frontier_stack.erase(frontier_stack.begin());
-			frontier_stack_view.erase(frontier_stack_view.begin());
+			frontier_stack.pop_front();
+			frontier_stack_view.pop_front();
 			top_point_decisions = 0;
 			return goTowardsPoint(current_position, current_target, middle_distance_min);
 		}
@@ -377,37 +352,37 @@ public:
 			cout << "Too close in front " << middle_distance << endl;
 			// Stop current point and go to next on stack
 			cout << "Frontier grid" << endl;
-			for(int i = 0; i < frontier_grid[0].size(); i++){
-				for(int j = 0; j < frontier_grid.size(); j++){
+			for(int i = 0; i < height; i++){
+				for(int j = 0; j < length; j++){
 					if(i == (int)(current_position.getY()) and j == (int)(current_position.getX())){
-						cout << "[" << frontier_grid[j][i] << "] "; 
+						cout << "[" << frontierCell(j, i) << "] "; 
 					}
 					else{
-						cout << frontier_grid[j][i] << " ";
+						cout << frontierCell(j, i) << " ";
 					}
 				}
 				cout << endl;
 			}
 			cout << "stack_grid" << endl;
-			for(int i = 0; i < stack_grid[0].size(); i++){
-				for(int j = 0; j < stack_grid.size(); j++){
+			for(int i = 0; i < height; i++){
+				for(int j = 0; j < length; j++){
 					if(i == (int)(current_position.getY()) and j == (int)(current_position.getX())){
-						cout << "[" << stack_grid[j][i] << "] "; 
+						cout << "[" << (stack_grid.get(j, i) ? 1 : -1) << "] "; 
 					}
 					else{
-						cout << stack_grid[j][i] << " ";
+						cout << (stack_grid.get(j, i) ? 1 : -1) << " ";
 					}
 				}
 				cout << endl;
 			}
 			cout << "traveled_grid" << endl;
-			for(int i = 0; i < traveled_grid[0].size(); i++){
-				for(int j = 0; j < traveled_grid.size(); j++){
+			for(int i = 0; i < height; i++){
+				for(int j = 0; j < length; j++){
 					if(i == (int)(current_position.getY()) and j == (int)(current_position.getX())){
-						cout << "[" << traveled_grid[j][i] << "] "; 
+						cout << "[" << (traveled_grid.get(j, i) ? 1 : -1) << "] "; 
 					}
 					else{
-						cout << traveled_grid[j][i] << " ";
+						cout << (traveled_grid.get(j, i) ? 1 : -1) << " ";
 					}
 				}
 				cout << endl;
@@ -419,31 +394,11 @@ public:
 				while(visited and frontier_stack.size() > 0){
 					top_point = frontier_stack_view[0];
 					current_target = frontier_stack[0];
-					frontier_stack.erase(frontier_stack.begin());
-					frontier_stack_view.erase(frontier_stack_view.begin());
-					if(traveled_grid[(int)(current_target.getX())][(int)(current_target.getY())] == -1 and frontier_grid[(int)(current_target.getX())][(int)(current_target.getY())] == 0){
-						bool any_open = false;
-						if((int)(current_target.getX())-1 >= 0){
-							if(frontier_grid[(int)(current_target.getX())-1][(int)(current_target.getY())] == -1){
-								any_open = true;
-							}
-						}
-						if((int)(current_target.getX())+1 < frontier_grid.size()){
-							if(frontier_grid[(int)(current_target.getX())+1][(int)(current_target.getY())] == -1){
-								any_open = true;
-							}
-						}
-						if((int)(current_target.getY())-1 >= 0){
-							if(frontier_grid[(int)(current_target.getX())][(int)(current_target.getY())-1] == -1){
-								any_open = true;
-							}
-						}
-						if((int)(current_target.getY())+1 < frontier_grid[(int)(current_target.getX())].size()){
-							if(frontier_grid[(int)(current_target.getX())][(int)(current_target.getY())+1] == -1){
-								any_open = true;
-							}
-						}
-						if(any_open == true){
+					frontier_stack.pop_front();
+					frontier_stack_view.pop_front();
+					// Entries that stopped being frontiers since they were pushed are dropped here
+					if(!traveled_grid.get((int)(current_target.getX()), (int)(current_target.getY())) and frontierCell((int)(current_target.getX()), (int)(current_target.getY())) == 0){
+						if(hasUnknownNeighbor((int)(current_target.getX()), (int)(current_target.getY()))){
 							visited = false;
 						}
 					}
@@ -660,9 +615,9 @@ public:
 		int min_dist = 100;
 		for(int i = current_x - 2; i <= current_x + 2; i++){
 			for(int j = current_y - 2; j <= current_y + 2; j++){
-				if(i >= 0 and i < frontier_grid.size() and j >= 0 and j < frontier_grid[0].size() and i != current_x and j != current_y){
+				if(known_grid.inBounds(i, j) and i != current_x and j != current_y){
 					int dist_target = abs(target_x - i) + abs(target_y - j);
-					if(frontier_grid[i][j] == 0 and dist_target < min_dist){
+					if(frontierCell(i, j) == 0 and dist_target < min_dist){
 						closest_x = i;
 						closest_y = j;
 						min_dist = dist_target;
@@ -916,6 +871,46 @@ public:
 		}
 	}
 
+	// Records a cell whose laser counts changed during the current scan, once per scan
+	void markTouched(int x, int y){
+		if(x < 0 or y < 0 or x >= length or y >= height){
+			return;
+		}
+		if(touched_grid[x][y] != scan_count){
+			touched_grid[x][y] = scan_count;
+			touched_cells.push_back(pair<int, int>(x, y));
+		}
+	}
+
+	bool hasUnknownNeighbor(int x, int y){
+		if(x-1 >= 0 and !known_grid.get(x-1, y)){
+			return true;
+		}
+		if(x+1 < length and !known_grid.get(x+1, y)){
+			return true;
+		}
+		if(y-1 >= 0 and !known_grid.get(x, y-1)){
+			return true;
+		}
+		if(y+1 < height and !known_grid.get(x, y+1)){
+			return true;
+		}
+		return false;
+	}
+
+	// -1 for unmarked, 1 for occupied, 0 for unoccupied
+	int frontierCell(int x, int y){
+		if(!known_grid.get(x, y)){
+			return -1;
+		}
+		return occupied_grid.get(x, y) ? 1 : 0;
+	}
+
+	void setFrontierCell(int x, int y, int value){
+		known_grid.set(x, y);
+		occupied_grid.set(x, y, value == 1);
+	}
+
 	FORRAction goTowardsPoint(Position current_position, Position target_position, double middle_distance_min){
 		cout << "In goTowardsPoint" << endl;
 		double distance_from_target = current_position.getDistance(target_position);
@@ -980,17 +975,24 @@ private:
 	int top_point_decisions;
 	int decision_limit;
 	int start_rotations;
-	vector< vector<int> > frontier_grid;
-	vector<Position> frontier_stack;
-	vector<Position> frontier_stack_view;
+	// Whether each cell has been marked and, once it has, whether it is occupied
+	BitGrid known_grid;
+	BitGrid occupied_grid;
+	// Frontier cells in discovery order with the position they were seen from, taken from the front
+	deque<Position> frontier_stack;
+	deque<Position> frontier_stack_view;
 	vector<Position> position_history;
 	vector< vector<CartesianPoint> > laserEndpoints_history;
 	Position current_target;
 	Position top_point;
-	vector< vector<int> > stack_grid;
-	vector< vector<int> > traveled_grid;
+	BitGrid stack_grid;
+	BitGrid traveled_grid;
 	vector< vector<int> > passed_grid;
 	vector< vector<int> > hit_grid;
+	// Scan that last touched each cell, and the cells touched by the current scan
+	vector< vector<int> > touched_grid;
+	vector< pair<int, int> > touched_cells;
+	int scan_count;
 	vector< vector<double> > path_to_top_point;
 	vector< vector<double> > path_to_current_target;
 	bool frontiers_complete;
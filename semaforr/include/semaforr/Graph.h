@@ -28,6 +28,10 @@ private:
   bool isEdge(Edge e); 
 
   int maxInd;
+
+  // Bumped whenever nodes, edges, costs or accessibility change, so searches can tell when
+  // anything they precomputed from the graph is stale
+  int revision;
  
 public: 
   Graph(Map * m, int p);
@@ -42,6 +46,7 @@ public:
   int getLength() const { return length; }
   int getHeight() const { return height; }
   int getMaxInd() const { return maxInd; }
+  int getRevision() const { return revision; }
 
   vector<Node*> getNodes() const { return nodes; }
 
@@ -65,6 +70,7 @@ public:
 
   void updateEdgeCost(int i, double costfromto, double costtofrom){
 	edges[i]->setCost(costfromto, costtofrom);
+	revision++;
   }
 
   //! returns the neigbors of the node with index n. Calls directly Node::getNeighbors 
@@ -12,7 +12,9 @@
 #include <FORRGeometry.h>
 #include <Position.h>
 #include <FORRAction.h>
+#include <BitGrid.h>
 #include <vector>
+#include <deque>
 #include <string>
 #include <math.h>
 #include <iostream>
@@ -309,7 +311,7 @@ struct DecisionPoint{
         // left_width_max = sqrt((max_left_right_x - max_left_left_x) * (max_left_right_x - max_left_left_x) + (max_left_right_y - max_left_left_y) * (max_left_right_y - max_left_left_y));
         // right_width_max = sqrt((max_right_right_x - max_right_left_x) * (max_right_right_x - max_right_left_x) + (max_right_right_y - max_right_left_y) * (max_right_right_y - max_right_left_y));
 	}
-	bool operator==(const DecisionPoint p) {
+	bool operator==(const DecisionPoint &p) {
 		return (point == p.point);
 	}
 	bool operator < (const DecisionPoint p) const{
@@ -338,6 +340,98 @@ struct DecisionPoint{
 	}
 };
 
+// Decision points kept front first, with a spatial hash over the segment from each point to its left point and
+// to its right point, so finding the points similar to a new one only visits those whose segment passes nearby
+class DecisionPointStack{
+public:
+	DecisionPointStack(): cell_size(2.0) { }
+
+	int size() const {return points.size();}
+	DecisionPoint &operator[](int i) {return points[i];}
+	DecisionPoint &front() {return points.front();}
+	// Index in the explorer's position history of the front point, -1 when none was given
+	int frontHistoryIndex() {return history_index.front();}
+
+	void push_front(const DecisionPoint &p, int history = -1){
+		points.push_front(p);
+		history_index.push_front(history);
+		indexSegments(&points.front(), true);
+	}
+
+	void push_back(const DecisionPoint &p, int history = -1){
+		points.push_back(p);
+		history_index.push_back(history);
+		indexSegments(&points.back(), true);
+	}
+
+	void pop_front(){
+		indexSegments(&points.front(), false);
+		points.pop_front();
+		history_index.pop_front();
+	}
+
+	// Every point whose segment toward the side new_point looks at passes within tolerance of new_point's segment
+	// (plus some that do not, the caller applies the exact test)
+	vector<const DecisionPoint*> nearby(const DecisionPoint &new_point, double tolerance) const{
+		const map< pair<int, int>, vector<const DecisionPoint*> > &cells = (new_point.direction ? right_cells : left_cells);
+		Position end = (new_point.direction ? new_point.right_point : new_point.left_point);
+		int min_x, min_y, max_x, max_y;
+		cellRange(new_point.point, end, tolerance, min_x, min_y, max_x, max_y);
+		set<const DecisionPoint*> found;
+		for(int i = min_x; i <= max_x; i++){
+			for(int j = min_y; j <= max_y; j++){
+				map< pair<int, int>, vector<const DecisionPoint*> >::const_iterator it = cells.find(pair<int, int>(i, j));
+				if(it != cells.end()){
+					found.insert(it->second.begin(), it->second.end());
+				}
+			}
+		}
+		return vector<const DecisionPoint*>(found.begin(), found.end());
+	}
+
+private:
+	// The hash keeps pointers into points, which a deque leaves valid when elements are added or removed at the ends
+	DecisionPointStack(const DecisionPointStack &);
+	DecisionPointStack &operator=(const DecisionPointStack &);
+
+	void cellRange(Position start, Position end, double tolerance, int &min_x, int &min_y, int &max_x, int &max_y) const{
+		min_x = (int)floor((min(start.getX(), end.getX()) - tolerance) / cell_size);
+		min_y = (int)floor((min(start.getY(), end.getY()) - tolerance) / cell_size);
+		max_x = (int)floor((max(start.getX(), end.getX()) + tolerance) / cell_size);
+		max_y = (int)floor((max(start.getY(), end.getY()) + tolerance) / cell_size);
+	}
+
+	void indexSegments(const DecisionPoint *p, bool add){
+		updateCells(right_cells, p, p->right_point, add);
+		updateCells(left_cells, p, p->left_point, add);
+	}
+
+	void updateCells(map< pair<int, int>, vector<const DecisionPoint*> > &cells, const DecisionPoint *p, Position end, bool add){
+		int min_x, min_y, max_x, max_y;
+		cellRange(p->point, end, 0, min_x, min_y, max_x, max_y);
+		for(int i = min_x; i <= max_x; i++){
+			for(int j = min_y; j <= max_y; j++){
+				pair<int, int> key(i, j);
+				if(add){
+					cells[key].push_back(p);
+					continue;
+				}
+				vector<const DecisionPoint*> &entries = cells[key];
+				entries.erase(remove(entries.begin(), entries.end(), p), entries.end());
+				if(entries.size() == 0){
+					cells.erase(key);
+				}
+			}
+		}
+	}
+
+	double cell_size;
+	deque<DecisionPoint> points;
+	deque<int> history_index;
+	map< pair<int, int>, vector<const DecisionPoint*> > right_cells;
+	map< pair<int, int>, vector<const DecisionPoint*> > left_cells;
+};
+
 class Highway{
 public:
 	Highway(DecisionPoint point){
@@ -410,13 +504,7 @@ public:
 			}
 			highway_grid.push_back(col);
 		}
-		for(int i = 0; i < l; i++){
-			vector<int> col;
-			for(int j = 0; j < h; j ++){
-				col.push_back(0);
-			}
-			traveled_grid.push_back(col);
-		}
+		traveled_grid.assign(l, h);
 		for(int i = 0; i < l; i++){
 			vector< vector< pair<int, int> > > col;
 			for(int j = 0; j < h; j ++){
@@ -536,13 +624,11 @@ public:
 				// cout << "Adding to stack " << highway_stack.size() << " distance " << current_position.right_distance << " view " << current_position.farthest_view_right << endl;
 				if(current_position.farthest_distance_right >= 2*distance_threshold){
 					cout << "Adding to top of longest stack " << highway_stack_longest.size() << " farthest right distance " << current_position.farthest_distance_right << " x " << right_position.point.getX() << " y " << right_position.point.getY() << endl;
-					highway_stack_longest.insert(highway_stack_longest.begin(), right_position);
-					stack_longest_index.insert(stack_longest_index.begin(), position_history.size()-1);
+					highway_stack_longest.push_front(right_position, position_history.size()-1);
 				}
 				else{
 					cout << "Adding to top of shorter stack " << highway_stack.size() << " farthest right distance " << current_position.farthest_distance_right << " x " << right_position.point.getX() << " y " << right_position.point.getY() << endl;
-					highway_stack.insert(highway_stack.begin(), right_position);
-					stack_index.insert(stack_index.begin(), position_history.size()-1);
+					highway_stack.push_front(right_position, position_history.size()-1);
 				}
 			}
 		}
@@ -553,13 +639,11 @@ public:
 				// cout << "Adding to stack " << highway_stack.size() << " distance " << current_position.left_distance << " view " << current_position.farthest_view_left << endl;
 				if(current_position.farthest_distance_left >= 2*distance_threshold){
 					cout << "Adding to top of longest stack " << highway_stack_longest.size() << " farthest left distance " << current_position.farthest_distance_left << " x " << left_position.point.getX() << " y " << left_position.point.getY() << endl;
-					highway_stack_longest.insert(highway_stack_longest.begin(), left_position);
-					stack_longest_index.insert(stack_longest_index.begin(), position_history.size()-1);
+					highway_stack_longest.push_front(left_position, position_history.size()-1);
 				}
 				else{
 					cout << "Adding to top of shorter stack " << highway_stack.size() << " farthest left distance " << current_position.farthest_distance_left << " x " << left_position.point.getX() << " y " << left_position.point.getY() << endl;
-					highway_stack.insert(highway_stack.begin(), left_position);
-					stack_index.insert(stack_index.begin(), position_history.size()-1);
+					highway_stack.push_front(left_position, position_history.size()-1);
 				}
 			}
 		}
@@ -574,20 +658,18 @@ public:
 			}
 			else if(highway_stack_longest.size() > 0 or highway_stack.size() > 0){
 				if(highway_stack_longest.size() > 0){
-					top_point = highway_stack_longest[0];
-					top_point_index = stack_longest_index[0];
+					top_point = highway_stack_longest.front();
+					top_point_index = highway_stack_longest.frontHistoryIndex();
 					// cout << "Top point " << top_point.point.getX() << " " << top_point.point.getY() << endl;
 					highway_stack_completed.push_back(top_point);
-					highway_stack_longest.erase(highway_stack_longest.begin());
-					stack_longest_index.erase(stack_longest_index.begin());
+					highway_stack_longest.pop_front();
 				}
 				else{
-					top_point = highway_stack[0];
-					top_point_index = stack_index[0];
+					top_point = highway_stack.front();
+					top_point_index = highway_stack.frontHistoryIndex();
 					// cout << "Top point " << top_point.point.getX() << " " << top_point.point.getY() << endl;
 					highway_stack_completed.push_back(top_point);
-					highway_stack.erase(highway_stack.begin());
-					stack_index.erase(stack_index.begin());
+					highway_stack.pop_front();
 				}
 				Highway new_highway = Highway(top_point);
 				highways.push_back(new_highway);
@@ -723,18 +805,16 @@ public:
 					// 	already_sorted = true;
 					// }
 					if(highway_stack_longest.size() > 0){
-						top_point = highway_stack_longest[0];
-						top_point_index = stack_longest_index[0];
+						top_point = highway_stack_longest.front();
+						top_point_index = highway_stack_longest.frontHistoryIndex();
 						// cout << "Potential Top point " << top_point.point.getX() << " " << top_point.point.getY() << endl;
-						highway_stack_longest.erase(highway_stack_longest.begin());
-						stack_longest_index.erase(stack_longest_index.begin());
+						highway_stack_longest.pop_front();
 					}
 					else{
-						top_point = highway_stack[0];
-						top_point_index = stack_index[0];
+						top_point = highway_stack.front();
+						top_point_index = highway_stack.frontHistoryIndex();
 						// cout << "Potential Top point " << top_point.point.getX() << " " << top_point.point.getY() << endl;
-						highway_stack.erase(highway_stack.begin());
-						stack_index.erase(stack_index.begin());
+						highway_stack.pop_front();
 					}
 					start_highway = highway_grid[(int)(top_point.point.getX())][(int)(top_point.point.getY())];
 					if(top_point.direction == true){
@@ -1193,7 +1273,7 @@ public:
 		}
 	}
 
-	void findPathOnGrid(DecisionPoint current_point, DecisionPoint target_point, int target_point_index){
+	void findPathOnGrid(const DecisionPoint &current_point, const DecisionPoint &target_point, int target_point_index){
 		path_to_top_point.clear();
 		cout << "current_point " << current_point.point.getX() << " " << current_point.point.getY() << " target_point " << target_point.point.getX() << " " << target_point.point.getY() << " target_point_index " << target_point_index << endl;
 		if(target_point_index == -1){
@@ -1211,21 +1291,22 @@ public:
 			}
 			cout << "new target_point_index " << target_point_index << endl;
 		}
-		vector<DecisionPoint> trailPositions;
-		trailPositions.push_back(position_history[target_point_index]);
+		// Indices into position_history, whose points carry their whole laser scan and are not worth copying
+		vector<int> trailPositions;
+		trailPositions.push_back(target_point_index);
 		for(int i = target_point_index; i < position_history.size(); i++){
 			for(int n = position_history.size()-1; n > i; n--){
 				if(canAccessPoint(position_history[i].laserEndpoints, CartesianPoint(position_history[i].point.getX(), position_history[i].point.getY()), CartesianPoint(position_history[n].point.getX(), position_history[n].point.getY()), 2)) {
-					trailPositions.push_back(position_history[n]);
+					trailPositions.push_back(n);
 					i = n-1;
 				}
 			}
 		}
-		trailPositions.push_back(position_history[position_history.size()-1]);
+		trailPositions.push_back(position_history.size()-1);
 		for(int i = trailPositions.size()-1; i >= 0; i--){
 			vector<double> marker;
-			marker.push_back(trailPositions[i].point.getX());
-			marker.push_back(trailPositions[i].point.getY());
+			marker.push_back(position_history[trailPositions[i]].point.getX());
+			marker.push_back(position_history[trailPositions[i]].point.getY());
 			path_to_top_point.push_back(marker);
 		}
 
@@ -1463,7 +1544,7 @@ public:
 		return decision;
 	}
 
-	bool pointAlreadyInStack(DecisionPoint new_point, bool onlyCompleted = false){
+	bool pointAlreadyInStack(const DecisionPoint &new_point, bool onlyCompleted = false){
 		cout << "Check if point in stack" << endl;
 		int start_highway = highway_grid[(int)(new_point.point.getX())][(int)(new_point.point.getY())];
 		int end_highway = -1;
@@ -1537,160 +1618,169 @@ public:
 		}
 	}
 
-	bool anySimilarOnList(DecisionPoint new_point, vector<DecisionPoint> stack){
-		for(int i = 0; i < stack.size(); i++){
-			Position new_point_start = new_point.point;
-			Position new_point_end;
-			Position exist_point_start;
-			Position exist_point_end;
-			if(new_point.direction == true){
-				new_point_end = new_point.right_point;
-				exist_point_start = stack[i].point;
-				exist_point_end = stack[i].right_point;
-			}
-			else{
-				new_point_end = new_point.left_point;
-				exist_point_start = stack[i].point;
-				exist_point_end = stack[i].left_point;
-			}
-			double new_dist = new_point_start.getDistance(new_point_end);
-			double exist_dist = exist_point_start.getDistance(exist_point_end);
-			double start_to_start_dist = new_point_start.getDistance(exist_point_start);
-			double end_to_end_dist = new_point_end.getDistance(exist_point_end);
-			double start_to_end_dist = new_point_start.getDistance(exist_point_end);
-			double end_to_start_dist = new_point_end.getDistance(exist_point_start);
-			if((start_to_start_dist <= 1 and end_to_end_dist <= 1) or (start_to_end_dist <= 1 and end_to_start_dist <= 1) or (start_to_start_dist <= 1 and start_to_end_dist <= 1) or (end_to_end_dist <= 1 and end_to_start_dist <= 1)){
+	// Only the points whose segment passes within 1 of the new one can pass any of the tests in similarDecisionPoints
+	bool anySimilarOnList(const DecisionPoint &new_point, const DecisionPointStack &stack){
+		vector<const DecisionPoint*> candidates = stack.nearby(new_point, 1);
+		for(int i = 0; i < candidates.size(); i++){
+			if(similarDecisionPoints(new_point, *candidates[i])){
 				return true;
 			}
-			double x = new_point_start.getX();
-			double y = new_point_start.getY();
-			double x1 = exist_point_start.getX();
-			double y1 = exist_point_start.getY();
-			double x2 = exist_point_end.getX();
-			double y2 = exist_point_end.getY();
-			double A = x - x1;
-			double B = y - y1;
-			double C = x2 - x1;
-			double D = y2 - y1;
-			double dot = A * C + B * D;
-			double len_sq = C * C + D * D;
-			double param = -1;
-			if (len_sq != 0) //in case of 0 length line
-				param = dot / len_sq;
-			double xx, yy;
-			if (param < 0) {
-				xx = x1;
-				yy = y1;
-			}
-			else if (param > 1) {
-				xx = x2;
-				yy = y2;
-			}
-			else {
-				xx = x1 + param * C;
-				yy = y1 + param * D;
-			}
-			double dx = x - xx;
-			double dy = y - yy;
-			double start_to_closest_exist = sqrt(dx * dx + dy * dy);
-			Position start_to_closest_on_exist(xx, yy, 0);
-			x = new_point_end.getX();
-			y = new_point_end.getY();
-			x1 = exist_point_start.getX();
-			y1 = exist_point_start.getY();
-			x2 = exist_point_end.getX();
-			y2 = exist_point_end.getY();
-			A = x - x1;
-			B = y - y1;
-			C = x2 - x1;
-			D = y2 - y1;
-			dot = A * C + B * D;
-			len_sq = C * C + D * D;
-			param = -1;
-			if (len_sq != 0) //in case of 0 length line
-				param = dot / len_sq;
-			if (param < 0) {
-				xx = x1;
-				yy = y1;
-			}
-			else if (param > 1) {
-				xx = x2;
-				yy = y2;
-			}
-			else {
-				xx = x1 + param * C;
-				yy = y1 + param * D;
-			}
-			dx = x - xx;
-			dy = y - yy;
-			double end_to_closest_exist = sqrt(dx * dx + dy * dy);
-			Position end_to_closest_on_exist(xx, yy, 0);
-			x = exist_point_start.getX();
-			y = exist_point_start.getY();
-			x1 = new_point_start.getX();
-			y1 = new_point_start.getY();
-			x2 = new_point_end.getX();
-			y2 = new_point_end.getY();
-			A = x - x1;
-			B = y - y1;
-			C = x2 - x1;
-			D = y2 - y1;
-			dot = A * C + B * D;
-			len_sq = C * C + D * D;
-			param = -1;
-			if (len_sq != 0) //in case of 0 length line
-				param = dot / len_sq;
-			if (param < 0) {
-				xx = x1;
-				yy = y1;
-			}
-			else if (param > 1) {
-				xx = x2;
-				yy = y2;
-			}
-			else {
-				xx = x1 + param * C;
-				yy = y1 + param * D;
-			}
-			dx = x - xx;
-			dy = y - yy;
-			double start_to_closest_new = sqrt(dx * dx + dy * dy);
-			Position start_to_closest_on_new(xx, yy, 0);
-			x = exist_point_end.getX();
-			y = exist_point_end.getY();
-			x1 = new_point_start.getX();
-			y1 = new_point_start.getY();
-			x2 = new_point_end.getX();
-			y2 = new_point_end.getY();
-			A = x - x1;
-			B = y - y1;
-			C = x2 - x1;
-			D = y2 - y1;
-			dot = A * C + B * D;
-			len_sq = C * C + D * D;
-			param = -1;
-			if (len_sq != 0) //in case of 0 length line
-				param = dot / len_sq;
-			if (param < 0) {
-				xx = x1;
-				yy = y1;
-			}
-			else if (param > 1) {
-				xx = x2;
-				yy = y2;
-			}
-			else {
-				xx = x1 + param * C;
-				yy = y1 + param * D;
-			}
-			dx = x - xx;
-			dy = y - yy;
-			double end_to_closest_new = sqrt(dx * dx + dy * dy);
-			Position end_to_closest_on_new(xx, yy, 0);
+		}
+		return false;
+	}
 
-			if((end_to_closest_exist <= 1 and start_to_closest_new <= 1 and end_to_closest_on_exist.getDistance(start_to_closest_on_new) >= ((new_dist + exist_dist)/2.0)/3.0) or (end_to_closest_new <= 1 and start_to_closest_exist <= 1 and end_to_closest_on_new.getDistance(start_to_closest_on_exist) >= ((new_dist + exist_dist)/2.0)/3.0) or (start_to_start_dist <= 1 and end_to_closest_exist <= 1) or (start_to_start_dist <= 1 and end_to_closest_new <= 1) or (start_to_closest_exist <= 1 and end_to_closest_exist <= 1) or (start_to_closest_new <= 1 and end_to_closest_new <= 1) or (end_to_end_dist <= 1 and start_to_closest_exist <= 1) or (end_to_end_dist <= 1 and start_to_closest_new <= 1)){
-				return true;
-			}
+	bool similarDecisionPoints(const DecisionPoint &new_point, const DecisionPoint &exist_point){
+		Position new_point_start = new_point.point;
+		Position new_point_end;
+		Position exist_point_start;
+		Position exist_point_end;
+		if(new_point.direction == true){
+			new_point_end = new_point.right_point;
+			exist_point_start = exist_point.point;
+			exist_point_end = exist_point.right_point;
+		}
+		else{
+			new_point_end = new_point.left_point;
+			exist_point_start = exist_point.point;
+			exist_point_end = exist_point.left_point;
+		}
+		double new_dist = new_point_start.getDistance(new_point_end);
+		double exist_dist = exist_point_start.getDistance(exist_point_end);
+		double start_to_start_dist = new_point_start.getDistance(exist_point_start);
+		double end_to_end_dist = new_point_end.getDistance(exist_point_end);
+		double start_to_end_dist = new_point_start.getDistance(exist_point_end);
+		double end_to_start_dist = new_point_end.getDistance(exist_point_start);
+		if((start_to_start_dist <= 1 and end_to_end_dist <= 1) or (start_to_end_dist <= 1 and end_to_start_dist <= 1) or (start_to_start_dist <= 1 and start_to_end_dist <= 1) or (end_to_end_dist <= 1 and end_to_start_dist <= 1)){
+			return true;
+		}
+		double x = new_point_start.getX();
+		double y = new_point_start.getY();
+		double x1 = exist_point_start.getX();
+		double y1 = exist_point_start.getY();
+		double x2 = exist_point_end.getX();
+		double y2 = exist_point_end.getY();
+		double A = x - x1;
+		double B = y - y1;
+		double C = x2 - x1;
+		double D = y2 - y1;
+		double dot = A * C + B * D;
+		double len_sq = C * C + D * D;
+		double param = -1;
+		if (len_sq != 0) //in case of 0 length line
+			param = dot / len_sq;
+		double xx, yy;
+		if (param < 0) {
+			xx = x1;
+			yy = y1;
+		}
+		else if (param > 1) {
+			xx = x2;
+			yy = y2;
+		}
+		else {
+			xx = x1 + param * C;
+			yy = y1 + param * D;
+		}
+		double dx = x - xx;
+		double dy = y - yy;
+		double start_to_closest_exist = sqrt(dx * dx + dy * dy);
+		Position start_to_closest_on_exist(xx, yy, 0);
+		x = new_point_end.getX();
+		y = new_point_end.getY();
+		x1 = exist_point_start.getX();
+		y1 = exist_point_start.getY();
+		x2 = exist_point_end.getX();
+		y2 = exist_point_end.getY();
+		A = x - x1;
+		B = y - y1;
+		C = x2 - x1;
+		D = y2 - y1;
+		dot = A * C + B * D;
+		len_sq = C * C + D * D;
+		param = -1;
+		if (len_sq != 0) //in case of 0 length line
+			param = dot / len_sq;
+		if (param < 0) {
+			xx = x1;
+			yy = y1;
+		}
+		else if (param > 1) {
+			xx = x2;
+			yy = y2;
+		}
+		else {
+			xx = x1 + param * C;
+			yy = y1 + param * D;
+		}
+		dx = x - xx;
+		dy = y - yy;
+		double end_to_closest_exist = sqrt(dx * dx + dy * dy);
+		Position end_to_closest_on_exist(xx, yy, 0);
+		x = exist_point_start.getX();
+		y = exist_point_start.getY();
+		x1 = new_point_start.getX();
+		y1 = new_point_start.getY();
+		x2 = new_point_end.getX();
+		y2 = new_point_end.getY();
+		A = x - x1;
+		B = y - y1;
+		C = x2 - x1;
+		D = y2 - y1;
+		dot = A * C + B * D;
+		len_sq = C * C + D * D;
+		param = -1;
+		if (len_sq != 0) //in case of 0 length line
+			param = dot / len_sq;
+		if (param < 0) {
+			xx = x1;
+			yy = y1;
+		}
+		else if (param > 1) {
+			xx = x2;
+			yy = y2;
+		}
+		else {
+			xx = x1 + param * C;
+			yy = y1 + param * D;
+		}
+		dx = x - xx;
+		dy = y - yy;
+		double start_to_closest_new = sqrt(dx * dx + dy * dy);
+		Position start_to_closest_on_new(xx, yy, 0);
+		x = exist_point_end.getX();
+		y = exist_point_end.getY();
+		x1 = new_point_start.getX();
+		y1 = new_point_start.getY();
+		x2 = new_point_end.getX();
+		y2 = new_point_end.getY();
+		A = x - x1;
+		B = y - y1;
+		C = x2 - x1;
+		D = y2 - y1;
+		dot = A * C + B * D;
+		len_sq = C * C + D * D;
+		param = -1;
+		if (len_sq != 0) //in case of 0 length line
+			param = dot / len_sq;
+		if (param < 0) {
+			xx = x1;
+			yy = y1;
+		}
+		else if (param > 1) {
+			xx = x2;
+			yy = y2;
+		}
+		else {
+			xx = x1 + param * C;
+			yy = y1 + param * D;
+		}
+		dx = x - xx;
+		dy = y - yy;
+		double end_to_closest_new = sqrt(dx * dx + dy * dy);
+		Position end_to_closest_on_new(xx, yy, 0);
+
+		if((end_to_closest_exist <= 1 and start_to_closest_new <= 1 and end_to_closest_on_exist.getDistance(start_to_closest_on_new) >= ((new_dist + exist_dist)/2.0)/3.0) or (end_to_closest_new <= 1 and start_to_closest_exist <= 1 and end_to_closest_on_new.getDistance(start_to_closest_on_exist) >= ((new_dist + exist_dist)/2.0)/3.0) or (start_to_start_dist <= 1 and end_to_closest_exist <= 1) or (start_to_start_dist <= 1 and end_to_closest_new <= 1) or (start_to_closest_exist <= 1 and end_to_closest_exist <= 1) or (start_to_closest_new <= 1 and end_to_closest_new <= 1) or (end_to_end_dist <= 1 and start_to_closest_exist <= 1) or (end_to_end_dist <= 1 and start_to_closest_new <= 1)){
+			return true;
 		}
 		return false;
 	}
@@ -1710,11 +1800,9 @@ private:
 	vector< vector< vector< pair<int, int> > > > highway_grid_connections;
 	vector<Highway> highways;
 	// priority_queue<DecisionPoint> highway_queue;
-	vector<DecisionPoint> highway_stack;
-	vector<DecisionPoint> highway_stack_longest;
-	vector<int> stack_index;
-	vector<int> stack_longest_index;
-	vector<DecisionPoint> highway_stack_completed;
+	DecisionPointStack highway_stack;
+	DecisionPointStack highway_stack_longest;
+	DecisionPointStack highway_stack_completed;
 	DecisionPoint last_position;
 	vector<DecisionPoint> position_history;
 	int last_highway;
@@ -1722,7 +1810,7 @@ private:
 	Position middle_of_highway;
 	DecisionPoint top_point;
 	int top_point_index;
-	vector< vector<int> > traveled_grid;
+	BitGrid traveled_grid;
 	vector< vector<double> > path_to_top_point;
 	bool highways_complete;
 	bool go_to_top_point;
@@ -0,0 +1,187 @@
+/*!
+ * Instrumentation.h
+ *
+ * Stage latency histograms and event counters shared by the controller, planners and visualizer.
+ * Recording only uses atomic adds, registering a name the first time takes the registry lock.
+ *
+ */
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <cmath>
+#include <stdint.h>
+#include <time.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <ros/console.h>
+
+// Seconds on the monotonic clock, unaffected by changes to the wall clock
+inline double getMonotonicTimeSec(){
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec/1000000000.0);
+}
+
+class Counter {
+  public:
+    Counter() : value(0) {};
+
+    void add(uint64_t n) { __sync_fetch_and_add(&value, n); }
+    uint64_t get() { return __sync_fetch_and_add(&value, 0); }
+
+  private:
+    volatile uint64_t value;
+};
+
+// Log scale histogram of durations, four buckets per doubling starting at one microsecond,
+// so percentiles are reported to within 19% and the maximum exactly
+class LatencyHistogram {
+  public:
+    enum { BUCKETS = 128 };
+
+    LatencyHistogram() : count(0), totalMicros(0), maxMicros(0) {
+      for(int i = 0; i < BUCKETS; i++){
+        buckets[i] = 0;
+      }
+    };
+
+    void record(double seconds){
+      uint64_t micros = (seconds > 0 ? (uint64_t)(seconds * 1000000.0) : 0);
+      int index = (micros <= 1 ? 0 : (int)(4 * log((double)micros) / log(2.0)));
+      if(index >= BUCKETS){
+        index = BUCKETS - 1;
+      }
+      __sync_fetch_and_add(&buckets[index], 1);
+      __sync_fetch_and_add(&count, 1);
+      __sync_fetch_and_add(&totalMicros, micros);
+      uint64_t seen = maxMicros;
+      while(micros > seen){
+        uint64_t previous = __sync_val_compare_and_swap(&maxMicros, seen, micros);
+        if(previous == seen){
+          break;
+        }
+        seen = previous;
+      }
+    }
+
+    uint64_t getCount() { return __sync_fetch_and_add(&count, 0); }
+    double getMax() { return __sync_fetch_and_add(&maxMicros, 0) / 1000000.0; }
+    double getMean() {
+      uint64_t n = getCount();
+      return (n == 0 ? 0 : (__sync_fetch_and_add(&totalMicros, 0) / 1000000.0) / n);
+    }
+
+    // Upper edge in seconds of the bucket holding the given fraction (0 to 1) of the samples
+    double percentile(double fraction){
+      uint64_t n = getCount();
+      if(n == 0){
+        return 0;
+      }
+      uint64_t rank = (uint64_t)ceil(fraction * n);
+      if(rank == 0){
+        rank = 1;
+      }
+      uint64_t seen = 0;
+      for(int i = 0; i < BUCKETS; i++){
+        seen += __sync_fetch_and_add(&buckets[i], 0);
+        if(seen >= rank){
+          double edge = pow(2.0, (i + 1) / 4.0) / 1000000.0;
+          return (edge < getMax() ? edge : getMax());
+        }
+      }
+      return getMax();
+    }
+
+  private:
+    volatile uint64_t buckets[BUCKETS];
+    volatile uint64_t count;
+    volatile uint64_t totalMicros;
+    volatile uint64_t maxMicros;
+};
+
+// Named histograms and counters of the process. Histograms and counters are never removed,
+// so the pointers handed out stay valid and can be cached by the caller.
+class Instrumentation {
+  public:
+    static Instrumentation &instance(){
+      static Instrumentation instrumentation;
+      return instrumentation;
+    }
+
+    LatencyHistogram *histogram(std::string name){
+      boost::lock_guard<boost::mutex> lock(registryMutex);
+      std::map<std::string, LatencyHistogram*>::iterator it = histograms.find(name);
+      if(it != histograms.end()){
+        return it->second;
+      }
+      LatencyHistogram *created = new LatencyHistogram();
+      histograms[name] = created;
+      return created;
+    }
+
+    Counter *counter(std::string name){
+      boost::lock_guard<boost::mutex> lock(registryMutex);
+      std::map<std::string, Counter*>::iterator it = counters.find(name);
+      if(it != counters.end()){
+        return it->second;
+      }
+      Counter *created = new Counter();
+      counters[name] = created;
+      return created;
+    }
+
+    std::map<std::string, LatencyHistogram*> getHistograms(){
+      boost::lock_guard<boost::mutex> lock(registryMutex);
+      return histograms;
+    }
+
+    std::map<std::string, Counter*> getCounters(){
+      boost::lock_guard<boost::mutex> lock(registryMutex);
+      return counters;
+    }
+
+    // One line per stage (count, then mean, p50, p99 and max in seconds) followed by one line per counter
+    bool writeSummary(std::string fileName){
+      std::ofstream out(fileName.c_str());
+      if(!out.is_open()){
+        ROS_WARN_STREAM("Could not open instrumentation summary file " << fileName);
+        return false;
+      }
+      std::map<std::string, LatencyHistogram*> stages = getHistograms();
+      out << "# stage count mean p50 p99 max" << std::endl;
+      for(std::map<std::string, LatencyHistogram*>::iterator it = stages.begin(); it != stages.end(); it++){
+        LatencyHistogram *h = it->second;
+        out << it->first << " " << h->getCount() << " " << h->getMean() << " " << h->percentile(0.5) << " " << h->percentile(0.99) << " " << h->getMax() << std::endl;
+      }
+      std::map<std::string, Counter*> events = getCounters();
+      out << "# counter value" << std::endl;
+      for(std::map<std::string, Counter*>::iterator it = events.begin(); it != events.end(); it++){
+        out << it->first << " " << it->second->get() << std::endl;
+      }
+      return out.good();
+    }
+
+  private:
+    Instrumentation() {};
+
+    boost::mutex registryMutex;
+    std::map<std::string, LatencyHistogram*> histograms;
+    std::map<std::string, Counter*> counters;
+};
+
+// Records the time from its construction to the end of the enclosing scope
+class ScopedTimer {
+  public:
+    ScopedTimer(LatencyHistogram *h) : histogram(h), start(getMonotonicTimeSec()) {};
+    ScopedTimer(std::string name) : histogram(Instrumentation::instance().histogram(name)), start(getMonotonicTimeSec()) {};
+    ~ScopedTimer() { histogram->record(getMonotonicTimeSec() - start); }
+
+  private:
+    LatencyHistogram *histogram;
+    double start;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * JumpPointSearch.h
+ *
+ * Jump point search over a navigation graph whose nodes sit on a uniform lattice, as built by
+ * Graph::generateNavGraph. Where a node and its eight lattice neighbors each have exactly their
+ * eight lattice edges, all at pure distance cost, the node is interior: the search only keeps
+ * the natural successors there and runs through straight lines of interior nodes in one step,
+ * using a table of how far each line runs. Every other node (near walls, where edges are
+ * inflated, or missing, or not on the lattice) is expanded like A* does, so the paths found cost
+ * the same as astar's. The tables follow Graph::getRevision and are rebuilt when it changes.
+ *
+ */
+
+#ifndef JUMPPOINTSEARCH_H
+#define JUMPPOINTSEARCH_H
+
+#include "Graph.h"
+#include "BitGrid.h"
+#include <list>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+class JumpPointSearch {
+public:
+  JumpPointSearch() : graph(0), revision(-1), lattice(false), searchStamp(0) {};
+
+  // Search the graph for a path from source to target, heuristic inflated by weight. Returns
+  // false, leaving the path empty, when the graph is not a lattice (call usable() first) or
+  // there is no path.
+  bool search(Graph *g, int source, int target, double weight = 1);
+
+  // Whether the graph's nodes sit on a lattice the search can run on, rebuilding the tables
+  // if the graph changed
+  bool usable(Graph *g);
+
+  // Node ids from the source to the target, every lattice step included
+  list<int> getPathToTarget() { return path; }
+  vector< list<int> > getPathsToTarget() { return vector< list<int> >(1, path); }
+
+  int getExpanded() { return expanded; }
+
+private:
+  // The eight lattice directions, the four straight ones first
+  static const int dirX[8];
+  static const int dirY[8];
+
+  void build();
+  // Cost of moving from node to the neighbor nid the way Node::getCostTo reads it, false if
+  // they are not joined by an edge
+  static bool edgeCost(Node *node, int nid, double &cost);
+  bool isOpen(int id);
+  int neighborCell(int cell, int dir);
+  // Node where a straight jump from an interior node stops: the target if it lies on the line
+  // before the line leaves the interior, otherwise the first node that is not interior
+  int jumpStraight(int id, int dir, int target, int &steps);
+  void push(int id, int parent, int dir, double g, int target, double weight);
+  double heuristic(int id, int target);
+  void constructPath(int source, int target);
+
+  Graph *graph;
+  int revision;
+  bool lattice;
+  int spacing, columns, rows;
+  // Octile distance is only a lower bound when every edge is a lattice step, euclidean otherwise
+  bool octile;
+  // Lattice cell of every node and node of every cell, -1 where there is none
+  vector<int> nodeCell;
+  vector<int> cellNode;
+  BitGrid interior;
+  // For interior nodes, the number of steps along each straight direction to the first node
+  // that is not interior
+  vector<int> runLength[4];
+
+  // Search state, only valid for nodes stamped with the current search
+  struct Entry {
+    double f, g;
+    int id, dir;
+    bool operator<(const Entry &other) const {
+      // priority_queue keeps the largest on top, so lower f and then higher g come first
+      if(f != other.f)
+        return f > other.f;
+      return g < other.g;
+    }
+  };
+  priority_queue<Entry> open;
+  vector<int> stamp;
+  vector<double> gValue;
+  vector<int> parent;
+  vector<char> closed;
+  int searchStamp;
+  int expanded;
+  list<int> path;
+};
+
+#endif
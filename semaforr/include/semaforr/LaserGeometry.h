@@ -0,0 +1,103 @@
+/*!
+ * LaserGeometry.h
+ *
+ * Beam layout of the laser (count, angle of the first beam, angle between beams, range) and the
+ * unit vector of every beam relative to the robot's heading, kept in flat tables so turning a scan
+ * into endpoints takes one sin and cos per scan instead of one per beam. The layout starts from
+ * the configuration and follows the scans, the tables are only rebuilt when it changes.
+ *
+ */
+#ifndef LASERGEOMETRY_H
+#define LASERGEOMETRY_H
+
+#include "FORRGeometry.h"
+
+#include <vector>
+#include <cmath>
+#include <sensor_msgs/LaserScan.h>
+
+class LaserGeometry {
+  public:
+    LaserGeometry() : beams(0), angleMin(0), angleIncrement(0), rangeMax(0), center(0) {};
+
+    // A scan of beams that is centered on the heading
+    LaserGeometry(int beam_count, double increment, double range_max){
+      set(beam_count, -(beam_count / 2) * increment, increment, range_max);
+    }
+
+    void set(int beam_count, double angle_min, double increment, double range_max){
+      beams = (beam_count < 0 ? 0 : beam_count);
+      angleMin = angle_min;
+      angleIncrement = increment;
+      rangeMax = range_max;
+      center = (increment != 0 ? (int)floor(-angle_min / increment + 0.5) : 0);
+      cosines.resize(beams);
+      sines.resize(beams);
+      for(int i = 0; i < beams; i++){
+        cosines[i] = cos(angleMin + i * angleIncrement);
+        sines[i] = sin(angleMin + i * angleIncrement);
+      }
+    }
+
+    // Takes the layout of the scan, returns true if it differed and the tables were rebuilt
+    bool update(const sensor_msgs::LaserScan &scan){
+      if(matches(scan) or scan.ranges.size() == 0 or scan.angle_increment == 0){
+        return false;
+      }
+      set(scan.ranges.size(), scan.angle_min, scan.angle_increment, scan.range_max);
+      return true;
+    }
+
+    bool matches(const sensor_msgs::LaserScan &scan) const {
+      return scan.ranges.size() == beams and scan.angle_min == angleMin and scan.angle_increment == angleIncrement;
+    }
+
+    int size() const { return beams; }
+    double getAngleMin() const { return angleMin; }
+    double getAngleIncrement() const { return angleIncrement; }
+    double getRangeMax() const { return rangeMax; }
+    // Beam that points along the heading
+    int getCenter() const { return center; }
+
+    // Beam closest to angle, relative to the heading, counted from the center beam the way the
+    // scan index was always computed and clamped to the scan
+    int beamIndex(double angle) const {
+      if(beams == 0){
+        return 0;
+      }
+      int index = center + (int)(angle / angleIncrement);
+      if(index < 0) index = 0;
+      if(index > beams - 1) index = beams - 1;
+      return index;
+    }
+
+    // Endpoints of the scan's beams seen from (x, y) facing theta. Scans with another layout fall
+    // back to computing each beam's direction.
+    std::vector<CartesianPoint> endpoints(double x, double y, double theta, const sensor_msgs::LaserScan &scan) const {
+      std::vector<CartesianPoint> points;
+      points.reserve(scan.ranges.size());
+      if(!matches(scan)){
+        double angle = scan.angle_min + theta;
+        for(int i = 0; i < scan.ranges.size(); i++, angle += scan.angle_increment){
+          points.push_back(CartesianPoint(x + scan.ranges[i] * cos(angle), y + scan.ranges[i] * sin(angle)));
+        }
+        return points;
+      }
+      double c = cos(theta), s = sin(theta);
+      for(int i = 0; i < beams; i++){
+        double dx = c * cosines[i] - s * sines[i];
+        double dy = s * cosines[i] + c * sines[i];
+        points.push_back(CartesianPoint(x + scan.ranges[i] * dx, y + scan.ranges[i] * dy));
+      }
+      return points;
+    }
+
+  private:
+    int beams;
+    double angleMin, angleIncrement, rangeMax;
+    int center;
+    // cos and sin of each beam's angle relative to the heading
+    std::vector<double> cosines, sines;
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include <stdio.h>
 #include <string>
 #include "tinyxml.h"
+#include "FORRGeometry.h"
 #include <algorithm>
 
 using namespace std;
@@ -54,6 +55,8 @@ public:
   
 protected:
   vector<Wall> walls;
+  // same walls as one set, for batched distance queries
+  SegmentSet wallSegments;
   vector< vector <bool> > occupancyGrid;
   int occupancySize;
   
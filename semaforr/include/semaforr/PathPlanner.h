@@ -8,9 +8,11 @@
 #define PATH_PLANNER_H
 
 #include "astar.h"
+#include "JumpPointSearch.h"
 #include "Position.h"
 #include "FORRGeometry.h"
 #include <semaforr/CrowdModel.h>
+#include <boost/make_shared.hpp>
 #include <math.h>
 #include <vector>
 #include "FORRConveyors.h"
@@ -35,7 +37,8 @@ private:
   Graph * navGraph;
   Graph * originalNavGraph;
   Map map;
-  semaforr::CrowdModel crowdModel;
+  // Shared with the agent state and the other planners, replaced whole when a new model arrives
+  semaforr::CrowdModel::ConstPtr crowdModel;
   Node source, target; 
   list<int> path;
   vector< list<int> > paths;
@@ -72,6 +75,26 @@ private:
   vector<bool> usedOtherIntersection;
   vector< vector<int> > coverage_grid;
   bool use_coverage_grid;
+  double heuristicWeight;
+  bool jumpPointSearch;
+  JumpPointSearch jumpSearch;
+  // Plans found by earlier searches, most recently used first. A plan is valid while the graph
+  // keeps the revision it was found on and, for planners that recost the graph, the cost model
+  // keeps its version.
+  struct CachedPlan {
+    int source, target;
+    int graphRevision, costModelVersion;
+    double heuristicWeight;
+    list<int> path;
+    vector< list<int> > paths;
+  };
+  list<CachedPlan> planCache;
+  int planCacheSize;
+  int costModelVersion;
+  // Graph revision left by the last updateNavGraph() and the cost model version it used
+  int recostedRevision, recostedVersion;
+  // Farthest (cm) a node dropped by pullString() may lie from the straight line that replaces it
+  double stringPullWidth;
 
   //list<int>::iterator head;
   Node waypoint; 
@@ -85,6 +108,11 @@ private:
   void smoothPath(list<int>&, Node, Node);
   double computeCrowdFlow(Node s, Node d);
   double projection(double angle, double length, double xs, double ys, double xd, double yd);
+  bool recostsGraph();
+  bool usesJumpPointSearch();
+  bool findCachedPlan(int s, int t);
+  bool graphCostsCurrent();
+  void cachePlan(int s, int t);
 
 public: 
   /*! \brief C'tor (only version) 
@@ -92,13 +120,46 @@ public:
     \param Node starting point (source)
     \param Node destination point (target)
   */
- PathPlanner(Graph * g, Map& m, Node s, Node t, string n): navGraph(g), map(m), source(s), target(t), name(n), pathCalculated(false), use_coverage_grid(false){}
+ PathPlanner(Graph * g, Map& m, Node s, Node t, string n): navGraph(g), map(m), crowdModel(boost::make_shared<semaforr::CrowdModel>()), source(s), target(t), name(n), pathCalculated(false), use_coverage_grid(false), heuristicWeight(1), jumpPointSearch(false), planCacheSize(0), costModelVersion(0), recostedRevision(-1), recostedVersion(0), stringPullWidth(0){}
 
- PathPlanner(Graph * g, Node s, Node t, string n): navGraph(g), source(s), target(t), name(n), pathCalculated(false), use_coverage_grid(false){}
+ PathPlanner(Graph * g, Node s, Node t, string n): navGraph(g), crowdModel(boost::make_shared<semaforr::CrowdModel>()), source(s), target(t), name(n), pathCalculated(false), use_coverage_grid(false), heuristicWeight(1), jumpPointSearch(false), planCacheSize(0), costModelVersion(0), recostedRevision(-1), recostedVersion(0), stringPullWidth(0){}
 
   int calcPath(bool cautious = false);
   int calcOrigPath(bool cautious = false);
 
+  /*! \brief Inflation applied to the A* heuristic in calcPath(), 1 gives an optimal search */
+  void setHeuristicWeight(double w){ heuristicWeight = (w < 1 ? 1 : w); }
+  double getHeuristicWeight(){ return heuristicWeight; }
+
+  /*! \brief Use jump point search instead of A* in calcPath() where the graph allows it. Planners that
+   *         change their edge costs and the skeleton planners always use A*. */
+  void setJumpPointSearch(bool j){ jumpPointSearch = j; }
+  bool getJumpPointSearch(){ return jumpPointSearch; }
+
+  /*! \brief Number of plans calcPath() keeps for reuse, least recently used dropped first, 0 turns
+   *         the cache off */
+  void setPlanCacheSize(int n){
+    planCacheSize = (n < 0 ? 0 : n);
+    while(planCache.size() > planCacheSize){
+      planCache.pop_back();
+    }
+  }
+  int getPlanCacheSize(){ return planCacheSize; }
+
+  /*! \brief Version of the inputs updateNavGraph() costs edges with (crowd model, spatial model,
+   *         position history), cached plans of a planner that recosts its graph need the same one */
+  void setCostModelVersion(int v){ costModelVersion = v; }
+
+  /*! \brief Width (cm) of the band around a path that pullString() keeps its shortcuts in, 0 turns
+   *         string pulling off */
+  void setStringPullWidth(double w){ stringPullWidth = (w < 0 ? 0 : w); }
+
+  /*! \brief The nodes of path p that a robot has to head for in turn: a node is dropped when the
+   *         straight line between its neighbors is not obstructed and passes within the string
+   *         pull width of it and every other node dropped in between. The path is returned whole
+   *         when string pulling is off. */
+  list<int> pullString(list<int> p);
+
   /*! \return list of node indexes of waypoints */
   list<int> getPath(){ return path; }
   list<int> getOrigPath(){ return origPath; }
@@ -138,10 +199,13 @@ public:
     // origPathCosts.clear();
   }
 
-  void setCrowdModel(semaforr::CrowdModel c){ 
+  void setCrowdModel(const semaforr::CrowdModel::ConstPtr &c){ 
 	crowdModel = c;
   }
-  semaforr::CrowdModel getCrowdModel(){ return crowdModel;}
+  void setCrowdModel(const semaforr::CrowdModel &c){ 
+	crowdModel = boost::make_shared<semaforr::CrowdModel>(c);
+  }
+  const semaforr::CrowdModel &getCrowdModel(){ return *crowdModel;}
 
   void setOriginalNavGraph(Graph * navGraph){ 
     originalNavGraph = navGraph;
@@ -344,6 +408,11 @@ public:
     
   double calcPathCost(list<int>);
   double calcOrigPathCost(list<int>);
+
+  /*! \brief Costs of every plan on the graph of every planner, costs[planner][plan], each one what
+   *         calcPathCost() of that planner gives and 0 for the skeleton planners. Each plan is walked
+   *         once for all the planners. */
+  static vector< vector<double> > calcPathCosts(const vector<PathPlanner*> &planners, const vector< list<int> > &plans);
   double calcPathCost(vector<CartesianPoint> waypoints, Position source, Position target);
 
   double estimateCost(Node, Node, int); 
@@ -0,0 +1,135 @@
+/*!
+ * RecordFile.h
+ *
+ * Binary record file: a header (four character tag, M::SCHEMA_VERSION, md5sum of M)
+ * followed by one length-prefixed ros::serialization of M per record
+ *
+ */
+#ifndef RECORDFILE_H
+#define RECORDFILE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+#include <ros/ros.h>
+#include <ros/serialization.h>
+
+template <class M>
+class RecordFileWriter {
+  public:
+    RecordFileWriter(std::string fileMagic) : magic(fileMagic) {};
+    ~RecordFileWriter() { close(); };
+
+    // Opens (truncates) the file and writes the header, returns false if the file could not be opened
+    bool open(std::string fileName){
+      close();
+      out.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if(!out.is_open()){
+        ROS_WARN_STREAM("Could not open record file " << fileName);
+        return false;
+      }
+      out.write(magic.c_str(), 4);
+      uint16_t version = M::SCHEMA_VERSION;
+      out.write((const char*)&version, sizeof(version));
+      std::string md5 = ros::message_traits::MD5Sum<M>::value();
+      uint32_t md5Length = md5.size();
+      out.write((const char*)&md5Length, sizeof(md5Length));
+      out.write(md5.c_str(), md5Length);
+      return out.good();
+    }
+
+    bool isOpen() { return out.is_open(); }
+
+    void write(const M &record){
+      uint32_t length = ros::serialization::serializationLength(record);
+      if(buffer.size() < length){
+        buffer.resize(length);
+      }
+      ros::serialization::OStream stream(&buffer[0], length);
+      ros::serialization::serialize(stream, record);
+      out.write((const char*)&length, sizeof(length));
+      out.write((const char*)&buffer[0], length);
+      out.flush();
+    }
+
+    void close(){
+      if(out.is_open()){
+        out.close();
+      }
+    }
+
+  private:
+    std::string magic;
+    std::ofstream out;
+    // Reused between records so a record does not allocate a fresh buffer
+    std::vector<uint8_t> buffer;
+};
+
+template <class M>
+class RecordFileReader {
+  public:
+    RecordFileReader(std::string fileMagic) : magic(fileMagic), version(0) {};
+
+    // Opens the file and checks the header, returns false if it is not a compatible record file
+    bool open(std::string fileName){
+      in.open(fileName.c_str(), std::ios::in | std::ios::binary);
+      if(!in.is_open()){
+        return false;
+      }
+      char header[4];
+      in.read(header, 4);
+      if(!in.good() or std::string(header, 4) != magic){
+        return false;
+      }
+      in.read((char*)&version, sizeof(version));
+      uint32_t md5Length = 0;
+      in.read((char*)&md5Length, sizeof(md5Length));
+      if(!in.good() or md5Length > 64){
+        return false;
+      }
+      md5.resize(md5Length);
+      if(md5Length > 0){
+        in.read(&md5[0], md5Length);
+      }
+      if(version != M::SCHEMA_VERSION){
+        ROS_WARN_STREAM("Record file schema version " << version << " does not match version " << M::SCHEMA_VERSION);
+        return false;
+      }
+      if(md5 != ros::message_traits::MD5Sum<M>::value()){
+        ROS_WARN_STREAM("Record file message md5sum " << md5 << " does not match md5sum " << ros::message_traits::MD5Sum<M>::value());
+        return false;
+      }
+      return in.good();
+    }
+
+    // Reads the next record, returns false at the end of the file or on a truncated record
+    bool next(M &record){
+      uint32_t length = 0;
+      in.read((char*)&length, sizeof(length));
+      if(!in.good() or length == 0){
+        return false;
+      }
+      if(buffer.size() < length){
+        buffer.resize(length);
+      }
+      in.read((char*)&buffer[0], length);
+      if(in.gcount() != length){
+        return false;
+      }
+      ros::serialization::IStream stream(&buffer[0], length);
+      ros::serialization::deserialize(stream, record);
+      return true;
+    }
+
+    uint16_t getVersion() { return version; }
+
+  private:
+    std::string magic;
+    std::ifstream in;
+    uint16_t version;
+    std::string md5;
+    std::vector<uint8_t> buffer;
+};
+
+#endif
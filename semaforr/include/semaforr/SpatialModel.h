@@ -35,6 +35,25 @@ public:
 	FORRHallways* getHallways(){return hallways;}
 	FORRBarriers* getBarriers(){return barriers;}
 
+	void save(SnapshotWriter &out){
+		abstract_map->save(out);
+		trails->save(out);
+		conveyors->save(out);
+		doors->save(out);
+		hallways->save(out);
+		barriers->save(out);
+	}
+
+	// Each model is restored on its own, one that is missing from the snapshot stays as it is
+	void load(SnapshotReader &in){
+		abstract_map->load(in);
+		trails->load(in);
+		conveyors->load(in);
+		doors->load(in);
+		hallways->load(in);
+		barriers->load(in);
+	}
+
 private:
 	FORRRegionList *abstract_map;
 	//FORRTrace *trace;
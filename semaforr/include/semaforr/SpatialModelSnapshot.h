@@ -0,0 +1,343 @@
+/*!
+ * SpatialModelSnapshot.h
+ *
+ * Binary snapshot of the learned spatial model, so a run can start from what earlier runs on the
+ * same map learned. The file is a header (four character tag, SNAPSHOT_VERSION, hash of the map
+ * file, section count) followed by tagged, length-prefixed sections. Every field is 8 bytes wide
+ * and arrays are stored flat and padded to 8 bytes, so the reader maps the file and copies each
+ * array straight out of the mapping. Fields are in the byte order of the machine that wrote them.
+ *
+ */
+#ifndef SPATIALMODELSNAPSHOT_H
+#define SPATIALMODELSNAPSHOT_H
+
+#include "FORRGeometry.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ros/console.h>
+
+// Bumped whenever the layout of any section changes, older snapshots are then ignored
+#define SNAPSHOT_VERSION 1
+
+// 64 bit FNV-1a hash of the file's contents, 0 if it cannot be read
+inline uint64_t hashFile(std::string fileName){
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+  if(!in.is_open()){
+    return 0;
+  }
+  uint64_t hash = 14695981039346656037ULL;
+  char buffer[65536];
+  while(in.good()){
+    in.read(buffer, sizeof(buffer));
+    std::streamsize count = in.gcount();
+    for(std::streamsize i = 0; i < count; i++){
+      hash ^= (unsigned char)buffer[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+class SnapshotWriter {
+  public:
+    SnapshotWriter() : sectionStart(0), sections(0) {};
+
+    // Sections are written one after the other, each closed by endSection before the next begins
+    void beginSection(std::string tag){
+      std::string padded = (tag + "    ").substr(0, 4);
+      data.insert(data.end(), padded.begin(), padded.end());
+      putRaw(0, 4);
+      sectionStart = data.size();
+      putRaw(0, 8);
+    }
+
+    void endSection(){
+      uint64_t length = data.size() - sectionStart - 8;
+      memcpy(&data[sectionStart], &length, 8);
+      sections++;
+    }
+
+    void putInt(int64_t value) { putRaw(&value, 8); }
+    void putDouble(double value) { putRaw(&value, 8); }
+    void putPoint(CartesianPoint point) { putDouble(point.get_x()); putDouble(point.get_y()); }
+
+    void putInts(const std::vector<int> &values){
+      putInt(values.size());
+      if(values.size() > 0){
+        putRaw(&values[0], values.size() * sizeof(int));
+      }
+      pad();
+    }
+
+    void putDoubles(const std::vector<double> &values){
+      putInt(values.size());
+      if(values.size() > 0){
+        putRaw(&values[0], values.size() * sizeof(double));
+      }
+    }
+
+    void putPoints(const std::vector<CartesianPoint> &points){
+      putInt(points.size());
+      for(int i = 0; i < points.size(); i++){
+        putPoint(points[i]);
+      }
+    }
+
+    void putPointLists(const std::vector< std::vector<CartesianPoint> > &lists){
+      putInt(lists.size());
+      for(int i = 0; i < lists.size(); i++){
+        putPoints(lists[i]);
+      }
+    }
+
+    // Rows of equal length written as one flat array, an empty grid has no columns
+    void putIntGrid(const std::vector< std::vector<int> > &grid){
+      int rows = grid.size();
+      int cols = (rows > 0 ? grid[0].size() : 0);
+      putInt(rows);
+      putInt(cols);
+      for(int i = 0; i < rows; i++){
+        if(cols > 0){
+          putRaw(&grid[i][0], cols * sizeof(int));
+        }
+      }
+      pad();
+    }
+
+    void putIntGridList(const std::vector< std::vector<int> > &rows){
+      putInt(rows.size());
+      for(int i = 0; i < rows.size(); i++){
+        putInts(rows[i]);
+      }
+    }
+
+    // Writes the header and the sections to a temporary file next to fileName and then renames
+    // it, so a reader never sees a half written snapshot
+    bool write(std::string fileName, uint64_t mapHash){
+      std::string temporary = fileName + ".tmp";
+      std::ofstream out(temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if(!out.is_open()){
+        ROS_WARN_STREAM("Could not open spatial model snapshot " << temporary);
+        return false;
+      }
+      out.write("SFSM", 4);
+      uint32_t version = SNAPSHOT_VERSION;
+      out.write((const char*)&version, sizeof(version));
+      out.write((const char*)&mapHash, sizeof(mapHash));
+      uint64_t count = sections;
+      out.write((const char*)&count, sizeof(count));
+      if(data.size() > 0){
+        out.write(&data[0], data.size());
+      }
+      out.close();
+      if(out.fail() or rename(temporary.c_str(), fileName.c_str()) != 0){
+        ROS_WARN_STREAM("Could not write spatial model snapshot " << fileName);
+        return false;
+      }
+      return true;
+    }
+
+  private:
+    void putRaw(const void *bytes, int length){
+      int start = data.size();
+      data.resize(start + length, 0);
+      if(bytes != 0){
+        memcpy(&data[start], bytes, length);
+      }
+    }
+
+    void pad(){
+      data.resize((data.size() + 7) / 8 * 8, 0);
+    }
+
+    std::vector<char> data;
+    int sectionStart;
+    int sections;
+};
+
+class SnapshotReader {
+  public:
+    SnapshotReader() : base(0), size(0), position(0), end(0), failed(false) {};
+    ~SnapshotReader() { close(); };
+
+    // Maps the file and checks its header, returns false if there is no snapshot or it was written
+    // by another version or for another map
+    bool open(std::string fileName, uint64_t mapHash){
+      close();
+      int fd = ::open(fileName.c_str(), O_RDONLY);
+      if(fd < 0){
+        return false;
+      }
+      struct stat info;
+      if(fstat(fd, &info) != 0 or info.st_size < 24){
+        ::close(fd);
+        return false;
+      }
+      void *mapping = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if(mapping == MAP_FAILED){
+        return false;
+      }
+      base = (const char*)mapping;
+      size = info.st_size;
+      uint32_t version;
+      uint64_t hash, count;
+      memcpy(&version, base + 4, 4);
+      memcpy(&hash, base + 8, 8);
+      memcpy(&count, base + 16, 8);
+      if(std::string(base, 4) != "SFSM" or version != SNAPSHOT_VERSION){
+        ROS_WARN_STREAM("Ignoring spatial model snapshot " << fileName << " of another version");
+        close();
+        return false;
+      }
+      if(hash != mapHash){
+        ROS_WARN_STREAM("Ignoring spatial model snapshot " << fileName << " learned on another map");
+        close();
+        return false;
+      }
+      // Index the sections, a truncated section ends the index
+      uint64_t offset = 24;
+      for(uint64_t i = 0; i < count and offset + 16 <= size; i++){
+        uint64_t length;
+        memcpy(&length, base + offset + 8, 8);
+        if(length > size - offset - 16){
+          break;
+        }
+        sectionOffsets[std::string(base + offset, 4)] = std::make_pair(offset + 16, length);
+        offset += 16 + length;
+      }
+      return true;
+    }
+
+    void close(){
+      if(base != 0){
+        munmap((void*)base, size);
+      }
+      base = 0;
+      size = 0;
+      sectionOffsets.clear();
+    }
+
+    // Moves to the start of the section, returns false if the snapshot does not have it
+    bool section(std::string tag){
+      std::string padded = (tag + "    ").substr(0, 4);
+      std::map<std::string, std::pair<uint64_t, uint64_t> >::iterator it = sectionOffsets.find(padded);
+      if(it == sectionOffsets.end()){
+        return false;
+      }
+      position = it->second.first;
+      end = it->second.first + it->second.second;
+      failed = false;
+      return true;
+    }
+
+    // False once a read ran past the end of the current section, the values read are then zeros
+    bool ok() { return !failed; }
+
+    int64_t getInt() { int64_t value = 0; getRaw(&value, 8); return value; }
+    double getDouble() { double value = 0; getRaw(&value, 8); return value; }
+    CartesianPoint getPoint() { double x = getDouble(); double y = getDouble(); return CartesianPoint(x, y); }
+
+    std::vector<int> getInts(){
+      std::vector<int> values(getCount(sizeof(int)));
+      if(values.size() > 0){
+        getRaw(&values[0], values.size() * sizeof(int));
+      }
+      skipPadding();
+      return values;
+    }
+
+    std::vector<double> getDoubles(){
+      std::vector<double> values(getCount(sizeof(double)));
+      if(values.size() > 0){
+        getRaw(&values[0], values.size() * sizeof(double));
+      }
+      return values;
+    }
+
+    std::vector<CartesianPoint> getPoints(){
+      std::vector<CartesianPoint> points(getCount(16));
+      for(int i = 0; i < points.size(); i++){
+        points[i] = getPoint();
+      }
+      return points;
+    }
+
+    std::vector< std::vector<CartesianPoint> > getPointLists(){
+      std::vector< std::vector<CartesianPoint> > lists(getCount(8));
+      for(int i = 0; i < lists.size(); i++){
+        lists[i] = getPoints();
+      }
+      return lists;
+    }
+
+    std::vector< std::vector<int> > getIntGrid(){
+      int64_t rows = getInt();
+      int64_t cols = getInt();
+      if(rows < 0 or cols < 0 or (cols > 0 and rows * cols * sizeof(int) > end - position)){
+        failed = true;
+        return std::vector< std::vector<int> >();
+      }
+      std::vector< std::vector<int> > grid(rows, std::vector<int>(cols));
+      for(int i = 0; i < rows; i++){
+        if(cols > 0){
+          getRaw(&grid[i][0], cols * sizeof(int));
+        }
+      }
+      skipPadding();
+      return grid;
+    }
+
+    std::vector< std::vector<int> > getIntGridList(){
+      std::vector< std::vector<int> > rows(getCount(8));
+      for(int i = 0; i < rows.size(); i++){
+        rows[i] = getInts();
+      }
+      return rows;
+    }
+
+  private:
+    void getRaw(void *bytes, uint64_t length){
+      if(failed or length > end - position){
+        failed = true;
+        memset(bytes, 0, length);
+        return;
+      }
+      memcpy(bytes, base + position, length);
+      position += length;
+    }
+
+    // Element count of the array that follows, 0 if the section is too short to hold that many
+    uint64_t getCount(uint64_t elementSize){
+      int64_t count = getInt();
+      if(count < 0 or (uint64_t)count > (end - position) / elementSize){
+        failed = true;
+        return 0;
+      }
+      return count;
+    }
+
+    void skipPadding(){
+      uint64_t aligned = (position + 7) / 8 * 8;
+      position = (aligned > end ? end : aligned);
+    }
+
+    const char *base;
+    uint64_t size;
+    uint64_t position, end;
+    bool failed;
+    // Tag of each section and the offset and length of its contents
+    std::map<std::string, std::pair<uint64_t, uint64_t> > sectionOffsets;
+};
+
+#endif
@@ -71,7 +71,7 @@ class Task {
       decisionSequence = new std::vector<FORRAction>;
       pos_hist = new vector<Position>();
       laser_hist = new vector< vector<CartesianPoint> >();
-      laser_scan_hist = new vector< sensor_msgs::LaserScan >();
+      laser_scan_hist = new vector< sensor_msgs::LaserScan::ConstPtr >();
       dimension = 200;
       if(length > dimension){
         dimension = length;
@@ -201,7 +201,7 @@ class Task {
 
   void clearPositionHistory(){pos_hist->clear();}
 
-  void saveSensor(Position currentPosition, vector<CartesianPoint> laserEndpoints, sensor_msgs::LaserScan ls){
+  void saveSensor(Position currentPosition, const vector<CartesianPoint> &laserEndpoints, const sensor_msgs::LaserScan::ConstPtr &ls){
   	pos_hist->push_back(currentPosition);
   	laser_hist->push_back(laserEndpoints);
   	laser_scan_hist->push_back(ls);
@@ -218,9 +218,16 @@ class Task {
 	// }
   }
 
+  // Takes back the last saveSensor
+  void dropLastSensor(){
+  	pos_hist->pop_back();
+  	laser_hist->pop_back();
+  	laser_scan_hist->pop_back();
+  }
+
   vector< vector <CartesianPoint> > *getLaserHistory(){return laser_hist;}
 
-  vector< sensor_msgs::LaserScan > *getLaserScanHistory(){return laser_scan_hist;}
+  vector< sensor_msgs::LaserScan::ConstPtr > *getLaserScanHistory(){return laser_scan_hist;}
 
   vector<CartesianPoint> getWaypoints(){
   	// cout << "in getWaypoints" << endl;
@@ -444,8 +451,10 @@ class Task {
 	pathPlanner = planner;
 	plannerName = planner->getName();
 	if(plannerName != "skeleton" and plannerName != "hallwayskel"){
+		// waypoints only where the plan turns, waypointInd keeps every node for the path costs
+		list<int> pulledInd = planner->pullString(waypointInd);
 		list<int>::iterator it;
-		for ( it = waypointInd.begin(); it != waypointInd.end(); it++ ){
+		for ( it = pulledInd.begin(); it != pulledInd.end(); it++ ){
 			// cout << "node " << (*it) << endl;
 			double r_x = navGraph->getNode(*it).getX()/100.0;
 			double r_y = navGraph->getNode(*it).getY()/100.0;
@@ -2382,7 +2391,7 @@ class Task {
   vector< vector<CartesianPoint> > *laser_hist; 
 
   // Laser scan history sensor
-  vector< sensor_msgs::LaserScan > *laser_scan_hist;
+  vector< sensor_msgs::LaserScan::ConstPtr > *laser_scan_hist;
 
   // Cleaned Position History, along with its corresponding laser scan data : Set of cleaned positions
   std::pair < std::vector<CartesianPoint>, std::vector<vector<CartesianPoint> > > *cleaned_trail;
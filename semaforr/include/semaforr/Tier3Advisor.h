@@ -61,6 +61,11 @@ class Tier3Advisor {
     // This function will return advices on all proposed actions
     std::map <FORRAction, double> allAdvice();
 
+    // Comments on every action before vetoes and normalization, computed ahead of time when speculating
+    std::map <FORRAction, double> rawAdvice();
+    // What allAdvice would return from the comments of rawAdvice under the current vetoes
+    std::map <FORRAction, double> adviceFromRaw(std::map <FORRAction, double> raw);
+
     // method that returns advisor's name; it is used to print it out in the log
     // to see which advisor gave what advice strenght to which action
     string get_name(){ return name;}
@@ -21,9 +21,95 @@
 #include <std_msgs/String.h>
 #include <string>
 #include <semaforr/CrowdModel.h>
+#include <semaforr/DecisionLog.h>
+#include <sys/time.h>
+#include <boost/thread.hpp>
+#include "DecisionLogFile.h"
+#include "Instrumentation.h"
+// DiagnosticStatus declares an ERROR level, which FORRGeometry.h defines as a macro
+#pragma push_macro("ERROR")
+#undef ERROR
+#include <diagnostic_msgs/DiagnosticArray.h>
+#pragma pop_macro("ERROR")
 
 using namespace std;
 
+// Groups of topics that are rebuilt and rate limited together
+enum VisualizationLayer { VIZ_TASK, VIZ_CONVEYOR, VIZ_HALLWAYS, VIZ_REGIONS, VIZ_TRAILS, VIZ_DOORS, VIZ_WALLS, VIZ_HIGHWAY, VIZ_LAYER_COUNT };
+
+// Copy of everything the visualization layers draw. It is taken on the decision thread and handed
+// to the visualization thread, which never reads the live beliefs. Only layers set in layers are filled.
+struct VisualizationSnapshot {
+  int layers;
+  // VIZ_TASK
+  double targetX, targetY, waypointX, waypointY;
+  vector<CartesianPoint> waypoints, origWaypoints, allTargets, remainingTargets;
+  // VIZ_CONVEYOR
+  int conveyorGranularity, conveyorWidth, conveyorHeight;
+  vector< vector<int> > conveyors;
+  // VIZ_HALLWAYS, VIZ_REGIONS, VIZ_TRAILS, VIZ_DOORS, VIZ_WALLS
+  vector<Aggregate> hallways;
+  vector<FORRRegion> regions;
+  vector< vector<CartesianPoint> > trails;
+  vector< vector<Door> > doors;
+  vector<Wall> walls;
+  // VIZ_HIGHWAY
+  int highwaysOn, highwayLength, highwayHeight;
+  double highwayTargetX, highwayTargetY;
+  vector< vector<int> > highwayGrid;
+  vector< vector<double> > highwayPath;
+  vector<Position> highwayStack;
+
+  VisualizationSnapshot() : layers(0), targetX(0), targetY(0), waypointX(0), waypointY(0), conveyorGranularity(1), conveyorWidth(0), conveyorHeight(0), highwaysOn(0), highwayLength(0), highwayHeight(0), highwayTargetX(0), highwayTargetY(0) {};
+
+  bool hasLayer(int layer) const { return layers & (1 << layer); }
+
+  // Moves the layers carried by newer into this snapshot, replacing older copies of the same layers
+  void merge(VisualizationSnapshot &newer){
+    if(newer.hasLayer(VIZ_TASK)){
+      targetX = newer.targetX; targetY = newer.targetY;
+      waypointX = newer.waypointX; waypointY = newer.waypointY;
+      waypoints.swap(newer.waypoints);
+      origWaypoints.swap(newer.origWaypoints);
+      allTargets.swap(newer.allTargets);
+      remainingTargets.swap(newer.remainingTargets);
+    }
+    if(newer.hasLayer(VIZ_CONVEYOR)){
+      conveyorGranularity = newer.conveyorGranularity;
+      conveyorWidth = newer.conveyorWidth;
+      conveyorHeight = newer.conveyorHeight;
+      conveyors.swap(newer.conveyors);
+    }
+    if(newer.hasLayer(VIZ_HALLWAYS)){
+      hallways.swap(newer.hallways);
+    }
+    if(newer.hasLayer(VIZ_REGIONS)){
+      regions.swap(newer.regions);
+    }
+    if(newer.hasLayer(VIZ_TRAILS)){
+      trails.swap(newer.trails);
+    }
+    if(newer.hasLayer(VIZ_DOORS)){
+      doors.swap(newer.doors);
+    }
+    if(newer.hasLayer(VIZ_WALLS)){
+      walls.swap(newer.walls);
+    }
+    if(newer.hasLayer(VIZ_HIGHWAY)){
+      highwaysOn = newer.highwaysOn;
+      highwayLength = newer.highwayLength;
+      highwayHeight = newer.highwayHeight;
+      highwayTargetX = newer.highwayTargetX;
+      highwayTargetY = newer.highwayTargetY;
+      highwayGrid.swap(newer.highwayGrid);
+      highwayPath.swap(newer.highwayPath);
+      highwayStack.swap(newer.highwayStack);
+    }
+    layers |= newer.layers;
+    newer.layers = 0;
+  }
+};
+
 
 class Visualizer
 {
@@ -60,10 +146,34 @@ private:
   ros::Publisher highway_plan_pub_;
   ros::Publisher highway_target_pub_;
   ros::Publisher highway_stack_pub_;
+  ros::Publisher diagnostics_pub_;
   Controller *con;
   Beliefs *beliefs;
   ros::NodeHandle *nh_;
   int visualized;
+  DecisionLogWriter logFile;
+  // Last logged copy of each spatial model section with its content hash and version,
+  // indexed by the bit position of its DecisionLog::SECTION_* flag
+  semaforr::DecisionLog loggedSections;
+  uint64_t sectionHashes[6];
+  uint32_t sectionVersions[6];
+  int loggedSpatialModelVersion;
+  int decisionsSinceKeyframe;
+  // Visualization thread and the snapshot waiting for it
+  boost::thread vizThread;
+  boost::mutex vizMutex;
+  boost::condition_variable vizCondition;
+  VisualizationSnapshot pendingSnapshot;
+  bool stopVisualization;
+  // Per layer bookkeeping: waiting for a publish, last publish time, subscribers seen and spatial model version drawn
+  bool layerDirty[VIZ_LAYER_COUNT];
+  double layerPublishTime[VIZ_LAYER_COUNT];
+  int layerSubscribers[VIZ_LAYER_COUNT];
+  int layerSpatialModelVersion[VIZ_LAYER_COUNT];
+  // Shortest time between two publishes of the same layer in seconds
+  double layerMinInterval;
+  // Time between two diagnostics messages in seconds, 0 when they are off
+  double diagnosticsInterval;
 
 public:
   //! ROS node initialization
@@ -71,6 +181,12 @@ public:
   {
     nh_ = nh;
     visualized = false;
+    for(int i = 0; i < 6; i++){
+      sectionHashes[i] = 0;
+      sectionVersions[i] = 0;
+    }
+    loggedSpatialModelVersion = -1;
+    decisionsSinceKeyframe = 0;
     //set up the publisher for the cmd_vel topic
     target_pub_ = nh_->advertise<geometry_msgs::PointStamped>("target_point", 1);
     waypoint_pub_ = nh_->advertise<geometry_msgs::PointStamped>("waypoint", 1);
@@ -94,7 +210,7 @@ public:
     edges_cost_pub_ = nh_->advertise<visualization_msgs::MarkerArray>("edges_cost", 1);
     //trails_pub_ = nh_->advertise<nav_msgs::Path>("trail", 1);
     trails_pub_ = nh_->advertise<visualization_msgs::Marker>("trail", 1);
-    stats_pub_ = nh_->advertise<std_msgs::String>("decision_log", 1);
+    stats_pub_ = nh_->advertise<semaforr::DecisionLog>("decision_log", 1);
     doors_pub_ = nh_->advertise<visualization_msgs::Marker>("door", 1);
     barriers_pub_ = nh_->advertise<visualization_msgs::Marker>("barrier", 1);
     walls_pub_ = nh_->advertise<visualization_msgs::Marker>("walls", 1);
@@ -104,47 +220,308 @@ public:
     highway_plan_pub_ = nh_->advertise<nav_msgs::Path>("highway_plan", 1);
     highway_target_pub_ = nh_->advertise<geometry_msgs::PointStamped>("highway_target_point", 1);
     highway_stack_pub_ = nh_->advertise<visualization_msgs::Marker>("highway_stack", 1);
+    diagnostics_pub_ = nh_->advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 1);
     //declare and create a controller with task, action and advisor configuration
     con = c;
     beliefs = con->getBeliefs();
+    if(con->getDecisionLogFile() != ""){
+      logFile.open(con->getDecisionLogFile());
+    }
+    layerMinInterval = (con->getVisualizationRate() > 0 ? 1.0 / con->getVisualizationRate() : 0);
+    diagnosticsInterval = (con->getDiagnosticsRate() > 0 ? 1.0 / con->getDiagnosticsRate() : 0);
+    for(int i = 0; i < VIZ_LAYER_COUNT; i++){
+      layerDirty[i] = false;
+      layerPublishTime[i] = 0;
+      layerSubscribers[i] = 0;
+      layerSpatialModelVersion[i] = -1;
+    }
+    stopVisualization = false;
+    vizThread = boost::thread(&Visualizer::visualizationLoop, this);
+  }
+
+  ~Visualizer(){
+    {
+      boost::lock_guard<boost::mutex> lock(vizMutex);
+      stopVisualization = true;
+    }
+    vizCondition.notify_one();
+    vizThread.join();
   }
 
+  // Called on the decision thread after every updateState. Copies the layers that changed, have
+  // subscribers and are not rate limited, and leaves building and sending the messages to the visualization thread.
   void publish(){
-	if(beliefs->getAgentState()->getCurrentTask() != NULL and con->getHighwayFinished()){
-		publish_next_target();
-		publish_next_waypoint();
-		publish_plan();
-		publish_original_plan();
-		publish_all_targets();
-		publish_remaining_targets();
+	timeval tv;
+	gettimeofday(&tv,NULL);
+	double now = tv.tv_sec + (tv.tv_usec/1000000.0);
+	int spatialModelVersion = con->getSpatialModelVersion();
+	VisualizationSnapshot snapshot;
+
+	bool taskActive = (beliefs->getAgentState()->getCurrentTask() != NULL and con->getHighwayFinished());
+	if(layerDue(VIZ_TASK, taskActive, now)){
+		Task *task = beliefs->getAgentState()->getCurrentTask();
+		snapshot.targetX = task->getTaskX();
+		snapshot.targetY = task->getTaskY();
+		snapshot.waypointX = task->getX();
+		snapshot.waypointY = task->getY();
+		snapshot.waypoints = task->getWaypoints();
+		snapshot.origWaypoints = task->getOrigWaypoints();
+		list<Task*>& all_agenda = beliefs->getAgentState()->getAllAgenda();
+		for(list<Task*>::iterator it = all_agenda.begin(); it != all_agenda.end(); it++){
+			snapshot.allTargets.push_back(CartesianPoint((*it)->getX(), (*it)->getY()));
+		}
+		list<Task*>& agenda = beliefs->getAgentState()->getAgenda();
+		for(list<Task*>::iterator it = agenda.begin(); it != agenda.end(); it++){
+			snapshot.remainingTargets.push_back(CartesianPoint((*it)->getX(), (*it)->getY()));
+		}
+		snapshot.layers |= (1 << VIZ_TASK);
+	}
+	if(layerDue(VIZ_CONVEYOR, spatialModelChanged(VIZ_CONVEYOR, spatialModelVersion), now)){
+		snapshot.conveyorGranularity = beliefs->getSpatialModel()->getConveyors()->getGranularity();
+		snapshot.conveyorWidth = beliefs->getSpatialModel()->getConveyors()->getBoxWidth();
+		snapshot.conveyorHeight = beliefs->getSpatialModel()->getConveyors()->getBoxHeight();
+		snapshot.conveyors = beliefs->getSpatialModel()->getConveyors()->getConveyors();
+		snapshot.layers |= (1 << VIZ_CONVEYOR);
+	}
+	if(layerDue(VIZ_HALLWAYS, spatialModelChanged(VIZ_HALLWAYS, spatialModelVersion), now)){
+		snapshot.hallways = beliefs->getSpatialModel()->getHallways()->getHallways();
+		snapshot.layers |= (1 << VIZ_HALLWAYS);
+	}
+	if(layerDue(VIZ_REGIONS, spatialModelChanged(VIZ_REGIONS, spatialModelVersion), now)){
+		snapshot.regions = beliefs->getSpatialModel()->getRegionList()->getRegions();
+		snapshot.layers |= (1 << VIZ_REGIONS);
+	}
+	if(layerDue(VIZ_TRAILS, spatialModelChanged(VIZ_TRAILS, spatialModelVersion), now)){
+		snapshot.trails = beliefs->getSpatialModel()->getTrails()->getTrailsPoints();
+		snapshot.layers |= (1 << VIZ_TRAILS);
+	}
+	if(layerDue(VIZ_DOORS, spatialModelChanged(VIZ_DOORS, spatialModelVersion), now)){
+		snapshot.doors = beliefs->getSpatialModel()->getDoors()->getDoors();
+		snapshot.layers |= (1 << VIZ_DOORS);
+	}
+	// The map does not change during a run, walls are only sent again to new subscribers
+	if(layerDue(VIZ_WALLS, layerSpatialModelVersion[VIZ_WALLS] == -1, now)){
+		layerSpatialModelVersion[VIZ_WALLS] = spatialModelVersion;
+		snapshot.walls = con->getPlanner()->getMap()->getWalls();
+		snapshot.layers |= (1 << VIZ_WALLS);
+	}
+	// Highways change every decision while they are being explored
+	bool highwayChanged = spatialModelChanged(VIZ_HIGHWAY, spatialModelVersion);
+	if(con->getHighwaysOn() == 1){
+		highwayChanged = highwayChanged or !con->getHighwayFinished();
+	}
+	else if(con->getHighwaysOn() == 2){
+		highwayChanged = highwayChanged or !con->getFrontierFinished();
+	}
+	if(layerDue(VIZ_HIGHWAY, con->getHighwaysOn() != 0 and highwayChanged, now)){
+		snapshot.highwaysOn = con->getHighwaysOn();
+		if(con->getHighwaysOn() == 1){
+			snapshot.highwayLength = con->gethighwayExploration()->getLength();
+			snapshot.highwayHeight = con->gethighwayExploration()->getHeight();
+			if(con->getHighwayFinished()){
+				snapshot.highwayGrid = beliefs->getAgentState()->getPassageGrid();
+			}
+			else{
+				snapshot.highwayGrid = con->gethighwayExploration()->getHighwayGrid();
+			}
+			snapshot.highwayPath = con->gethighwayExploration()->getHighwayPath();
+			snapshot.highwayTargetX = con->gethighwayExploration()->getHighwayTarget().getX();
+			snapshot.highwayTargetY = con->gethighwayExploration()->getHighwayTarget().getY();
+			snapshot.highwayStack = con->gethighwayExploration()->getHighwayStack();
+		}
+		else{
+			snapshot.highwayLength = con->getfrontierExploration()->getLength();
+			snapshot.highwayHeight = con->getfrontierExploration()->getHeight();
+			if(con->getFrontierFinished()){
+				snapshot.highwayGrid = beliefs->getAgentState()->getPassageGrid();
+			}
+			else{
+				snapshot.highwayGrid = con->getfrontierExploration()->getFrontierGrid();
+			}
+			snapshot.highwayPath = con->getfrontierExploration()->getFrontierPath();
+			snapshot.highwayTargetX = con->getfrontierExploration()->getFrontierTarget().getX();
+			snapshot.highwayTargetY = con->getfrontierExploration()->getFrontierTarget().getY();
+			snapshot.highwayStack = con->getfrontierExploration()->getFrontierStack();
+		}
+		snapshot.layers |= (1 << VIZ_HIGHWAY);
+	}
+
+	if(snapshot.layers != 0){
+		{
+			boost::lock_guard<boost::mutex> lock(vizMutex);
+			pendingSnapshot.merge(snapshot);
+		}
+		vizCondition.notify_one();
+	}
+  }
+
+  // True once per spatial model version for the given layer
+  bool spatialModelChanged(int layer, int spatialModelVersion){
+	if(layerSpatialModelVersion[layer] == spatialModelVersion){
+		return false;
+	}
+	layerSpatialModelVersion[layer] = spatialModelVersion;
+	return true;
+  }
+
+  // Marks the layer dirty when it changed or gained a subscriber, and returns true when a dirty layer
+  // has someone listening and was last published at least layerMinInterval ago
+  bool layerDue(int layer, bool changed, double now){
+	int subscribers = layerSubscriberCount(layer);
+	if(changed or subscribers > layerSubscribers[layer]){
+		layerDirty[layer] = true;
+	}
+	layerSubscribers[layer] = subscribers;
+	if(!layerDirty[layer] or subscribers == 0 or now - layerPublishTime[layer] < layerMinInterval){
+		return false;
+	}
+	layerDirty[layer] = false;
+	layerPublishTime[layer] = now;
+	return true;
+  }
+
+  int layerSubscriberCount(int layer){
+	switch(layer){
+		case VIZ_TASK:
+			return target_pub_.getNumSubscribers() + waypoint_pub_.getNumSubscribers() + plan_pub_.getNumSubscribers() + waypoints_pub_.getNumSubscribers() + original_plan_pub_.getNumSubscribers() + all_targets_pub_.getNumSubscribers() + remaining_targets_pub_.getNumSubscribers();
+		case VIZ_CONVEYOR:
+			return conveyor_pub_.getNumSubscribers();
+		case VIZ_HALLWAYS:
+			return hallway1_pub_.getNumSubscribers() + hallway2_pub_.getNumSubscribers() + hallway3_pub_.getNumSubscribers() + hallway4_pub_.getNumSubscribers();
+		case VIZ_REGIONS:
+			return region_pub_.getNumSubscribers() + exits_pub_.getNumSubscribers() + skeleton_pub_.getNumSubscribers();
+		case VIZ_TRAILS:
+			return trails_pub_.getNumSubscribers();
+		case VIZ_DOORS:
+			return doors_pub_.getNumSubscribers();
+		case VIZ_WALLS:
+			return walls_pub_.getNumSubscribers();
+		case VIZ_HIGHWAY:
+			return highway_pub_.getNumSubscribers() + highway_plan_pub_.getNumSubscribers() + highway_target_pub_.getNumSubscribers() + highway_stack_pub_.getNumSubscribers();
+	}
+	return 0;
+  }
+
+  // Visualization thread, waits for snapshots and publishes their layers
+  // Publishes snapshots as they arrive, and the stage latencies and counters every diagnosticsInterval
+  void visualizationLoop(){
+	double nextDiagnostics = getMonotonicTimeSec() + diagnosticsInterval;
+	while(true){
+		VisualizationSnapshot snapshot;
+		{
+			boost::unique_lock<boost::mutex> lock(vizMutex);
+			while(pendingSnapshot.layers == 0 and !stopVisualization){
+				if(diagnosticsInterval <= 0){
+					vizCondition.wait(lock);
+					continue;
+				}
+				double remaining = nextDiagnostics - getMonotonicTimeSec();
+				if(remaining <= 0){
+					break;
+				}
+				vizCondition.timed_wait(lock, boost::posix_time::microseconds((long)(remaining * 1000000.0) + 1));
+			}
+			if(stopVisualization){
+				return;
+			}
+			snapshot.merge(pendingSnapshot);
+		}
+		if(snapshot.layers != 0){
+			ScopedTimer vizTimer("visualization");
+			publishSnapshot(snapshot);
+		}
+		if(diagnosticsInterval > 0 and getMonotonicTimeSec() >= nextDiagnostics){
+			publish_diagnostics();
+			nextDiagnostics = getMonotonicTimeSec() + diagnosticsInterval;
+		}
+	}
+  }
+
+  // One status per stage with its latency percentiles in seconds, and one status holding every counter
+  void publish_diagnostics(){
+	diagnostic_msgs::DiagnosticArray diagnostics;
+	diagnostics.header.stamp = ros::Time::now();
+	std::map<std::string, LatencyHistogram*> stages = Instrumentation::instance().getHistograms();
+	for(std::map<std::string, LatencyHistogram*>::iterator it = stages.begin(); it != stages.end(); it++){
+		diagnostic_msgs::DiagnosticStatus status;
+		status.level = diagnostic_msgs::DiagnosticStatus::OK;
+		status.name = "semaforr/" + it->first;
+		status.hardware_id = "semaforr";
+		status.message = "latency in seconds";
+		addDiagnosticValue(status, "count", it->second->getCount());
+		addDiagnosticValue(status, "mean", it->second->getMean());
+		addDiagnosticValue(status, "p50", it->second->percentile(0.5));
+		addDiagnosticValue(status, "p99", it->second->percentile(0.99));
+		addDiagnosticValue(status, "max", it->second->getMax());
+		diagnostics.status.push_back(status);
+	}
+	std::map<std::string, Counter*> events = Instrumentation::instance().getCounters();
+	diagnostic_msgs::DiagnosticStatus counters;
+	counters.level = diagnostic_msgs::DiagnosticStatus::OK;
+	counters.name = "semaforr/counters";
+	counters.hardware_id = "semaforr";
+	counters.message = "event counts";
+	for(std::map<std::string, Counter*>::iterator it = events.begin(); it != events.end(); it++){
+		addDiagnosticValue(counters, it->first, it->second->get());
+	}
+	diagnostics.status.push_back(counters);
+	diagnostics_pub_.publish(diagnostics);
+  }
+
+  template <class T>
+  void addDiagnosticValue(diagnostic_msgs::DiagnosticStatus &status, std::string key, T value){
+	diagnostic_msgs::KeyValue entry;
+	entry.key = key;
+	std::stringstream stream;
+	stream << value;
+	entry.value = stream.str();
+	status.values.push_back(entry);
+  }
+
+  void publishSnapshot(const VisualizationSnapshot &snapshot){
+	if(snapshot.hasLayer(VIZ_TASK)){
+		publish_next_target(snapshot);
+		publish_next_waypoint(snapshot);
+		publish_plan(snapshot);
+		publish_original_plan(snapshot);
+		publish_all_targets(snapshot);
+		publish_remaining_targets(snapshot);
 	}
 	// publish_nodes();
 	// publish_reachable_nodes();
 	// publish_edges();
-        /*if(visualized < 5){
-		publish_nodes();
-		publish_reachable_nodes();
-		//publish_edges();
-		visualized++;
-	}*/
 	//publish_edges_cost();
-	publish_conveyor();
-	publish_hallway1();
-	publish_hallway2();
-	publish_hallway3();
-	publish_hallway4();
-	publish_region();
-	publish_exits();
-	publish_skeleton();
-	publish_trails();
-	publish_doors();
+	if(snapshot.hasLayer(VIZ_CONVEYOR)){
+		publish_conveyor(snapshot);
+	}
+	if(snapshot.hasLayer(VIZ_HALLWAYS)){
+		publish_hallway1(snapshot);
+		publish_hallway2(snapshot);
+		publish_hallway3(snapshot);
+		publish_hallway4(snapshot);
+	}
+	if(snapshot.hasLayer(VIZ_REGIONS)){
+		publish_region(snapshot);
+		publish_exits(snapshot);
+		publish_skeleton(snapshot);
+	}
+	if(snapshot.hasLayer(VIZ_TRAILS)){
+		publish_trails(snapshot);
+	}
+	if(snapshot.hasLayer(VIZ_DOORS)){
+		publish_doors(snapshot);
+	}
 	// publish_barriers();
-	publish_walls();
+	if(snapshot.hasLayer(VIZ_WALLS)){
+		publish_walls(snapshot);
+	}
 	// //publish_occupancy();
-	publish_highway();
-	publish_highway_plan();
-	publish_highway_target();
-	publish_highway_stack();
+	if(snapshot.hasLayer(VIZ_HIGHWAY)){
+		publish_highway(snapshot);
+		publish_highway_plan(snapshot);
+		publish_highway_target(snapshot);
+		publish_highway_stack(snapshot);
+	}
   }
 
 
@@ -331,59 +708,53 @@ public:
 	edges_pub_.publish(markerArray);
   }
 
-  void publishLog(FORRAction decision, double overallTimeSec, double computationTimeSec){
-	publish_log(decision, overallTimeSec, computationTimeSec);
+  void publishLog(FORRAction decision, double overallTimeSec, double computationTimeSec, double senseToActSec = 0){
+	publish_log(decision, overallTimeSec, computationTimeSec, senseToActSec);
   }
 
-  void publish_next_target(){
+  void publish_next_target(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside visualization tool!!");
 	geometry_msgs::PointStamped target;
 	target.header.frame_id = "map";
 	target.header.stamp = ros::Time::now();
-	target.point.x = beliefs->getAgentState()->getCurrentTask()->getTaskX();
-	target.point.y = beliefs->getAgentState()->getCurrentTask()->getTaskY();
+	target.point.x = snapshot.targetX;
+	target.point.y = snapshot.targetY;
 	target.point.z = 0;
 	target_pub_.publish(target);
   }
 
-  void publish_highway_target(){
+  void publish_highway_target(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside visualization tool!!");
 	geometry_msgs::PointStamped target;
 	target.header.frame_id = "map";
 	target.header.stamp = ros::Time::now();
-	if(con->getHighwaysOn() == 1){
-		target.point.x = con->gethighwayExploration()->getHighwayTarget().getX();
-		target.point.y = con->gethighwayExploration()->getHighwayTarget().getY();
-		target.point.z = 0;
-		highway_target_pub_.publish(target);
-	}
-	else if(con->getHighwaysOn() == 2){
-		target.point.x = con->getfrontierExploration()->getFrontierTarget().getX();
-		target.point.y = con->getfrontierExploration()->getFrontierTarget().getY();
+	if(snapshot.highwaysOn == 1 or snapshot.highwaysOn == 2){
+		target.point.x = snapshot.highwayTargetX;
+		target.point.y = snapshot.highwayTargetY;
 		target.point.z = 0;
 		highway_target_pub_.publish(target);
 	}
   }
 
-  void publish_next_waypoint(){
+  void publish_next_waypoint(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside visualization tool!!");
 	geometry_msgs::PointStamped waypoint;
 	waypoint.header.frame_id = "map";
 	waypoint.header.stamp = ros::Time::now();
-	waypoint.point.x = beliefs->getAgentState()->getCurrentTask()->getX();
-	waypoint.point.y = beliefs->getAgentState()->getCurrentTask()->getY();
+	waypoint.point.x = snapshot.waypointX;
+	waypoint.point.y = snapshot.waypointY;
 	waypoint.point.z = 0;
 	waypoint_pub_.publish(waypoint);
   }
 
 
-  void publish_plan(){
+  void publish_plan(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish plan!!");
 	nav_msgs::Path path;
 	path.header.frame_id = "map";
 	path.header.stamp = ros::Time::now();
 
-	vector <CartesianPoint> waypoints = beliefs->getAgentState()->getCurrentTask()->getWaypoints();
+	const vector <CartesianPoint> &waypoints = snapshot.waypoints;
 	// double pathCostInNavGraph = beliefs->getAgentState()->getCurrentTask()->getPathCostInNavGraph();
 	// double pathCostInNavOrigGraph = beliefs->getAgentState()->getCurrentTask()->getPathCostInNavOrigGraph();
 	// std::stringstream output;
@@ -435,18 +806,12 @@ public:
   	waypoints_pub_.publish(marker);
  }
 
- void publish_highway_plan(){
+ void publish_highway_plan(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish highway plan!!");
 	nav_msgs::Path path;
 	path.header.frame_id = "map";
 	path.header.stamp = ros::Time::now();
-	vector< vector<double> > waypoints;
-	if(con->getHighwaysOn() == 1){
-		waypoints = con->gethighwayExploration()->getHighwayPath();
-	}
-	else if(con->getHighwaysOn() == 2){
-		waypoints = con->getfrontierExploration()->getFrontierPath();
-	}
+	const vector< vector<double> > &waypoints = snapshot.highwayPath;
 	for(int i = 0; i < waypoints.size(); i++){
 		geometry_msgs::PoseStamped poseStamped;
 		poseStamped.header.frame_id = "map";
@@ -458,13 +823,13 @@ public:
 	highway_plan_pub_.publish(path);
  }
 
- void publish_original_plan(){
+ void publish_original_plan(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish original plan!!");
 	nav_msgs::Path path;
 	path.header.frame_id = "map";
 	path.header.stamp = ros::Time::now();
 
-	vector <CartesianPoint> waypoints = beliefs->getAgentState()->getCurrentTask()->getOrigWaypoints();
+	const vector <CartesianPoint> &waypoints = snapshot.origWaypoints;
 	// double origPathCostInNavGraph = beliefs->getAgentState()->getCurrentTask()->getOrigPathCostInNavGraph();
 	// double origPathCostInOrigNavGraph = beliefs->getAgentState()->getCurrentTask()->getOrigPathCostInOrigNavGraph();
 	// std::stringstream output;
@@ -482,7 +847,7 @@ public:
 	original_plan_pub_.publish(path);
  }
 
-  void publish_conveyor(){
+  void publish_conveyor(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish conveyor");
 	nav_msgs::OccupancyGrid grid;
 
@@ -491,11 +856,11 @@ public:
 	grid.info.map_load_time = ros::Time::now();
 
 	grid.info.origin.orientation.w = 0;
-	grid.info.resolution = beliefs->getSpatialModel()->getConveyors()->getGranularity();
-	grid.info.width = beliefs->getSpatialModel()->getConveyors()->getBoxWidth();
-	grid.info.height = beliefs->getSpatialModel()->getConveyors()->getBoxHeight();
+	grid.info.resolution = snapshot.conveyorGranularity;
+	grid.info.width = snapshot.conveyorWidth;
+	grid.info.height = snapshot.conveyorHeight;
 
-	vector< vector<int> > conveyors = beliefs->getSpatialModel()->getConveyors()->getConveyors();
+	const vector< vector<int> > &conveyors = snapshot.conveyors;
 	for(int j = 0; j < grid.info.height; j++){
 		for(int i = 0; i < grid.info.width; i++){
 			grid.data.push_back(conveyors[i][j]);
@@ -504,10 +869,10 @@ public:
 	conveyor_pub_.publish(grid);
   }
 
-  void publish_hallway1(){
+  void publish_hallway1(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish hallway1");
 	visualization_msgs::Marker marker;
-	vector<Aggregate> hallways = beliefs->getSpatialModel()->getHallways()->getHallways();
+	vector<Aggregate> hallways = snapshot.hallways;
 	// cout << "There are currently " << hallways.size() << " hallways" << endl;
 	marker.header.frame_id = "map";
 	marker.header.stamp = ros::Time::now();
@@ -549,10 +914,10 @@ public:
 	hallway1_pub_.publish(marker);
   }
 
-  void publish_hallway2(){
+  void publish_hallway2(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish hallway2");
 	visualization_msgs::Marker marker;
-	vector<Aggregate> hallways = beliefs->getSpatialModel()->getHallways()->getHallways();
+	vector<Aggregate> hallways = snapshot.hallways;
 	//cout << "There are currently " << hallways.size() << " hallways" << endl;
 	marker.header.frame_id = "map";
 	marker.header.stamp = ros::Time::now();
@@ -594,10 +959,10 @@ public:
 	hallway2_pub_.publish(marker);
   }
 
-  void publish_hallway3(){
+  void publish_hallway3(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish hallway3");
 	visualization_msgs::Marker marker;
-	vector<Aggregate> hallways = beliefs->getSpatialModel()->getHallways()->getHallways();
+	vector<Aggregate> hallways = snapshot.hallways;
 	//cout << "There are currently " << hallways.size() << " hallways" << endl;
 	marker.header.frame_id = "map";
 	marker.header.stamp = ros::Time::now();
@@ -639,10 +1004,10 @@ public:
 	hallway3_pub_.publish(marker);
   }
 
-  void publish_hallway4(){
+  void publish_hallway4(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish hallway4");
 	visualization_msgs::Marker marker;
-	vector<Aggregate> hallways = beliefs->getSpatialModel()->getHallways()->getHallways();
+	vector<Aggregate> hallways = snapshot.hallways;
 	//cout << "There are currently " << hallways.size() << " hallways" << endl;
 	marker.header.frame_id = "map";
 	marker.header.stamp = ros::Time::now();
@@ -712,11 +1077,11 @@ public:
 	occupancy_pub_.publish(grid);
   }
 
-  void publish_region(){
+  void publish_region(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish regions");
 
 	visualization_msgs::MarkerArray markerArray;
-	vector<FORRRegion> regions = beliefs->getSpatialModel()->getRegionList()->getRegions();
+	vector<FORRRegion> regions = snapshot.regions;
 	cout << "There are currently " << regions.size() << " regions" << endl;
 	for(int i = 0 ; i < regions.size(); i++){
 		//regions[i].print();
@@ -752,9 +1117,9 @@ public:
 	region_pub_.publish(markerArray);
   }
 
-  void publish_exits(){
+  void publish_exits(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish exits");
-	vector<FORRRegion> regions = beliefs->getSpatialModel()->getRegionList()->getRegions();
+	vector<FORRRegion> regions = snapshot.regions;
 	// cout << "There are currently " << regions.size() << " regions" << endl;
 	visualization_msgs::Marker marker;
 	marker.header.frame_id = "map";
@@ -792,9 +1157,9 @@ public:
 	}
   	exits_pub_.publish(marker);
   }
-  void publish_skeleton(){
+  void publish_skeleton(const VisualizationSnapshot &snapshot){
   	// ROS_DEBUG("Inside publish skeleton");
-  	vector<FORRRegion> regions = beliefs->getSpatialModel()->getRegionList()->getRegions();
+  	vector<FORRRegion> regions = snapshot.regions;
 	// cout << "There are currently " << regions.size() << " regions" << endl;
 	visualization_msgs::Marker line_list;
 	line_list.header.frame_id = "map";
@@ -826,11 +1191,11 @@ public:
   	skeleton_pub_.publish(line_list);
   }
 
-  void publish_trails(){
+  void publish_trails(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish trail");
 	//Goal here is to publish all trails
 
-	FORRTrails *trails = beliefs->getSpatialModel()->getTrails();
+	const vector< vector<CartesianPoint> > &trails = snapshot.trails;
 	/*nav_msgs::Path path;
 	path.header.frame_id = "map";
 	path.header.stamp = ros::Time::now();
@@ -861,17 +1226,17 @@ public:
 	line_list.scale.x = 0.1;
 	line_list.color.r = 1.0;
 	line_list.color.a = 1.0;
-	// cout << "There are currently " << trails->getSize() << " trails" << endl;
-	for(int i = 0 ; i < trails->getSize(); i++){
-		vector<TrailMarker> trail = trails->getTrail(i);
-		for(int j = 0; j < trail.size()-1; j++){
+	// cout << "There are currently " << trails.size() << " trails" << endl;
+	for(int i = 0 ; i < trails.size(); i++){
+		const vector<CartesianPoint> &trail = trails[i];
+		for(int j = 0; j+1 < trail.size(); j++){
 			geometry_msgs::Point p1, p2;
-			p1.x = trail[j].coordinates.get_x();
-			p1.y = trail[j].coordinates.get_y();
+			p1.x = trail[j].get_x();
+			p1.y = trail[j].get_y();
 			p1.z = 0;
 
-			p2.x = trail[j+1].coordinates.get_x();
-			p2.y = trail[j+1].coordinates.get_y();
+			p2.x = trail[j+1].get_x();
+			p2.y = trail[j+1].get_y();
 			p2.z = 0;
 
 			line_list.points.push_back(p1);
@@ -882,10 +1247,10 @@ public:
 
   }
 
-  void publish_doors(){
+  void publish_doors(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish doors");
 
-	std::vector< std::vector<Door> > doors = beliefs->getSpatialModel()->getDoors()->getDoors();
+	std::vector< std::vector<Door> > doors = snapshot.doors;
 	// cout << "There are currently " << doors.size() << " regions" << endl;
 	visualization_msgs::Marker line_list;
 	line_list.header.frame_id = "map";
@@ -969,9 +1334,9 @@ public:
 	barriers_pub_.publish(cube);
   }
 
-  void publish_walls(){
+  void publish_walls(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish walls");
-	vector<Wall> walls = con->getPlanner()->getMap()->getWalls();
+	const vector<Wall> &walls = snapshot.walls;
 	cout << "There are currently " << walls.size() << " walls" << endl;
 	visualization_msgs::Marker line_list;
 	line_list.header.frame_id = "map";
@@ -1115,16 +1480,15 @@ public:
 	// walls_pub_.publish(cube_list);
   }
 
-  void publish_all_targets(){
+  void publish_all_targets(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Publish All targets as pose array!!");
 	geometry_msgs::PoseArray targets;
 	targets.header.frame_id = "map";
 	targets.header.stamp = ros::Time::now();
 
-	list<Task*> agenda = beliefs->getAgentState()->getAllAgenda();
-	for(list<Task*>::iterator it = agenda.begin(); it != agenda.end(); it++){
-		double x = (*it)->getX();
-		double y = (*it)->getY();
+	for(int i = 0; i < snapshot.allTargets.size(); i++){
+		double x = snapshot.allTargets[i].get_x();
+		double y = snapshot.allTargets[i].get_y();
 		geometry_msgs::Pose pose;
 		pose.position.x = x;
 		pose.position.y = y;
@@ -1133,16 +1497,15 @@ public:
 	all_targets_pub_.publish(targets);
   }
 
-  void publish_remaining_targets(){
+  void publish_remaining_targets(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Publish remaining targets as pose array!!");
 	geometry_msgs::PoseArray targets;
 	targets.header.frame_id = "map";
 	targets.header.stamp = ros::Time::now();
 
-	list<Task*> agenda = beliefs->getAgentState()->getAgenda();
-	for(list<Task*>::iterator it = agenda.begin(); it != agenda.end(); it++){
-		double x = (*it)->getX();
-		double y = (*it)->getY();
+	for(int i = 0; i < snapshot.remainingTargets.size(); i++){
+		double x = snapshot.remainingTargets[i].get_x();
+		double y = snapshot.remainingTargets[i].get_y();
 		geometry_msgs::Pose pose;
 		pose.position.x = x;
 		pose.position.y = y;
@@ -1151,7 +1514,7 @@ public:
 	remaining_targets_pub_.publish(targets);
   }
 
-  void publish_highway(){
+  void publish_highway(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish highway");
 	nav_msgs::OccupancyGrid grid;
 
@@ -1161,43 +1524,10 @@ public:
 
 	grid.info.origin.orientation.w = 0;
 	grid.info.resolution = 1;
-	if(con->getHighwaysOn() == 1){
-		grid.info.width = con->gethighwayExploration()->getLength();
-		grid.info.height = con->gethighwayExploration()->getHeight();
-		vector< vector<int> > highways;
-		if(con->getHighwayFinished()){
-			highways = beliefs->getAgentState()->getPassageGrid();
-		}
-		else{
-			highways = con->gethighwayExploration()->getHighwayGrid();
-		}
-		if(highways.size() > 0){
-			for(int j = 0; j < grid.info.height; j++){
-				for(int i = 0; i < grid.info.width; i++){
-					if(highways[i][j] < 0){
-						grid.data.push_back(-1);
-					}
-					else if(highways[i][j] * 2 < 100){
-						grid.data.push_back(highways[i][j] * 2);
-					}
-					else{
-						grid.data.push_back(100);
-					}
-				}
-			}
-			highway_pub_.publish(grid);
-		}
-	}
-	else if(con->getHighwaysOn() == 2){
-		grid.info.width = con->getfrontierExploration()->getLength();
-		grid.info.height = con->getfrontierExploration()->getHeight();
-		vector< vector<int> > highways;
-		if(con->getFrontierFinished()){
-			highways = beliefs->getAgentState()->getPassageGrid();
-		}
-		else{
-			highways = con->getfrontierExploration()->getFrontierGrid();
-		}
+	if(snapshot.highwaysOn == 1 or snapshot.highwaysOn == 2){
+		grid.info.width = snapshot.highwayLength;
+		grid.info.height = snapshot.highwayHeight;
+		const vector< vector<int> > &highways = snapshot.highwayGrid;
 		if(highways.size() > 0){
 			for(int j = 0; j < grid.info.height; j++){
 				for(int i = 0; i < grid.info.width; i++){
@@ -1217,15 +1547,9 @@ public:
 	}
   }
 
-  void publish_highway_stack(){
+  void publish_highway_stack(const VisualizationSnapshot &snapshot){
 	// ROS_DEBUG("Inside publish highway_stack");
-	vector< Position > highway_stack;
-	if(con->getHighwaysOn() == 1){
-		highway_stack = con->gethighwayExploration()->getHighwayStack();
-	}
-	else if(con->getHighwaysOn() == 2){
-		highway_stack = con->getfrontierExploration()->getFrontierStack();
-	}
+	const vector< Position > &highway_stack = snapshot.highwayStack;
 	visualization_msgs::Marker marker;
 	marker.header.frame_id = "map";
 	marker.header.stamp = ros::Time::now();
@@ -1269,9 +1593,136 @@ public:
   	highway_stack_pub_.publish(marker);
   }
 
-  void publish_log(FORRAction decision, double overallTimeSec, double computationTimeSec){
+  // Fills the region, trail, door, conveyor and hallway sections of a decision log
+  void fillSpatialSections(semaforr::DecisionLog &sections){
+	vector<FORRRegion> regions = beliefs->getSpatialModel()->getRegionList()->getRegions();
+	vector< vector< CartesianPoint> > trails =  beliefs->getSpatialModel()->getTrails()->getTrailsPoints();
+	vector< vector<int> > conveyors = beliefs->getSpatialModel()->getConveyors()->getConveyors();
+	std::vector< std::vector<Door> > doors = beliefs->getSpatialModel()->getDoors()->getDoors();
+	vector<Aggregate> hallways = beliefs->getSpatialModel()->getHallways()->getHallways();
+
+	sections.region_exit_offsets.push_back(0);
+	for(int i = 0; i < regions.size(); i++){
+		sections.region_circles.push_back(regions[i].getCenter().get_x());
+		sections.region_circles.push_back(regions[i].getCenter().get_y());
+		sections.region_circles.push_back(regions[i].getRadius());
+		vector<FORRExit> exits = regions[i].getExits();
+		for(int j = 0; j < exits.size() ; j++){
+			sections.region_exits.push_back(exits[j].getExitPoint().get_x());
+			sections.region_exits.push_back(exits[j].getExitPoint().get_y());
+			sections.region_exits.push_back(exits[j].getExitRegion());
+			sections.region_exits.push_back(exits[j].getMidPoint().get_x());
+			sections.region_exits.push_back(exits[j].getMidPoint().get_y());
+			sections.region_exits.push_back(exits[j].getExitRegionPoint().get_x());
+			sections.region_exits.push_back(exits[j].getExitRegionPoint().get_y());
+			sections.region_exits.push_back(exits[j].getExitDistance());
+			sections.region_exits.push_back(exits[j].getConnectionPath());
+		}
+		sections.region_exit_offsets.push_back(sections.region_exits.size()/9);
+	}
+	// ROS_DEBUG("After regions");
+
+	sections.trail_offsets.push_back(0);
+	for(int i = 0; i < trails.size(); i++){
+		for(int j = 0; j < trails[i].size(); j++){
+			sections.trail_points.push_back(trails[i][j].get_x());
+			sections.trail_points.push_back(trails[i][j].get_y());
+		}
+		sections.trail_offsets.push_back(sections.trail_points.size()/2);
+	}
+	// ROS_DEBUG("After trails");
+
+	// The last conveyor row is left out, as the tab-separated log did
+	if(conveyors.size() > 1){
+		sections.conveyor_rows = conveyors.size()-1;
+		sections.conveyor_cols = conveyors[0].size();
+		sections.conveyor_cells.reserve(sections.conveyor_rows * sections.conveyor_cols);
+		for(int j = 0; j < conveyors.size()-1; j++){
+			sections.conveyor_cells.insert(sections.conveyor_cells.end(), conveyors[j].begin(), conveyors[j].end());
+		}
+	}
+	// ROS_DEBUG("After conveyors");
+
+	for(int i = 0; i < doors.size(); i++){
+		for(int j = 0; j < doors[i].size(); j++){
+			sections.door_region.push_back(i);
+			sections.door_points.push_back(doors[i][j].startPoint.getExitPoint().get_x());
+			sections.door_points.push_back(doors[i][j].startPoint.getExitPoint().get_y());
+			sections.door_points.push_back(doors[i][j].endPoint.getExitPoint().get_x());
+			sections.door_points.push_back(doors[i][j].endPoint.getExitPoint().get_y());
+			sections.door_strength.push_back(doors[i][j].str);
+		}
+	}
+	// ROS_DEBUG("After doors");
+
+	sections.hallway_offsets.push_back(0);
+	for(int i = 0; i < hallways.size(); i++){
+		vector<CartesianPoint> points = hallways[i].getPoints();
+		sections.hallway_type.push_back(hallways[i].getHallwayType());
+		for(int j = 0; j < points.size(); j++){
+			sections.hallway_points.push_back(points[j].get_x());
+			sections.hallway_points.push_back(points[j].get_y());
+		}
+		sections.hallway_offsets.push_back(sections.hallway_points.size()/2);
+	}
+  }
+
+  // Fills the passage grid section of a decision log
+  void fillPassageSection(semaforr::DecisionLog &sections){
+	vector< vector<int> > highways;
+	if(con->getHighwaysOn() == 1){
+		if(con->getHighwayFinished()){
+			highways = beliefs->getAgentState()->getPassageGrid();
+		}
+		else{
+			highways = con->gethighwayExploration()->getHighwayGrid();
+		}
+	}
+	else if(con->getHighwaysOn() == 2){
+		if(con->getFrontierFinished()){
+			highways = beliefs->getAgentState()->getPassageGrid();
+		}
+		else{
+			highways = con->getfrontierExploration()->getFrontierGrid();
+		}
+	}
+	// The last passage row is left out, as the tab-separated log did
+	if(highways.size() > 1){
+		sections.passage_rows = highways.size()-1;
+		sections.passage_cols = highways[0].size();
+		sections.passage_cells.reserve(sections.passage_rows * sections.passage_cols);
+		for(int j = 0; j < highways.size()-1; j++){
+			sections.passage_cells.insert(sections.passage_cells.end(), highways[j].begin(), highways[j].end());
+		}
+	}
+  }
+
+  // Keeps the sections in candidates whose content differs from the last logged copy, bumping their
+  // version, and returns the mask of the ones that changed
+  uint8_t updateLoggedSections(const semaforr::DecisionLog &sections, uint8_t candidates){
+	uint8_t changed = 0;
+	for(int i = 0; i < 6; i++){
+		uint8_t section = (1 << i);
+		if(!(candidates & section)){
+			continue;
+		}
+		uint64_t hash = hashDecisionLogSection(sections, section);
+		if(sectionVersions[i] == 0 or hash != sectionHashes[i]){
+			sectionHashes[i] = hash;
+			sectionVersions[i]++;
+			changed |= section;
+		}
+	}
+	copyDecisionLogSections(sections, loggedSections, changed);
+	return changed;
+  }
+
+  void publish_log(FORRAction decision, double overallTimeSec, double computationTimeSec, double senseToActSec){
 	// ROS_DEBUG("Inside publish decision log!!");
-	std_msgs::String log;
+	semaforr::DecisionLog log;
+	log.header.frame_id = "map";
+	log.header.stamp = ros::Time::now();
+	log.schema_version = semaforr::DecisionLog::SCHEMA_VERSION;
 	double robotX = beliefs->getAgentState()->getCurrentPosition().getX();
 	double robotY = beliefs->getAgentState()->getCurrentPosition().getY();
 	double targetX;
@@ -1300,29 +1751,10 @@ public:
 
 	FORRAction max_forward = beliefs->getAgentState()->maxForwardAction();
 	// ROS_DEBUG("After max_forward");
-	//vector< vector<CartesianPoint> > allTrace = beliefs->getAgentState()->getAllTrace();
 	list<Task*>& agenda = beliefs->getAgentState()->getAgenda();
 	list<Task*>& all_agenda = beliefs->getAgentState()->getAllAgenda();
 	// ROS_DEBUG("After all_agenda");
-	vector<FORRRegion> regions = beliefs->getSpatialModel()->getRegionList()->getRegions();
-	vector< vector< CartesianPoint> > trails =  beliefs->getSpatialModel()->getTrails()->getTrailsPoints();
-	// ROS_DEBUG("After trails");
-	FORRActionType chosenActionType = decision.type;
-	int chosenActionParameter = decision.parameter;
-	double decisionTier = con->getCurrentDecisionStats()->decisionTier;
-	string vetoedActions = con->getCurrentDecisionStats()->vetoedActions;
-	string advisors = con->getCurrentDecisionStats()->advisors;
-	string advisorComments = con->getCurrentDecisionStats()->advisorComments;
-	string advisorInfluence = con->getCurrentDecisionStats()->advisorInfluence;
-	double planningComputationTime = con->getCurrentDecisionStats()->planningComputationTime;
-	double learningComputationTime = con->getCurrentDecisionStats()->learningComputationTime;
-	double graphingComputationTime = con->getCurrentDecisionStats()->graphingComputationTime;
-	string chosenPlanner = con->getCurrentDecisionStats()->chosenPlanner;
-	string plannerComments = con->getCurrentDecisionStats()->plannerComments;
-	// cout << "vetoedActions = " << vetoedActions << " decisionTier = " << decisionTier << " advisors = " << advisors << " advisorComments = " << advisorComments << endl;
-	vector< vector<int> > conveyors = beliefs->getSpatialModel()->getConveyors()->getConveyors();
-	std::vector< std::vector<Door> > doors = beliefs->getSpatialModel()->getDoors()->getDoors();
-	vector<Aggregate> hallways = beliefs->getSpatialModel()->getHallways()->getHallways();
+	FORRActionStats *stats = con->getCurrentDecisionStats();
 
 	// ROS_DEBUG("After decision statistics");
 	int decisionCount = -1;
@@ -1336,243 +1768,111 @@ public:
 
 	cout << "Current task " << currentTask << " and decision number " << decisionCount << " with overall time " << overallTimeSec << " and computation time " << computationTimeSec << endl;
 
-	std::stringstream lep;
-	for(int i = 0; i < laserEndpoints.size(); i++){
-		double x = laserEndpoints[i].get_x();
- 		double y = laserEndpoints[i].get_y();
-		lep << x << "," << y << ";";
-	}
-	// ROS_DEBUG("After laserEndpoints");
-
-
-	std::stringstream ls;
-	double min_laser_scan = 25; //meters
-	for(int i = 0; i < laserScan.ranges.size(); i++){
-		double length = laserScan.ranges[i];
-		if(length < min_laser_scan){
-			min_laser_scan = length;
-		}
-		ls << length << ",";
-	}
-	// ROS_DEBUG("After laserScan");
-	/*int totalSize = 0;
-	for(int i = 0; i < allTrace.size(); i++){
-		totalSize += allTrace[i].size();
-	}*/
-
-
-	std::stringstream regionsstream;
-	for(int i = 0; i < regions.size(); i++){
-		regionsstream << regions[i].getCenter().get_x() << " " << regions[i].getCenter().get_y() << " " << regions[i].getRadius();
-		vector<FORRExit> exits = regions[i].getExits();
-		for(int j = 0; j < exits.size() ; j++){
-			regionsstream << " " << exits[j].getExitPoint().get_x() << " "  << exits[j].getExitPoint().get_y() << " "  << exits[j].getExitRegion() << " "  << exits[j].getMidPoint().get_x() << " "  << exits[j].getMidPoint().get_y() << " "  << exits[j].getExitRegionPoint().get_x() << " "  << exits[j].getExitRegionPoint().get_y() << " "  << exits[j].getExitDistance() << " "  << exits[j].getConnectionPath();
-		}
-		regionsstream << ";";
-	}
-	// ROS_DEBUG("After regions");
-
-
-	std::stringstream trailstream;
-	for(int i = 0; i < trails.size(); i++){
-		for(int j = 0; j < trails[i].size(); j++){
-			trailstream << trails[i][j].get_x() << " " << trails[i][j].get_y() << " ";
-		}
-		trailstream << ";";
+	log.task = currentTask;
+	log.decision_count = decisionCount;
+	log.overall_time = overallTimeSec;
+	log.computation_time = computationTimeSec;
+	log.sense_to_act_time = senseToActSec;
+	log.planning_time = stats->planningComputationTime;
+	log.learning_time = stats->learningComputationTime;
+	log.graphing_time = stats->graphingComputationTime;
+	log.target_x = targetX;
+	log.target_y = targetY;
+	log.robot_x = robotX;
+	log.robot_y = robotY;
+	log.robot_theta = robotTheta;
+	log.max_forward = max_forward.parameter;
+	log.decision_tier = stats->decisionTier;
+	log.action_type = decision.type;
+	log.action_parameter = decision.parameter;
+	log.cutoff_stages = stats->cutoffStages;
+
+	for(int i = 0; i < stats->vetoedActions.size(); i++){
+		log.veto_type.push_back(stats->vetoedActions[i].type);
+		log.veto_parameter.push_back(stats->vetoedActions[i].parameter);
+		log.veto_source.push_back(stats->vetoSources[i]);
 	}
-	// ROS_DEBUG("After trails");
 
-	std::stringstream conveyorStream;
-	for(int j = 0; j < conveyors.size()-1; j++){
-		for(int i = 0; i < conveyors[j].size(); i++){
-			conveyorStream << conveyors[j][i] << " ";
-		}
-		conveyorStream << ";";
-	}
-	// ROS_DEBUG("After conveyors");
-	
-
-	std::stringstream doorStream;
-	for(int i = 0; i < doors.size(); i++){
-		for(int j = 0; j < doors[i].size(); j++){
-			doorStream << doors[i][j].startPoint.getExitPoint().get_x() << " " << doors[i][j].startPoint.getExitPoint().get_y() << " " << doors[i][j].endPoint.getExitPoint().get_x() << " " << doors[i][j].endPoint.getExitPoint().get_y() << " " << doors[i][j].str << ", ";
-		}
-		doorStream << ";";
+	log.advisor_names = stats->advisorNames;
+	log.advisor_weights = stats->advisorWeights;
+	log.advisor_active.assign(stats->advisorActive.begin(), stats->advisorActive.end());
+	log.advisor_commenting.assign(stats->advisorCommenting.begin(), stats->advisorCommenting.end());
+	log.comment_advisor.assign(stats->commentAdvisor.begin(), stats->commentAdvisor.end());
+	for(int i = 0; i < stats->commentActions.size(); i++){
+		log.comment_type.push_back(stats->commentActions[i].type);
+		log.comment_parameter.push_back(stats->commentActions[i].parameter);
 	}
+	log.comment_strength = stats->commentStrengths;
 
-	// ROS_DEBUG("After doors");
+	log.chosen_planner = stats->chosenPlanner;
+	log.planner_names = stats->plannerNames;
+	log.plan_planner.assign(stats->planPlanner.begin(), stats->planPlanner.end());
+	log.plan_cost_columns = stats->planCostColumns;
+	log.plan_costs = stats->planCosts;
+	// ROS_DEBUG("After decision statistics");
 
-	std::stringstream hallwayStream;
-	for(int i = 0; i < hallways.size(); i++){
-		vector<CartesianPoint> points = hallways[i].getPoints();
-		hallwayStream << hallways[i].getHallwayType();
-		for(int j = 0; j < points.size(); j++){
-			hallwayStream << " " << points[j].get_x() << " " << points[j].get_y();
-		}
-		hallwayStream << ";";
+	log.laser_endpoints.reserve(2*laserEndpoints.size());
+	for(int i = 0; i < laserEndpoints.size(); i++){
+		log.laser_endpoints.push_back(laserEndpoints[i].get_x());
+		log.laser_endpoints.push_back(laserEndpoints[i].get_y());
 	}
+	log.laser_ranges = laserScan.ranges;
+	// ROS_DEBUG("After laserScan");
 
-	// ROS_DEBUG("After hallways");
-
-	std::stringstream planStream;
+	log.plan_path_costs[0] = log.plan_path_costs[1] = 0;
+	log.original_plan_path_costs[0] = log.original_plan_path_costs[1] = 0;
 	if(beliefs->getAgentState()->getCurrentTask() != NULL){
 		vector <CartesianPoint> waypoints = beliefs->getAgentState()->getCurrentTask()->getWaypoints();
-		double pathCostInNavGraph = beliefs->getAgentState()->getCurrentTask()->getPathCostInNavGraph();
-		double pathCostInNavOrigGraph = beliefs->getAgentState()->getCurrentTask()->getPathCostInNavOrigGraph();
-		planStream << pathCostInNavGraph << " " << pathCostInNavOrigGraph << ";";
-
+		log.plan_path_costs[0] = beliefs->getAgentState()->getCurrentTask()->getPathCostInNavGraph();
+		log.plan_path_costs[1] = beliefs->getAgentState()->getCurrentTask()->getPathCostInNavOrigGraph();
 		for(int i = 0; i < waypoints.size(); i++){
-			planStream << waypoints[i].get_x() << " " << waypoints[i].get_y();
-			planStream << ";";
+			log.plan_waypoints.push_back(waypoints[i].get_x());
+			log.plan_waypoints.push_back(waypoints[i].get_y());
 		}
 
-		//double plancost = beliefs->getAgentState()->getCurrentTask()->planCost(waypoints, con->getPlanner(), beliefs->getAgentState()->getCurrentPosition(), Position(targetX,targetY,0));
-		//planStream << "\t" << plancost;
-	}
-	// ROS_DEBUG("After planStream");
-
-	std::stringstream origPlanStream;
-	if(beliefs->getAgentState()->getCurrentTask() != NULL){
-		vector <CartesianPoint> waypoints = beliefs->getAgentState()->getCurrentTask()->getOrigWaypoints();
-		double origPathCostInNavGraph = beliefs->getAgentState()->getCurrentTask()->getOrigPathCostInNavGraph();
-		double origPathCostInOrigNavGraph = beliefs->getAgentState()->getCurrentTask()->getOrigPathCostInOrigNavGraph();
-		origPlanStream << origPathCostInNavGraph << " " << origPathCostInOrigNavGraph<< ";";
-
-		for(int i = 0; i < waypoints.size(); i++){
-			origPlanStream << waypoints[i].get_x() << " " << waypoints[i].get_y();
-			origPlanStream << ";";		
+		vector <CartesianPoint> origWaypoints = beliefs->getAgentState()->getCurrentTask()->getOrigWaypoints();
+		log.original_plan_path_costs[0] = beliefs->getAgentState()->getCurrentTask()->getOrigPathCostInNavGraph();
+		log.original_plan_path_costs[1] = beliefs->getAgentState()->getCurrentTask()->getOrigPathCostInOrigNavGraph();
+		for(int i = 0; i < origWaypoints.size(); i++){
+			log.original_plan_waypoints.push_back(origWaypoints[i].get_x());
+			log.original_plan_waypoints.push_back(origWaypoints[i].get_y());
 		}
-
-		//double plancost = beliefs->getAgentState()->getCurrentTask()->planCost(waypoints, con->getPlanner(), beliefs->getAgentState()->getCurrentPosition(), Position(targetX,targetY,0));
-		//origPlanStream << "\t" << plancost;
-	}
-	//ROS_DEBUG("After origPlanStream");
-
-	std::stringstream crowdStream;
-	geometry_msgs::PoseArray crowdpose = beliefs->getAgentState()->getCrowdPose();
-
-	for(int i = 0; i < crowdpose.poses.size(); i++){
-		crowdStream << crowdpose.poses[i].position.x << " " << crowdpose.poses[i].position.y << " " << crowdpose.poses[i].orientation.x 
-		<< " " << crowdpose.poses[i].orientation.y << " " << crowdpose.poses[i].orientation.z << " " << crowdpose.poses[i].orientation.w;
-		crowdStream << ";";
-	}
-	//ROS_DEBUG("After crowdStream");
-
-	std::stringstream allCrowdStream;
-	geometry_msgs::PoseArray crowdposeall = beliefs->getAgentState()->getCrowdPoseAll();
-
-	for(int i = 0; i < crowdposeall.poses.size(); i++){
-		allCrowdStream << crowdposeall.poses[i].position.x << " " << crowdposeall.poses[i].position.y << " " << crowdposeall.poses[i].orientation.x
-		<< " " << crowdposeall.poses[i].orientation.y << " " << crowdposeall.poses[i].orientation.z << " " << crowdposeall.poses[i].orientation.w;
-		allCrowdStream << ";";
-	}
-	//ROS_DEBUG("After all crowdStream");
-
-	std::stringstream crowdModel;
-	semaforr::CrowdModel model = con->getPlanner()->getCrowdModel();
-	int resolution = model.resolution;
-	int height = model.height;
-	int width = model.width;
-	std::vector<double> densities = model.densities;
-	std::vector<double> risk = model.risk;
-	crowdModel << height << " " << width << " " << resolution << ";";
-	for(int i = 0; i < densities.size() ; i++){
-		crowdModel << densities[i] << " ";
 	}
-	crowdModel << "\t";
-	for(int i = 0; i < risk.size() ; i++){
-		crowdModel << risk[i] << " ";
+	// ROS_DEBUG("After plans");
+
+	// Spatial model sections only change when the controller learns, and the passage grid is
+	// refreshed at the start of each task, everything else is carried by the last logged copy
+	semaforr::DecisionLog sections;
+	uint8_t candidates = 0;
+	if(con->getSpatialModelVersion() != loggedSpatialModelVersion){
+		loggedSpatialModelVersion = con->getSpatialModelVersion();
+		fillSpatialSections(sections);
+		candidates |= semaforr::DecisionLog::SECTION_ALL & ~semaforr::DecisionLog::SECTION_PASSAGES;
 	}
-	crowdModel << "\t";
-	std::vector<double> left = model.left;
-	for(int i = 0; i < left.size() ; i++){
-		crowdModel << left[i] << " ";
-	}
-	crowdModel << "\t";
-	std::vector<double> right = model.right;
-	for(int i = 0; i < right.size() ; i++){
-		crowdModel << right[i] << " ";
-	}
-	crowdModel << "\t";
-	std::vector<double> up = model.up;
-	for(int i = 0; i < up.size() ; i++){
-		crowdModel << up[i] << " ";
-	}
-	crowdModel << "\t";
-	std::vector<double> down = model.down;
-	for(int i = 0; i < down.size() ; i++){
-		crowdModel << down[i] << " ";
-	}
-	crowdModel << "\t";
-	std::vector<double> up_left = model.up_left;
-	for(int i = 0; i < up_left.size() ; i++){
-		crowdModel << up_left[i] << " ";
-	}
-	crowdModel << "\t";
-	std::vector<double> up_right = model.up_right;
-	for(int i = 0; i < up_right.size() ; i++){
-		crowdModel << up_right[i] << " ";
-	}
-	crowdModel << "\t";
-	std::vector<double> down_left = model.down_left;
-	for(int i = 0; i < down_left.size() ; i++){
-		crowdModel << down_left[i] << " ";
-	}
-	crowdModel << "\t";
-	std::vector<double> down_right = model.down_right;
-	for(int i = 0; i < down_right.size() ; i++){
-		crowdModel << down_right[i] << " ";
-	}
-
-	//ROS_DEBUG("After all crowd model");
-
-	std::stringstream passageStream;
 	if(currentTask > 0 and decisionCount == 1){
-		vector< vector<int> > highways;
-		if(con->getHighwaysOn() == 1){
-			if(con->getHighwayFinished()){
-				highways = beliefs->getAgentState()->getPassageGrid();
-			}
-			else{
-				highways = con->gethighwayExploration()->getHighwayGrid();
-			}
-		}
-		else if(con->getHighwaysOn() == 2){
-			if(con->getFrontierFinished()){
-				highways = beliefs->getAgentState()->getPassageGrid();
-			}
-			else{
-				highways = con->getfrontierExploration()->getFrontierGrid();
-			}
-		}
-		if(highways.size() > 0){
-			for(int j = 0; j < highways.size()-1; j++){
-				for(int i = 0; i < highways[j].size(); i++){
-					passageStream << highways[j][i] << " ";
-				}
-				passageStream << ";";
-			}
-		}
-		else{
-			passageStream << " ";
-		}
+		fillPassageSection(sections);
+		candidates |= semaforr::DecisionLog::SECTION_PASSAGES;
 	}
-	else{
-		passageStream << " ";
+	uint8_t changed = updateLoggedSections(sections, candidates);
+	log.keyframe = (decisionsSinceKeyframe == 0);
+	log.sections = (log.keyframe ? semaforr::DecisionLog::SECTION_ALL : changed);
+	copyDecisionLogSections(loggedSections, log, log.sections);
+	log.regions_version = sectionVersions[0];
+	log.trails_version = sectionVersions[1];
+	log.doors_version = sectionVersions[2];
+	log.conveyors_version = sectionVersions[3];
+	log.hallways_version = sectionVersions[4];
+	log.passages_version = sectionVersions[5];
+	decisionsSinceKeyframe++;
+	if(con->getDecisionLogKeyframe() > 0 and decisionsSinceKeyframe >= con->getDecisionLogKeyframe()){
+		decisionsSinceKeyframe = 0;
 	}
+	// ROS_DEBUG("After spatial model sections");
 
-	// ROS_DEBUG("After conveyors");
-
-	std::stringstream output;
-
-	output << currentTask << "\t" << decisionCount << "\t" << overallTimeSec << "\t" << computationTimeSec << "\t" << targetX << "\t" << targetY << "\t" << robotX << "\t" << robotY << "\t" << robotTheta << "\t" << max_forward.parameter << "\t" << decisionTier << "\t" << vetoedActions << "\t" << chosenActionType << "\t" << chosenActionParameter << "\t" << advisors << "\t" << advisorComments << "\t" << planStream.str() << "\t" << origPlanStream.str() << "\t" << regionsstream.str() << "\t" << trailstream.str() << "\t" << doorStream.str() << "\t" << conveyorStream.str() << "\t" << hallwayStream.str() << "\t" << planningComputationTime << "\t" << learningComputationTime << "\t" << chosenPlanner << "\t" << graphingComputationTime<< "\t" << passageStream.str() << "\t" << plannerComments  << "\t" << lep.str() << "\t" << ls.str();// << "\t" << crowdModel.str() << "\t" << crowdStream.str() << "\t" << allCrowdStream.str() << "\t" << advisorInfluence;
-
-	//output << currentTask << "\t" << decisionCount << "\t" << targetX << "\t" << targetY << "\t" << robotX << "\t" << robotY << "\t" << robotTheta << "\t" << lep.str() << "\t" << ls.str();
-
-	//output << currentTask << "\t" << decisionCount << "\t" << overallTimeSec << "\t" << computationTimeSec << "\t" << targetX << "\t" << targetY << "\t" << robotX << "\t" << robotY << "\t" << robotTheta << "\t" << max_forward.parameter << "\t" << decisionTier << "\t" << vetoedActions << "\t" << chosenActionType << "\t" << chosenActionParameter << "\t" << advisors << "\t" << advisorComments << "\t" << lep.str() << "\t" << ls.str() << "\t" << crowdStream.str() << "\t" << allCrowdStream.str() << "\t" << crowdModel.str() << "\t" << planStream.str();
-
-	log.data = output.str();
 	stats_pub_.publish(log);
+	if(logFile.isOpen()){
+		logFile.write(log);
+	}
 	con->clearCurrentDecisionStats();
   }
 };
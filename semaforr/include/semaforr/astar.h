@@ -13,6 +13,7 @@ public:
 
   astar (Graph*);
   astar (Graph, Node&, Node&, string);
+  astar (Graph, Node&, Node&, string, double); // Weighted A*, heuristic inflated by the last argument
   bool search(int, int, string); // Search the graph for a path and return true if found
 
   // Wrappers
@@ -26,6 +27,7 @@ private:
   class _VNode;  // prototype
   Graph *graph;
   _VNode *start, *goal;
+  double weight; // Heuristic inflation, 1 gives plain A*
   vector<_VNode*> closed;
 
   // Private funcs
@@ -162,29 +162,14 @@ Position AgentState::getNearestObstacle(Position pos){
 //Sees if the laser scan intersects with a segment created by 2
 //trailpoints
 bool AgentState::canSeeSegment(CartesianPoint point1, CartesianPoint point2){
-  CartesianPoint curr(currentPosition.getX(),currentPosition.getY());
-  return canSeeSegment(laserEndpoints, curr, point1, point2);
+  return laserSegments.first_intersecting(LineSegment(point1, point2)) >= 0;
 }
 
 //Sees if the laser scan intersects with a segment created by 2
 //trailpoints
 bool AgentState::canSeeSegment(vector<CartesianPoint> givenLaserEndpoints, CartesianPoint laserPos, CartesianPoint point1, CartesianPoint point2){
-  CartesianPoint intersection_point(0,0);
-  bool canSeeSegment = false;
-  for(int i = 0; i < givenLaserEndpoints.size(); i++){
-    //this can be cleaned up or put into one function, but need to convert the distance to a linesegment to calculate
-    //the distance from a point to a line
-    CartesianPoint endpoint = givenLaserEndpoints[i];
-    
-    LineSegment distance_vector_line = LineSegment(laserPos, endpoint);
-    LineSegment trail_segment = LineSegment(point1, point2);
-    if(do_intersect(distance_vector_line, trail_segment, intersection_point)){
-      canSeeSegment = true;
-	break;
-    }
-  }
-  //else, not visible
-  return canSeeSegment;
+  SegmentSet beams(laserPos, givenLaserEndpoints);
+  return beams.first_intersecting(LineSegment(point1, point2)) >= 0;
 }
 
 
@@ -345,7 +330,17 @@ std::pair < std::vector<CartesianPoint>, std::vector< vector<CartesianPoint> > >
 bool AgentState::canSeePoint(CartesianPoint point, double distanceLimit){
   CartesianPoint curr(currentPosition.getX(),currentPosition.getY());
   //return canSeePoint(laserEndpoints, curr, point);
-  return canAccessPoint(laserEndpoints, curr, point, distanceLimit);
+  if(laserGeometry.size() == 0 or laserEndpoints.size() != laserGeometry.size()){
+    return canAccessPoint(laserEndpoints, curr, point, distanceLimit);
+  }
+  // the current scan's beam angles are known, so the beam closest to the point is found directly
+  double angle = atan2(point.get_y() - curr.get_y(), point.get_x() - curr.get_x()) - currentPosition.getTheta();
+  while(angle > M_PI) angle -= 2 * M_PI;
+  while(angle < -M_PI) angle += 2 * M_PI;
+  int beam = (int)floor((angle - laserGeometry.getAngleMin()) / laserGeometry.getAngleIncrement() + 0.5);
+  if(beam < 0) beam = 0;
+  if(beam > laserGeometry.size() - 1) beam = laserGeometry.size() - 1;
+  return canAccessPoint(laserEndpoints, curr, point, distanceLimit, beam);
 }
 
 bool AgentState::canSeeRegion(CartesianPoint center, double radius, double distanceLimit){
@@ -375,59 +370,53 @@ bool AgentState::canSeeRegion(CartesianPoint center, double radius, double dista
 
 void AgentState::transformToEndpoints(){
     ROS_DEBUG("Convert laser scan to endpoints");
-    double start_angle = currentLaserScan.angle_min;
-    double increment = currentLaserScan.angle_increment;
-    laserEndpoints.clear();
-    // cout << "start_angle " << start_angle << " increment " << increment << endl;
-
-    double r_x = currentPosition.getX();
-    double r_y = currentPosition.getY();
-    double r_ang = currentPosition.getTheta();
-    CartesianPoint current_point(r_x,r_y);
-  
-    for(int i = 0 ; i < currentLaserScan.ranges.size(); i++){
-       Vector v = Vector(current_point, start_angle + r_ang, currentLaserScan.ranges[i]);
-       CartesianPoint endpoint = v.get_endpoint();
-       start_angle = start_angle + increment;
-       laserEndpoints.push_back(endpoint);
-    }    
+    laserGeometry.update(*currentLaserScan);
+    laserEndpoints = laserGeometry.endpoints(currentPosition.getX(), currentPosition.getY(), currentPosition.getTheta(), *currentLaserScan);
+    laserSegments = SegmentSet(CartesianPoint(currentPosition.getX(), currentPosition.getY()), laserEndpoints);
 }
 
-vector<CartesianPoint> AgentState::transformToEndpoints(Position p, sensor_msgs::LaserScan scan){
-    // ROS_DEBUG("Convert laser scan to endpoints");
-    double start_angle = scan.angle_min;
-    double increment = scan.angle_increment;
-    vector<CartesianPoint> les;
+vector<CartesianPoint> AgentState::transformToEndpoints(Position p, const sensor_msgs::LaserScan &scan){
+    return laserGeometry.endpoints(p.getX(), p.getY(), p.getTheta(), scan);
+}
 
-    double r_x = p.getX();
-    double r_y = p.getY();
-    double r_ang = p.getTheta();
-    CartesianPoint current_point(r_x,r_y);
-  
-    for(int i = 0 ; i < scan.ranges.size(); i++){
-       Vector v = Vector(current_point, start_angle + r_ang, scan.ranges[i]);
-       CartesianPoint endpoint = v.get_endpoint();
-       start_angle = start_angle + increment;
-       les.push_back(endpoint);
+// Reprojects the endpoints seen from one pose into the beams of another and keeps the nearest one per beam.
+// Beams no endpoint falls into, and beams that saw nothing, are left at the maximum range.
+sensor_msgs::LaserScan AgentState::predictLaserScan(Position from, const sensor_msgs::LaserScan &scan, Position to){
+    sensor_msgs::LaserScan predicted = scan;
+    if(scan.ranges.size() == 0 or scan.angle_increment == 0){
+      return predicted;
     }
-    return les;
+    for(int i = 0; i < predicted.ranges.size(); i++){
+      predicted.ranges[i] = scan.range_max;
+    }
+    double angle = scan.angle_min + from.getTheta();
+    for(int i = 0; i < scan.ranges.size(); i++, angle += scan.angle_increment){
+      if(scan.ranges[i] >= scan.range_max or scan.ranges[i] < scan.range_min){
+        continue;
+      }
+      double dx = from.getX() + scan.ranges[i] * cos(angle) - to.getX();
+      double dy = from.getY() + scan.ranges[i] * sin(angle) - to.getY();
+      double beamAngle = atan2(dy, dx) - to.getTheta();
+      while(beamAngle > M_PI) beamAngle -= 2 * M_PI;
+      while(beamAngle < -M_PI) beamAngle += 2 * M_PI;
+      int index = (int)floor((beamAngle - scan.angle_min) / scan.angle_increment + 0.5);
+      if(index < 0 or index >= predicted.ranges.size()){
+        continue;
+      }
+      double range = sqrt(dx * dx + dy * dy);
+      if(range < predicted.ranges[index]){
+        predicted.ranges[index] = range;
+      }
+    }
+    return predicted;
 }
 
 double AgentState::getDistanceToObstacle(double rotation_angle){
 	// ROS_DEBUG("In getDistanceToObstacle");
-	// one increment in the laser range scan is 1/3 degrees, i.e 0.005817 in radians  
-	int index = (int)(rotation_angle/(laserScanRadianIncrement));
-  // cout << "index " << index << endl;
-	//ROS_DEBUG("In getDistanceToObstacle after index");
-	//shift the index in the positive
-	index = index + 330;
-	//ROS_DEBUG("In getDistanceToObstacle after index shift");
-	if(index < 0) index = 0;
-	//ROS_DEBUG("In getDistanceToObstacle after first if");
-	if(index > 659) index = 659;
-	//ROS_DEBUG("In getDistanceToObstacle after second if");
+	// beam closest to the rotation, counted from the beam straight ahead
+	int index = laserGeometry.beamIndex(rotation_angle);
 	// cout << index << " " << currentLaserScan.ranges.size() << endl;
-	if(currentLaserScan.ranges.size() == 0) { return maxLaserRange; }
+	if(currentLaserScan->ranges.size() == 0) { return maxLaserRange; }
 	// cout << currentLaserScan.ranges[index] << endl;
 
   double min_distance = 25;
@@ -435,12 +424,12 @@ double AgentState::getDistanceToObstacle(double rotation_angle){
   if(start_index < 0)
     start_index = 0;
   int end_index = index + 2;
-  if(end_index > 659)
-    end_index = 659;
+  if(end_index > (int)currentLaserScan->ranges.size() - 1)
+    end_index = currentLaserScan->ranges.size() - 1;
 
   for(int i = start_index; i <= end_index; i++){
-    if(currentLaserScan.ranges[i] < min_distance){
-      min_distance = currentLaserScan.ranges[i];
+    if(currentLaserScan->ranges[i] < min_distance){
+      min_distance = currentLaserScan->ranges[i];
     }
   }
   return min_distance;
@@ -489,16 +478,8 @@ double AgentState::getDistanceToObstacle(double rotation_angle){
 
 double AgentState::getDistanceToObstacle(Position initialPosition, vector<CartesianPoint> initialLaser, double rotation_angle){
   //ROS_DEBUG("In getDistanceToObstacle");
-  // one increment in the laser range scan is 1/3 degrees, i.e 0.005817 in radians  
-  int index = (int)(rotation_angle/(laserScanRadianIncrement));
-  //ROS_DEBUG("In getDistanceToObstacle after index");
-  //shift the index in the positive
-  index = index + 330;
-  //ROS_DEBUG("In getDistanceToObstacle after index shift");
-  if(index < 0) index = 0;
-  //ROS_DEBUG("In getDistanceToObstacle after first if");
-  if(index > 659) index = 659;
-  //ROS_DEBUG("In getDistanceToObstacle after second if");
+  // beam closest to the rotation, counted from the beam straight ahead
+  int index = laserGeometry.beamIndex(rotation_angle);
   //cout << index << " " << currentLaserScan.ranges.size() << endl;
   if(initialLaser.size() == 0) { return maxLaserRange; }
   //cout << currentLaserScan.ranges[index] << endl;
@@ -508,8 +489,8 @@ double AgentState::getDistanceToObstacle(Position initialPosition, vector<Cartes
   if(start_index < 0)
     start_index = 0;
   int end_index = index + 2;
-  if(end_index > 659)
-    end_index = 659;
+  if(end_index > (int)initialLaser.size() - 1)
+    end_index = initialLaser.size() - 1;
 
   for(int i = start_index; i <= end_index; i++){
     double distance_to_laser = initialPosition.getDistance(initialLaser[i].get_x(), initialLaser[i].get_y());
@@ -861,7 +842,7 @@ bool AgentState::getRobotConfined(int decisionLimit, double distanceLimit){
   return robotConfined;
 }
 
-vector <Position> AgentState::getCrowdPositions(geometry_msgs::PoseArray crowdpose){
+vector <Position> AgentState::getCrowdPositions(const geometry_msgs::PoseArray &crowdpose){
   vector <Position> crowdPositions;
   for(int i = 0; i < crowdpose.poses.size(); i++){
     double x = crowdpose.poses[i].position.x;
@@ -876,7 +857,7 @@ vector <Position> AgentState::getCrowdPositions(geometry_msgs::PoseArray crowdpo
 }
 
 bool AgentState::crowdModelLearned(){
-  std::vector<double> densities = crowdModel.densities;
+  const std::vector<double> &densities = crowdModel->densities;
   for(int i = 0; i < densities.size() ; i++){
     if(densities[i]>0){
       return true;
@@ -886,7 +867,7 @@ bool AgentState::crowdModelLearned(){
 }
 
 bool AgentState::riskModelLearned(){
-  std::vector<double> risk = crowdModel.risk;
+  const std::vector<double> &risk = crowdModel->risk;
   for(int i = 0; i < risk.size() ; i++){
     if(risk[i]>0){
       return true;
@@ -896,49 +877,49 @@ bool AgentState::riskModelLearned(){
 }
 
 bool AgentState::flowModelLearned(){
-  std::vector<double> left = crowdModel.left;
+  const std::vector<double> &left = crowdModel->left;
   for(int i = 0; i < left.size() ; i++){
     if(left[i]>0){
       return true;
     }
   }
-  std::vector<double> right = crowdModel.right;
+  const std::vector<double> &right = crowdModel->right;
   for(int i = 0; i < right.size() ; i++){
     if(right[i]>0){
       return true;
     }
   }
-  std::vector<double> up = crowdModel.up;
+  const std::vector<double> &up = crowdModel->up;
   for(int i = 0; i < up.size() ; i++){
     if(up[i]>0){
       return true;
     }
   }
-  std::vector<double> down = crowdModel.down;
+  const std::vector<double> &down = crowdModel->down;
   for(int i = 0; i < down.size() ; i++){
     if(down[i]>0){
       return true;
     }
   }
-  std::vector<double> up_left = crowdModel.up_left;
+  const std::vector<double> &up_left = crowdModel->up_left;
   for(int i = 0; i < up_left.size() ; i++){
     if(up_left[i]>0){
       return true;
     }
   }
-  std::vector<double> up_right = crowdModel.up_right;
+  const std::vector<double> &up_right = crowdModel->up_right;
   for(int i = 0; i < up_right.size() ; i++){
     if(up_right[i]>0){
       return true;
     }
   }
-  std::vector<double> down_left = crowdModel.down_left;
+  const std::vector<double> &down_left = crowdModel->down_left;
   for(int i = 0; i < down_left.size() ; i++){
     if(down_left[i]>0){
       return true;
     }
   }
-  std::vector<double> down_right = crowdModel.down_right;
+  const std::vector<double> &down_right = crowdModel->down_right;
   for(int i = 0; i < down_right.size() ; i++){
     if(down_right[i]>0){
       return true;
@@ -948,45 +929,45 @@ bool AgentState::flowModelLearned(){
 }
 
 double AgentState::getGridValue(double x, double y){
-  int resolution = crowdModel.resolution;
-  int height = crowdModel.height;
-  int width = crowdModel.width;
+  int resolution = crowdModel->resolution;
+  int height = crowdModel->height;
+  int width = crowdModel->width;
   //std::vector<double> densities = crowdModel.densities;
-  double gridValue = crowdModel.densities[(floor(y/resolution)*width)+floor(x/resolution)];
+  double gridValue = crowdModel->densities[(floor(y/resolution)*width)+floor(x/resolution)];
   //cout << "resolution = " << resolution << " height = " << height << " width = " << width << " gridValue = " << gridValue << endl;
   return gridValue;
 }
 
 double AgentState::getRiskValue(double x, double y){
-  int resolution = crowdModel.resolution;
-  int height = crowdModel.height;
-  int width = crowdModel.width;
+  int resolution = crowdModel->resolution;
+  int height = crowdModel->height;
+  int width = crowdModel->width;
   //std::vector<double> risk = crowdModel.risk;
-  double riskValue = crowdModel.risk[(floor(y/resolution)*width)+floor(x/resolution)];
+  double riskValue = crowdModel->risk[(floor(y/resolution)*width)+floor(x/resolution)];
   //cout << "resolution = " << resolution << " height = " << height << " width = " << width << " riskValue = " << riskValue << endl;
   return riskValue;
 }
 
 double AgentState::getFlowValue(double x, double y, double theta){
-  int resolution = crowdModel.resolution;
-  int height = crowdModel.height;
-  int width = crowdModel.width;
+  int resolution = crowdModel->resolution;
+  int height = crowdModel->height;
+  int width = crowdModel->width;
   //std::vector<double> left = crowdModel.left;
-  double leftValue = crowdModel.left[(floor(y/resolution)*width)+floor(x/resolution)];
+  double leftValue = crowdModel->left[(floor(y/resolution)*width)+floor(x/resolution)];
   //std::vector<double> right = crowdModel.right;
-  double rightValue = crowdModel.right[(floor(y/resolution)*width)+floor(x/resolution)];
+  double rightValue = crowdModel->right[(floor(y/resolution)*width)+floor(x/resolution)];
   //std::vector<double> up = crowdModel.up;
-  double upValue = crowdModel.up[(floor(y/resolution)*width)+floor(x/resolution)];
+  double upValue = crowdModel->up[(floor(y/resolution)*width)+floor(x/resolution)];
   //std::vector<double> down = crowdModel.down;
-  double downValue = crowdModel.down[(floor(y/resolution)*width)+floor(x/resolution)];
+  double downValue = crowdModel->down[(floor(y/resolution)*width)+floor(x/resolution)];
   //std::vector<double> up_left = crowdModel.up_left;
-  double up_leftValue = crowdModel.up_left[(floor(y/resolution)*width)+floor(x/resolution)];
+  double up_leftValue = crowdModel->up_left[(floor(y/resolution)*width)+floor(x/resolution)];
   //std::vector<double> up_right = crowdModel.up_right;
-  double up_rightValue = crowdModel.up_right[(floor(y/resolution)*width)+floor(x/resolution)];
+  double up_rightValue = crowdModel->up_right[(floor(y/resolution)*width)+floor(x/resolution)];
   //std::vector<double> down_left = crowdModel.down_left;
-  double down_leftValue = crowdModel.down_left[(floor(y/resolution)*width)+floor(x/resolution)];
+  double down_leftValue = crowdModel->down_left[(floor(y/resolution)*width)+floor(x/resolution)];
   //std::vector<double> down_right = crowdModel.down_right;
-  double down_rightValue = crowdModel.down_right[(floor(y/resolution)*width)+floor(x/resolution)];
+  double down_rightValue = crowdModel->down_right[(floor(y/resolution)*width)+floor(x/resolution)];
 
   double totalX = leftValue*cos(M_PI) + rightValue*cos(0) + upValue*cos(M_PI/2) + downValue*cos(3*M_PI/2) + up_leftValue*cos(3*M_PI/4) + up_rightValue*cos(M_PI/4) + down_leftValue*cos(5*M_PI/4) + down_rightValue*cos(7*M_PI/4);
   double totalY = leftValue*sin(M_PI) + rightValue*sin(0) + upValue*sin(M_PI/2) + downValue*sin(3*M_PI/2) + up_leftValue*sin(3*M_PI/4) + up_rightValue*sin(M_PI/4) + down_leftValue*sin(5*M_PI/4) + down_rightValue*sin(7*M_PI/4);
@@ -1013,52 +994,39 @@ double AgentState::getFlowValue(double x, double y, double theta){
 }
 
 double AgentState::getCrowdObservation(double x, double y){
-  int resolution = crowdModel.resolution;
-  int height = crowdModel.height;
-  int width = crowdModel.width;
-  double crowdObservationValue = crowdModel.crowd_observations[(floor(y/resolution)*width)+floor(x/resolution)];
+  int resolution = crowdModel->resolution;
+  int height = crowdModel->height;
+  int width = crowdModel->width;
+  double crowdObservationValue = crowdModel->crowd_observations[(floor(y/resolution)*width)+floor(x/resolution)];
   //cout << "resolution = " << resolution << " height = " << height << " width = " << width << " crowdObservationValue = " << crowdObservationValue << endl;
   return crowdObservationValue;
 }
 
 double AgentState::getRiskExperience(double x, double y){
-  int resolution = crowdModel.resolution;
-  int height = crowdModel.height;
-  int width = crowdModel.width;
-  double riskExperienceValue = crowdModel.risk_experiences[(floor(y/resolution)*width)+floor(x/resolution)];
+  int resolution = crowdModel->resolution;
+  int height = crowdModel->height;
+  int width = crowdModel->width;
+  double riskExperienceValue = crowdModel->risk_experiences[(floor(y/resolution)*width)+floor(x/resolution)];
   //cout << "resolution = " << resolution << " height = " << height << " width = " << width << " riskExperienceValue = " << riskExperienceValue << endl;
   return riskExperienceValue;
 }
 
 double AgentState::getFLowObservation(double x, double y){
-  int resolution = crowdModel.resolution;
-  int height = crowdModel.height;
-  int width = crowdModel.width;
-  double leftValue = crowdModel.left[(floor(y/resolution)*width)+floor(x/resolution)];
-  double rightValue = crowdModel.right[(floor(y/resolution)*width)+floor(x/resolution)];
-  double upValue = crowdModel.up[(floor(y/resolution)*width)+floor(x/resolution)];
-  double downValue = crowdModel.down[(floor(y/resolution)*width)+floor(x/resolution)];
-  double up_leftValue = crowdModel.up_left[(floor(y/resolution)*width)+floor(x/resolution)];
-  double up_rightValue = crowdModel.up_right[(floor(y/resolution)*width)+floor(x/resolution)];
-  double down_leftValue = crowdModel.down_left[(floor(y/resolution)*width)+floor(x/resolution)];
-  double down_rightValue = crowdModel.down_right[(floor(y/resolution)*width)+floor(x/resolution)];
+  int resolution = crowdModel->resolution;
+  int height = crowdModel->height;
+  int width = crowdModel->width;
+  double leftValue = crowdModel->left[(floor(y/resolution)*width)+floor(x/resolution)];
+  double rightValue = crowdModel->right[(floor(y/resolution)*width)+floor(x/resolution)];
+  double upValue = crowdModel->up[(floor(y/resolution)*width)+floor(x/resolution)];
+  double downValue = crowdModel->down[(floor(y/resolution)*width)+floor(x/resolution)];
+  double up_leftValue = crowdModel->up_left[(floor(y/resolution)*width)+floor(x/resolution)];
+  double up_rightValue = crowdModel->up_right[(floor(y/resolution)*width)+floor(x/resolution)];
+  double down_leftValue = crowdModel->down_left[(floor(y/resolution)*width)+floor(x/resolution)];
+  double down_rightValue = crowdModel->down_right[(floor(y/resolution)*width)+floor(x/resolution)];
 
   double totalX = leftValue*cos(M_PI) + rightValue*cos(0) + upValue*cos(M_PI/2) + downValue*cos(3*M_PI/2) + up_leftValue*cos(3*M_PI/4) + up_rightValue*cos(M_PI/4) + down_leftValue*cos(5*M_PI/4) + down_rightValue*cos(7*M_PI/4);
   double totalY = leftValue*sin(M_PI) + rightValue*sin(0) + upValue*sin(M_PI/2) + downValue*sin(3*M_PI/2) + up_leftValue*sin(3*M_PI/4) + up_rightValue*sin(M_PI/4) + down_leftValue*sin(5*M_PI/4) + down_rightValue*sin(7*M_PI/4);
   double flowMagnitude = sqrt(totalX*totalX + totalY*totalY);
-  double crowdObservationValue = crowdModel.crowd_observations[(floor(y/resolution)*width)+floor(x/resolution)];
+  double crowdObservationValue = crowdModel->crowd_observations[(floor(y/resolution)*width)+floor(x/resolution)];
   return flowMagnitude*crowdObservationValue;
 }
-
-void AgentState::dfs(int x, int y, int current_label, vector<int> dx, vector<int> dy, int row_count, int col_count, vector< vector<int> > *label, vector< vector<int> > *m) {
-  if (x < 0 || x == row_count) return; // out of bounds
-  if (y < 0 || y == col_count) return; // out of bounds
-  if ((*label)[x][y] != 0 || (*m)[x][y] < 0) return; // already labeled or not marked with 1 in m
-
-  // mark the current cell
-  (*label)[x][y] = current_label;
-
-  // recursively mark the neighbors
-  for (int direction = 0; direction < dx.size(); ++direction)
-    dfs(x + dx[direction], y + dy[direction], current_label, dx, dy, row_count, col_count, label, m);
-}
\ No newline at end of file
@@ -0,0 +1,64 @@
+/*
+ * BitGrid.cpp
+ *
+ */
+
+#include "BitGrid.h"
+#include <algorithm>
+
+void BitGrid::assign(int l, int h, bool value){
+  length = max(l, 0);
+  height = max(h, 0);
+  words_per_x = (height + 63) / 64;
+  bits.assign(length * words_per_x, 0);
+  if(value){
+    setAll(true);
+  }
+}
+
+uint64_t BitGrid::lastWordMask() const {
+  int used = height & 63;
+  return used == 0 ? ~(uint64_t)0 : ((uint64_t)1 << used) - 1;
+}
+
+int BitGrid::popcount(uint64_t word){
+#if defined(__GNUC__)
+  return __builtin_popcountll(word);
+#else
+  word = word - ((word >> 1) & 0x5555555555555555ULL);
+  word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+  word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (int)((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+void BitGrid::setAll(bool value){
+  fill(bits.begin(), bits.end(), value ? ~(uint64_t)0 : 0);
+  if(value and words_per_x > 0){
+    uint64_t last = lastWordMask();
+    for(int x = 0; x < length; x++){
+      bits[x * words_per_x + words_per_x - 1] &= last;
+    }
+  }
+}
+
+int BitGrid::count(int x0, int y0, int x1, int y1) const {
+  x0 = max(x0, 0);
+  x1 = min(x1, length - 1);
+  y0 = max(y0, 0);
+  y1 = min(y1, height - 1);
+  if(x0 > x1 or y0 > y1){
+    return 0;
+  }
+  int first_word = y0 >> 6, last_word = y1 >> 6;
+  int total = 0;
+  for(int x = x0; x <= x1; x++){
+    const uint64_t *row = &bits[x * words_per_x];
+    for(int w = first_word; w <= last_word; w++){
+      int low = (w == first_word ? y0 & 63 : 0);
+      int high = (w == last_word ? y1 & 63 : 63);
+      total += popcount(row[w] & (~(uint64_t)0 >> (63 - high)) & (~(uint64_t)0 << low));
+    }
+  }
+  return total;
+}
@@ -0,0 +1,159 @@
+/*
+ * ConnectedComponents.cpp
+ *
+ */
+
+#include "ConnectedComponents.h"
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+int ConnectedComponents::stripes = 1;
+
+vector< pair<int, int> > ConnectedComponents::fourConnected(){
+  vector< pair<int, int> > offsets;
+  offsets.push_back(make_pair(1, 0));
+  offsets.push_back(make_pair(0, 1));
+  return offsets;
+}
+
+vector< pair<int, int> > ConnectedComponents::eightConnected(){
+  vector< pair<int, int> > offsets = fourConnected();
+  offsets.push_back(make_pair(1, 1));
+  offsets.push_back(make_pair(1, -1));
+  return offsets;
+}
+
+void ConnectedComponents::setStripes(int count){
+  stripes = (count < 1 ? 1 : count);
+}
+
+int ConnectedComponents::getStripes(){
+  return stripes;
+}
+
+// Root of the cell's set, halving the path on the way
+int ConnectedComponents::find(vector<int> &parent, int cell){
+  while(parent[cell] != cell){
+    parent[cell] = parent[parent[cell]];
+    cell = parent[cell];
+  }
+  return cell;
+}
+
+// The smaller index becomes the root, so a stripe's sets stay rooted inside the stripe
+void ConnectedComponents::join(vector<int> &parent, int a, int b){
+  int root_a = find(parent, a);
+  int root_b = find(parent, b);
+  if(root_a < root_b){
+    parent[root_b] = root_a;
+  }
+  else if(root_b < root_a){
+    parent[root_a] = root_b;
+  }
+}
+
+// Joins each foreground cell in rows [first_row, last_row) with its forward neighbors that are
+// foreground and lie in rows [pair_first_row, pair_last_row)
+void ConnectedComponents::joinRows(const vector<unsigned char> *foreground, int rows, int cols, const vector< pair<int, int> > *offsets, vector<int> *parent, int first_row, int last_row, int pair_first_row, int pair_last_row){
+  for(int r = first_row; r < last_row; r++){
+    for(int c = 0; c < cols; c++){
+      int cell = r * cols + c;
+      if(!(*foreground)[cell]){
+        continue;
+      }
+      for(int k = 0; k < offsets->size(); k++){
+        int r2 = r + (*offsets)[k].first;
+        int c2 = c + (*offsets)[k].second;
+        if(r2 < pair_first_row or r2 >= pair_last_row or c2 < 0 or c2 >= cols){
+          continue;
+        }
+        int neighbor = r2 * cols + c2;
+        if((*foreground)[neighbor]){
+          join(*parent, cell, neighbor);
+        }
+      }
+    }
+  }
+}
+
+int ConnectedComponents::label(const vector<unsigned char> &foreground, int rows, int cols, const vector< pair<int, int> > &offsets, vector<int> &labels){
+  int cells = rows * cols;
+  labels.assign(cells, 0);
+  if(cells == 0){
+    return 0;
+  }
+  // Point every offset forward in scan order, so each pair is joined once
+  vector< pair<int, int> > forward;
+  int max_row_offset = 0;
+  for(int k = 0; k < offsets.size(); k++){
+    pair<int, int> offset = offsets[k];
+    if(offset.first < 0 or (offset.first == 0 and offset.second < 0)){
+      offset = make_pair(-offset.first, -offset.second);
+    }
+    if(offset.first == 0 and offset.second == 0){
+      continue;
+    }
+    forward.push_back(offset);
+    max_row_offset = max(max_row_offset, offset.first);
+  }
+
+  vector<int> parent(cells);
+  for(int i = 0; i < cells; i++){
+    parent[i] = i;
+  }
+  int stripe_count = min(stripes, rows);
+  if(stripe_count <= 1){
+    joinRows(&foreground, rows, cols, &forward, &parent, 0, rows, 0, rows);
+  }
+  else{
+    // Each stripe only touches its own cells, the pairs crossing a border are joined afterwards
+    boost::thread_group workers;
+    for(int s = 0; s < stripe_count; s++){
+      int first_row = rows * s / stripe_count;
+      int last_row = rows * (s + 1) / stripe_count;
+      workers.create_thread(boost::bind(&ConnectedComponents::joinRows, &foreground, rows, cols, &forward, &parent, first_row, last_row, first_row, last_row));
+    }
+    workers.join_all();
+    for(int s = 1; s < stripe_count; s++){
+      int border = rows * s / stripe_count;
+      joinRows(&foreground, rows, cols, &forward, &parent, max(border - max_row_offset, 0), border, border, rows);
+    }
+  }
+
+  vector<int> root_label(cells, 0);
+  int components = 0;
+  for(int i = 0; i < cells; i++){
+    if(!foreground[i]){
+      continue;
+    }
+    int root = find(parent, i);
+    if(root_label[root] == 0){
+      root_label[root] = ++components;
+    }
+    labels[i] = root_label[root];
+  }
+  return components;
+}
+
+int ConnectedComponents::labelGrid(const vector< vector<int> > &grid, int min_value, const vector< pair<int, int> > &offsets, vector< vector<int> > &labels, int background_label){
+  int rows = grid.size();
+  int cols = (rows > 0 ? grid[0].size() : 0);
+  vector<unsigned char> foreground(rows * cols, 0);
+  for(int r = 0; r < rows; r++){
+    for(int c = 0; c < cols; c++){
+      foreground[r * cols + c] = (grid[r][c] >= min_value);
+    }
+  }
+  vector<int> flat_labels;
+  int components = label(foreground, rows, cols, offsets, flat_labels);
+  labels.assign(rows, vector<int>(cols, background_label));
+  for(int r = 0; r < rows; r++){
+    for(int c = 0; c < cols; c++){
+      if(flat_labels[r * cols + c] > 0){
+        labels[r][c] = flat_labels[r * cols + c];
+      }
+    }
+  }
+  return components;
+}
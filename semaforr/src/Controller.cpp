@@ -5,9 +5,12 @@
           
 #include "Controller.h"
 #include "FORRGeometry.h"
+#include "Instrumentation.h"
+#include "ConnectedComponents.h"
 #include <unistd.h>
 
 #include <deque>
+#include <algorithm>
 #include <iostream> 
 #include <fstream>
 #include <math.h>
@@ -83,6 +86,31 @@ void Controller::initialize_params(string filename){
   string fileLine;
   std::ifstream file(filename.c_str());
   ROS_DEBUG_STREAM("Reading params_file:" << filename);
+  decisionDeadline = 0;
+  anytimeWeight = 1;
+  jumpPointPlanners.clear();
+  planCacheSize = 0;
+  stringPullWidth = 0;
+  crowdModelVersion = 0;
+  decisionStartTime = 0;
+  tierThreeCutOff = false;
+  decisionLogFile = "";
+  decisionLogKeyframe = 100;
+  decisionInputFile = "";
+  laserBeamCount = 660;
+  spatialModelSnapshotFile = "";
+  visualizationRate = 10;
+  diagnosticsRate = 1;
+  labelingStripes = 1;
+  instrumentationSummaryFile = "";
+  eventDriven = false;
+  commandRate = 30;
+  speculativeDecision = false;
+  speculativeTolerance = 0.1;
+  speculativeCheck = false;
+  speculationValid = false;
+  speculationCommitted = false;
+  spatialModelVersion = 0;
   //cout << "Inside file in tasks " << endl;
   if(!file.is_open()){
     ROS_DEBUG("Unable to locate or read params config file!");
@@ -139,6 +167,14 @@ void Controller::initialize_params(string filename){
       maxLaserRange = atof(vstrings[1].c_str());
       ROS_DEBUG_STREAM("maxLaserRange " << maxLaserRange);
     }
+    else if (fileLine.find("laserBeamCount") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      laserBeamCount = atoi(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("laserBeamCount " << laserBeamCount);
+    }
     else if (fileLine.find("maxForwardActionBuffer") != std::string::npos) {
       std::stringstream ss(fileLine);
       std::istream_iterator<std::string> begin(ss);
@@ -187,6 +223,161 @@ void Controller::initialize_params(string filename){
       planLimit = atoi(vstrings[1].c_str());
       ROS_DEBUG_STREAM("planLimit " << planLimit);
     }
+    else if (fileLine.find("decisionDeadline") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      decisionDeadline = atof(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("decisionDeadline " << decisionDeadline);
+    }
+    else if (fileLine.find("anytimeWeight") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      anytimeWeight = atof(vstrings[1].c_str());
+      if(anytimeWeight < 1){
+        anytimeWeight = 1;
+      }
+      ROS_DEBUG_STREAM("anytimeWeight " << anytimeWeight);
+    }
+    else if (fileLine.find("stringPullWidth") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      stringPullWidth = atof(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("stringPullWidth " << stringPullWidth);
+    }
+    else if (fileLine.find("planCacheSize") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      planCacheSize = atoi(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("planCacheSize " << planCacheSize);
+    }
+    else if (fileLine.find("jumpPointSearch") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      jumpPointPlanners.assign(vstrings.begin() + 1, vstrings.end());
+      ROS_DEBUG_STREAM("jumpPointSearch " << jumpPointPlanners.size() << " planners");
+    }
+    else if (fileLine.find("decisionLogFile") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      if(vstrings.size() > 1){
+        decisionLogFile = vstrings[1];
+      }
+      ROS_DEBUG_STREAM("decisionLogFile " << decisionLogFile);
+    }
+    else if (fileLine.find("decisionInputFile") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      if(vstrings.size() > 1){
+        decisionInputFile = vstrings[1];
+      }
+      ROS_DEBUG_STREAM("decisionInputFile " << decisionInputFile);
+    }
+    else if (fileLine.find("spatialModelSnapshotFile") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      if(vstrings.size() > 1){
+        spatialModelSnapshotFile = vstrings[1];
+      }
+      ROS_DEBUG_STREAM("spatialModelSnapshotFile " << spatialModelSnapshotFile);
+    }
+    else if (fileLine.find("decisionLogKeyframe") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      decisionLogKeyframe = atoi(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("decisionLogKeyframe " << decisionLogKeyframe);
+    }
+    else if (fileLine.find("visualizationRate") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      visualizationRate = atof(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("visualizationRate " << visualizationRate);
+    }
+    else if (fileLine.find("labelingStripes") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      labelingStripes = atoi(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("labelingStripes " << labelingStripes);
+    }
+    else if (fileLine.find("diagnosticsRate") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      diagnosticsRate = atof(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("diagnosticsRate " << diagnosticsRate);
+    }
+    else if (fileLine.find("instrumentationSummaryFile") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      if(vstrings.size() > 1){
+        instrumentationSummaryFile = vstrings[1];
+      }
+      ROS_DEBUG_STREAM("instrumentationSummaryFile " << instrumentationSummaryFile);
+    }
+    else if (fileLine.find("eventDriven") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      eventDriven = atoi(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("eventDriven " << eventDriven);
+    }
+    else if (fileLine.find("commandRate") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      commandRate = atof(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("commandRate " << commandRate);
+    }
+    else if (fileLine.find("speculativeDecision") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      speculativeDecision = atoi(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("speculativeDecision " << speculativeDecision);
+    }
+    else if (fileLine.find("speculativeCheck") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      speculativeCheck = atoi(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("speculativeCheck " << speculativeCheck);
+    }
+    else if (fileLine.find("speculativeTolerance") != std::string::npos) {
+      std::stringstream ss(fileLine);
+      std::istream_iterator<std::string> begin(ss);
+      std::istream_iterator<std::string> end;
+      std::vector<std::string> vstrings(begin, end);
+      speculativeTolerance = atof(vstrings[1].c_str());
+      ROS_DEBUG_STREAM("speculativeTolerance " << speculativeTolerance);
+    }
     else if (fileLine.find("trailsOn") != std::string::npos) {
       std::stringstream ss(fileLine);
       std::istream_iterator<std::string> begin(ss);
@@ -665,6 +856,14 @@ void Controller::initialize_planner(string map_config, string map_dimensions, in
     hwsk_planner->setOriginalNavGraph(origNavGraphHallwaySkeleton);
     ROS_DEBUG_STREAM("Created planner: hallwayskel");
   }
+  for (int i = 0; i < tier2Planners.size(); i++) {
+    tier2Planners[i]->setPlanCacheSize(planCacheSize);
+    tier2Planners[i]->setStringPullWidth(stringPullWidth*100);
+    if (find(jumpPointPlanners.begin(), jumpPointPlanners.end(), tier2Planners[i]->getName()) != jumpPointPlanners.end()) {
+      tier2Planners[i]->setJumpPointSearch(true);
+      ROS_DEBUG_STREAM("Jump point search for planner: " << tier2Planners[i]->getName());
+    }
+  }
   cout << "initialized planners" << endl;
 }
 
@@ -805,7 +1004,7 @@ void Controller::initialize_spatial_model(string filename){
       }
       vector< vector< TrailMarker> > trls;
       vector<CartesianPoint> lsim;
-      for (int k = 0; k < 660; k++){
+      for (int k = 0; k < laserBeamCount; k++){
         lsim.push_back(CartesianPoint(0,0));
       }
       for(int i = 0; i < out.size(); i++){
@@ -893,6 +1092,7 @@ void Controller::initialize_spatial_model(string filename){
       ROS_DEBUG_STREAM("regionpath " << regionpath.size());
     }
   }
+  spatialModelVersion++;
 }
 
 
@@ -904,6 +1104,7 @@ Controller::Controller(string advisor_config, string params_config, string map_c
 
   // Initialize robot parameters from a config file
   initialize_params(params_config);
+  ConnectedComponents::setStripes(labelingStripes);
   
   // Initialize planner and map dimensions
   int l,h;
@@ -921,6 +1122,7 @@ Controller::Controller(string advisor_config, string params_config, string map_c
 
   // Initialize parameters
   beliefs->getAgentState()->setAgentStateParameters(canSeePointEpsilon, laserScanRadianIncrement, robotFootPrint, robotFootPrintBuffer, maxLaserRange, maxForwardActionBuffer, maxForwardActionSweepAngle);
+  beliefs->getAgentState()->setLaserGeometry(LaserGeometry(laserBeamCount, laserScanRadianIncrement, maxLaserRange));
   tier1 = new Tier1Advisor(beliefs);
   firstTaskAssigned = false;
   decisionStats = new FORRActionStats();
@@ -933,6 +1135,14 @@ Controller::Controller(string advisor_config, string params_config, string map_c
   frontierFinished = 0;
   frontierExploration = new FrontierExplorer(l, h, highwayTimeThreshold, highwayDecisionThreshold, arrMove, arrRotate, moveArrMax, rotateArrMax);
 
+  // Start from the spatial model learned by earlier runs on this map
+  mapHash = hashFile(map_config);
+  if(spatialModelSnapshotFile != "" and beliefs->loadSnapshot(spatialModelSnapshotFile, mapHash)){
+    ROS_INFO_STREAM("Loaded spatial model snapshot " << spatialModelSnapshotFile << " with " << beliefs->getAgentState()->getAllTrace().size() << " tasks");
+    spatialModelVersion++;
+    updateSkeletonGraph(beliefs->getAgentState());
+  }
+
   // Initialize circumnavigator
   // PathPlanner *skeleton_planner;
   // for (planner2It it = tier2Planners.begin(); it != tier2Planners.end(); it++){
@@ -945,8 +1155,11 @@ Controller::Controller(string advisor_config, string params_config, string map_c
 
 
 // Function which takes sensor inputs and updates it for semaforr to use for decision making, and updates task status
-void Controller::updateState(Position current, sensor_msgs::LaserScan laser_scan, geometry_msgs::PoseArray crowdpose, geometry_msgs::PoseArray crowdposeall){
+void Controller::updateState(Position current, const sensor_msgs::LaserScan::ConstPtr &laser_scan, const geometry_msgs::PoseArray::ConstPtr &crowdpose, const geometry_msgs::PoseArray::ConstPtr &crowdposeall){
   cout << "In update state" << endl;
+  ScopedTimer updateTimer("update_state");
+  // The decision deadline covers replanning here as well as decide()
+  decisionStartTime = getCurrentTimeSec();
   beliefs->getAgentState()->setCurrentSensor(current, laser_scan);
   beliefs->getAgentState()->setCrowdPose(crowdpose);
   beliefs->getAgentState()->setCrowdPoseAll(crowdposeall);
@@ -1126,6 +1339,7 @@ bool Controller::isMissionComplete(){
 //
 FORRAction Controller::decide() {
   ROS_DEBUG("Entering decision loop");
+  ScopedTimer decideTimer("decide");
   FORRAction decidedAction;
   if(!highwayExploration->getHighwaysComplete() and highwaysOn){
     decidedAction = highwayExploration->exploreDecision(beliefs->getAgentState()->getCurrentPosition(), beliefs->getAgentState()->getCurrentLaserScan());
@@ -1143,8 +1357,11 @@ FORRAction Controller::decide() {
     if(frontierFinished < 3){
       frontierFinished++;
     }
+    speculationCommitted = speculationMatches();
     decidedAction = FORRDecision();
+    speculationCommitted = false;
   }
+  speculationValid = false;
   //ROS_DEBUG("After decision made");
   beliefs->getAgentState()->getCurrentTask()->incrementDecisionCount();
   //ROS_DEBUG("After incrementDecisionCount");
@@ -1156,6 +1373,111 @@ FORRAction Controller::decide() {
 }
 
 
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Speculative decisions: while an action executes, tier 3 advice is scored from the pose and scan the
+// action is expected to end at, recorded in the position and laser histories for the time being as the
+// real decision will find them. The next decision reuses it if nothing it depends on has moved on.
+// Predicted poses that finish a waypoint or the task are skipped, since reaching them replans and learns.
+//
+void Controller::speculate(FORRAction action){
+  speculationValid = false;
+  AgentState *agentState = beliefs->getAgentState();
+  Task *task = agentState->getCurrentTask();
+  if(!speculativeDecision or task == NULL or action.type == PAUSE or action.parameter == 0){
+    return;
+  }
+  if((!highwayExploration->getHighwaysComplete() and highwaysOn) or (!frontierExploration->getFrontiersComplete() and frontiersOn)){
+    return;
+  }
+  double start = getCurrentTimeSec();
+  Position actualPose = agentState->getCurrentPosition();
+  sensor_msgs::LaserScan::ConstPtr actualScan = agentState->getCurrentLaserScanPtr();
+  Position predictedPose = agentState->getExpectedPositionAfterAction(action);
+  sensor_msgs::LaserScan::ConstPtr predictedScan = boost::make_shared<sensor_msgs::LaserScan>(agentState->predictLaserScan(actualPose, *actualScan, predictedPose));
+  if(task->isTaskComplete(predictedPose) or task->isAnyWaypointComplete(predictedPose, agentState->transformToEndpoints(predictedPose, *predictedScan))){
+    return;
+  }
+
+  agentState->setSpeculativeSensor(predictedPose, predictedScan);
+  speculativeCommenting.clear();
+  speculativeAdvice.clear();
+  for (advisor3It it = tier3Advisors.begin(); it != tier3Advisors.end(); ++it){
+    Tier3Advisor *advisor = *it;
+    if(advisor->is_active() == false){
+      continue;
+    }
+    advisor->set_commenting();
+    speculativeCommenting[advisor] = advisor->is_commenting();
+    if(advisor->is_commenting()){
+      speculativeAdvice[advisor] = advisor->rawAdvice();
+    }
+  }
+  agentState->undoSpeculativeSensor(actualPose, actualScan);
+
+  speculativeTask = task;
+  speculativeDecisionCount = task->getDecisionCount();
+  speculativeModelVersion = spatialModelVersion;
+  speculativeWaypointX = task->getX();
+  speculativeWaypointY = task->getY();
+  speculativePose = predictedPose;
+  speculativeScan = predictedScan;
+  speculativeCrowd = agentState->getCrowdPosePtr();
+  speculationValid = true;
+  ROS_DEBUG_STREAM("Speculated on the next decision in " << (getCurrentTimeSec() - start));
+}
+
+bool Controller::speculationMatches(){
+  if(!speculationValid){
+    return false;
+  }
+  AgentState *agentState = beliefs->getAgentState();
+  Task *task = agentState->getCurrentTask();
+  if(task != speculativeTask or task->getDecisionCount() != speculativeDecisionCount or spatialModelVersion != speculativeModelVersion){
+    ROS_DEBUG("Speculation recomputed: task or spatial model changed");
+    return false;
+  }
+  if(task->getX() != speculativeWaypointX or task->getY() != speculativeWaypointY){
+    ROS_DEBUG("Speculation recomputed: waypoint changed");
+    return false;
+  }
+  Position pose = agentState->getCurrentPosition();
+  double heading = fabs(pose.getTheta() - speculativePose.getTheta());
+  if(heading > M_PI){
+    heading = 2 * M_PI - heading;
+  }
+  if(pose.getDistance(speculativePose) > speculativeTolerance or heading > speculativeTolerance){
+    ROS_DEBUG_STREAM("Speculation recomputed: pose off by " << pose.getDistance(speculativePose) << " " << heading);
+    return false;
+  }
+  const sensor_msgs::LaserScan &scan = agentState->getCurrentLaserScan();
+  if(scan.ranges.size() != speculativeScan->ranges.size()){
+    return false;
+  }
+  double difference = 0;
+  for(int i = 0; i < scan.ranges.size(); i++){
+    difference += fabs(min(scan.ranges[i], scan.range_max) - min(speculativeScan->ranges[i], speculativeScan->range_max));
+  }
+  if(scan.ranges.size() > 0 and difference / scan.ranges.size() > speculativeTolerance){
+    ROS_DEBUG_STREAM("Speculation recomputed: laser off by " << difference / scan.ranges.size());
+    return false;
+  }
+  const geometry_msgs::PoseArray &crowd = agentState->getCrowdPose();
+  if(crowd.poses.size() != speculativeCrowd->poses.size()){
+    return false;
+  }
+  for(int i = 0; i < crowd.poses.size(); i++){
+    double dx = crowd.poses[i].position.x - speculativeCrowd->poses[i].position.x;
+    double dy = crowd.poses[i].position.y - speculativeCrowd->poses[i].position.y;
+    if(sqrt(dx * dx + dy * dy) > speculativeTolerance){
+      ROS_DEBUG("Speculation recomputed: crowd moved");
+      return false;
+    }
+  }
+  ROS_DEBUG("Speculation committed");
+  return true;
+}
+
+
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // Update spatial model after every task 
 //
@@ -1191,17 +1513,20 @@ void Controller::learnSpatialModel(AgentState* agentState, bool taskStatus, bool
   all_laser_trace.push_back(laser_trace);
 
   if(trailsOn and !earlyLearning){
+    ScopedTimer learnTimer("learn/trails");
     beliefs->getSpatialModel()->getTrails()->updateTrails(agentState);
     beliefs->getSpatialModel()->getTrails()->resetChosenTrail();
     ROS_DEBUG("Trails Learned");
   }
   vector< vector<CartesianPoint> > trails_trace = beliefs->getSpatialModel()->getTrails()->getTrailsPoints();
   if(conveyorsOn and taskStatus){
+    ScopedTimer learnTimer("learn/conveyors");
     //beliefs->getSpatialModel()->getConveyors()->populateGridFromPositionHistory(pos_hist);
     beliefs->getSpatialModel()->getConveyors()->populateGridFromTrailTrace(trails_trace.back());
     ROS_DEBUG("Conveyors Learned");
   }
   if(regionsOn){
+    ScopedTimer learnTimer("learn/regions");
     beliefs->getSpatialModel()->getRegionList()->learnRegionsAndExits(pos_hist, laser_hist, all_trace, all_laser_trace);
     // beliefs->getSpatialModel()->getRegionList()->learnRegions(pos_hist, laser_hist);
     ROS_DEBUG("Regions Learned");
@@ -1212,11 +1537,13 @@ void Controller::learnSpatialModel(AgentState* agentState, bool taskStatus, bool
   }
   vector<FORRRegion> regions = beliefs->getSpatialModel()->getRegionList()->getRegions();
   if(doorsOn){
+    ScopedTimer learnTimer("learn/doors");
     beliefs->getSpatialModel()->getDoors()->clearAllDoors();
     beliefs->getSpatialModel()->getDoors()->learnDoors(regions);
     ROS_DEBUG("Doors Learned");
   }
   if(hallwaysOn){
+    ScopedTimer learnTimer("learn/hallways");
     //beliefs->getSpatialModel()->getHallways()->clearAllHallways();
     //beliefs->getSpatialModel()->getHallways()->learnHallways(agentState, all_trace, all_laser_hist);
     beliefs->getSpatialModel()->getHallways()->learnHallways(agentState, trace, laser_hist);
@@ -1224,6 +1551,7 @@ void Controller::learnSpatialModel(AgentState* agentState, bool taskStatus, bool
     ROS_DEBUG("Hallways Learned");
   }
   if(barrsOn){
+    ScopedTimer learnTimer("learn/barriers");
     beliefs->getSpatialModel()->getBarriers()->updateBarriers(laser_hist, all_trace.back());
     ROS_DEBUG("Barriers Learned");
   }
@@ -1231,9 +1559,20 @@ void Controller::learnSpatialModel(AgentState* agentState, bool taskStatus, bool
   end_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
   computationTimeSec = (end_timecv-start_timecv);
   decisionStats->learningComputationTime = computationTimeSec;
+  spatialModelVersion++;
+}
+
+// Writes the snapshot of everything learned this run, once when the run ends
+void Controller::saveSpatialModelSnapshot(){
+  if(spatialModelSnapshotFile == ""){
+    return;
+  }
+  ScopedTimer snapshotTimer("learn/snapshot");
+  beliefs->saveSnapshot(spatialModelSnapshotFile, mapHash);
 }
 
 void Controller::updateSkeletonGraph(AgentState* agentState){
+  ScopedTimer graphTimer("learn/skeleton_graph");
   double computationTimeSec=0.0;
   timeval cv;
   double start_timecv;
@@ -1400,6 +1739,7 @@ void Controller::updateSkeletonGraph(AgentState* agentState){
   end_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
   computationTimeSec = (end_timecv-start_timecv);
   decisionStats->graphingComputationTime = computationTimeSec;
+  spatialModelVersion++;
 }
 
 
@@ -1413,13 +1753,24 @@ FORRAction Controller::FORRDecision()
   ROS_DEBUG("In FORR decision");
   FORRAction *decision = new FORRAction();
   // Basic semaFORR three tier decision making architecture 
-  if(!tierOneDecision(decision)){
+  bool tierOneMade;
+  {
+    ScopedTimer tierOneTimer("tier1");
+    tierOneMade = tierOneDecision(decision);
+  }
+  if(!tierOneMade){
   	ROS_DEBUG("Decision to be made by t3!!");
   	//decision->type = FORWARD;
   	//decision->parameter = 5;
-  	tierThreeDecision(decision);
-  	tierThreeAdvisorInfluence();
-  	decisionStats->decisionTier = 3;
+  	bool tierThreeMade = tierThreeDecision(decision);
+  	if(tierThreeMade or tierThreeCutOff == false){
+  	  tierThreeAdvisorInfluence();
+  	  decisionStats->decisionTier = 3;
+  	}
+  	else{
+  	  tierOneFallback(decision);
+  	  decisionStats->decisionTier = 1.9;
+  	}
   }
   //cout << "decisionTier = " << decisionStats->decisionTier << endl;
   // //ROS_DEBUG("After decision made");
@@ -1551,20 +1902,22 @@ bool Controller::tierOneDecision(FORRAction *decision){
       }
     }
     vector<FORRAction> SVetoedActions;
-    std::stringstream vetoList;
     for(int i = 0; i < AOVetoedActions.size(); i++){
-      vetoList << AOVetoedActions[i].type << " " << AOVetoedActions[i].parameter << " 1a;";
+      decisionStats->vetoedActions.push_back(AOVetoedActions[i]);
+      decisionStats->vetoSources.push_back('a');
     }
     for(int i = 0; i < NOVetoedActions.size(); i++){
-      vetoList << NOVetoedActions[i].type << " " << NOVetoedActions[i].parameter << " 1b;";
+      decisionStats->vetoedActions.push_back(NOVetoedActions[i]);
+      decisionStats->vetoSources.push_back('b');
     }
     for(int i = 0; i < DGBVetoedActions.size(); i++){
-      vetoList << DGBVetoedActions[i].type << " " << DGBVetoedActions[i].parameter << " 1c;";
+      decisionStats->vetoedActions.push_back(DGBVetoedActions[i]);
+      decisionStats->vetoSources.push_back('c');
     }
     for(int i = 0; i < SVetoedActions.size(); i++){
-      vetoList << SVetoedActions[i].type << " " << SVetoedActions[i].parameter << " 1d;";
+      decisionStats->vetoedActions.push_back(SVetoedActions[i]);
+      decisionStats->vetoSources.push_back('d');
     }
-    decisionStats->vetoedActions = vetoList.str();
   }
   // set<FORRAction> *vetoedActions = beliefs->getAgentState()->getVetoedActions();
   // std::stringstream vetoList;
@@ -1588,7 +1941,6 @@ void Controller::tierTwoDecision(Position current, bool selectNextTask){
   ROS_DEBUG_STREAM("Tier 2 Decision");
   vector< list<int> > plans;
   vector<string> plannerNames;
-  typedef vector< list<int> >::iterator vecIT;
   if(selectNextTask == true){
     beliefs->getAgentState()->setCurrentTask(beliefs->getAgentState()->getNextTask());
   }
@@ -1600,54 +1952,106 @@ void Controller::tierTwoDecision(Position current, bool selectNextTask){
   gettimeofday(&cv,NULL);
   start_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
   bool planCreated = false;
-  for (planner2It it = tier2Planners.begin(); it != tier2Planners.end(); it++){
-    PathPlanner *planner = *it;
-    planner->setPosHistory(beliefs->getAgentState()->getAllTrace());
-    vector< vector<CartesianPoint> > trails_trace = beliefs->getSpatialModel()->getTrails()->getTrailsPoints();
-    planner->setSpatialModel(beliefs->getSpatialModel()->getConveyors(),beliefs->getSpatialModel()->getRegionList()->getRegions(),beliefs->getSpatialModel()->getDoors()->getDoors(),trails_trace,beliefs->getSpatialModel()->getHallways()->getHallways());
-    if(highwayFinished >= 1 or frontierFinished >= 1){
-      // cout << "setting values for highways" << endl;
-      planner->setPassageGrid(beliefs->getAgentState()->getPassageGrid(), beliefs->getAgentState()->getPassageGraphNodes(), beliefs->getAgentState()->getPassageGraph(), beliefs->getAgentState()->getAveragePassage());
-      // cout << "set planner values" << endl;
-      beliefs->getAgentState()->getCurrentTask()->setPassageValues(beliefs->getAgentState()->getPassageGrid(), beliefs->getAgentState()->getPassageGraphNodes(), beliefs->getAgentState()->getPassageGraphEdges(), beliefs->getAgentState()->getPassageGraph(), beliefs->getAgentState()->getAveragePassage(), beliefs->getAgentState()->getGraphTrails(), beliefs->getAgentState()->getGraphThroughIntersections(), beliefs->getAgentState()->getGraphIntersectionTrails());
-      // cout << "set task values" << endl;
-    }
-    if(tier1->localExplorationStarted()){
-      planner->setCoverageGrid(tier1->getLocalExploreCoverage());
-    }
-    //ROS_DEBUG_STREAM("Creating plans " << planner->getName());
-    //gettimeofday(&cv,NULL);
-    //start_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
-    vector< list<int> > multPlans = beliefs->getAgentState()->getPlansWaypoints(current,planner,aStarOn);
-    for (int i = 0; i < multPlans.size(); i++){
-      plans.push_back(multPlans[i]);
-      plannerNames.push_back(planner->getName());
-      if(multPlans[i].size() > 0){
-        planCreated = true;
-      }
-    }
-    //gettimeofday(&cv,NULL);
-    //end_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
-    //computationTimeSec = (end_timecv-start_timecv);
-    //ROS_DEBUG_STREAM("Planning time = " << computationTimeSec);
+  // Anytime planning: with a deadline set, the first round uses weighted A* and later rounds lower the weight
+  // towards 1 while time remains. A planner that is not reached in a round keeps its plans from the previous round.
+  double heuristicWeight = 1;
+  if(decisionDeadline > 0){
+    heuristicWeight = anytimeWeight;
   }
-  if(planCreated == true){
-    vector< vector<double> > planCosts;
-    typedef vector< vector<double> >::iterator costIT;
-
+  vector< vector< list<int> > > plannerPlans(tier2Planners.size());
+  int round = 0;
+  int plannersDone = 0;
+  bool planningCutOff = false;
+  while(true){
+    plannersDone = 0;
     for (planner2It it = tier2Planners.begin(); it != tier2Planners.end(); it++){
       PathPlanner *planner = *it;
-      vector<double> planCost;
-      ROS_DEBUG_STREAM("Computing plan cost " << planner->getName());
-      for (vecIT vt = plans.begin(); vt != plans.end(); vt++){
-        double costOfPlan = 0;
-        if(planner->getName() != "skeleton" and planner->getName() != "hallwayskel"){
-          costOfPlan = planner->calcPathCost(*vt);
+      if(decisionDeadlinePassed() and (round > 0 or planCreated)){
+        planningCutOff = true;
+        break;
+      }
+      ScopedTimer plannerTimer("tier2/" + planner->getName());
+      planner->setHeuristicWeight(heuristicWeight);
+      // Spatial model, crowd model and finished tasks (the position history) only ever count up, so
+      // their sum changes whenever one of them does
+      int tasksFinished = beliefs->getAgentState()->getAllAgenda().size() - beliefs->getAgentState()->getAgenda().size();
+      planner->setCostModelVersion(spatialModelVersion + crowdModelVersion + tasksFinished);
+      if(round > 0){
+        plannerPlans[plannersDone] = beliefs->getAgentState()->getPlansWaypoints(current,planner,aStarOn);
+        plannersDone++;
+        continue;
+      }
+      planner->setPosHistory(beliefs->getAgentState()->getAllTrace());
+      vector< vector<CartesianPoint> > trails_trace = beliefs->getSpatialModel()->getTrails()->getTrailsPoints();
+      planner->setSpatialModel(beliefs->getSpatialModel()->getConveyors(),beliefs->getSpatialModel()->getRegionList()->getRegions(),beliefs->getSpatialModel()->getDoors()->getDoors(),trails_trace,beliefs->getSpatialModel()->getHallways()->getHallways());
+      if(highwayFinished >= 1 or frontierFinished >= 1){
+        // cout << "setting values for highways" << endl;
+        planner->setPassageGrid(beliefs->getAgentState()->getPassageGrid(), beliefs->getAgentState()->getPassageGraphNodes(), beliefs->getAgentState()->getPassageGraph(), beliefs->getAgentState()->getAveragePassage());
+        // cout << "set planner values" << endl;
+        beliefs->getAgentState()->getCurrentTask()->setPassageValues(beliefs->getAgentState()->getPassageGrid(), beliefs->getAgentState()->getPassageGraphNodes(), beliefs->getAgentState()->getPassageGraphEdges(), beliefs->getAgentState()->getPassageGraph(), beliefs->getAgentState()->getAveragePassage(), beliefs->getAgentState()->getGraphTrails(), beliefs->getAgentState()->getGraphThroughIntersections(), beliefs->getAgentState()->getGraphIntersectionTrails());
+        // cout << "set task values" << endl;
+      }
+      if(tier1->localExplorationStarted()){
+        planner->setCoverageGrid(tier1->getLocalExploreCoverage());
+      }
+      //ROS_DEBUG_STREAM("Creating plans " << planner->getName());
+      //gettimeofday(&cv,NULL);
+      //start_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
+      plannerPlans[plannersDone] = beliefs->getAgentState()->getPlansWaypoints(current,planner,aStarOn);
+      for (int i = 0; i < plannerPlans[plannersDone].size(); i++){
+        if(plannerPlans[plannersDone][i].size() > 0){
+          planCreated = true;
         }
-        planCost.push_back(costOfPlan);
-        ROS_DEBUG_STREAM("Cost = " << costOfPlan);
       }
-      planCosts.push_back(planCost);
+      plannersDone++;
+      //gettimeofday(&cv,NULL);
+      //end_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
+      //computationTimeSec = (end_timecv-start_timecv);
+      //ROS_DEBUG_STREAM("Planning time = " << computationTimeSec);
+    }
+    if(planningCutOff or heuristicWeight <= 1){
+      break;
+    }
+    if(decisionDeadlinePassed()){
+      planningCutOff = true;
+      break;
+    }
+    heuristicWeight = 1 + (heuristicWeight - 1)/2;
+    if(heuristicWeight < 1.1){
+      heuristicWeight = 1;
+    }
+    round++;
+    ROS_DEBUG_STREAM("Refining plans with heuristic weight " << heuristicWeight);
+  }
+  if(planningCutOff){
+    std::stringstream cutoff;
+    cutoff << "tier2 " << round << " " << heuristicWeight << " " << plannersDone << " " << tier2Planners.size() << ";";
+    decisionStats->cutoffStages = decisionStats->cutoffStages + cutoff.str();
+    ROS_DEBUG_STREAM("Tier 2 cut off by deadline: " << cutoff.str());
+  }
+  for (int p = 0; p < tier2Planners.size(); p++){
+    tier2Planners[p]->setHeuristicWeight(1);
+    decisionStats->plannerNames.push_back(tier2Planners[p]->getName());
+    for (int i = 0; i < plannerPlans[p].size(); i++){
+      plans.push_back(plannerPlans[p][i]);
+      plannerNames.push_back(tier2Planners[p]->getName());
+      decisionStats->planPlanner.push_back(p);
+    }
+  }
+  if(planCreated == true){
+    typedef vector< vector<double> >::iterator costIT;
+
+    // Every plan under every planner's costs, each plan walked once for all of them
+    vector< vector<double> > planCosts;
+    {
+      ScopedTimer costTimer("tier2/plan_costs");
+      planCosts = PathPlanner::calcPathCosts(tier2Planners, plans);
+    }
+    for (int p = 0; p < tier2Planners.size(); p++){
+      ROS_DEBUG_STREAM("Computing plan cost " << tier2Planners[p]->getName());
+      for (int i = 0; i < planCosts[p].size(); i++){
+        ROS_DEBUG_STREAM("Cost = " << planCosts[p][i]);
+      }
     }
 
     typedef vector<double>::iterator doubIT;
@@ -1671,18 +2075,17 @@ void Controller::tierTwoDecision(Position current, bool selectNextTask){
       planCostsNormalized.push_back(planCostNormalized);
     }
     //planCostsNormalized.pop_back();
-    std::stringstream plannerCommentsList;
+    decisionStats->planCostColumns = planCostsNormalized.size() + 1;
     vector<double> totalCosts;
     for (int i = 0; i < plans.size(); i++){
       double cost=0;
       // ROS_DEBUG_STREAM("Computing total cost = " << cost);
-      plannerCommentsList << plannerNames[i] << " ";
       for (costIT it = planCostsNormalized.begin(); it != planCostsNormalized.end(); it++){
         cost += it->at(i);
-        plannerCommentsList << it->at(i) << " ";
+        decisionStats->planCosts.push_back(it->at(i));
         // ROS_DEBUG_STREAM("cost = " << cost);
       }
-      plannerCommentsList << cost << ";";
+      decisionStats->planCosts.push_back(cost);
       ROS_DEBUG_STREAM("Final cost = " << cost);
       totalCosts.push_back(cost);
     }
@@ -1743,7 +2146,6 @@ void Controller::tierTwoDecision(Position current, bool selectNextTask){
         break;
       }
     }
-    decisionStats->plannerComments = plannerCommentsList.str();
   }
   for (planner2It it = tier2Planners.begin(); it != tier2Planners.end(); it++){
     PathPlanner *planner = *it;
@@ -1758,11 +2160,16 @@ void Controller::tierTwoDecision(Position current, bool selectNextTask){
 
 
 
+// Higher weighted tier 3 advisors are consulted first when a decision deadline is set
+static bool compareAdvisorPriority(Tier3Advisor *first, Tier3Advisor *second){
+  return first->get_weight() > second->get_weight();
+}
+
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // Generate tier 3 decision
 //
 //
-void Controller::tierThreeDecision(FORRAction *decision){
+bool Controller::tierThreeDecision(FORRAction *decision){
   std::map<FORRAction, double> comments;
   // This map will aggregate value of all advisers
   std::map<FORRAction, double> allComments;
@@ -1782,29 +2189,76 @@ void Controller::tierThreeDecision(FORRAction *decision){
     if(advisor->get_name() == "BaseLine")         linearBaseline   = advisor->get_weight();
   }
        
-  std::stringstream advisorsList;
-  std::stringstream advisorCommentsList;
+  // With a decision deadline the advisors are consulted by descending weight, so the ones that matter most
+  // are heard before the deadline cuts the rest off
+  std::vector<Tier3Advisor*> consulted = tier3Advisors;
+  if(decisionDeadline > 0){
+    std::stable_sort(consulted.begin(), consulted.end(), compareAdvisorPriority);
+  }
+  int advisorsConsulted = 0;
+  bool advisorsCutOff = false;
+  static Counter *advisorsEvaluated = Instrumentation::instance().counter("tier3_advisors_evaluated");
+  static Counter *speculationsChecked = Instrumentation::instance().counter("speculation_advisors_checked");
+  static Counter *speculationMismatches = Instrumentation::instance().counter("speculation_advisor_mismatches");
   // cout << "processing advisors::"<< endl;
-  for (advisor3It it = tier3Advisors.begin(); it != tier3Advisors.end(); ++it){
+  for (advisor3It it = consulted.begin(); it != consulted.end(); ++it){
     Tier3Advisor *advisor = *it; 
     // cout << advisor->get_name() << endl;
-    // check if advisor should make a decision
-    advisor->set_commenting();
+    int advisorIndex = decisionStats->advisorNames.size();
+    decisionStats->advisorNames.push_back(advisor->get_name());
+    decisionStats->advisorWeights.push_back(advisor->get_weight());
+    decisionStats->advisorActive.push_back(advisor->is_active());
+    if(advisorsCutOff or decisionDeadlinePassed()){
+      advisorsCutOff = true;
+      decisionStats->advisorCommenting.push_back(false);
+      continue;
+    }
+    advisorsConsulted++;
+    // check if advisor should make a decision, a committed speculation already knows
+    bool commenting;
+    if(speculationCommitted){
+      commenting = speculativeCommenting[advisor];
+    }
+    else{
+      advisor->set_commenting();
+      commenting = advisor->is_commenting();
+    }
+    decisionStats->advisorCommenting.push_back(commenting);
+    // Check mode: the advice committed from the speculation has to be what the real sensing gives
+    bool checkSpeculation = (speculationCommitted and speculativeCheck and advisor->is_active());
+    if(checkSpeculation){
+      speculationsChecked->add(1);
+      advisor->set_commenting();
+      if(advisor->is_commenting() != commenting){
+        speculationMismatches->add(1);
+        ROS_WARN_STREAM("Speculative commenting of " << advisor->get_name() << " differs from the real sensing");
+        checkSpeculation = false;
+      }
+    }
     if(advisor->is_active() == false){
       //cout << advisor->get_name() << " is inactive " << endl;
-      advisorsList << advisor->get_name() << " " << advisor->get_weight() << " " << advisor->is_active() << " " << advisor->is_commenting() << ";";
       continue;
     }
-    if(advisor->is_commenting() == false){
+    if(commenting == false){
       //cout << advisor->get_name() << " is not commenting " << endl;
-      advisorsList << advisor->get_name() << " " << advisor->get_weight() << " " << advisor->is_active() << " " << advisor->is_commenting() << ";";
       continue;
     }
 
-    advisorsList << advisor->get_name() << " " << advisor->get_weight() << " " << advisor->is_active() << " " << advisor->is_commenting() << ";";
-
     // cout << "Before commenting " << endl;
-    comments = advisor->allAdvice();
+    {
+      ScopedTimer advisorTimer("tier3/" + advisor->get_name());
+      if(speculationCommitted){
+        comments = advisor->adviceFromRaw(speculativeAdvice[advisor]);
+      }
+      else{
+        comments = advisor->allAdvice();
+      }
+    }
+    if(checkSpeculation and advisor->allAdvice() != comments){
+      speculationMismatches->add(1);
+      ROS_WARN_STREAM("Speculative comments of " << advisor->get_name() << " differ from the ones on the real sensing");
+    }
+    advisorsEvaluated->add(1);
     // cout << "after commenting " << endl;
     // aggregate all comments
 
@@ -1820,7 +2274,9 @@ void Controller::tierThreeDecision(FORRAction *decision){
       //   weight = beliefs->getAgentState()->getAgenda().size()/5;
       // }
 
-      advisorCommentsList << advisor->get_name() << " " << iterator->first.type << " " << iterator->first.parameter << " " << iterator->second << ";";
+      decisionStats->commentAdvisor.push_back(advisorIndex);
+      decisionStats->commentActions.push_back(iterator->first);
+      decisionStats->commentStrengths.push_back(iterator->second);
 
       if( allComments.find(iterator->first) == allComments.end()){
 	    allComments[iterator->first] =  iterator->second * weight;
@@ -1849,9 +2305,17 @@ void Controller::tierThreeDecision(FORRAction *decision){
       best_decisions.push_back(iterator->first);
   }
   
+  tierThreeCutOff = advisorsCutOff;
+  if(advisorsCutOff){
+    std::stringstream cutoff;
+    cutoff << "tier3 " << advisorsConsulted << " " << consulted.size() << ";";
+    decisionStats->cutoffStages = decisionStats->cutoffStages + cutoff.str();
+    ROS_DEBUG_STREAM("Tier 3 cut off by deadline: " << cutoff.str());
+  }
   // cout << "There are " << best_decisions.size() << " decisions that got the highest grade " << endl;
   if(best_decisions.size() == 0){
       (*decision) = FORRAction(PAUSE,0);
+      return false;
   }
   //for(unsigned i = 0; i < best_decisions.size(); ++i)
       //cout << "Action type: " << best_decisions.at(i).type << " parameter: " << best_decisions.at(i).parameter << endl;
@@ -1861,9 +2325,49 @@ void Controller::tierThreeDecision(FORRAction *decision){
   int random_number = rand() % (best_decisions.size());
     
   (*decision) = best_decisions.at(random_number);
-  decisionStats->advisors = advisorsList.str();
-  decisionStats->advisorComments = advisorCommentsList.str();
-  //cout << " advisors = " << decisionStats->advisors << "\nadvisorComments = " << decisionStats->advisorComments << endl;
+  return true;
+}
+
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Tier 1 fallback when the deadline cut tier 3 off with no advice, head for the current waypoint
+// (the task's getX/getY, which is the target itself when no plan is active) unless vetoed
+//
+//
+void Controller::tierOneFallback(FORRAction *decision){
+  (*decision) = FORRAction(PAUSE,0);
+  if(beliefs->getAgentState()->getCurrentTask() == NULL){
+    return;
+  }
+  CartesianPoint waypoint(beliefs->getAgentState()->getCurrentTask()->getX(),beliefs->getAgentState()->getCurrentTask()->getY());
+  FORRAction towards = beliefs->getAgentState()->moveTowards(waypoint);
+  set<FORRAction> *vetoed_actions = beliefs->getAgentState()->getVetoedActions();
+  if(towards.parameter != 0 and vetoed_actions->find(towards) == vetoed_actions->end()){
+    if(towards.type == RIGHT_TURN or towards.type == LEFT_TURN or beliefs->getAgentState()->maxForwardAction().parameter >= towards.parameter){
+      (*decision) = towards;
+    }
+  }
+  ROS_INFO_STREAM("Tier 1 fallback has made a decision " << decision->type << " " << decision->parameter);
+}
+
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Decision deadline helpers
+//
+//
+double Controller::getCurrentTimeSec(){
+  timeval cv;
+  gettimeofday(&cv,NULL);
+  return cv.tv_sec + (cv.tv_usec/1000000.0);
+}
+
+bool Controller::decisionDeadlinePassed(){
+  if(decisionDeadline <= 0){
+    return false;
+  }
+  return (getCurrentTimeSec() - decisionStartTime) >= decisionDeadline;
 }
 
 
@@ -464,7 +464,6 @@ bool do_intersect(Vector vector1, Vector vector2, CartesianPoint& intersection){
 bool canAccessPoint(std::vector<CartesianPoint> givenLaserEndpoints, CartesianPoint laserPos, CartesianPoint point, double distanceLimit){
   // cout << "AgentState:canAccessPoint() , robot pos " << laserPos.get_x() << "," << laserPos.get_y() << " target " << point.get_x() << "," << point.get_y() << endl; 
   // cout << "Number of laser endpoints " << givenLaserEndpoints.size() << endl; 
-  bool canAccessPoint = false;
   double distLaserPosToPoint = laserPos.get_distance(point);
   if(distLaserPosToPoint > distanceLimit){
     // cout << "Cannot access, too far away" << endl;
@@ -489,6 +488,17 @@ bool canAccessPoint(std::vector<CartesianPoint> givenLaserEndpoints, CartesianPo
       index = i;
     }
   }
+  return canAccessPoint(givenLaserEndpoints, laserPos, point, distanceLimit, index);
+}
+
+//same test when the beam pointing closest to point is already known, e.g. from the beam angles of the scan
+bool canAccessPoint(const std::vector<CartesianPoint> &givenLaserEndpoints, CartesianPoint laserPos, CartesianPoint point, double distanceLimit, int nearest_beam){
+  bool canAccessPoint = false;
+  double distLaserPosToPoint = laserPos.get_distance(point);
+  if(distLaserPosToPoint > distanceLimit){
+    return false;
+  }
+  int index = nearest_beam;
   while (index-2 < 0){
     index = index + 1;
   }
@@ -498,7 +508,7 @@ bool canAccessPoint(std::vector<CartesianPoint> givenLaserEndpoints, CartesianPo
   // cout << "Min angle : " << min_angle << ", " << index << endl;
   int numFree = 0;
   for(int i = -2; i < 3; i++) {
-    double distLaserEndPointToLaserPos = givenLaserEndpoints[index+i].get_distance(laserPos);
+    double distLaserEndPointToLaserPos = distance(givenLaserEndpoints[index+i], laserPos);
     // cout << "Distance Laser EndPoint to Laser Pos : " << distLaserEndPointToLaserPos << ", Distance Laser Pos to Point : " << distLaserPosToPoint << endl;
     if (distLaserEndPointToLaserPos > distLaserPosToPoint) {
       numFree++;
@@ -518,8 +528,8 @@ bool canAccessPoint(std::vector<CartesianPoint> givenLaserEndpoints, CartesianPo
   double ab = laserPos.get_distance(point);
   for(int i = -2; i < 3; i++) {
     //cout << "Laser endpoint : " << givenLaserEndpoints[i].get_x() << "," << givenLaserEndpoints[i].get_y() << endl;
-    double ac = laserPos.get_distance(givenLaserEndpoints[index+i]);
-    double bc = givenLaserEndpoints[index+i].get_distance(point);
+    double ac = distance(laserPos, givenLaserEndpoints[index+i]);
+    double bc = distance(givenLaserEndpoints[index+i], point);
     if(((ab + bc) - ac) < epsilon){
       // cout << "Distance vector endpoint visible: ("<<givenLaserEndpoints[index+i].get_x()<<","<< givenLaserEndpoints[index+i].get_y()<<")"<<endl; 
       // cout << "Distance: "<<distance_to_point<<endl;
@@ -530,8 +540,8 @@ bool canAccessPoint(std::vector<CartesianPoint> givenLaserEndpoints, CartesianPo
   if(canSeePoint == false){
     for(int i = 0; i < givenLaserEndpoints.size(); i++){
       //cout << "Laser endpoint : " << givenLaserEndpoints[i].get_x() << "," << givenLaserEndpoints[i].get_y() << endl;
-      double ac = laserPos.get_distance(givenLaserEndpoints[i]);
-      double bc = givenLaserEndpoints[i].get_distance(point);
+      double ac = distance(laserPos, givenLaserEndpoints[i]);
+      double bc = distance(givenLaserEndpoints[i], point);
       if(((ab + bc) - ac) < epsilon){
         // cout << "Distance vector endpoint visible: ("<<givenLaserEndpoints[i].get_x()<<","<< givenLaserEndpoints[i].get_y()<<")"<<endl; 
         // cout << "Distance: "<<distance_to_point<<endl;
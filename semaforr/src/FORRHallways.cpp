@@ -1,4 +1,5 @@
 #include<FORRHallways.h>
+#include "ConnectedComponents.h"
 
 using namespace std;
 
@@ -606,73 +607,13 @@ void FORRHallways::BinarizeImage(vector<vector<int> > &binarized, const vector<v
 }
 
 
-void FORRHallways::doUnion(int x, int y, int x2, int y2, vector<vector<int> > &labeled_image){
-  int a = map_width_*y+x;
-  int ya = y;
-  int xa = x;
-  //cout << "a " << a << " " << xa << " " << ya << endl;
-  while (labeled_image[xa][ya] != a){
-    a = labeled_image[xa][ya];
-    ya = floor(a/map_width_);
-    xa = a - map_width_*ya;
-    //cout << a << " " << xa << " " << ya << endl;
-  }
-  int b = map_width_*y2+x2;
-  int yb = y2;
-  int xb = x2;
-  //cout << "b " << b << " " << xb << " " << yb << endl;
-  while (labeled_image[xb][yb] != b){
-    b = labeled_image[xb][yb];
-    yb = floor(b/map_width_);
-    xb = b - map_width_*yb;
-    //cout << b << " " << xb << " " << yb << endl;
-  }
-  labeled_image[xb][yb] = a;
-}
- 
-void FORRHallways::unionCoords(int x, int y, int x2, int y2, const vector<vector<int> > &binary_map, vector<vector<int> > &labeled_image){
-  if (y2 < map_height_ && x2 < map_width_ && binary_map[x][y] && binary_map[x2][y2]){
-    //cout << y2 << " " << x2 << " " << binary_map[x][y] << " " << binary_map[x2][y2] << endl;
-    doUnion(x, y, x2, y2, labeled_image);
-  }
-}
-
+// Cells join their right, lower and lower right neighbors, background cells are labeled -1
 void FORRHallways::LabelImage(const vector<vector<int> > &binary_map, vector<vector<int> > &labeled_image){
-  //cout << "map_width_ " << map_width_ << " map_height_ " << map_height_ << endl;
-  for (int x = 0; x < map_width_; x++){
-    for (int y = 0; y < map_height_; y++){
-      labeled_image[x][y] = map_width_*y+x;
-      //cout << x << " " << y << " " << map_width_*y+x << endl;
-    }
-  }
-
-  for (int x = 0; x < map_width_; x++){
-    for (int y = 0; y < map_height_; y++){
-      unionCoords(x, y, x+1, y, binary_map, labeled_image);
-      unionCoords(x, y, x, y+1, binary_map, labeled_image);
-      unionCoords(x, y, x+1, y+1, binary_map, labeled_image);
-    }
-  }
-  for (int x = 0; x < map_width_; x++){
-    for (int y = 0; y < map_height_; y++){
-      if (binary_map[x][y] == 0){
-        //cout << ' ';
-        labeled_image[x][y] = -1;
-        continue;
-      }
-      int c = map_width_*y+x;
-      int xnew = x;
-      int ynew = y;
-      while (labeled_image[xnew][ynew] != c){
-        c = labeled_image[xnew][ynew];
-        ynew = floor(c/map_width_);
-        xnew = c - map_width_*ynew;
-      }
-      //cout << c << " ";
-      labeled_image[x][y] = c;
-    }
-    //cout << "\n";
-  }
+  vector< pair<int, int> > offsets;
+  offsets.push_back(make_pair(1, 0));
+  offsets.push_back(make_pair(0, 1));
+  offsets.push_back(make_pair(1, 1));
+  ConnectedComponents::labelGrid(binary_map, 1, offsets, labeled_image, -1);
 }
 
 void FORRHallways::ListGroups(vector<vector< pair<int,int> > > &aggregates_and_points, const vector<vector<int> > &labeled_image){
@@ -22,6 +22,7 @@ Graph::Graph(Map * m, int p): map(m) {
   }
   cout << "Node index columns : " << nodeIndex.size() << endl;
   maxInd = -1;
+  revision = 0;
   generateNavGraph();
 }
 
@@ -46,6 +47,7 @@ Graph::Graph(int p, int l, int h){
   }
   cout << "Node index columns : " << nodeIndex.size() << endl;
   maxInd = -1;
+  revision = 0;
 }
 
 void Graph::resetGraph(){
@@ -56,6 +58,7 @@ void Graph::resetGraph(){
       nodeIndex[x][y] = -1;
     }
   }
+  revision++;
   cout << "Graph reset complete" << endl;
 }
 
@@ -86,10 +89,13 @@ Node* Graph::getNodePtr(int n){
  */
 Edge* Graph::getEdge(int n1, int n2) {
   vector<Edge*>::iterator eiter;
-  Node nd1 = getNode(n1);
-  Node nd2 = getNode(n2);
-  if (! (nd1.getID() == Node::invalid_node_index || nd2.getID() == Node::invalid_node_index )){
-    for( eiter = edges.begin(); eiter != edges.end(); eiter++ ){
+  Node *nd1 = getNodePtr(n1);
+  Node *nd2 = getNodePtr(n2);
+  if (! (nd1->getID() == Node::invalid_node_index || nd2->getID() == Node::invalid_node_index )){
+    // every edge is in the edge lists of both its nodes, in the same order as in edges, so the
+    // first match among the edges of n1 is the first match in edges
+    vector<Edge*> &nodeEdges = nd1->getNodeEdges();
+    for( eiter = nodeEdges.begin(); eiter != nodeEdges.end(); eiter++ ){
       if ( n1 == (*eiter)->getFrom() && n2 == (*eiter)->getTo() ) 
         return (*eiter); 
       if ( n1 == (*eiter)->getTo() && n2 == (*eiter)->getFrom() ) 
@@ -253,6 +259,7 @@ bool Graph::addNode(int x, int y, double r, int ind){
     if(ind > maxInd){
       maxInd = ind;
     }
+    revision++;
   }
   // else{
   //   cout << "Node already exists, try nearby" << endl;
@@ -320,6 +327,7 @@ bool Graph::addNode(int x, int y, double r, int ind){
 }
 
 void Graph::addEdge(int ind1, int ind2, double distance, vector<CartesianPoint> path){
+  revision++;
   Edge * e = new Edge(ind1, ind2);
   //cout << "for each edge "<< endl;
   if(isEdge((*e))){
@@ -472,6 +480,7 @@ void Graph::clearGraph() {
   for(itr = nodes.begin(); itr != nodes.end(); itr++) {
     (*itr)->setAccessible(true);
   }
+  revision++;
 }
 
 vector<int> Graph::getNeighbors(Node n){
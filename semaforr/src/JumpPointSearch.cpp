@@ -0,0 +1,308 @@
+#include "JumpPointSearch.h"
+#include "Instrumentation.h"
+#include <limits>
+
+const int JumpPointSearch::dirX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+const int JumpPointSearch::dirY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+bool JumpPointSearch::usable(Graph *g)
+{
+  if(g != graph or g->getRevision() != revision)
+  {
+    graph = g;
+    revision = g->getRevision();
+    build();
+  }
+  return lattice;
+}
+
+bool JumpPointSearch::edgeCost(Node *node, int nid, double &cost)
+{
+  bool found = false;
+  vector<Edge*> &edges = node->getNodeEdges();
+  for(int i = 0; i < edges.size(); i++)
+  {
+    if(edges[i]->getTo() == node->getID() && edges[i]->getFrom() == nid)
+    {
+      cost = edges[i]->getCost(false);
+      found = true;
+    }
+    else if(edges[i]->getFrom() == node->getID() && edges[i]->getTo() == nid)
+    {
+      cost = edges[i]->getCost(true);
+      found = true;
+    }
+  }
+  return found;
+}
+
+int JumpPointSearch::neighborCell(int cell, int dir)
+{
+  int x = cell / rows + dirX[dir];
+  int y = cell % rows + dirY[dir];
+  if(x < 0 or y < 0 or x >= columns or y >= rows)
+    return -1;
+  return x * rows + y;
+}
+
+// A node is open when it has exactly its eight lattice neighbors, all accessible and joined to it
+// at pure distance cost
+bool JumpPointSearch::isOpen(int id)
+{
+  Node *node = graph->getNodePtr(id);
+  if(!node->isAccessible() or node->numNeighbors() != 8)
+    return false;
+  vector<int> neighbors = node->getNeighbors();
+  for(int dir = 0; dir < 8; dir++)
+  {
+    int cell = neighborCell(nodeCell[id], dir);
+    if(cell < 0 or cellNode[cell] < 0)
+      return false;
+    int nid = cellNode[cell];
+    Node *neighbor = graph->getNodePtr(nid);
+    double cost;
+    if(!neighbor->isAccessible() or find(neighbors.begin(), neighbors.end(), nid) == neighbors.end() or !edgeCost(node, nid, cost))
+      return false;
+    if(cost != Map::distance(node->getX(), node->getY(), neighbor->getX(), neighbor->getY()))
+      return false;
+  }
+  return true;
+}
+
+void JumpPointSearch::build()
+{
+  static Counter *rebuilds = Instrumentation::instance().counter("jps_table_rebuilds");
+  rebuilds->add(1);
+  lattice = false;
+  spacing = graph->getProximity();
+  int count = graph->numNodes();
+  if(spacing <= 0 or count == 0)
+    return;
+  int maxX = 0, maxY = 0;
+  for(int i = 0; i < count; i++)
+  {
+    Node *node = graph->getNodePtr(i);
+    if(node->getID() != i or node->getX() < 0 or node->getY() < 0 or node->getX() % spacing != 0 or node->getY() % spacing != 0)
+      return;
+    maxX = max(maxX, node->getX());
+    maxY = max(maxY, node->getY());
+  }
+  columns = maxX / spacing + 1;
+  rows = maxY / spacing + 1;
+  cellNode.assign(columns * rows, -1);
+  nodeCell.assign(count, -1);
+  for(int i = 0; i < count; i++)
+  {
+    Node *node = graph->getNodePtr(i);
+    int cell = (node->getX() / spacing) * rows + node->getY() / spacing;
+    if(cellNode[cell] >= 0)
+      return;
+    cellNode[cell] = i;
+    nodeCell[i] = cell;
+  }
+  octile = true;
+  for(int i = 0; i < count and octile; i++)
+  {
+    vector<int> neighbors = graph->getNodePtr(i)->getNeighbors();
+    for(int j = 0; j < neighbors.size(); j++)
+    {
+      int dx = abs(nodeCell[neighbors[j]] / rows - nodeCell[i] / rows);
+      int dy = abs(nodeCell[neighbors[j]] % rows - nodeCell[i] % rows);
+      if(dx > 1 or dy > 1)
+        octile = false;
+    }
+  }
+
+  BitGrid openGrid(columns, rows);
+  for(int i = 0; i < count; i++)
+  {
+    if(isOpen(i))
+      openGrid.set(nodeCell[i] / rows, nodeCell[i] % rows);
+  }
+  // Interior nodes are open with every neighbor open, so their whole 3x3 block is plain lattice
+  interior.assign(columns, rows);
+  for(int x = 0; x < columns; x++)
+  {
+    for(int y = 0; y < rows; y++)
+    {
+      if(openGrid.count(x - 1, y - 1, x + 1, y + 1) == 9)
+        interior.set(x, y);
+    }
+  }
+  // Each straight direction is filled from the far end of every line backwards
+  for(int dir = 0; dir < 4; dir++)
+  {
+    runLength[dir].assign(count, 0);
+    for(int i = 0; i < columns; i++)
+    {
+      int x = (dirX[dir] > 0 ? columns - 1 - i : i);
+      for(int j = 0; j < rows; j++)
+      {
+        int y = (dirY[dir] > 0 ? rows - 1 - j : j);
+        int id = cellNode[x * rows + y];
+        if(id < 0 or !interior.get(x, y))
+          continue;
+        int next = cellNode[neighborCell(x * rows + y, dir)];
+        int nx = x + dirX[dir], ny = y + dirY[dir];
+        runLength[dir][id] = (interior.get(nx, ny) ? runLength[dir][next] + 1 : 1);
+      }
+    }
+  }
+  stamp.assign(count, 0);
+  gValue.assign(count, 0);
+  parent.assign(count, -1);
+  closed.assign(count, 0);
+  searchStamp = 0;
+  lattice = true;
+}
+
+int JumpPointSearch::jumpStraight(int id, int dir, int target, int &steps)
+{
+  int cell = nodeCell[id];
+  steps = runLength[dir][id];
+  int tcell = nodeCell[target];
+  int dx = tcell / rows - cell / rows;
+  int dy = tcell % rows - cell % rows;
+  int along = dx * dirX[dir] + dy * dirY[dir];
+  // The target is on the line when it is straight ahead and no further than where the line ends
+  if(dx * dirY[dir] - dy * dirX[dir] == 0 and along > 0 and along <= steps)
+  {
+    steps = along;
+    return target;
+  }
+  return cellNode[(cell / rows + steps * dirX[dir]) * rows + cell % rows + steps * dirY[dir]];
+}
+
+double JumpPointSearch::heuristic(int id, int target)
+{
+  Node *a = graph->getNodePtr(id);
+  Node *b = graph->getNodePtr(target);
+  double dx = abs(a->getX() - b->getX());
+  double dy = abs(a->getY() - b->getY());
+  if(!octile)
+    return sqrt(dx * dx + dy * dy);
+  return max(dx, dy) + (sqrt(2.0) - 1) * min(dx, dy);
+}
+
+void JumpPointSearch::push(int id, int from, int dir, double g, int target, double weight)
+{
+  if(stamp[id] != searchStamp)
+  {
+    stamp[id] = searchStamp;
+    gValue[id] = numeric_limits<double>::infinity();
+    parent[id] = -1;
+    closed[id] = 0;
+  }
+  if(closed[id] or g >= gValue[id])
+    return;
+  gValue[id] = g;
+  parent[id] = from;
+  Entry entry;
+  entry.g = g;
+  entry.f = g + weight * heuristic(id, target);
+  entry.id = id;
+  entry.dir = dir;
+  open.push(entry);
+}
+
+bool JumpPointSearch::search(Graph *g, int source, int target, double weight)
+{
+  path.clear();
+  expanded = 0;
+  if(!usable(g) or source < 0 or target < 0 or source >= graph->numNodes() or target >= graph->numNodes())
+    return false;
+  if(weight < 1)
+    weight = 1;
+  static Counter *nodesExpanded = Instrumentation::instance().counter("jps_nodes_expanded");
+  searchStamp++;
+  open = priority_queue<Entry>();
+  push(source, -1, -1, 0, target, weight);
+  while(!open.empty())
+  {
+    Entry current = open.top(); open.pop();
+    int id = current.id;
+    if(closed[id] or current.g > gValue[id])
+      continue;
+    closed[id] = 1;
+    expanded++;
+    if(id == target)
+    {
+      nodesExpanded->add(expanded);
+      constructPath(source, target);
+      return true;
+    }
+    int cell = nodeCell[id];
+    int dir = current.dir;
+    if(dir >= 0 and interior.get(cell / rows, cell % rows))
+    {
+      // Only the natural successors, every other neighbor is reached as cheaply without this node
+      if(dir < 4)
+      {
+        int steps;
+        int next = jumpStraight(id, dir, target, steps);
+        push(next, id, dir, current.g + steps * spacing, target, weight);
+      }
+      else
+      {
+        int straight[2] = {(dirX[dir] > 0 ? 0 : 1), (dirY[dir] > 0 ? 2 : 3)};
+        for(int i = 0; i < 2; i++)
+        {
+          int steps;
+          int next = jumpStraight(id, straight[i], target, steps);
+          push(next, id, straight[i], current.g + steps * spacing, target, weight);
+        }
+        // A diagonal jump would stop at once, the straight lines from the next node always end
+        // at a node that is not interior
+        int next = cellNode[neighborCell(cell, dir)];
+        Node *from = graph->getNodePtr(id);
+        Node *to = graph->getNodePtr(next);
+        push(next, id, dir, current.g + Map::distance(from->getX(), from->getY(), to->getX(), to->getY()), target, weight);
+      }
+      continue;
+    }
+    // Anywhere else every neighbor is a successor, as in astar
+    Node *node = graph->getNodePtr(id);
+    vector<int> neighbors = node->getNeighbors();
+    for(int i = 0; i < neighbors.size(); i++)
+    {
+      int nid = neighbors[i];
+      double cost;
+      if(!graph->getNodePtr(nid)->isAccessible() or !edgeCost(node, nid, cost))
+        continue;
+      int ndir = -1;
+      for(int d = 0; d < 8; d++)
+      {
+        if(neighborCell(cell, d) == nodeCell[nid])
+          ndir = d;
+      }
+      push(nid, id, ndir, current.g + cost, target, weight);
+    }
+  }
+  nodesExpanded->add(expanded);
+  return false;
+}
+
+// Parents are jump points, the lattice nodes between each one and the next are filled back in
+void JumpPointSearch::constructPath(int source, int target)
+{
+  path.clear();
+  int id = target;
+  path.push_front(id);
+  while(id != source and parent[id] >= 0)
+  {
+    int from = parent[id];
+    int dx = nodeCell[from] / rows - nodeCell[id] / rows;
+    int dy = nodeCell[from] % rows - nodeCell[id] % rows;
+    int steps = max(abs(dx), abs(dy));
+    if(steps > 1 and (dx == 0 or dy == 0 or abs(dx) == abs(dy)))
+    {
+      int sx = (dx > 0) - (dx < 0), sy = (dy > 0) - (dy < 0);
+      for(int k = 1; k < steps; k++)
+      {
+        path.push_front(cellNode[nodeCell[id] + k * (sx * rows + sy)]);
+      }
+    }
+    path.push_front(from);
+    id = from;
+  }
+}
@@ -34,6 +34,7 @@ void Map::addWall(double x1, double y1, double x2, double y2){
   wall.y1 = y1;
   wall.y2 = y2;
   walls.push_back(wall);
+  wallSegments.add(CartesianPoint(x1, y1), CartesianPoint(x2, y2));
   double distance = Map::distance(x1,y1,x2,y2);
   double stepSize = 2; //cms
   cout << "Wall : " << x1 << " " << y1 << " " << x2 << " " << y2 << " " << endl;
@@ -221,12 +222,5 @@ double Map::distanceFromSegment(double x1, double y1, double x2, double y2, doub
 
 double Map::getDistanceClosestWall(double x, double y)
 {
-  double minDistance = 1000000.0;
-  for(int i = 0; i < walls.size(); i++){
-    double wallDist = distanceFromWall(x, y, i);
-    if(wallDist < minDistance){
-      minDistance = wallDist;
-    }
-  }
-  return minDistance;
+  return min(1000000.0, wallSegments.min_distance(CartesianPoint(x, y)));
 }
@@ -5,6 +5,7 @@
  */
 
 #include "PathPlanner.h"
+#include "Instrumentation.h"
 #include <limits.h>
 #include <algorithm>
 
@@ -106,19 +107,36 @@ int PathPlanner::calcPath(bool cautious){
       return 4;
     //cout << signature << "Updating nav graph" << endl;
     // update the nav graph with the latest crowd model to change the edge weights
-    if (name != "distance" and name != "skeleton" and name != "hallwayskel") {
-      cout << "Updating nav graph for non-distance planners" << endl;
-      updateNavGraph();
-      cout << "Finished nav graph update" << endl;
+    bool cached = findCachedPlan(s.getID(), t.getID());
+    bool found = cached;
+    if (cached) {
+      cout << "Reusing cached plan" << endl;
     }
-    astar newsearch(*navGraph, s, t, name);
-    cout << "Finished search" << endl;
-    // cout << "finished search" << endl;
-    if ( newsearch.isPathFound() ) {
+    else if (usesJumpPointSearch()) {
+      found = jumpSearch.search(navGraph, s.getID(), t.getID(), heuristicWeight);
+      path = jumpSearch.getPathToTarget();
+      paths = jumpSearch.getPathsToTarget();
+    }
+    else {
+      if (recostsGraph() and !graphCostsCurrent()) {
+        cout << "Updating nav graph for non-distance planners" << endl;
+        updateNavGraph();
+        recostedRevision = navGraph->getRevision();
+        recostedVersion = costModelVersion;
+        cout << "Finished nav graph update" << endl;
+      }
+      astar newsearch(*navGraph, s, t, name, heuristicWeight);
+      found = newsearch.isPathFound();
       path = newsearch.getPathToTarget();
       // cout << "got path" << endl;
       paths = newsearch.getPathsToTarget();
       // cout << "got paths" << endl;
+    }
+    cout << "Finished search" << endl;
+    // cout << "finished search" << endl;
+    if ( found and !cached )
+      cachePlan(s.getID(), t.getID());
+    if ( found ) {
       objectiveSet = false;
       pathCompleted = false;
 
@@ -344,9 +362,87 @@ int PathPlanner::calcOrigPath(bool cautious){
   return 0;
 }
 
+// A plan from an earlier search is reused when it was found with the same heuristic weight on the
+// graph as it is now and, for planners that recost the graph, with the same cost model. Besides the
+// same source, an optimal plan to the same target that passes through the source is reused from the
+// source on, so a robot following its plan still finds it. The hallway skeleton planner's plans come
+// with prologue and epilogue paths and are never cached, nor are plans while the coverage grid is in
+// use since it changes with every step.
+bool PathPlanner::findCachedPlan(int s, int t){
+  if(planCacheSize == 0 or name == "hallwayskel" or use_coverage_grid){
+    return false;
+  }
+  static Counter *hits = Instrumentation::instance().counter("plan_cache_hits");
+  static Counter *misses = Instrumentation::instance().counter("plan_cache_misses");
+  int version = (recostsGraph() ? costModelVersion : 0);
+  for(list<CachedPlan>::iterator it = planCache.begin(); it != planCache.end(); it++){
+    if(it->target != t or it->graphRevision != navGraph->getRevision() or it->costModelVersion != version or it->heuristicWeight != heuristicWeight){
+      continue;
+    }
+    list<int>::iterator from = find(it->path.begin(), it->path.end(), s);
+    if(from == it->path.end() or (it->source != s and heuristicWeight != 1)){
+      continue;
+    }
+    path.assign(from, it->path.end());
+    paths.clear();
+    for(int i = 0; i < it->paths.size(); i++){
+      list<int>::iterator pathFrom = find(it->paths[i].begin(), it->paths[i].end(), s);
+      if(pathFrom != it->paths[i].end()){
+        paths.push_back(list<int>(pathFrom, it->paths[i].end()));
+      }
+    }
+    planCache.splice(planCache.begin(), planCache, it);
+    hits->add(1);
+    return true;
+  }
+  misses->add(1);
+  return false;
+}
+
+// With the plan cache on, a graph recosted from the same cost model and untouched since keeps its
+// costs, and recosting it again would only drop the cached plans by changing its revision
+bool PathPlanner::graphCostsCurrent(){
+  if(planCacheSize == 0 or use_coverage_grid){
+    return false;
+  }
+  return recostedRevision == navGraph->getRevision() and recostedVersion == costModelVersion;
+}
+
+void PathPlanner::cachePlan(int s, int t){
+  if(planCacheSize == 0 or name == "hallwayskel" or use_coverage_grid){
+    return;
+  }
+  CachedPlan plan;
+  plan.source = s;
+  plan.target = t;
+  plan.graphRevision = navGraph->getRevision();
+  plan.costModelVersion = (recostsGraph() ? costModelVersion : 0);
+  plan.heuristicWeight = heuristicWeight;
+  plan.path = path;
+  plan.paths = paths;
+  planCache.push_front(plan);
+  while(planCache.size() > planCacheSize){
+    planCache.pop_back();
+  }
+}
+
+// Planners other than these change the edge costs of their graph before every search
+bool PathPlanner::recostsGraph(){
+  return name != "distance" and name != "skeleton" and name != "hallwayskel";
+}
+
+// Jump point search needs edge costs that are distances on a lattice, which rules out the
+// planners that recost their graph and the skeleton graphs
+bool PathPlanner::usesJumpPointSearch(){
+  if(!jumpPointSearch or recostsGraph() or name == "skeleton" or name == "hallwayskel"){
+    return false;
+  }
+  return jumpSearch.usable(navGraph);
+}
+
 void PathPlanner::updateNavGraph(){
 	cout << "Updating nav graph before" << endl;
-	if(crowdModel.densities.size() == 0 and (name == "density" or name == "risk" or name == "flow")){
+	if(crowdModel->densities.size() == 0 and (name == "density" or name == "risk" or name == "flow")){
 		cout << "crowdModel not recieved" << endl;
 	}
 	else{
@@ -354,7 +450,9 @@ void PathPlanner::updateNavGraph(){
 		/*for(int i = 0 ; i < crowdModel.densities.size(); i++){
 			cout << crowdModel.densities[i] << endl;
 		}*/
+		static Counter *edgesRecosted = Instrumentation::instance().counter("nav_graph_edges_recosted");
 		vector<Edge*> edges = navGraph->getEdges();
+		edgesRecosted->add(edges.size());
 		// compute the extra cost imposed by crowd model on each edge in navGraph
 		for(int i = 0; i < edges.size(); i++){
 			Node toNode = navGraph->getNode(edges[i]->getTo());
@@ -1039,19 +1137,19 @@ double PathPlanner::computeNewEdgeCost(Node s, Node d, bool direction, double ol
 
 
 double PathPlanner::cellCost(int nodex, int nodey, int buffer){
-	int x = (int)((nodex/100.0)/crowdModel.resolution);
-	int x1 = (int)(((nodex+buffer)/100.0)/crowdModel.resolution);
-	int x2 = (int)(((nodex-buffer)/100.0)/crowdModel.resolution);
-	int y = (int)((nodey/100.0)/crowdModel.resolution);
-	int y1 = (int)(((nodey+buffer)/100.0)/crowdModel.resolution);
-	int y2 = (int)(((nodey-buffer)/100.0)/crowdModel.resolution);
+	int x = (int)((nodex/100.0)/crowdModel->resolution);
+	int x1 = (int)(((nodex+buffer)/100.0)/crowdModel->resolution);
+	int x2 = (int)(((nodex-buffer)/100.0)/crowdModel->resolution);
+	int y = (int)((nodey/100.0)/crowdModel->resolution);
+	int y1 = (int)(((nodey+buffer)/100.0)/crowdModel->resolution);
+	int y2 = (int)(((nodey-buffer)/100.0)/crowdModel->resolution);
 
 	//std::cout << "x " << x << " y " << y;
-	double d = crowdModel.densities[(y * crowdModel.width) + x];
-	double d1 = crowdModel.densities[(y1 * crowdModel.width) + x];
-	double d2 = crowdModel.densities[(y2 * crowdModel.width) + x];
-	double d3 = crowdModel.densities[(y * crowdModel.width) + x1];
-	double d4 = crowdModel.densities[(y * crowdModel.width) + x2];
+	double d = crowdModel->densities[(y * crowdModel->width) + x];
+	double d1 = crowdModel->densities[(y1 * crowdModel->width) + x];
+	double d2 = crowdModel->densities[(y2 * crowdModel->width) + x];
+	double d3 = crowdModel->densities[(y * crowdModel->width) + x1];
+	double d4 = crowdModel->densities[(y * crowdModel->width) + x2];
 	//std::cout << " Cell cost " << d << std::endl;
 	//return (d + d1 + d2 + d3 + d4)/5;
 	double da = std::max(std::max(d, d1),d2);
@@ -1062,19 +1160,19 @@ double PathPlanner::cellCost(int nodex, int nodey, int buffer){
 
 
 double PathPlanner::riskCost(int nodex, int nodey, int buffer){
-  int x = (int)((nodex/100.0)/crowdModel.resolution);
-  int x1 = (int)(((nodex+buffer)/100.0)/crowdModel.resolution);
-  int x2 = (int)(((nodex-buffer)/100.0)/crowdModel.resolution);
-  int y = (int)((nodey/100.0)/crowdModel.resolution);
-  int y1 = (int)(((nodey+buffer)/100.0)/crowdModel.resolution);
-  int y2 = (int)(((nodey-buffer)/100.0)/crowdModel.resolution);
+  int x = (int)((nodex/100.0)/crowdModel->resolution);
+  int x1 = (int)(((nodex+buffer)/100.0)/crowdModel->resolution);
+  int x2 = (int)(((nodex-buffer)/100.0)/crowdModel->resolution);
+  int y = (int)((nodey/100.0)/crowdModel->resolution);
+  int y1 = (int)(((nodey+buffer)/100.0)/crowdModel->resolution);
+  int y2 = (int)(((nodey-buffer)/100.0)/crowdModel->resolution);
 
   //std::cout << "x " << x << " y " << y;
-  double d = crowdModel.risk[(y * crowdModel.width) + x];
-  double d1 = crowdModel.risk[(y1 * crowdModel.width) + x];
-  double d2 = crowdModel.risk[(y2 * crowdModel.width) + x];
-  double d3 = crowdModel.risk[(y * crowdModel.width) + x1];
-  double d4 = crowdModel.risk[(y * crowdModel.width) + x2];
+  double d = crowdModel->risk[(y * crowdModel->width) + x];
+  double d1 = crowdModel->risk[(y1 * crowdModel->width) + x];
+  double d2 = crowdModel->risk[(y2 * crowdModel->width) + x];
+  double d3 = crowdModel->risk[(y * crowdModel->width) + x1];
+  double d4 = crowdModel->risk[(y * crowdModel->width) + x2];
   //std::cout << " Cell cost " << d << std::endl;
   //return (d + d1 + d2 + d3 + d4)/5;
   double da = std::max(std::max(d, d1),d2);
@@ -1085,28 +1183,28 @@ double PathPlanner::riskCost(int nodex, int nodey, int buffer){
 
 // Projection of crowd flow vectors on vector at s and d and then take the average
 double PathPlanner::computeCrowdFlow(Node s, Node d){
-	int s_x_index = (int)((s.getX()/100.0)/crowdModel.resolution);
-	int s_y_index = (int)((s.getY()/100.0)/crowdModel.resolution);
-	int d_x_index = (int)((d.getX()/100.0)/crowdModel.resolution);
-	int d_y_index = (int)((d.getY()/100.0)/crowdModel.resolution);
+	int s_x_index = (int)((s.getX()/100.0)/crowdModel->resolution);
+	int s_y_index = (int)((s.getY()/100.0)/crowdModel->resolution);
+	int d_x_index = (int)((d.getX()/100.0)/crowdModel->resolution);
+	int d_y_index = (int)((d.getY()/100.0)/crowdModel->resolution);
 	//Assuming crowd densities are normalized between 0 and 1
-	double s_l = crowdModel.left[(s_y_index * crowdModel.width) + s_x_index];
-	double d_l = crowdModel.left[(d_y_index * crowdModel.width) + d_x_index];
-	double s_r = crowdModel.right[(s_y_index * crowdModel.width) + s_x_index];
-	double d_r = crowdModel.right[(d_y_index * crowdModel.width) + d_x_index];
-	double s_u = crowdModel.up[(s_y_index * crowdModel.width) + s_x_index];
-	double d_u = crowdModel.up[(d_y_index * crowdModel.width) + d_x_index];
-	double s_d = crowdModel.down[(s_y_index * crowdModel.width) + s_x_index];
-	double d_d = crowdModel.down[(d_y_index * crowdModel.width) + d_x_index];
-
-	double s_ul = crowdModel.up_left[(s_y_index * crowdModel.width) + s_x_index];
-	double d_ul = crowdModel.up_left[(d_y_index * crowdModel.width) + d_x_index];
-	double s_ur = crowdModel.up_right[(s_y_index * crowdModel.width) + s_x_index];
-	double d_ur = crowdModel.up_right[(d_y_index * crowdModel.width) + d_x_index];
-	double s_dl = crowdModel.down_left[(s_y_index * crowdModel.width) + s_x_index];
-	double d_dl = crowdModel.down_left[(d_y_index * crowdModel.width) + d_x_index];
-	double s_dr = crowdModel.down_right[(s_y_index * crowdModel.width) + s_x_index];
-	double d_dr = crowdModel.down_right[(d_y_index * crowdModel.width) + d_x_index];
+	double s_l = crowdModel->left[(s_y_index * crowdModel->width) + s_x_index];
+	double d_l = crowdModel->left[(d_y_index * crowdModel->width) + d_x_index];
+	double s_r = crowdModel->right[(s_y_index * crowdModel->width) + s_x_index];
+	double d_r = crowdModel->right[(d_y_index * crowdModel->width) + d_x_index];
+	double s_u = crowdModel->up[(s_y_index * crowdModel->width) + s_x_index];
+	double d_u = crowdModel->up[(d_y_index * crowdModel->width) + d_x_index];
+	double s_d = crowdModel->down[(s_y_index * crowdModel->width) + s_x_index];
+	double d_d = crowdModel->down[(d_y_index * crowdModel->width) + d_x_index];
+
+	double s_ul = crowdModel->up_left[(s_y_index * crowdModel->width) + s_x_index];
+	double d_ul = crowdModel->up_left[(d_y_index * crowdModel->width) + d_x_index];
+	double s_ur = crowdModel->up_right[(s_y_index * crowdModel->width) + s_x_index];
+	double d_ur = crowdModel->up_right[(d_y_index * crowdModel->width) + d_x_index];
+	double s_dl = crowdModel->down_left[(s_y_index * crowdModel->width) + s_x_index];
+	double d_dl = crowdModel->down_left[(d_y_index * crowdModel->width) + d_x_index];
+	double s_dr = crowdModel->down_right[(s_y_index * crowdModel->width) + s_x_index];
+	double d_dr = crowdModel->down_right[(d_y_index * crowdModel->width) + d_x_index];
 
 	//cout << "Left : " << d_l << " * " << s_l << endl;
 	//cout << "Right : " << d_r << " * " << s_r << endl;
@@ -1340,6 +1438,92 @@ double PathPlanner::calcPathCost(list<int> p){
   return pcost;
 }
 
+// The planners' graphs are built from the same map with the same proximity, so an edge usually sits
+// at the same place in a node's edge list on all of them. Each step of a plan finds its edge once,
+// on the first graph it is in, and every other graph is only checked at that place before falling
+// back to getEdge().
+vector< vector<double> > PathPlanner::calcPathCosts(const vector<PathPlanner*> &planners, const vector< list<int> > &plans){
+  vector< vector<double> > costs(planners.size(), vector<double>(plans.size(), 0));
+  vector<Graph*> graphs;
+  vector<int> columns;
+  for(int i = 0; i < planners.size(); i++){
+    if(planners[i]->getName() != "skeleton" and planners[i]->getName() != "hallwayskel"){
+      graphs.push_back(planners[i]->getGraph());
+      columns.push_back(i);
+    }
+  }
+  for(int p = 0; p < plans.size(); p++){
+    list<int>::const_iterator iter = plans[p].begin();
+    if(iter == plans[p].end()){
+      continue;
+    }
+    int first = *iter;
+    for(iter++; iter != plans[p].end(); iter++){
+      int second = *iter;
+      int slot = -1;
+      for(int g = 0; g < graphs.size(); g++){
+        Edge *e = NULL;
+        vector<Edge*> &nodeEdges = graphs[g]->getNodePtr(first)->getNodeEdges();
+        if(slot >= 0 and slot < nodeEdges.size()){
+          Edge *candidate = nodeEdges[slot];
+          if((candidate->getFrom() == first and candidate->getTo() == second) or (candidate->getFrom() == second and candidate->getTo() == first)){
+            e = candidate;
+          }
+        }
+        if(e == NULL){
+          for(int k = 0; k < nodeEdges.size(); k++){
+            if((nodeEdges[k]->getFrom() == first and nodeEdges[k]->getTo() == second) or (nodeEdges[k]->getFrom() == second and nodeEdges[k]->getTo() == first)){
+              e = nodeEdges[k];
+              slot = k;
+              break;
+            }
+          }
+        }
+        if(e != NULL){
+          costs[columns[g]][p] += e->getCost(true);
+        }
+      }
+      first = second;
+    }
+  }
+  return costs;
+}
+
+// Greedy, the line from the last node kept is stretched node by node until it is obstructed or
+// leaves the band around the nodes it skips. The band keeps the route the planner chose, a crowd
+// or risk planner's detour is straightened but not cut off.
+list<int> PathPlanner::pullString(list<int> p){
+  if(stringPullWidth <= 0 or p.size() < 3){
+    return p;
+  }
+  vector<Node*> nodes;
+  for(list<int>::iterator it = p.begin(); it != p.end(); it++){
+    nodes.push_back(navGraph->getNodePtr(*it));
+  }
+  list<int> pulled;
+  pulled.push_back(nodes[0]->getID());
+  int anchor = 0;
+  for(int next = 2; next < nodes.size(); next++){
+    Node *from = nodes[anchor];
+    Node *to = nodes[next];
+    bool shortcut = true;
+    for(int i = anchor + 1; i < next and shortcut; i++){
+      if(map.distanceFromSegment(from->getX(), from->getY(), to->getX(), to->getY(), nodes[i]->getX(), nodes[i]->getY()) > stringPullWidth){
+        shortcut = false;
+      }
+    }
+    if(shortcut and map.isPathObstructed(from->getX(), from->getY(), to->getX(), to->getY())){
+      shortcut = false;
+    }
+    if(!shortcut){
+      anchor = next - 1;
+      pulled.push_back(nodes[anchor]->getID());
+    }
+  }
+  pulled.push_back(nodes.back()->getID());
+  return pulled;
+}
+
 double PathPlanner::calcOrigPathCost(list<int> p){
   double pcost = 0;
   list<int>::iterator iter;
@@ -0,0 +1,208 @@
+/*
+ * Implementation of SegmentSet, the batched segment queries declared in
+ * FORRGeometry.h. Kept apart from FORRGeometry.cpp because the intrinsics
+ * headers pull in <stdlib.h>, which would change the abs() overloads the
+ * tolerance checks there resolve to.
+ *
+ */
+
+#include "FORRGeometry.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using std::min;
+using std::max;
+
+/**********************************************************************
+                  SegmentSet implementation
+**********************************************************************/
+SegmentSet::SegmentSet(CartesianPoint origin, const std::vector<CartesianPoint>& endpoints){
+  for(int i = 0; i < endpoints.size(); i++){
+    add(origin, endpoints[i]);
+  }
+}
+
+void SegmentSet::add(CartesianPoint first, CartesianPoint second){
+  LineSegment segment(first, second);
+  x1.push_back(first.get_x());
+  y1.push_back(first.get_y());
+  x2.push_back(second.get_x());
+  y2.push_back(second.get_y());
+  a.push_back(segment.get_value_a());
+  b.push_back(segment.get_value_b());
+  c.push_back(segment.get_value_c());
+  length.push_back(distance(first, second));
+}
+
+void SegmentSet::clear(){
+  x1.clear(); y1.clear(); x2.clear(); y2.clear();
+  a.clear(); b.clear(); c.clear(); length.clear();
+}
+
+namespace {
+
+struct SegmentArrays{
+  const double *x1, *y1, *x2, *y2, *a, *b, *c, *length;
+};
+
+struct QuerySegment{
+  double x1, y1, x2, y2, a, b, c, length;
+};
+
+bool intersects_scalar(const SegmentArrays& s, int i, const QuerySegment& q){
+  double determinant = s.a[i] * q.b - q.a * s.b[i];
+  if(determinant == 0)
+    return false;
+  double x = (q.b * s.c[i] - s.b[i] * q.c) / determinant;
+  double y = (q.c * s.a[i] - s.c[i] * q.a) / determinant;
+  double on_segment = sqrt((x - s.x1[i])*(x - s.x1[i]) + (y - s.y1[i])*(y - s.y1[i])) + sqrt((x - s.x2[i])*(x - s.x2[i]) + (y - s.y2[i])*(y - s.y2[i])) - s.length[i];
+  double on_query = sqrt((x - q.x1)*(x - q.x1) + (y - q.y1)*(y - q.y1)) + sqrt((x - q.x2)*(x - q.x2) + (y - q.y2)*(y - q.y2)) - q.length;
+  return fabs(on_segment) < POINT_IN_SEGMENT_TOLERANCE and fabs(on_query) < POINT_IN_SEGMENT_TOLERANCE;
+}
+
+double squared_distance_scalar(const SegmentArrays& s, int i, double px, double py){
+  double dx = s.x2[i] - s.x1[i];
+  double dy = s.y2[i] - s.y1[i];
+  double length_squared = dx * dx + dy * dy;
+  double t = 0;
+  if(length_squared > 0){
+    t = ((px - s.x1[i]) * dx + (py - s.y1[i]) * dy) / length_squared;
+    t = max(0.0, min(1.0, t));
+  }
+  double ex = px - (s.x1[i] + t * dx);
+  double ey = py - (s.y1[i] + t * dy);
+  return ex * ex + ey * ey;
+}
+
+#if defined(__AVX2__)
+typedef __m256d lanes;
+const int LANES = 4;
+inline lanes load(const double *p) { return _mm256_loadu_pd(p); }
+inline lanes broadcast(double v) { return _mm256_set1_pd(v); }
+inline lanes add(lanes l, lanes r) { return _mm256_add_pd(l, r); }
+inline lanes sub(lanes l, lanes r) { return _mm256_sub_pd(l, r); }
+inline lanes mul(lanes l, lanes r) { return _mm256_mul_pd(l, r); }
+inline lanes divide(lanes l, lanes r) { return _mm256_div_pd(l, r); }
+inline lanes root(lanes v) { return _mm256_sqrt_pd(v); }
+inline lanes lower(lanes l, lanes r) { return _mm256_min_pd(l, r); }
+inline lanes upper(lanes l, lanes r) { return _mm256_max_pd(l, r); }
+inline lanes both(lanes l, lanes r) { return _mm256_and_pd(l, r); }
+inline lanes less_than(lanes l, lanes r) { return _mm256_cmp_pd(l, r, _CMP_LT_OQ); }
+inline lanes not_equal(lanes l, lanes r) { return _mm256_cmp_pd(l, r, _CMP_NEQ_UQ); }
+inline int mask(lanes v) { return _mm256_movemask_pd(v); }
+inline void store(double *p, lanes v) { _mm256_storeu_pd(p, v); }
+#define SEGMENTSET_SIMD
+#elif defined(__SSE2__)
+typedef __m128d lanes;
+const int LANES = 2;
+inline lanes load(const double *p) { return _mm_loadu_pd(p); }
+inline lanes broadcast(double v) { return _mm_set1_pd(v); }
+inline lanes add(lanes l, lanes r) { return _mm_add_pd(l, r); }
+inline lanes sub(lanes l, lanes r) { return _mm_sub_pd(l, r); }
+inline lanes mul(lanes l, lanes r) { return _mm_mul_pd(l, r); }
+inline lanes divide(lanes l, lanes r) { return _mm_div_pd(l, r); }
+inline lanes root(lanes v) { return _mm_sqrt_pd(v); }
+inline lanes lower(lanes l, lanes r) { return _mm_min_pd(l, r); }
+inline lanes upper(lanes l, lanes r) { return _mm_max_pd(l, r); }
+inline lanes both(lanes l, lanes r) { return _mm_and_pd(l, r); }
+inline lanes less_than(lanes l, lanes r) { return _mm_cmplt_pd(l, r); }
+inline lanes not_equal(lanes l, lanes r) { return _mm_cmpneq_pd(l, r); }
+inline int mask(lanes v) { return _mm_movemask_pd(v); }
+inline void store(double *p, lanes v) { _mm_storeu_pd(p, v); }
+#define SEGMENTSET_SIMD
+#endif
+
+#ifdef SEGMENTSET_SIMD
+inline lanes distance_lanes(lanes x, lanes y, lanes px, lanes py){
+  lanes dx = sub(x, px);
+  lanes dy = sub(y, py);
+  return root(add(mul(dx, dx), mul(dy, dy)));
+}
+
+inline lanes within_tolerance_lanes(lanes difference){
+  return both(less_than(broadcast(-POINT_IN_SEGMENT_TOLERANCE), difference), less_than(difference, broadcast(POINT_IN_SEGMENT_TOLERANCE)));
+}
+
+// Same arithmetic as intersects_scalar lane by lane, bit i of the result is set when segment first + i is hit
+int intersects_lanes(const SegmentArrays& s, int first, const QuerySegment& q){
+  lanes sa = load(s.a + first), sb = load(s.b + first), sc = load(s.c + first);
+  lanes qa = broadcast(q.a), qb = broadcast(q.b), qc = broadcast(q.c);
+  lanes determinant = sub(mul(sa, qb), mul(qa, sb));
+  lanes x = divide(sub(mul(qb, sc), mul(sb, qc)), determinant);
+  lanes y = divide(sub(mul(qc, sa), mul(sc, qa)), determinant);
+  lanes on_segment = sub(add(distance_lanes(x, y, load(s.x1 + first), load(s.y1 + first)), distance_lanes(x, y, load(s.x2 + first), load(s.y2 + first))), load(s.length + first));
+  lanes on_query = sub(add(distance_lanes(x, y, broadcast(q.x1), broadcast(q.y1)), distance_lanes(x, y, broadcast(q.x2), broadcast(q.y2))), broadcast(q.length));
+  lanes hit = both(not_equal(determinant, broadcast(0.0)), both(within_tolerance_lanes(on_segment), within_tolerance_lanes(on_query)));
+  return mask(hit);
+}
+
+// Same arithmetic as squared_distance_scalar, max(NaN, 0) is 0 so degenerate segments project to their first end
+lanes squared_distance_lanes(const SegmentArrays& s, int first, lanes px, lanes py){
+  lanes sx1 = load(s.x1 + first), sy1 = load(s.y1 + first);
+  lanes dx = sub(load(s.x2 + first), sx1);
+  lanes dy = sub(load(s.y2 + first), sy1);
+  lanes length_squared = add(mul(dx, dx), mul(dy, dy));
+  lanes t = divide(add(mul(sub(px, sx1), dx), mul(sub(py, sy1), dy)), length_squared);
+  t = lower(broadcast(1.0), upper(t, broadcast(0.0)));
+  lanes ex = sub(px, add(sx1, mul(t, dx)));
+  lanes ey = sub(py, add(sy1, mul(t, dy)));
+  return add(mul(ex, ex), mul(ey, ey));
+}
+#endif
+
+}
+
+int SegmentSet::first_intersecting(LineSegment query) const{
+  if(x1.empty())
+    return -1;
+  SegmentArrays s = { &x1[0], &y1[0], &x2[0], &y2[0], &a[0], &b[0], &c[0], &length[0] };
+  pair<CartesianPoint, CartesianPoint> ends = query.get_endpoints();
+  QuerySegment q = { ends.first.get_x(), ends.first.get_y(), ends.second.get_x(), ends.second.get_y(),
+                     query.get_value_a(), query.get_value_b(), query.get_value_c(), distance(ends.first, ends.second) };
+  int n = size();
+  int i = 0;
+#ifdef SEGMENTSET_SIMD
+  for(; i + LANES <= n; i += LANES){
+    int hits = intersects_lanes(s, i, q);
+    if(hits != 0)
+      return i + __builtin_ctz(hits);
+  }
+#endif
+  for(; i < n; i++){
+    if(intersects_scalar(s, i, q))
+      return i;
+  }
+  return -1;
+}
+
+double SegmentSet::min_distance(CartesianPoint point) const{
+  if(x1.empty())
+    return std::numeric_limits<double>::infinity();
+  SegmentArrays s = { &x1[0], &y1[0], &x2[0], &y2[0], &a[0], &b[0], &c[0], &length[0] };
+  double px = point.get_x();
+  double py = point.get_y();
+  double closest = std::numeric_limits<double>::infinity();
+  int n = size();
+  int i = 0;
+#ifdef SEGMENTSET_SIMD
+  if(n >= LANES){
+    lanes closest_lanes = broadcast(closest);
+    for(; i + LANES <= n; i += LANES){
+      closest_lanes = lower(closest_lanes, squared_distance_lanes(s, i, broadcast(px), broadcast(py)));
+    }
+    double per_lane[LANES];
+    store(per_lane, closest_lanes);
+    for(int j = 0; j < LANES; j++){
+      closest = min(closest, per_lane[j]);
+    }
+  }
+#endif
+  for(; i < n; i++){
+    closest = min(closest, squared_distance_scalar(s, i, px, py));
+  }
+  return sqrt(closest);
+}
@@ -95,6 +95,33 @@ std::map <FORRAction, double> Tier3Advisor::allAdvice(){
 }
 
 
+std::map <FORRAction, double> Tier3Advisor::rawAdvice(){
+  std::map <FORRAction, double> result;
+  // allAdvice always runs in rotation mode, so only the rotation advisors comment
+  if((this->get_name()).find("Rotation") == std::string::npos){
+    return result;
+  }
+  set<FORRAction> *action_set = beliefs->getAgentState()->getActionSet();
+  for(set<FORRAction>::iterator actionIter = action_set->begin(); actionIter != action_set->end(); actionIter++){
+    result[*actionIter] = this->actionComment(*actionIter);
+  }
+  return result;
+}
+
+
+std::map <FORRAction, double> Tier3Advisor::adviceFromRaw(std::map <FORRAction, double> raw){
+  set<FORRAction> *vetoed_actions = beliefs->getAgentState()->getVetoedActions();
+  std::map <FORRAction, double> result;
+  for(map<FORRAction, double>::iterator itr = raw.begin(); itr != raw.end(); itr++){
+    if(vetoed_actions->find(itr->first) == vetoed_actions->end()){
+      result[itr->first] = itr->second;
+    }
+  }
+  normalize(&result);
+  return result;
+}
+
+
 //normalizing from 0 to 10
 void Tier3Advisor::
 normalize(map <FORRAction, double> * result){
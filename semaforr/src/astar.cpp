@@ -1,4 +1,5 @@
 #include "astar.h"
+#include "Instrumentation.h"
 
 double astar::small_cost = 1;
 double astar::diag_cost = sqrt(2 * small_cost * small_cost);
@@ -6,12 +7,22 @@ double astar::diag_cost = sqrt(2 * small_cost * small_cost);
 astar::astar(Graph *g)
 {
   this->graph = g;
+  this->weight = 1;
   this->path.clear();
 }
 
 astar::astar(Graph g, Node& start, Node& goal, string name)
 {
   this->graph = &g;
+  this->weight = 1;
+  this->path.clear();
+  search(start.getID(), goal.getID(), name);
+}
+
+astar::astar(Graph g, Node& start, Node& goal, string name, double w)
+{
+  this->graph = &g;
+  this->weight = (w < 1 ? 1 : w);
   this->path.clear();
   search(start.getID(), goal.getID(), name);
 }
@@ -21,13 +32,16 @@ bool astar::search(int source, int target, string name)
   start = new _VNode(graph->getNode(source));
   goal  = new _VNode(graph->getNode(target));
   open.push(start);
-  //int count = 0;
+  static Counter *nodesExpanded = Instrumentation::instance().counter("astar_nodes_expanded");
+  int count = 0;
   while (!open.empty())
   {
     _VNode* current = open.top(); open.pop(); // Get and remove the top of the open list
+    count++;
     if(current->id == goal->id) // Found the path
     {
       // cout << "Source " << source << " Target " << target << " Start " << start->id << " Goal " << goal->id << " Current " << current->id << endl;
+      nodesExpanded->add(count);
       construct_path(start, current);
       return true;
     }
@@ -44,7 +58,7 @@ bool astar::search(int source, int target, string name)
       tmp->g = current->g + graph->getNode(current->id).getCostTo(tmp->id);
       if (name != "skeleton" or name != "hallwayskel")
       {
-        tmp->f = tmp->g + euclidian_h(tmp, goal); // Compute f for this node
+        tmp->f = tmp->g + weight * euclidian_h(tmp, goal); // Compute f for this node
       }
       else
       {
@@ -89,9 +103,9 @@ bool astar::search(int source, int target, string name)
 
       push_update(open, tmp);
     }
-    //count++;
   }
   //cout << "Number of nodes expanded = " << count << endl;
+  nodesExpanded->add(count);
   return false;
 }
 
@@ -16,6 +16,8 @@
 #include "Controller.h"
 #include "FORRAction.h"
 #include "Visualizer.h"
+#include "DecisionInputFile.h"
+#include "Instrumentation.h"
 
 #include <ros/package.h>
 #include <ros/ros.h>
@@ -27,6 +29,8 @@
 #include <tf/transform_datatypes.h>
 #include <semaforr/CrowdModel.h>
 #include <python2.7/Python.h>
+#include <boost/thread.hpp>
+#include <boost/make_shared.hpp>
 
 using namespace std;
 
@@ -44,14 +48,18 @@ private:
 	ros::Subscriber sub_crowd_model_;
 	ros::Subscriber sub_crowd_pose_;
 	ros::Subscriber sub_crowd_pose_all_;
+	//! Re-publishes the current command in event driven mode
+	ros::Timer cmd_timer_;
 	// Current position and previous stopping position of the robot
 	Position current, previous;
-	// Current and previous laser scan
-	sensor_msgs::LaserScan laserscan;
-	// Current crowd_model
-	semaforr::CrowdModel crowdModel;
+	// Latest laser scan, crowd_model and crowd_pose messages. The callbacks keep the messages roscpp
+	// delivered and the decision loop shares them with the controller, so they are never copied.
+	sensor_msgs::LaserScan::ConstPtr laserscan;
+	// Current crowd_model, applied to the controller by the decision loop
+	semaforr::CrowdModel::ConstPtr crowdModel;
+	bool crowdModelReceived;
 	// Current crowd_pose
-	geometry_msgs::PoseArray crowdPose, crowdPoseAll;
+	geometry_msgs::PoseArray::ConstPtr crowdPose, crowdPoseAll;
 	// Controller
 	Controller *controller;
 	// Pos received
@@ -60,6 +68,26 @@ private:
 	bool add_noise;
 	// Visualization 
 	Visualizer *viz_;
+	// Sensing of every decision, for semaforr_replay
+	DecisionInputWriter inputFile;
+	// Guards everything the callbacks write, and base_cmd, once callbacks run on the spinner thread
+	boost::mutex sensorMutex;
+	// Signalled by the pose and laser callbacks so the event driven loop wakes up on new data
+	boost::condition_variable sensorCondition;
+	// Number of pose and laser messages received, and the wall time the latest one arrived
+	unsigned long sensorCount;
+	double lastSensorTime;
+	// Command being executed
+	geometry_msgs::Twist base_cmd;
+	// Decision loop state
+	FORRAction semaforr_action;
+	bool action_complete, firstMessageReceived;
+	double start_time, action_start_time;
+	double overallTimeSec, computationTimeSec;
+	// Time from the arrival of the sensor data that completed the previous action to the new command
+	double senseToActSec;
+	double epsilon_move; //Meters
+	double epsilon_turn; //Radians
 public:
 	//! ROS node initialization
 	RobotDriver(ros::NodeHandle &nh, Controller *con)
@@ -76,43 +104,57 @@ public:
 		controller = con;
 		init_pos_received = false;
  		init_laser_received = false;
+		crowdModelReceived = false;
+		laserscan = boost::make_shared<sensor_msgs::LaserScan>();
+		crowdModel = boost::make_shared<semaforr::CrowdModel>();
+		crowdPose = boost::make_shared<geometry_msgs::PoseArray>();
+		crowdPoseAll = boost::make_shared<geometry_msgs::PoseArray>();
 		current.setX(0);current.setY(0);current.setTheta(0);
 		add_noise = false;
 		previous.setX(0);previous.setY(0);previous.setTheta(0);
+		sensorCount = 0;
+		lastSensorTime = 0;
+		senseToActSec = 0;
+		epsilon_move = 0.06;
+		epsilon_turn = 0.11;
 		viz_ = new Visualizer(&nh_, con);
+		if(con->getDecisionInputFile() != ""){
+			inputFile.open(con->getDecisionInputFile());
+		}
 	}
 
 	// Callback function for crowd pose message
-	void updateCrowdPose(const geometry_msgs::PoseArray &crowd_pose){
+	void updateCrowdPose(const geometry_msgs::PoseArray::ConstPtr &crowd_pose){
 		//ROS_DEBUG("Inside callback for crowd pose");
 		//update the crowd model of the belief
+		boost::lock_guard<boost::mutex> lock(sensorMutex);
 		crowdPose = crowd_pose;
 	}
 
 
 	// Callback function for crowd pose all message
-	void updateCrowdPoseAll(const geometry_msgs::PoseArray &crowd_pose_all){
+	void updateCrowdPoseAll(const geometry_msgs::PoseArray::ConstPtr &crowd_pose_all){
 		//ROS_DEBUG("Inside callback for crowd pose all");
 		//update the crowd model of the belief
+		boost::lock_guard<boost::mutex> lock(sensorMutex);
 		crowdPoseAll = crowd_pose_all;
 	}
 
-	// Callback function for crowd model message
-	void updateCrowdModel(const semaforr::CrowdModel & crowd_model){
+	// Callback function for crowd model message, the model reaches the planners at the next decision
+	void updateCrowdModel(const semaforr::CrowdModel::ConstPtr & crowd_model){
 		//ROS_DEBUG("Inside callback for crowd model");
-		//cout << crowd_model.height << " " << crowd_model.width << endl;
-		//update the crowd model of the belief
-		controller->getPlanner()->setCrowdModel(crowd_model);
-		controller->updatePlannersModels(crowd_model);
-		controller->getBeliefs()->getAgentState()->setCrowdModel(crowd_model);
+		//cout << crowd_model->height << " " << crowd_model->width << endl;
+		boost::lock_guard<boost::mutex> lock(sensorMutex);
+		crowdModel = crowd_model;
+		crowdModelReceived = true;
 	}
 
 	// Callback function for pose message
-	void updatePose(const geometry_msgs::PoseStamped & pose){
+	void updatePose(const geometry_msgs::PoseStamped::ConstPtr & pose){
 		//ROS_DEBUG("Inside callback for position message");
-		double x = pose.pose.position.x;
-		double y = pose.pose.position.y;
-		tf::Quaternion q(pose.pose.orientation.x,pose.pose.orientation.y,pose.pose.orientation.z,pose.pose.orientation.w);
+		double x = pose->pose.position.x;
+		double y = pose->pose.position.y;
+		tf::Quaternion q(pose->pose.orientation.x,pose->pose.orientation.y,pose->pose.orientation.z,pose->pose.orientation.w);
 		tf::Matrix3x3 m(q);
 		double roll, pitch, yaw;
 		m.getRPY(roll, pitch, yaw);
@@ -129,22 +171,44 @@ public:
 			}
 			currentPose = Position(new_x, new_y, new_theta);
 		}
-		if(init_pos_received == false){
-			//ROS_DEBUG("First Pose message");
-			init_pos_received = true;
-			previous = currentPose;
+		{
+			boost::lock_guard<boost::mutex> lock(sensorMutex);
+			if(init_pos_received == false){
+				//ROS_DEBUG("First Pose message");
+				init_pos_received = true;
+				previous = currentPose;
+			}
+			current = currentPose;
+			sensorCount++;
+			lastSensorTime = getWallTimeSec();
 		}
-		current = currentPose;
+		sensorCondition.notify_one();
 		//ROS_INFO_STREAM("Recieved pose message from menge: " << x << " " << y << " " << yaw << endl);
 	}
 
 	// Callback function for laser_scan message
-	void updateLaserScan(const sensor_msgs::LaserScan & scan){ 
+	void updateLaserScan(const sensor_msgs::LaserScan::ConstPtr & scan){ 
 		//ROS_DEBUG("Inside callback for base_scan message");
-		laserscan = scan; 
-		init_laser_received = true;
+		{
+			boost::lock_guard<boost::mutex> lock(sensorMutex);
+			laserscan = scan; 
+			init_laser_received = true;
+			sensorCount++;
+			lastSensorTime = getWallTimeSec();
+		}
+		sensorCondition.notify_one();
 		//ROS_INFO_STREAM("Recieved base_scan message from menge ");
 	}
+
+	// Timer callback that keeps the current command flowing in event driven mode
+	void publishCommand(const ros::TimerEvent &event){
+		geometry_msgs::Twist cmd;
+		{
+			boost::lock_guard<boost::mutex> lock(sensorMutex);
+			cmd = base_cmd;
+		}
+		cmd_vel_pub_.publish(cmd);
+	}
  
 	//Collect initial sensor data from robot
 	void initialize(){
@@ -152,27 +216,40 @@ public:
 		previous = current;
 	}
 
+	double getWallTimeSec(){
+		timeval tv;
+		gettimeofday(&tv,NULL);
+		return tv.tv_sec + (tv.tv_usec/1000000.0);
+	}
+
 	//Call semaforr and execute decisions, until mission is successful
 	void run(){ 
 		//ROS_DEBUG("main::run()");  	
 		//Declares the message to be sent
 		Py_Initialize();
-		geometry_msgs::Twist base_cmd;
+		base_cmd = geometry_msgs::Twist();
+		action_complete = true;
+		overallTimeSec = 0.0;
+		computationTimeSec = 0.0;
+		start_time = getWallTimeSec();
+		action_start_time = start_time;
+		if(controller->getEventDriven()){
+			runEventDriven();
+		}
+		else{
+			runPolling();
+		}
+		controller->saveSpatialModelSnapshot();
+		if(controller->getInstrumentationSummaryFile() != ""){
+			Instrumentation::instance().writeSummary(controller->getInstrumentationSummaryFile());
+		}
+		Py_Finalize();
+	}
 
+	// Original loop: sense, test for completion and publish the command at a fixed 30 Hz
+	void runPolling(){
 		ros::Rate rate(30.0);
-		double epsilon_move = 0.06; //Meters
-		double epsilon_turn = 0.11; //Radians
-		bool action_complete = true;
-		bool mission_complete = false;
-		FORRAction semaforr_action;
-		double overallTimeSec=0.0, computationTimeSec=0.0, actionTimeSec=0.0, action_start_time=0.0, action_end_time=0.0;
-		timeval tv, cv, atv;
-		double start_time, start_timecv;
-		double end_time, end_timecv;
-		gettimeofday(&tv,NULL);
-		start_time = tv.tv_sec + (tv.tv_usec/1000000.0);
 		// Run the loop , the input sensing and the output beaming is asynchrounous
-		bool firstMessageReceived;
 		while(nh_.ok()) {
 			// If pos value is not received from menge wait
 			while(init_pos_received == false or init_laser_received == false){
@@ -183,52 +260,11 @@ public:
 				ros::spinOnce();
 				firstMessageReceived = true;
 			}
-			gettimeofday(&tv,NULL);
-			end_time = tv.tv_sec + (tv.tv_usec/1000000.0);
-			overallTimeSec = (end_time-start_time);
 			//Sense the input and the current target to run the advisors and generate a decision
 			if(action_complete){
-				ROS_INFO_STREAM("Action completed. Save sensor info, Current position: " << current.getX() << " " << current.getY() << " " << current.getTheta());
-				if(firstMessageReceived == true){
-					firstMessageReceived = false;
-				}
-				else{
-					viz_->publishLog(semaforr_action, overallTimeSec, computationTimeSec);
-					controller->gethighwayExploration()->setHighwaysComplete(overallTimeSec);
-					controller->getfrontierExploration()->setFrontiersComplete(overallTimeSec);
-				}
-				gettimeofday(&cv,NULL);
-				start_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
-				controller->updateState(current, laserscan, crowdPose, crowdPoseAll);
-				// ROS_DEBUG("Finished UpdateState");
-				viz_->publish();
-				// ROS_DEBUG("Finished Publish");
-				previous = current;
-				ROS_DEBUG("Check if mission is complete");
-				mission_complete = controller->isMissionComplete();
-				if(mission_complete){
-					ROS_INFO("Mission completed");
-					gettimeofday(&cv,NULL);
-					end_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
-					computationTimeSec = (end_timecv-start_timecv);
-					viz_->publishLog(semaforr_action, overallTimeSec, computationTimeSec);
-					controller->gethighwayExploration()->setHighwaysComplete(overallTimeSec);
-					controller->getfrontierExploration()->setFrontiersComplete(overallTimeSec);
+				if(!decisionStep()){
 					break;
 				}
-				else{
-					ROS_INFO("Mission still in progress, invoke semaforr");
-					semaforr_action = controller->decide();
-					ROS_INFO_STREAM("SemaFORRdecision is " << semaforr_action.type << " " << semaforr_action.parameter); 
-					base_cmd = convert_to_vel(semaforr_action);
-					action_complete = false;
-					actionTimeSec=0.0;
-					gettimeofday(&atv,NULL);
-					action_start_time = atv.tv_sec + (atv.tv_usec/1000000.0);
-				}
-				gettimeofday(&cv,NULL);
-				end_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
-				computationTimeSec = (end_timecv-start_timecv);
 			}
 			//send the drive command 
 			cmd_vel_pub_.publish(base_cmd);
@@ -237,17 +273,152 @@ public:
 			rate.sleep();
 			// Sense input 
 			ros::spinOnce();
-			gettimeofday(&atv,NULL);
-			action_end_time = atv.tv_sec + (atv.tv_usec/1000000.0);
-			actionTimeSec = (action_end_time - action_start_time);
-			//ROS_INFO_STREAM("Action Time (sec) : " << actionTimeSec);
 			// Check if the action is complete
-			action_complete = testActionCompletion(semaforr_action, current, previous, epsilon_move, epsilon_turn, actionTimeSec);
+			action_complete = testActionCompletion(semaforr_action, current, previous, epsilon_move, epsilon_turn, getWallTimeSec() - action_start_time);
 			//action_complete = true;
 		}
-		Py_Finalize();
 	}
 
+	// Callbacks run on a spinner thread and wake this one up, so completion is tested on every new pose or
+	// scan and the next decision starts right away. Time based completion is caught by waking at the action's
+	// time limit, so a decision is never more than one sensor message or that limit late.
+	void runEventDriven(){
+		ros::AsyncSpinner spinner(1);
+		spinner.start();
+		cmd_timer_ = nh_.createTimer(ros::Duration(1.0 / controller->getCommandRate()), &RobotDriver::publishCommand, this);
+		{
+			boost::unique_lock<boost::mutex> lock(sensorMutex);
+			while((init_pos_received == false or init_laser_received == false) and nh_.ok()){
+				ROS_DEBUG("Waiting for first message or laser");
+				sensorCondition.timed_wait(lock, boost::posix_time::milliseconds(100));
+			}
+		}
+		firstMessageReceived = true;
+		unsigned long seenCount = 0;
+		while(nh_.ok()) {
+			if(action_complete){
+				if(!decisionStep()){
+					break;
+				}
+				cmd_vel_pub_.publish(base_cmd);
+				// The robot is moving now, use the wait to get a head start on the next decision
+				controller->speculate(semaforr_action);
+			}
+			Position now_position, previous_position;
+			{
+				boost::unique_lock<boost::mutex> lock(sensorMutex);
+				double limit = action_start_time + actionTimeLimit(semaforr_action);
+				while(sensorCount == seenCount and getWallTimeSec() < limit and nh_.ok()){
+					double wait = limit - getWallTimeSec();
+					sensorCondition.timed_wait(lock, boost::posix_time::microseconds((long)(wait * 1000000.0) + 1));
+				}
+				seenCount = sensorCount;
+				now_position = current;
+				previous_position = previous;
+			}
+			action_complete = testActionCompletion(semaforr_action, now_position, previous_position, epsilon_move, epsilon_turn, getWallTimeSec() - action_start_time);
+		}
+		cmd_timer_.stop();
+		spinner.stop();
+	}
+
+	// Logs the previous decision, updates the controller with the latest sensing and makes the next decision.
+	// Returns false once the mission is complete.
+	bool decisionStep(){
+		overallTimeSec = (getWallTimeSec()-start_time);
+		Position sensed;
+		sensor_msgs::LaserScan::ConstPtr scan;
+		geometry_msgs::PoseArray::ConstPtr pose, poseAll;
+		semaforr::CrowdModel::ConstPtr model;
+		bool newModel;
+		double sensedTime;
+		{
+			boost::lock_guard<boost::mutex> lock(sensorMutex);
+			sensed = current;
+			scan = laserscan;
+			pose = crowdPose;
+			poseAll = crowdPoseAll;
+			newModel = crowdModelReceived;
+			if(newModel){
+				model = crowdModel;
+				crowdModelReceived = false;
+			}
+			sensedTime = lastSensorTime;
+		}
+		if(inputFile.isOpen()){
+			semaforr::DecisionInput input;
+			input.overall_time = overallTimeSec;
+			input.robot_x = sensed.getX();
+			input.robot_y = sensed.getY();
+			input.robot_theta = sensed.getTheta();
+			input.scan = *scan;
+			input.crowd_pose = *pose;
+			input.crowd_pose_all = *poseAll;
+			input.crowd_model_updated = newModel;
+			if(newModel){
+				input.crowd_model = *model;
+			}
+			inputFile.write(input);
+		}
+		ROS_INFO_STREAM("Action completed. Save sensor info, Current position: " << sensed.getX() << " " << sensed.getY() << " " << sensed.getTheta());
+		if(firstMessageReceived == true){
+			firstMessageReceived = false;
+		}
+		else{
+			viz_->publishLog(semaforr_action, overallTimeSec, computationTimeSec, senseToActSec);
+			controller->gethighwayExploration()->setHighwaysComplete(overallTimeSec);
+			controller->getfrontierExploration()->setFrontiersComplete(overallTimeSec);
+		}
+		double start_timecv = getWallTimeSec();
+		if(newModel){
+			//update the crowd model of the belief
+			controller->getPlanner()->setCrowdModel(model);
+			controller->updatePlannersModels(model);
+			controller->getBeliefs()->getAgentState()->setCrowdModel(model);
+		}
+		controller->updateState(sensed, scan, pose, poseAll);
+		// ROS_DEBUG("Finished UpdateState");
+		viz_->publish();
+		// ROS_DEBUG("Finished Publish");
+		{
+			boost::lock_guard<boost::mutex> lock(sensorMutex);
+			previous = sensed;
+		}
+		ROS_DEBUG("Check if mission is complete");
+		bool mission_complete = controller->isMissionComplete();
+		if(mission_complete){
+			ROS_INFO("Mission completed");
+			computationTimeSec = (getWallTimeSec()-start_timecv);
+			viz_->publishLog(semaforr_action, overallTimeSec, computationTimeSec, senseToActSec);
+			controller->gethighwayExploration()->setHighwaysComplete(overallTimeSec);
+			controller->getfrontierExploration()->setFrontiersComplete(overallTimeSec);
+			return false;
+		}
+		ROS_INFO("Mission still in progress, invoke semaforr");
+		semaforr_action = controller->decide();
+		ROS_INFO_STREAM("SemaFORRdecision is " << semaforr_action.type << " " << semaforr_action.parameter); 
+		{
+			boost::lock_guard<boost::mutex> lock(sensorMutex);
+			base_cmd = convert_to_vel(semaforr_action);
+		}
+		action_complete = false;
+		action_start_time = getWallTimeSec();
+		computationTimeSec = (action_start_time-start_timecv);
+		senseToActSec = (action_start_time-sensedTime);
+		ROS_DEBUG_STREAM("Sense to act latency " << senseToActSec);
+		return true;
+	}
+
+	// Time after which testActionCompletion accepts the action whatever the sensors say
+	double actionTimeLimit(FORRAction action){
+		if(action.type == FORWARD and action.parameter != 0){
+			return controller->getBeliefs()->getAgentState()->getMovement(action.parameter);
+		}
+		else if(action.type == RIGHT_TURN or action.type == LEFT_TURN){
+			return fabs(controller->getBeliefs()->getAgentState()->getRotation(action.parameter))/0.5;
+		}
+		return 0.01;
+	}
 
 	//! Drive the robot according to the semaforr action, episilon = 0 to 1 indicating percent of task completion
 	// Need to improve this
@@ -0,0 +1,420 @@
+/* semaforr_bench
+ * \brief Times the SemaFORR hot paths on the bundled Menge maps and prints one JSON object per line:
+ * {"map", "benchmark", "operations", "seconds", "ops_per_sec", "allocations", "allocations_per_op"}
+ *
+ * Covers map loading, navigation graph construction, A* between random node pairs, crowd model edge
+ * updates, laser visibility queries and region/hallway learning. Learning runs on traces synthesized by
+ * driving A* paths with a ray cast laser, or on a recording from decisionInputFile when one is given.
+ *
+ * Usage: semaforr_bench examples_core_dir [map [decision_inputs]]
+ * Without a map every hunter-*, gradcenter-*, mcgovern-* and moma-* map in the directory is run.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "Map.h"
+#include "Graph.h"
+#include "astar.h"
+#include "PathPlanner.h"
+#include "AgentState.h"
+#include "FORRRegionList.h"
+#include "FORRHallways.h"
+#include "FORRGeometry.h"
+#include "DecisionInputFile.h"
+
+using namespace std;
+
+// Every allocation made by the process, read before and after each benchmark
+static unsigned long allocationCount = 0;
+// Standard output, where the results go while cout itself is silenced
+static std::streambuf *resultsBuffer = NULL;
+
+void* operator new(size_t size){
+	allocationCount++;
+	void *p = malloc(size == 0 ? 1 : size);
+	if(p == NULL){
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p){
+	free(p);
+}
+
+double getWallTimeSec(){
+	timeval tv;
+	gettimeofday(&tv,NULL);
+	return tv.tv_sec + (tv.tv_usec/1000000.0);
+}
+
+// Measures the code between construction and report()
+class Benchmark {
+	public:
+		Benchmark(string mapName, string benchmarkName) : map(mapName), name(benchmarkName) {
+			allocations = allocationCount;
+			start = getWallTimeSec();
+		};
+
+		void report(long operations){
+			double seconds = getWallTimeSec() - start;
+			unsigned long allocated = allocationCount - allocations;
+			std::stringstream line;
+			line << "{\"map\": \"" << map << "\", \"benchmark\": \"" << name << "\", \"operations\": " << operations
+				<< ", \"seconds\": " << seconds << ", \"ops_per_sec\": " << (seconds > 0 ? operations / seconds : 0)
+				<< ", \"allocations\": " << allocated << ", \"allocations_per_op\": " << (operations > 0 ? (double)allocated / operations : 0) << "}";
+			std::ostream results(resultsBuffer);
+			results << line.str() << endl;
+		}
+
+	private:
+		string map, name;
+		unsigned long allocations;
+		double start;
+};
+
+// Laser geometry of the simulated robot, as in the Menge agent profiles
+static const double LASER_ANGLE_MIN = -1.91986;
+static const double LASER_ANGLE_MAX = 1.9194;
+static const double LASER_INCREMENT = 0.005817;
+static const double LASER_RANGE_MAX = 25;
+
+// Ray casts a scan against the map walls, which are in centimeters
+sensor_msgs::LaserScan castScan(Map *map, Position pose){
+	sensor_msgs::LaserScan scan;
+	scan.angle_min = LASER_ANGLE_MIN;
+	scan.angle_max = LASER_ANGLE_MAX;
+	scan.angle_increment = LASER_INCREMENT;
+	scan.range_min = 0;
+	scan.range_max = LASER_RANGE_MAX;
+	vector<Wall> walls = map->getWalls();
+	for(double angle = LASER_ANGLE_MIN; angle <= LASER_ANGLE_MAX; angle += LASER_INCREMENT){
+		double dx = cos(pose.getTheta() + angle), dy = sin(pose.getTheta() + angle);
+		double range = LASER_RANGE_MAX;
+		for(int i = 0; i < walls.size(); i++){
+			double ax = walls[i].x1/100.0 - pose.getX(), ay = walls[i].y1/100.0 - pose.getY();
+			double ex = (walls[i].x2 - walls[i].x1)/100.0, ey = (walls[i].y2 - walls[i].y1)/100.0;
+			double denominator = dx * ey - dy * ex;
+			if(fabs(denominator) < 1e-12){
+				continue;
+			}
+			double t = (ax * ey - ay * ex) / denominator;
+			double u = (ax * dy - ay * dx) / denominator;
+			if(t >= 0 and u >= 0 and u <= 1 and t < range){
+				range = t;
+			}
+		}
+		scan.ranges.push_back(range);
+	}
+	return scan;
+}
+
+// One task of a run: robot positions and the laser endpoints seen at each
+struct Trace {
+	vector<Position> positions;
+	vector< vector<CartesianPoint> > lasers;
+};
+
+// Drives A* paths between random nodes, sampling a pose every half meter
+vector<Trace> synthesizeTraces(Map *map, Graph *graph, AgentState *agentState, int tasks){
+	vector<Trace> traces;
+	vector<Node*> nodes = graph->getNodes();
+	for(int task = 0; task < tasks and nodes.size() > 1; task++){
+		Node s = *nodes[rand() % nodes.size()];
+		Node t = *nodes[rand() % nodes.size()];
+		astar search(*graph, s, t, "distance");
+		list<int> path = search.getPathToTarget();
+		if(path.size() < 2){
+			continue;
+		}
+		Trace trace;
+		list<int>::iterator it = path.begin();
+		Node previous = graph->getNode(*it);
+		for(it++; it != path.end(); it++){
+			Node next = graph->getNode(*it);
+			double x1 = previous.getX()/100.0, y1 = previous.getY()/100.0;
+			double x2 = next.getX()/100.0, y2 = next.getY()/100.0;
+			double theta = atan2(y2 - y1, x2 - x1);
+			int steps = max(1, (int)(sqrt((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1)) / 0.5));
+			for(int i = 0; i < steps; i++){
+				Position pose(x1 + (x2 - x1) * i / steps, y1 + (y2 - y1) * i / steps, theta);
+				trace.positions.push_back(pose);
+				trace.lasers.push_back(agentState->transformToEndpoints(pose, castScan(map, pose)));
+			}
+			previous = next;
+		}
+		traces.push_back(trace);
+	}
+	return traces;
+}
+
+// Splits a decision input recording into tasks of taskLength decisions
+vector<Trace> readTraces(string fileName, AgentState *agentState, int taskLength){
+	vector<Trace> traces;
+	DecisionInputReader reader;
+	if(!reader.open(fileName)){
+		cerr << "Could not read decision inputs from " << fileName << endl;
+		return traces;
+	}
+	semaforr::DecisionInput input;
+	Trace trace;
+	while(reader.next(input)){
+		Position pose(input.robot_x, input.robot_y, input.robot_theta);
+		trace.positions.push_back(pose);
+		trace.lasers.push_back(agentState->transformToEndpoints(pose, input.scan));
+		if(trace.positions.size() == taskLength){
+			traces.push_back(trace);
+			trace = Trace();
+		}
+	}
+	if(trace.positions.size() > 1){
+		traces.push_back(trace);
+	}
+	return traces;
+}
+
+semaforr::CrowdModel synthesizeCrowdModel(int length, int height){
+	semaforr::CrowdModel model;
+	model.resolution = 1;
+	model.width = length + 2;
+	model.height = height + 2;
+	int cells = model.width * model.height;
+	for(int i = 0; i < cells; i++){
+		model.densities.push_back(rand() / (double)RAND_MAX);
+		model.risk.push_back(rand() / (double)RAND_MAX);
+		model.up.push_back(rand() / (double)RAND_MAX);
+		model.down.push_back(rand() / (double)RAND_MAX);
+		model.left.push_back(rand() / (double)RAND_MAX);
+		model.right.push_back(rand() / (double)RAND_MAX);
+		model.up_left.push_back(rand() / (double)RAND_MAX);
+		model.up_right.push_back(rand() / (double)RAND_MAX);
+		model.down_left.push_back(rand() / (double)RAND_MAX);
+		model.down_right.push_back(rand() / (double)RAND_MAX);
+	}
+	return model;
+}
+
+void benchmarkMap(string directory, string mapName, string inputs){
+	string mapConfig = directory + "/" + mapName + "/" + mapName + "S.xml";
+	string dimensions = directory + "/" + mapName + "/dimensions.conf";
+	std::ifstream file(dimensions.c_str());
+	int length = 0, height = 0;
+	double granularity = 0;
+	string fileLine;
+	while(getline(file, fileLine)){
+		if(fileLine.size() == 0 or fileLine[0] == '#')
+			continue;
+		std::stringstream ss(fileLine);
+		ss >> length >> height >> granularity;
+	}
+	if(length == 0 or height == 0 or granularity == 0){
+		cerr << "Skipping " << mapName << ", no dimensions" << endl;
+		return;
+	}
+	srand(1);
+
+	Map *map = new Map(length*100, height*100);
+	{
+		Benchmark bench(mapName, "map_read_xml");
+		int runs = 5;
+		for(int i = 0; i < runs; i++){
+			Map loaded(length*100, height*100);
+			loaded.readMapFromXML(mapConfig);
+		}
+		bench.report(runs);
+	}
+	map->readMapFromXML(mapConfig);
+
+	{
+		Benchmark bench(mapName, "graph_construction");
+		int runs = 3;
+		for(int i = 0; i < runs; i++){
+			Graph *graph = new Graph(map, (int)(granularity*100.0));
+			delete graph;
+		}
+		bench.report(runs);
+	}
+	Graph *graph = new Graph(map, (int)(granularity*100.0));
+	vector<Node*> nodes = graph->getNodes();
+	if(nodes.size() < 2){
+		cerr << "Skipping " << mapName << ", navigation graph is empty" << endl;
+		return;
+	}
+
+	{
+		Benchmark bench(mapName, "astar_search");
+		int runs = 100;
+		for(int i = 0; i < runs; i++){
+			Node s = *nodes[rand() % nodes.size()];
+			Node t = *nodes[rand() % nodes.size()];
+			astar search(*graph, s, t, "distance");
+		}
+		bench.report(runs);
+	}
+
+	{
+		JumpPointSearch jumpSearch;
+		jumpSearch.usable(graph);
+		Benchmark bench(mapName, "jump_point_search");
+		int runs = 100;
+		for(int i = 0; i < runs; i++){
+			jumpSearch.search(graph, nodes[rand() % nodes.size()]->getID(), nodes[rand() % nodes.size()]->getID());
+		}
+		bench.report(runs);
+	}
+
+	const char *crowdPlanners[] = {"density", "risk", "flow"};
+	for(int p = 0; p < 3; p++){
+		Node n;
+		PathPlanner planner(graph, *map, n, n, crowdPlanners[p]);
+		planner.setCrowdModel(synthesizeCrowdModel(length, height));
+		Benchmark bench(mapName, string("update_nav_graph_") + crowdPlanners[p]);
+		int runs = 5;
+		for(int i = 0; i < runs; i++){
+			planner.updateNavGraph();
+		}
+		bench.report(runs);
+	}
+
+	double arrMove[] = {0, 0.1, 0.2, 0.4, 0.8, 1.6, 3.2};
+	double arrRotate[] = {0, 0.0873, 0.2618, 0.5236, 0.7854, 1.0472, 1.5708};
+	AgentState *agentState = new AgentState(arrMove, arrRotate, 7, 7);
+	agentState->setAgentStateParameters(0.005, LASER_INCREMENT, 0.2794, 0.05, LASER_RANGE_MAX, 0.1, 0.5236);
+
+	vector<CartesianPoint> laserPositions;
+	vector< vector<CartesianPoint> > laserEndpoints;
+	for(int i = 0; i < 20; i++){
+		Node *node = nodes[rand() % nodes.size()];
+		Position pose(node->getX()/100.0, node->getY()/100.0, (rand() / (double)RAND_MAX) * 2 * M_PI - M_PI);
+		laserPositions.push_back(CartesianPoint(pose.getX(), pose.getY()));
+		laserEndpoints.push_back(agentState->transformToEndpoints(pose, castScan(map, pose)));
+	}
+	vector<CartesianPoint> queries;
+	for(int i = 0; i < 1000; i++){
+		queries.push_back(CartesianPoint((rand() / (double)RAND_MAX) * length, (rand() / (double)RAND_MAX) * height));
+	}
+	{
+		Benchmark bench(mapName, "can_see_point");
+		long runs = 0;
+		for(int l = 0; l < laserPositions.size(); l++){
+			for(int q = 0; q < queries.size(); q++, runs++){
+				agentState->canSeePoint(laserEndpoints[l], laserPositions[l], queries[q], 20);
+			}
+		}
+		bench.report(runs);
+	}
+	{
+		Benchmark bench(mapName, "can_see_segment");
+		long runs = 0;
+		for(int l = 0; l < laserPositions.size(); l++){
+			for(int q = 0; q + 1 < queries.size(); q += 2, runs++){
+				agentState->canSeeSegment(laserEndpoints[l], laserPositions[l], queries[q], queries[q+1]);
+			}
+		}
+		bench.report(runs);
+	}
+
+	vector<Trace> traces;
+	if(inputs != ""){
+		traces = readTraces(inputs, agentState, 100);
+	}
+	else{
+		traces = synthesizeTraces(map, graph, agentState, 10);
+	}
+	long positions = 0;
+	for(int t = 0; t < traces.size(); t++){
+		positions += traces[t].positions.size();
+	}
+	{
+		FORRRegionList regionList;
+		vector< vector<CartesianPoint> > runTrace;
+		vector< vector< vector<CartesianPoint> > > laserTrace;
+		Benchmark bench(mapName, "learn_regions_and_exits");
+		for(int t = 0; t < traces.size(); t++){
+			vector<CartesianPoint> trace;
+			for(int i = 0; i < traces[t].positions.size(); i++){
+				trace.push_back(CartesianPoint(traces[t].positions[i].getX(), traces[t].positions[i].getY()));
+			}
+			runTrace.push_back(trace);
+			laserTrace.push_back(traces[t].lasers);
+			regionList.learnRegionsAndExits(&traces[t].positions, &traces[t].lasers, runTrace, laserTrace);
+		}
+		bench.report(positions);
+	}
+	{
+		FORRHallways hallways(length, height);
+		Benchmark bench(mapName, "learn_hallways");
+		for(int t = 0; t < traces.size(); t++){
+			vector<CartesianPoint> trace;
+			for(int i = 0; i < traces[t].positions.size(); i++){
+				trace.push_back(CartesianPoint(traces[t].positions[i].getX(), traces[t].positions[i].getY()));
+			}
+			hallways.learnHallways(agentState, trace, &traces[t].lasers);
+		}
+		bench.report(positions);
+	}
+	delete agentState;
+	delete graph;
+	delete map;
+}
+
+bool isBenchmarkMap(string name){
+	const char *prefixes[] = {"hunter-", "gradcenter-", "mcgovern-", "moma-"};
+	for(int i = 0; i < 4; i++){
+		if(name.find(prefixes[i]) == 0){
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char **argv) {
+	if(argc < 2){
+		cerr << "Usage: semaforr_bench examples_core_dir [map [decision_inputs]]" << endl;
+		return 1;
+	}
+	string directory(argv[1]);
+	vector<string> maps;
+	if(argc > 2){
+		maps.push_back(argv[2]);
+	}
+	else{
+		DIR *dir = opendir(directory.c_str());
+		if(dir == NULL){
+			cerr << "Could not open " << directory << endl;
+			return 1;
+		}
+		for(struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)){
+			string name(entry->d_name);
+			struct stat info;
+			if(isBenchmarkMap(name) and stat((directory + "/" + name + "/" + name + "S.xml").c_str(), &info) == 0){
+				maps.push_back(name);
+			}
+		}
+		closedir(dir);
+		sort(maps.begin(), maps.end());
+	}
+	string inputs = (argc > 3 ? argv[3] : "");
+	// The code under test is chatty on stdout, keep it out of the results
+	resultsBuffer = cout.rdbuf();
+	std::ofstream quiet("/dev/null");
+	for(int i = 0; i < maps.size(); i++){
+		cerr << "Benchmarking " << maps[i] << endl;
+		cout.rdbuf(quiet.rdbuf());
+		benchmarkMap(directory, maps[i], inputs);
+		cout.rdbuf(resultsBuffer);
+	}
+	return 0;
+}
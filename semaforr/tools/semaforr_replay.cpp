@@ -0,0 +1,166 @@
+/* semaforr_replay
+ * \brief Feeds a recorded decision input file (decisionInputFile in params.conf) back through the
+ * Controller as fast as possible and reports how long each stage of the decisions took.
+ *
+ * Needs neither roscore nor Menge. In open loop every decision gets the recorded pose and scan.
+ * In closed loop only the first decision does, afterwards the robot is moved to the pose its own
+ * decision is expected to reach and the previous scan is reprojected there, while the crowd still
+ * comes from the recording.
+ *
+ * With speculativeDecision on, the next decision is speculated on after each one as semaforr does while
+ * the robot moves. With speculativeCheck on as well, advice committed from a speculation is recomputed
+ * on the real sensing and the replay fails if any advisor's comments differ.
+ *
+ * Usage: semaforr_replay path target_set map_config map_dimensions advisors params inputs [open|closed]
+ * with the first six arguments as given to semaforr.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/time.h>
+
+#include "Controller.h"
+#include "FORRAction.h"
+#include "FORRActionStats.h"
+#include "DecisionInputFile.h"
+#include "Instrumentation.h"
+
+using namespace std;
+
+// Seconds spent in one stage by every replayed decision
+class StageTimes {
+	public:
+		StageTimes(string stageName) : name(stageName) {};
+
+		void add(double seconds) { samples.push_back(seconds); }
+
+		void report(){
+			if(samples.size() == 0){
+				cout << setw(12) << name << " no samples" << endl;
+				return;
+			}
+			vector<double> sorted = samples;
+			sort(sorted.begin(), sorted.end());
+			double total = 0;
+			for(int i = 0; i < sorted.size(); i++){
+				total += sorted[i];
+			}
+			cout << setw(12) << name << fixed << setprecision(6)
+				<< " total " << total
+				<< " mean " << total / sorted.size()
+				<< " median " << sorted[sorted.size() / 2]
+				<< " max " << sorted[sorted.size() - 1] << endl;
+		}
+
+	private:
+		string name;
+		vector<double> samples;
+};
+
+double getWallTimeSec(){
+	timeval tv;
+	gettimeofday(&tv,NULL);
+	return tv.tv_sec + (tv.tv_usec/1000000.0);
+}
+
+int main(int argc, char **argv) {
+	if(argc < 8){
+		cerr << "Usage: semaforr_replay path target_set map_config map_dimensions advisors params inputs [open|closed]" << endl;
+		return 1;
+	}
+	string path(argv[1]);
+	string target_set(argv[2]);
+	string map_config(argv[3]);
+	string map_dimensions(argv[4]);
+	string advisors(argv[5]);
+	string params(argv[6]);
+	string inputs(argv[7]);
+	bool closedLoop = (argc > 8 and string(argv[8]) == "closed");
+
+	DecisionInputReader reader;
+	if(!reader.open(inputs)){
+		cerr << "Could not read decision inputs from " << inputs << endl;
+		return 1;
+	}
+	Controller *controller = new Controller(path + advisors, path + params, map_config, target_set, map_dimensions);
+	AgentState *agentState = controller->getBeliefs()->getAgentState();
+
+	StageTimes crowdTimes("crowd model"), updateTimes("updateState"), decideTimes("decide"), planningTimes("planning"), learningTimes("learning"), graphingTimes("graphing"), decisionTimes("decision");
+	semaforr::DecisionInput input;
+	Position pose;
+	sensor_msgs::LaserScan scan;
+	FORRAction action;
+	int decisions = 0;
+	bool missionComplete = false;
+	double replayStart = getWallTimeSec();
+	while(reader.next(input)){
+		if(decisions == 0 or !closedLoop){
+			pose = Position(input.robot_x, input.robot_y, input.robot_theta);
+			scan = input.scan;
+		}
+		else{
+			Position next = agentState->getExpectedPositionAfterAction(action);
+			scan = agentState->predictLaserScan(pose, scan, next);
+			pose = next;
+		}
+		if(decisions > 0){
+			controller->gethighwayExploration()->setHighwaysComplete(input.overall_time);
+			controller->getfrontierExploration()->setFrontiersComplete(input.overall_time);
+		}
+		double start = getWallTimeSec();
+		if(input.crowd_model_updated){
+			semaforr::CrowdModel::ConstPtr model = boost::make_shared<semaforr::CrowdModel>(input.crowd_model);
+			controller->getPlanner()->setCrowdModel(model);
+			controller->updatePlannersModels(model);
+			agentState->setCrowdModel(model);
+		}
+		double crowdDone = getWallTimeSec();
+		controller->updateState(pose, boost::make_shared<sensor_msgs::LaserScan>(scan), boost::make_shared<geometry_msgs::PoseArray>(input.crowd_pose), boost::make_shared<geometry_msgs::PoseArray>(input.crowd_pose_all));
+		double updateDone = getWallTimeSec();
+		if(controller->isMissionComplete()){
+			missionComplete = true;
+			break;
+		}
+		action = controller->decide();
+		double decideDone = getWallTimeSec();
+
+		FORRActionStats *stats = controller->getCurrentDecisionStats();
+		crowdTimes.add(crowdDone - start);
+		updateTimes.add(updateDone - crowdDone);
+		decideTimes.add(decideDone - updateDone);
+		planningTimes.add(stats->planningComputationTime);
+		learningTimes.add(stats->learningComputationTime);
+		graphingTimes.add(stats->graphingComputationTime);
+		decisionTimes.add(decideDone - start);
+		controller->clearCurrentDecisionStats();
+		decisions++;
+		if(controller->getSpeculativeDecision()){
+			controller->speculate(action);
+		}
+	}
+	double replayTime = getWallTimeSec() - replayStart;
+
+	cout << endl << "Replayed " << decisions << " decisions " << (closedLoop ? "closed loop" : "open loop") << " in " << replayTime << " seconds, mission " << (missionComplete ? "complete" : "incomplete") << endl;
+	crowdTimes.report();
+	updateTimes.report();
+	decideTimes.report();
+	planningTimes.report();
+	learningTimes.report();
+	graphingTimes.report();
+	decisionTimes.report();
+	bool speculationDiffers = false;
+	if(controller->getSpeculativeDecision() and controller->getSpeculativeCheck()){
+		uint64_t checked = Instrumentation::instance().counter("speculation_advisors_checked")->get();
+		uint64_t mismatches = Instrumentation::instance().counter("speculation_advisor_mismatches")->get();
+		cout << "Speculation check: " << checked << " committed advisor comments, " << mismatches << " differ from the recomputed ones" << endl;
+		speculationDiffers = (mismatches > 0);
+	}
+	if(controller->getInstrumentationSummaryFile() != ""){
+		Instrumentation::instance().writeSummary(controller->getInstrumentationSummaryFile());
+		cout << "Stage latencies and counters written to " << controller->getInstrumentationSummaryFile() << endl;
+	}
+	return (speculationDiffers ? 2 : 0);
+}
@@ -23,9 +23,70 @@
 #include <ros/ros.h>
 #include <ros/console.h>
 #include <std_msgs/String.h>
+#include <semaforr/DecisionLog.h>
 
 using namespace std;
 
+// Mean and variance accumulated one value at a time (Welford), plus the plain total
+class RunningStats
+{
+public:
+	double count, total, mean, m2;
+
+	RunningStats() : count(0), total(0), mean(0), m2(0) {}
+
+	void add(double value){
+		count++;
+		total += value;
+		double delta = value - mean;
+		mean += delta / count;
+		m2 += delta * (value - mean);
+	}
+
+	// Population standard deviation, as the explanations have always used
+	double standardDeviation() const {
+		return (count > 0 ? sqrt(m2 / count) : 0);
+	}
+};
+
+// Names mapped to dense ids, remembering the ids in name order for output that iterates by name
+class NameTable
+{
+private:
+	map <string, int> ids;
+	vector <string> names;
+	vector <int> sorted;
+
+public:
+	int intern(const string &name){
+		map <string, int>::iterator itr = ids.find(name);
+		if (itr != ids.end()) {
+			return itr->second;
+		}
+		int id = names.size();
+		ids[name] = id;
+		names.push_back(name);
+		vector <int>::iterator pos = sorted.begin();
+		while (pos != sorted.end() and names[*pos] < name) {
+			pos++;
+		}
+		sorted.insert(pos, id);
+		return id;
+	}
+
+	const string &name(int id) const { return names[id]; }
+	int size() const { return names.size(); }
+	const vector <int> &inNameOrder() const { return sorted; }
+};
+
+// One tier 3 comment of the current decision
+struct Tier3Comment
+{
+	int advisor;
+	int action;
+	double strength;
+};
+
 class Explanation
 {
 private:
@@ -38,7 +99,7 @@ private:
 	//! We will be listening to \decision_log topic
 	ros::Subscriber sub_decisionLog_;
 	// Current log
-	string current_log;
+	semaforr::DecisionLog current_log;
 	// Message received
 	bool init_message_received;
 	// Actions with their associated phrases
@@ -60,18 +121,20 @@ private:
 	// Tier 3 alternate action phrase
 	vector <double> diffOverallSupportThreshold;
 	vector <string> diffOverallSupportPhrase;
-	// Stats on tier 3
-	set<string> advisors;
-	map <string, double> advisorTotal;
-	map <string, double> advisorCount;
-	map <string, double> advisorMean;
-	map <string, double> advisorStandardDeviation;
-	map <string, double> advisorTScore;
-	set<string> actions;
-	map <string, double> actionTotal;
-	map <string, double> actionCount;
-	map <string, double> actionMean;
-	map <string, double> actionStandardDeviation;
+	// Advisor names and action keys ("type" + "parameter") interned to ids, seeded from the text config
+	NameTable advisorIds;
+	NameTable actionIds;
+	// Action ids by type * 256 + parameter, so comments don't rebuild the key string
+	map <int, int> actionIdsByCode;
+	// Advisor ids for the advisor_names of the last log, reused while the names don't change
+	vector <string> logAdvisorNames;
+	vector <int> logAdvisorIds;
+	// Stats on tier 3, indexed by advisor or action id
+	vector <Tier3Comment> comments;
+	vector <RunningStats> advisorStats;
+	vector <RunningStats> actionStats;
+	vector <double> advisorTScore;
+	vector <bool> advisorHasTScore;
 	double totalCommentCount=0, totalCommentMean=0, totalCommentStdev=0;
 	double gini, overallSupport, confidenceLevel;
 	vector <double> diffTScores, diffOverallSupports;
@@ -90,9 +153,9 @@ public:
 		init_message_received = false;
 	}
 
-	void updateLog(const std_msgs::String & log){
+	void updateLog(const semaforr::DecisionLog & log){
 		init_message_received = true;
-		current_log = log.data;
+		current_log = log;
 		//ROS_INFO_STREAM("Recieved log data: " << current_log << endl);
 	}
 
@@ -112,6 +175,7 @@ public:
 				vector<string> vstrings = parseText(fileLine, '\t');
 				for(int i=1; i < vstrings.size(); i+=2){
 					actionText.insert( pair<string,string>(vstrings[i],vstrings[i+1]));
+					actionIds.intern(vstrings[i]);
 					//ROS_DEBUG_STREAM("File text:" << vstrings[i] << " " << vstrings[i+1] << endl);
 				}
 				//ROS_DEBUG_STREAM("File text:" << vstrings[0]);
@@ -129,6 +193,7 @@ public:
 				vector<string> vstrings = parseText(fileLine, '\t');
 				for(int i=1; i < vstrings.size(); i+=2){
 					advSupportRationales.insert( pair<string,string>(vstrings[i],vstrings[i+1]));
+					advisorIds.intern(vstrings[i]);
 					//ROS_DEBUG_STREAM("File text:" << vstrings[i] << " " << vstrings[i+1] << endl);
 				}
 			}
@@ -191,8 +256,8 @@ public:
 	
 	void run(){
 		std_msgs::String explanationString;
-		string vetoedActions, chosenAction, advisorComments;
-		vector<string> currentPlan;
+		string chosenAction;
+		int chosenActionId;
 		ros::Rate rate(30.0);
 		timeval cv;
 		double start_timecv, end_timecv;
@@ -206,27 +271,22 @@ public:
 			}
 			gettimeofday(&cv,NULL);
 			start_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
-			//target = "(" + parseText(current_log, '\t')[4] + ", " + parseText(current_log, '\t')[5] + ")";
-			decisionTier = atof(parseText(current_log, '\t')[10].c_str());
-			vetoedActions = parseText(current_log, '\t')[11];
-			chosenAction = parseText(current_log, '\t')[12]+parseText(current_log, '\t')[13];
-			advisorComments = parseText(current_log, '\t')[15];
-			currentPlan = parseText(parseText(current_log, '\t')[16], ';');
-			// ROS_INFO_STREAM(decisionTier << " " << vetoedActions << " " << chosenAction << " " << advisorComments << endl << endl);
+			decisionTier = current_log.decision_tier;
+			chosenActionId = actionId(current_log.action_type, current_log.action_parameter);
+			chosenAction = actionIds.name(chosenActionId);
+			readTier3Comments();
+			// ROS_INFO_STREAM(decisionTier << " " << chosenAction << " " << comments.size() << endl << endl);
+			// Vetoes as [type, parameter, tier 1 tag]
 			vector< vector <string> > vetoes;
-			stringstream ss;
-			ss.str(vetoedActions);
-			string item;
-			char delim = ';';
-			while (getline(ss, item, delim)) {
+			for(int i = 0; i < current_log.veto_type.size(); i++){
 				vector<string> vstrings;
 				stringstream st;
-				st.str(item);
-				string sitem;
-				char sdelim = ' ';
-				while (getline(st, sitem, sdelim)) {
-					vstrings.push_back(sitem);
-				}
+				st << (int)current_log.veto_type[i];
+				vstrings.push_back(st.str());
+				st.str("");
+				st << (int)current_log.veto_parameter[i];
+				vstrings.push_back(st.str());
+				vstrings.push_back(string("1") + (char)current_log.veto_source[i]);
 				vetoes.push_back(vstrings);
 			}
 			int numMovesVetoed = 0;
@@ -269,17 +329,20 @@ public:
 			else if (decisionTier == 1.8){
 				explanationString.data = "I want to find the boundaries of our world and " + actioningText[chosenAction] + " would let find them.\n" + "Somewhat confident, because I am not sure if I will need to know about these boundaries later.\n" + alternateActions(chosenAction, decisionTier, vetoes);
 			}
+			else if (decisionTier == 1.9){
+				explanationString.data = "I ran out of time to weigh my options, so I am " + actioningText[chosenAction] + " to head for our waypoint.\n" + "Not confident, since I did not get to hear from all of my advisors.\n" + vetoedAlternateActions(vetoes, chosenAction);
+			}
 			else if (numMovesVetoed == 6 and numRotationsVetoed == 12 and chosenAction == "30") {
 				//ROS_DEBUG(vetoedActions << endl);
 				decisionTier = 1;
 				explanationString.data = "I decided to " + actionText[chosenAction] + " because I want to think more about what to do.\n" + "Not confident, since I don't know what else to do right now.\n" + vetoedAlternateActions(vetoes, chosenAction);
 			}
 			else {
-				parseTier3Comments(advisorComments);
-				advisorTScore = computeTier3TScores(advisorComments, chosenAction);
-				computeConfidence(chosenAction);
-				explanationString.data = tier3Explanation(chosenAction) + "\n" + confidenceExplanation() + "\n" + vetoedAlternateActions(vetoes, chosenAction) + "\n" + tier3AlternateActions(advisorComments, chosenAction);
-				if(currentPlan.size() > 1){
+				accumulateTier3Stats();
+				computeTier3TScores(chosenActionId, advisorTScore, advisorHasTScore);
+				computeConfidence(chosenActionId);
+				explanationString.data = tier3Explanation(chosenAction) + "\n" + confidenceExplanation() + "\n" + vetoedAlternateActions(vetoes, chosenAction) + "\n" + tier3AlternateActions(chosenActionId);
+				if(current_log.plan_waypoints.size() > 0){
 					string from = "target";
 					string to = "waypoint";
 					int start_pos = 0;
@@ -305,111 +368,53 @@ public:
 		}
 	}
 
-	void parseTier3Comments(string advisorComments) {
-		stringstream ss1;
-		ss1.str(advisorComments);
-		string item, val;
-		char delim = ';';
-		while (getline(ss1, item, delim)) {
-			stringstream subss;
-			subss.str(item);
-			char delim2 = ' ';
-			vector<string> vstrings;
-			while (getline(subss, val, delim2)) {
-				vstrings.push_back(val);
-			}
-			string action = (vstrings[1]+vstrings[2]);
-			if (advisorTotal.find(vstrings[0]) == advisorTotal.end()) {
-				advisorTotal[vstrings[0]] = atof(vstrings[3].c_str());
-			} else {
-				advisorTotal[vstrings[0]] = advisorTotal[vstrings[0]] + atof(vstrings[3].c_str());
-			}
-			if (advisorCount.find(vstrings[0]) == advisorCount.end()) {
-				advisorCount[vstrings[0]] = 1;
-			} else {
-				advisorCount[vstrings[0]] = advisorCount[vstrings[0]] + 1;
-			}
-			advisors.insert(vstrings[0]);
-			if (actionTotal.find(action) == actionTotal.end()) {
-				actionTotal[action] = atof(vstrings[3].c_str());
-			} else {
-				actionTotal[action] = actionTotal[action] + atof(vstrings[3].c_str());
-			}
-			if (actionCount.find(action) == actionCount.end()) {
-				actionCount[action] = 1;
-			} else {
-				actionCount[action] = actionCount[action] + 1;
-			}
-			actions.insert(action);
-			//ROS_INFO_STREAM(vstrings[0] << " " << action << " " << vstrings[3] << ";");
-			vstrings.clear();
-		}
-		set<string>::iterator adv, act;
-		for (adv = advisors.begin(); adv != advisors.end(); adv++) {
-			advisorMean[*adv] = (advisorTotal[*adv] / advisorCount[*adv]);
-		}
-		for (act = actions.begin(); act != actions.end(); act++) {
-			actionMean[*act] = (actionTotal[*act] / actionCount[*act]);
-		}
-
-		stringstream ss2;
-		ss2.str(advisorComments);
-		while (getline(ss2, item, delim)) {
-			stringstream subss;
-			subss.str(item);
-			char delim2 = ' ';
-			vector<string> vstrings;
-			while (getline(subss, val, delim2)) {
-				vstrings.push_back(val);
-			}
-			string action = (vstrings[1]+vstrings[2]);
-			if (advisorStandardDeviation.find(vstrings[0]) == advisorStandardDeviation.end()) {
-				advisorStandardDeviation[vstrings[0]] = pow((atof(vstrings[3].c_str()) - advisorMean[vstrings[0]]), 2);
-			} else {
-				advisorStandardDeviation[vstrings[0]] = advisorStandardDeviation[vstrings[0]] + pow((atof(vstrings[3].c_str()) - advisorMean[vstrings[0]]), 2);
-			}
-			
-			if (actionStandardDeviation.find(action) == actionStandardDeviation.end()) {
-				actionStandardDeviation[action] = pow((atof(vstrings[3].c_str()) - actionMean[action]), 2);
-			} else {
-				actionStandardDeviation[action] = actionStandardDeviation[action] + pow((atof(vstrings[3].c_str()) - actionMean[action]), 2);
-			}
-			vstrings.clear();
-		}
-		for (adv = advisors.begin(); adv != advisors.end(); adv++) {
-			advisorStandardDeviation[*adv] = sqrt(advisorStandardDeviation[*adv] / advisorCount[*adv]);
-		}
-		for (act = actions.begin(); act != actions.end(); act++) {
-			actionStandardDeviation[*act] = sqrt(actionStandardDeviation[*act] / actionCount[*act]);
+	// Copies the tier 3 comments of the current log with interned advisor and action ids
+	void readTier3Comments() {
+		if (current_log.advisor_names != logAdvisorNames) {
+			logAdvisorNames = current_log.advisor_names;
+			logAdvisorIds.clear();
+			for (int i = 0; i < logAdvisorNames.size(); i++) {
+				logAdvisorIds.push_back(advisorIds.intern(logAdvisorNames[i]));
+			}
+		}
+		comments.clear();
+		for (int i = 0; i < current_log.comment_advisor.size(); i++) {
+			Tier3Comment comment;
+			comment.advisor = logAdvisorIds[current_log.comment_advisor[i]];
+			comment.action = actionId(current_log.comment_type[i], current_log.comment_parameter[i]);
+			comment.strength = current_log.comment_strength[i];
+			comments.push_back(comment);
 		}
 	}
 
-	map <string, double> computeTier3TScores(string advisorComments, string chosenAction) {
-		map <string, double> tScores;
-		stringstream ss1;
-		ss1.str(advisorComments);
-		string item, val;
-		char delim = ';';
-		while (getline(ss1, item, delim)) {
-			stringstream subss;
-			subss.str(item);
-			char delim2 = ' ';
-			vector<string> vstrings;
-			while (getline(subss, val, delim2)) {
-				vstrings.push_back(val);
-			}
-			string action = (vstrings[1]+vstrings[2]);
-			if (action == chosenAction) {
-				if (advisorStandardDeviation[vstrings[0]] != 0) {
-					tScores[vstrings[0]] = ((atof(vstrings[3].c_str()) - advisorMean[vstrings[0]]) / advisorStandardDeviation[vstrings[0]]);
-					//ROS_INFO_STREAM(vstrings[0] << " " << action << ": " << vstrings[3] << ", mean: " << advisorMean[vstrings[0]] << ", stdev: " << advisorStandardDeviation[vstrings[0]] << ", t score: " << (atof(vstrings[3].c_str()) - advisorMean[vstrings[0]]) / advisorStandardDeviation[vstrings[0]]);
+	// One pass over the comments gives each advisor's and each action's total, mean and standard deviation
+	void accumulateTier3Stats() {
+		advisorStats.assign(advisorIds.size(), RunningStats());
+		actionStats.assign(actionIds.size(), RunningStats());
+		for (int i = 0; i < comments.size(); i++) {
+			advisorStats[comments[i].advisor].add(comments[i].strength);
+			actionStats[comments[i].action].add(comments[i].strength);
+			//ROS_INFO_STREAM(advisorIds.name(comments[i].advisor) << " " << actionIds.name(comments[i].action) << " " << comments[i].strength << ";");
+		}
+	}
+
+	// t-score of each advisor's comment on the action, against that advisor's comments on all actions
+	void computeTier3TScores(int action, vector <double> &tScores, vector <bool> &hasTScore) {
+		tScores.assign(advisorIds.size(), 0);
+		hasTScore.assign(advisorIds.size(), false);
+		for (int i = 0; i < comments.size(); i++) {
+			if (comments[i].action == action) {
+				const RunningStats &stats = advisorStats[comments[i].advisor];
+				double standardDeviation = stats.standardDeviation();
+				if (standardDeviation != 0) {
+					tScores[comments[i].advisor] = ((comments[i].strength - stats.mean) / standardDeviation);
+					//ROS_INFO_STREAM(advisorIds.name(comments[i].advisor) << " " << actionIds.name(action) << ": " << comments[i].strength << ", mean: " << stats.mean << ", stdev: " << standardDeviation);
 				} else {
-					tScores[vstrings[0]] = 0;
+					tScores[comments[i].advisor] = 0;
 				}
+				hasTScore[comments[i].advisor] = true;
 			}
-			vstrings.clear();
 		}
-		return tScores;
 	}
 
 	string tier3TScoretoPhrase(double tscore) {
@@ -428,48 +433,52 @@ public:
 		vector<string> supportPhrases, slightSupportPhrases;
 		vector<string> opposePhrases, slightOpposePhrases;
 		
-		map <string, double>::iterator itr;
-		//ROS_INFO_STREAM(advisorTScore.size());
-		for (itr = advisorTScore.begin(); itr != advisorTScore.end(); itr++) {
-			if (itr->second > (1.5)) {
+		const vector <int> &advisorOrder = advisorIds.inNameOrder();
+		for (int k = 0; k < advisorOrder.size(); k++) {
+			if (!advisorHasTScore[advisorOrder[k]]) {
+				continue;
+			}
+			const string &advisor = advisorIds.name(advisorOrder[k]);
+			double tScore = advisorTScore[advisorOrder[k]];
+			if (tScore > (1.5)) {
 				if(supportPhrases.size() == 0){
-					supportPhrases.push_back("I " + tier3TScoretoPhrase(itr->second) + " to " + advSupportRationales[itr->first]);
+					supportPhrases.push_back("I " + tier3TScoretoPhrase(tScore) + " to " + advSupportRationales[advisor]);
 				}
 				else{
-					supportPhrases.push_back(advSupportRationales[itr->first]);
+					supportPhrases.push_back(advSupportRationales[advisor]);
 				}
-				//ROS_INFO_STREAM(itr->first << ": " << itr->second);
-				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(itr->second) + " to " + advSupportRationales[itr->first]);
+				//ROS_INFO_STREAM(advisor << ": " << tScore);
+				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(tScore) + " to " + advSupportRationales[advisor]);
 			}
-			else if (itr->second > (0.75)) {
+			else if (tScore > (0.75)) {
 				if(slightSupportPhrases.size() == 0){
-					slightSupportPhrases.push_back("I " + tier3TScoretoPhrase(itr->second) + " to " + advSupportRationales[itr->first]);
+					slightSupportPhrases.push_back("I " + tier3TScoretoPhrase(tScore) + " to " + advSupportRationales[advisor]);
 				}
 				else{
-					slightSupportPhrases.push_back(advSupportRationales[itr->first]);
+					slightSupportPhrases.push_back(advSupportRationales[advisor]);
 				}
-				//ROS_INFO_STREAM(itr->first << ": " << itr->second);
-				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(itr->second) + " to " + advSupportRationales[itr->first]);
+				//ROS_INFO_STREAM(advisor << ": " << tScore);
+				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(tScore) + " to " + advSupportRationales[advisor]);
 			}
-			else if (itr->second > (-1.5) and itr->second <= (-0.75)) {
+			else if (tScore > (-1.5) and tScore <= (-0.75)) {
 				if(slightOpposePhrases.size() == 0){
-					slightOpposePhrases.push_back("I " + tier3TScoretoPhrase(itr->second) + " to " + advOpposeRationales[itr->first]);
+					slightOpposePhrases.push_back("I " + tier3TScoretoPhrase(tScore) + " to " + advOpposeRationales[advisor]);
 				}
 				else{
-					slightOpposePhrases.push_back(advOpposeRationales[itr->first]);
+					slightOpposePhrases.push_back(advOpposeRationales[advisor]);
 				}
-				//ROS_INFO_STREAM(itr->first << ": " << itr->second);
-				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(itr->second) + " to " + advOpposeRationales[itr->first]);
+				//ROS_INFO_STREAM(advisor << ": " << tScore);
+				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(tScore) + " to " + advOpposeRationales[advisor]);
 			}
-			else if (itr->second <= (-1.5)){
+			else if (tScore <= (-1.5)){
 				if(opposePhrases.size() == 0){
-					opposePhrases.push_back("I " + tier3TScoretoPhrase(itr->second) + " to " + advOpposeRationales[itr->first]);
+					opposePhrases.push_back("I " + tier3TScoretoPhrase(tScore) + " to " + advOpposeRationales[advisor]);
 				}
 				else{
-					opposePhrases.push_back(advOpposeRationales[itr->first]);
+					opposePhrases.push_back(advOpposeRationales[advisor]);
 				}
-				//ROS_INFO_STREAM(itr->first << ": " << itr->second);
-				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(itr->second) + " to " + advOpposeRationales[itr->first]);
+				//ROS_INFO_STREAM(advisor << ": " << tScore);
+				//ROS_INFO_STREAM("I " + tier3TScoretoPhrase(tScore) + " to " + advOpposeRationales[advisor]);
 			}
 		}
 		
@@ -560,21 +569,27 @@ public:
 		return explanation + "\n";
 	}
 	
-	void computeConfidence(string chosenAction) {
-		gini = 2 * (actionTotal[chosenAction]/(10*actionCount[chosenAction])) * (1 - (actionTotal[chosenAction]/(10*actionCount[chosenAction])));
-		//ROS_INFO_STREAM(actionTotal[chosenAction] << " " << actionCount[chosenAction] << " " << gini);
-		map <string, double>::iterator itr;
-		for (itr = actionTotal.begin(); itr != actionTotal.end(); itr++) {
-			totalCommentMean += itr->second;
-			totalCommentCount++;
-		}
-		totalCommentMean = totalCommentMean / totalCommentCount;
-		for (itr = actionTotal.begin(); itr != actionTotal.end(); itr++) {
-			totalCommentStdev += pow((itr->second - totalCommentMean), 2);
-		}
-		totalCommentStdev = sqrt(totalCommentStdev / totalCommentCount);
+	// Actions that were commented on, and the chosen one even without comments
+	bool actionConsidered(int action, int chosenAction) {
+		return (actionStats[action].count > 0 or action == chosenAction);
+	}
+
+	void computeConfidence(int chosenAction) {
+		const RunningStats &chosen = actionStats[chosenAction];
+		gini = 2 * (chosen.total/(10*chosen.count)) * (1 - (chosen.total/(10*chosen.count)));
+		//ROS_INFO_STREAM(chosen.total << " " << chosen.count << " " << gini);
+		RunningStats actionTotals;
+		const vector <int> &actionOrder = actionIds.inNameOrder();
+		for (int k = 0; k < actionOrder.size(); k++) {
+			if (actionConsidered(actionOrder[k], chosenAction)) {
+				actionTotals.add(actionStats[actionOrder[k]].total);
+			}
+		}
+		totalCommentCount = actionTotals.count;
+		totalCommentMean = actionTotals.mean;
+		totalCommentStdev = actionTotals.standardDeviation();
 		if (totalCommentStdev != 0) {
-			overallSupport = (actionTotal[chosenAction] - totalCommentMean)/totalCommentStdev;
+			overallSupport = (chosen.total - totalCommentMean)/totalCommentStdev;
 		}
 		else {
 			overallSupport = 0;
@@ -718,16 +733,22 @@ public:
 		return alternateExplanations;
 	}
 	
-	string tier3AlternateActions(string advisorComments, string chosenAction) {
+	string tier3AlternateActions(int chosenActionId) {
 		string alternateExplanations;
-		map <string, double>::iterator atr;
-		for (atr = actionTotal.begin(); atr != actionTotal.end(); atr++) {
+		const string &chosenAction = actionIds.name(chosenActionId);
+		const vector <int> &actionOrder = actionIds.inNameOrder();
+		const vector <int> &advisorOrder = advisorIds.inNameOrder();
+		vector <double> alternateTScores;
+		vector <bool> alternateHasTScore;
+		for (int k = 0; k < actionOrder.size(); k++) {
 			string supportConcat, opposeConcat, phraseDiffOverallSupport;
 			vector<string> supportPhrases, opposePhrases;
-			if (atr->first != chosenAction) {
+			int alternate = actionOrder[k];
+			if (actionConsidered(alternate, chosenActionId) and alternate != chosenActionId) {
+				const string &alternateAction = actionIds.name(alternate);
 				double diffOverallSupport;
 				if (totalCommentStdev != 0) {
-					diffOverallSupport = overallSupport - ((actionTotal[atr->first] - totalCommentMean)/totalCommentStdev);
+					diffOverallSupport = overallSupport - ((actionStats[alternate].total - totalCommentMean)/totalCommentStdev);
 				}
 				else {
 					diffOverallSupport = 0;
@@ -742,16 +763,20 @@ public:
 				//ROS_INFO_STREAM(phraseDiffOverallSupport);
 				diffOverallSupports.push_back(diffOverallSupport);
 				
-				map <string, double> alternateTScores = computeTier3TScores(advisorComments, atr->first);
-				map <string, double>::iterator itr;
-				for (itr = advisorTScore.begin(); itr != advisorTScore.end(); itr++) {
-					if ((itr->second - alternateTScores[itr->first]) > 1) {
-						supportPhrases.push_back(advSupportRationales[itr->first]);
+				computeTier3TScores(alternate, alternateTScores, alternateHasTScore);
+				for (int a = 0; a < advisorOrder.size(); a++) {
+					int advisor = advisorOrder[a];
+					if (!advisorHasTScore[advisor]) {
+						continue;
+					}
+					double diffTScore = advisorTScore[advisor] - alternateTScores[advisor];
+					if (diffTScore > 1) {
+						supportPhrases.push_back(advSupportRationales[advisorIds.name(advisor)]);
 					}
-					else if ((itr->second - alternateTScores[itr->first]) < -1) {
-						opposePhrases.push_back(advSupportRationales[itr->first]);
+					else if (diffTScore < -1) {
+						opposePhrases.push_back(advSupportRationales[advisorIds.name(advisor)]);
 					}
-					diffTScores.push_back((itr->second - alternateTScores[itr->first]));
+					diffTScores.push_back(diffTScore);
 				}
 				
 				if (supportPhrases.size() > 2) {
@@ -782,16 +807,16 @@ public:
 				
 				
 				if (supportPhrases.size() > 0 and opposePhrases.size() > 0) {
-					alternateExplanations = alternateExplanations + "I thought about " + actioningText[atr->first] + " because it would let us " + opposeConcat + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + " since it lets us " + supportConcat + ".\n";
+					alternateExplanations = alternateExplanations + "I thought about " + actioningText[alternateAction] + " because it would let us " + opposeConcat + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + " since it lets us " + supportConcat + ".\n";
 				}
 				else if (supportPhrases.size() > 0 and opposePhrases.size() == 0) {
-					alternateExplanations = alternateExplanations + "I thought about " + actioningText[atr->first] + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + " since it lets us " + supportConcat + ".\n";
+					alternateExplanations = alternateExplanations + "I thought about " + actioningText[alternateAction] + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + " since it lets us " + supportConcat + ".\n";
 				}
 				else if (supportPhrases.size() == 0 and opposePhrases.size() > 0) {
-					alternateExplanations = alternateExplanations + "I thought about it because " + actioningText[atr->first] + " would let us " + opposeConcat + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + ".\n";
+					alternateExplanations = alternateExplanations + "I thought about it because " + actioningText[alternateAction] + " would let us " + opposeConcat + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + ".\n";
 				}
 				else if (supportPhrases.size() == 0 and opposePhrases.size() == 0) {
-					alternateExplanations = alternateExplanations + "I thought about " + actioningText[atr->first] + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + ".\n";
+					alternateExplanations = alternateExplanations + "I thought about " + actioningText[alternateAction] + ", but I felt " + phraseDiffOverallSupport + " strongly about " + actioningText[chosenAction] + ".\n";
 				}
 				//ROS_INFO_STREAM(alternateExplanations);
 			}
@@ -800,6 +825,23 @@ public:
 		return alternateExplanations;
 	}
 
+	string actionKey(int type, int parameter){
+		stringstream ss;
+		ss << type << parameter;
+		return ss.str();
+	}
+
+	int actionId(int type, int parameter){
+		int code = type * 256 + parameter;
+		map <int, int>::iterator itr = actionIdsByCode.find(code);
+		if (itr != actionIdsByCode.end()) {
+			return itr->second;
+		}
+		int id = actionIds.intern(actionKey(type, parameter));
+		actionIdsByCode[code] = id;
+		return id;
+	}
+
 	vector<string> parseText(string text, char delim){
 		vector<string> vstrings;
 		stringstream ss;
@@ -818,17 +860,11 @@ public:
 	}
 	
 	void clearStats() {
-		advisors.clear();
-		advisorTotal.clear();
-		advisorCount.clear();
-		advisorMean.clear();
-		advisorStandardDeviation.clear();
+		comments.clear();
+		advisorStats.clear();
+		actionStats.clear();
 		advisorTScore.clear();
-		actions.clear();
-		actionTotal.clear();
-		actionCount.clear();
-		actionMean.clear();
-		actionStandardDeviation.clear();
+		advisorHasTScore.clear();
 		diffTScores.clear();
 		diffOverallSupports.clear();
 		
@@ -840,12 +876,13 @@ public:
 	
 	void logExplanationData() {
 		std_msgs::String logData;
-		vector<string> vstrings = parseText(current_log, '\t');
 
 		stringstream tscorestream;
-		map <string, double>::iterator itr;
-		for (itr = advisorTScore.begin(); itr != advisorTScore.end(); itr++) {
-			tscorestream << itr->second << " ";
+		const vector <int> &advisorOrder = advisorIds.inNameOrder();
+		for (int k = 0; k < advisorOrder.size(); k++) {
+			if (advisorOrder[k] < advisorHasTScore.size() and advisorHasTScore[advisorOrder[k]]) {
+				tscorestream << advisorTScore[advisorOrder[k]] << " ";
+			}
 		}
 		
 		stringstream difftscoresstream;
@@ -859,7 +896,7 @@ public:
 		}
 		
 		stringstream output;
-		output << atof(vstrings[0].c_str()) << "\t" << atof(vstrings[1].c_str()) << "\t" << atof(vstrings[2].c_str()) << "\t" << decisionTier << "\t" << computationTimeSec << "\t" << tscorestream.str() << "\t" << gini << "\t" << overallSupport << "\t" << confidenceLevel << "\t" << difftscoresstream.str() << "\t" << diffoverallsupportsstream.str();
+		output << current_log.task << "\t" << current_log.decision_count << "\t" << current_log.overall_time << "\t" << decisionTier << "\t" << computationTimeSec << "\t" << tscorestream.str() << "\t" << gini << "\t" << overallSupport << "\t" << confidenceLevel << "\t" << difftscoresstream.str() << "\t" << diffoverallsupportsstream.str();
 		
 		logData.data = output.str();
 		explanations_log_pub_.publish(logData);
@@ -18,6 +18,7 @@
 #include <map>
 #include <algorithm>
 #include <cmath>        //for atan2 and M_PI
+#include <limits>
 #include <sys/time.h>
 #include <nav_msgs/Path.h>
 #include <nav_msgs/OccupancyGrid.h>
@@ -26,9 +27,118 @@
 #include <ros/ros.h>
 #include <ros/console.h>
 #include <std_msgs/String.h>
+#include <semaforr/DecisionLog.h>
 
 using namespace std;
 
+// Crowd density or risk grid with running sums along each row, so a plan is scored by walking its
+// polyline through the grid (DDA) and adding up whole runs of cells in a row at a time
+class CrowdGrid
+{
+private:
+	int width, height;
+	double resolution;
+	// (width + 1) sums per row, rowSums[row * (width + 1) + x] is the sum of cells 0..x-1 in the row
+	vector<long> rowSums;
+
+	long runSum(int row, int first_x, int last_x) const {
+		const long *sums = &rowSums[row * (width + 1)];
+		return sums[last_x + 1] - sums[first_x];
+	}
+
+	// Grid coordinate of a map coordinate, clamped inside the grid
+	double toGrid(double value, int cells) const {
+		double cell = value / resolution;
+		if(cell < 0) cell = 0;
+		if(cell > cells - 1e-6) cell = cells - 1e-6;
+		return cell;
+	}
+
+	// Adds the cells the segment passes through, in runs along each row. The first cell is
+	// skipped when it was already counted as the end of the previous segment.
+	long segmentSum(double x0, double y0, double x1, double y1, bool skipFirst) const {
+		double fx0 = toGrid(x0, width), fy0 = toGrid(y0, height);
+		double fx1 = toGrid(x1, width), fy1 = toGrid(y1, height);
+		int cx = (int)fx0, cy = (int)fy0;
+		int ex = (int)fx1, ey = (int)fy1;
+		int stepX = (ex > cx ? 1 : -1), stepY = (ey > cy ? 1 : -1);
+		double dx = fabs(fx1 - fx0), dy = fabs(fy1 - fy0);
+		double inf = numeric_limits<double>::infinity();
+		double tDeltaX = (dx > 0 ? 1.0 / dx : inf), tDeltaY = (dy > 0 ? 1.0 / dy : inf);
+		double tMaxX = (dx > 0 ? (stepX > 0 ? (cx + 1 - fx0) : (fx0 - cx)) * tDeltaX : inf);
+		double tMaxY = (dy > 0 ? (stepY > 0 ? (cy + 1 - fy0) : (fy0 - cy)) * tDeltaY : inf);
+		int steps = abs(ex - cx) + abs(ey - cy);
+
+		long sum = 0;
+		int runRow = cy, runMin = cx, runMax = cx;
+		bool runOpen = !skipFirst;
+		for(int i = 0; i < steps; i++){
+			// Exactly |ex - cx| + |ey - cy| steps, so rounding can't walk past the end cell
+			if(cx != ex and (cy == ey or tMaxX < tMaxY)){
+				cx += stepX;
+				tMaxX += tDeltaX;
+			}
+			else{
+				cy += stepY;
+				tMaxY += tDeltaY;
+			}
+			if(runOpen and cy == runRow){
+				runMin = min(runMin, cx);
+				runMax = max(runMax, cx);
+				continue;
+			}
+			if(runOpen){
+				sum += runSum(runRow, runMin, runMax);
+			}
+			runOpen = true;
+			runRow = cy;
+			runMin = runMax = cx;
+		}
+		if(runOpen){
+			sum += runSum(runRow, runMin, runMax);
+		}
+		return sum;
+	}
+
+public:
+	CrowdGrid() : width(0), height(0), resolution(1) {}
+
+	void build(const nav_msgs::OccupancyGrid &grid){
+		width = grid.info.width;
+		height = grid.info.height;
+		resolution = (grid.info.resolution > 0 ? grid.info.resolution : 1);
+		rowSums.assign(height * (width + 1), 0);
+		for(int y = 0; y < height; y++){
+			long *sums = &rowSums[y * (width + 1)];
+			for(int x = 0; x < width; x++){
+				sums[x + 1] = sums[x] + (int)(unsigned char)grid.data[y * width + x];
+			}
+		}
+	}
+
+	bool empty() const { return width == 0 or height == 0; }
+
+	// Sum of the cells along each plan's polyline, every plan scored in one call
+	vector<double> planSums(const vector< const vector< vector<double> > * > &plans) const {
+		vector<double> sums(plans.size(), 0);
+		if(empty()){
+			return sums;
+		}
+		for(int p = 0; p < plans.size(); p++){
+			const vector< vector<double> > &plan = *plans[p];
+			long sum = 0;
+			if(plan.size() == 1){
+				sum = segmentSum(plan[0][0], plan[0][1], plan[0][0], plan[0][1], false);
+			}
+			for(int i = 0; i + 1 < plan.size(); i++){
+				sum += segmentSum(plan[i][0], plan[i][1], plan[i+1][0], plan[i+1][1], i > 0);
+			}
+			sums[p] = sum;
+		}
+		return sums;
+	}
+};
+
 class Explanation
 {
 private:
@@ -45,11 +155,11 @@ private:
 	// ros::Subscriber sub_plan_;
 	// ros::Subscriber sub_original_plan_;
 	// Current log
-	string current_log;
+	semaforr::DecisionLog current_log;
 	// Current crowd density
-	nav_msgs::OccupancyGrid current_crowd_density;
+	CrowdGrid current_crowd_density;
 	// Current crowd risk
-	nav_msgs::OccupancyGrid current_crowd_risk;
+	CrowdGrid current_crowd_risk;
 	// Current plans
 	// nav_msgs::Path current_plan;
 	// nav_msgs::Path current_original_plan;
@@ -134,24 +244,22 @@ public:
 		// orig_plan_message_received = false;
 	}
 
-	void updateLog(const std_msgs::String & log){
-		if(parseText(log.data, '\t')[25].length() > 1){
+	void updateLog(const semaforr::DecisionLog & log){
+		if(log.chosen_planner.length() > 1){
 			log_message_received = true;
-			current_log = log.data;
+			current_log = log;
 			//ROS_INFO_STREAM("Recieved log data: " << current_log << endl);
 		}
 	}
 
 	void updateCrowdDensity(const nav_msgs::OccupancyGrid & crowd_density){
 		density_message_received = true;
-		current_crowd_density = crowd_density;
-		//ROS_INFO_STREAM("Recieved crowd density data: " << current_crowd_density << endl);
+		current_crowd_density.build(crowd_density);
 	}
 
 	void updateCrowdRisk(const nav_msgs::OccupancyGrid & crowd_risk){
 		risk_message_received = true;
-		current_crowd_risk = crowd_risk;
-		//ROS_INFO_STREAM("Recieved crowd density data: " << current_crowd_risk << endl);
+		current_crowd_risk.build(crowd_risk);
 	}
 
 	// void updatePlan(const nav_msgs::Path & plan){
@@ -335,21 +443,20 @@ public:
 			ROS_INFO_STREAM("Messages received");
 			gettimeofday(&cv,NULL);
 			start_timecv = cv.tv_sec + (cv.tv_usec/1000000.0);
-			vector<string> parsed_log = parseText(current_log, '\t');
-			cout << "current decision " << parsed_log[0] << " " << parsed_log[1] << endl;
-			targetX = atof(parsed_log[4].c_str());
-			targetY = atof(parsed_log[5].c_str());
-			robotX = atof(parsed_log[6].c_str());
-			robotY = atof(parsed_log[7].c_str());
-			cout << "planners " << parsed_log[25] << endl;
-			selected_planner = parseText(parsed_log[25], '>')[0];
-			alternative_planners = parseText(parsed_log[25], '>');
+			cout << "current decision " << current_log.task << " " << current_log.decision_count << endl;
+			targetX = current_log.target_x;
+			targetY = current_log.target_y;
+			robotX = current_log.robot_x;
+			robotY = current_log.robot_y;
+			cout << "planners " << current_log.chosen_planner << endl;
+			selected_planner = parseText(current_log.chosen_planner, '>')[0];
+			alternative_planners = parseText(current_log.chosen_planner, '>');
 			for(int i = 0; i < alternative_planners.size(); i++){
 				cout << alternative_planners[i] << endl;
 			}
 			alternative_planners.erase(alternative_planners.begin());
 			alt_planner = alternative_planners[0];
-			savePlanCosts(parsed_log);
+			savePlanCosts();
 			if(selected_planner != "hallwayskel" and selected_planner != "skeletonhall"){
 				alt_planner = "distance";
 			}
@@ -361,8 +468,9 @@ public:
 			//ROS_INFO_STREAM("Before compute plan distances");
 			//computePlanDistances();
 			//ROS_INFO_STREAM("Before compute plan densities");
-			//computePlanDensities();
-			//computePlanRisks();
+			// Zero for a grid that has not arrived yet, so the plans then compare as before
+			computePlanDensities();
+			computePlanRisks();
 			//ROS_INFO_STREAM("Before compare plans");
 			if(selected_planner == "distance"){
 				explanationString.data = "I decided to go this way because I agree that we should take the shortest route.\nActually, I agree that we should take the shortest route.\nYour way is the best way to go.\nI'm really sure because this is the shortest way.";
@@ -740,12 +848,10 @@ public:
 	// 	//ROS_INFO_STREAM("Final orig plan distance: " << originalPlanDistance);
 	// }
 
-	void savePlanCosts(vector<string> parsed_log){
+	void savePlanCosts(){
 		ROS_INFO_STREAM("Inside save plan costs");
-		cout << "Plan text " << parsed_log[16] << endl;
-		vector<string> vstrings1 = parseText(parsed_log[16], ';');
-		planCost = atof(parseText(vstrings1[0], ' ')[0].c_str()) / 100.0; // cost is for selected plan
-		planDistance = atof(parseText(vstrings1[0], ' ')[1].c_str()) / 100.0; // distance is for alternative plan
+		planCost = current_log.plan_path_costs[0] / 100.0; // cost is for selected plan
+		planDistance = current_log.plan_path_costs[1] / 100.0; // distance is for alternative plan
 		ROS_INFO_STREAM("Plan cost: " << planCost << " Plan distance = " << planDistance);
 		vector<double> robot_point;
 		robot_point.push_back(robotX);
@@ -754,118 +860,66 @@ public:
 		target_point.push_back(targetX);
 		target_point.push_back(targetY);
 		current_plan.push_back(robot_point);
-		for(int i = 1; i < vstrings1.size(); i++){
+		for(int i = 0; i+1 < current_log.plan_waypoints.size(); i += 2){
 			vector<double> point;
-			point.push_back(atof(parseText(vstrings1[i], ' ')[0].c_str()));
-			point.push_back(atof(parseText(vstrings1[i], ' ')[1].c_str()));
+			point.push_back(current_log.plan_waypoints[i]);
+			point.push_back(current_log.plan_waypoints[i+1]);
 			current_plan.push_back(point);
 		}
 		current_plan.push_back(target_point);
 		ROS_INFO_STREAM("Plan length " << current_plan.size());
-		cout << "Orig Plan text " << parsed_log[17] << endl;
-		vector<string> vstrings2 = parseText(parsed_log[17], ';');
-		originalPlanCost = atof(parseText(vstrings2[0], ' ')[0].c_str()) / 100.0;
-		originalPlanDistance = atof(parseText(vstrings2[0], ' ')[1].c_str()) / 100.0;
+		originalPlanCost = current_log.original_plan_path_costs[0] / 100.0;
+		originalPlanDistance = current_log.original_plan_path_costs[1] / 100.0;
 		ROS_INFO_STREAM("Orig Plan cost: " << originalPlanCost << " Orig Plan distance = " << originalPlanDistance);
 		current_original_plan.push_back(robot_point);
-		for(int i = 1; i < vstrings2.size(); i++){
+		for(int i = 0; i+1 < current_log.original_plan_waypoints.size(); i += 2){
 			vector<double> point;
-			point.push_back(atof(parseText(vstrings2[i], ' ')[0].c_str()));
-			point.push_back(atof(parseText(vstrings2[i], ' ')[1].c_str()));
+			point.push_back(current_log.original_plan_waypoints[i]);
+			point.push_back(current_log.original_plan_waypoints[i+1]);
 			current_original_plan.push_back(point);
 		}
 		current_original_plan.push_back(target_point);
 		ROS_INFO_STREAM("Orig Plan length " << current_original_plan.size());
 	}
 
+	// Plan as "cost distance;x y;x y;..." for the explanations log
+	string planText(const boost::array<double, 2> &costs, const vector<double> &waypoints){
+		stringstream ss;
+		ss << costs[0] << " " << costs[1] << ";";
+		for(int i = 0; i+1 < waypoints.size(); i += 2){
+			ss << waypoints[i] << " " << waypoints[i+1] << ";";
+		}
+		return ss.str();
+	}
+
 	double computeDistance(double x1, double y1, double x2, double y2){
 		//ROS_INFO_STREAM("Inside compute distance");
 		double distance = sqrt(pow((x1 - x2),2) + pow((y1 - y2),2));
 		return distance;
 	}
 
+	// The current plan and the original plan, scored together against each crowd grid
+	vector< const vector< vector<double> > * > currentPlans(){
+		vector< const vector< vector<double> > * > plans;
+		plans.push_back(&current_plan);
+		plans.push_back(&current_original_plan);
+		return plans;
+	}
+
 	void computePlanDensities(){
 		ROS_INFO_STREAM("Inside compute plan densities");
-		//planCrowdDensity = atof(parseText(current_log)[25].c_str(), '\t');
-		//ROS_INFO_STREAM("Plan density: " << planCrowdDensity);
-		//originalPlanCrowdDensity = atof(parseText(current_log)[27].c_str(), '\t');
-		//ROS_INFO_STREAM("Orig plan density: " << originalPlanCrowdDensity);
-
-		vector< vector<int> > densities;
-		int granularity = current_crowd_density.info.resolution;
-		int boxes_height = current_crowd_density.info.height;
-		int boxes_width = current_crowd_density.info.width;
-		int map_height = boxes_height * granularity;
-		int map_width = boxes_width * granularity;
-		ROS_INFO_STREAM("granularity: " << granularity << " boxes_height: " << boxes_height << " boxes_width: " << boxes_width << " map_height: " << map_height << " map_width: " << map_width);
-		int start = 0;
-		//vector<signed char> density_data = current_crowd_density.data;
-		for(int i = 0; i < boxes_width; i++){
-			//ROS_INFO_STREAM("start: " << start);
-			vector<int> col;
-			for(int j = start; j < current_crowd_density.data.size(); j+=boxes_width){
-				//ROS_INFO_STREAM("j: " << j << " density: " << (int)(unsigned char)current_crowd_density.data[j]);
-				col.push_back((int)(unsigned char)current_crowd_density.data[j]);
-			}
-			densities.push_back(col);
-			start++;
-		}
-
-		ROS_INFO_STREAM("Initial plan density: " << planCrowdDensity);
-		for(int i = 0; i < current_plan.size()-1; i++){
-			planCrowdDensity += getGridValue(current_plan[i][0], current_plan[i][1], map_width, map_height, boxes_width, boxes_height, densities);
-		}
-		ROS_INFO_STREAM("Plan density after loop: " << planCrowdDensity);
-
-		ROS_INFO_STREAM("Initial orig plan density: " << originalPlanCrowdDensity);
-		for(int i = 0; i < current_original_plan.size()-1; i++){
-			originalPlanCrowdDensity += getGridValue(current_original_plan[i][0], current_original_plan[i][1], map_width, map_height, boxes_width, boxes_height, densities);
-		}
-		ROS_INFO_STREAM("Plan orig density after loop: " << originalPlanCrowdDensity);
+		vector<double> densities = current_crowd_density.planSums(currentPlans());
+		planCrowdDensity += densities[0];
+		originalPlanCrowdDensity += densities[1];
+		ROS_INFO_STREAM("Plan density: " << planCrowdDensity << " Orig plan density: " << originalPlanCrowdDensity);
 	}
 
 	void computePlanRisks(){
 		ROS_INFO_STREAM("Inside compute plan risks");
-		vector< vector<int> > risks;
-		int granularity = current_crowd_risk.info.resolution;
-		int boxes_height = current_crowd_risk.info.height;
-		int boxes_width = current_crowd_risk.info.width;
-		int map_height = boxes_height * granularity;
-		int map_width = boxes_width * granularity;
-		ROS_INFO_STREAM("granularity: " << granularity << " boxes_height: " << boxes_height << " boxes_width: " << boxes_width << " map_height: " << map_height << " map_width: " << map_width);
-		int start = 0;
-		//vector<signed char> risk_data = current_crowd_risk.data;
-		for(int i = 0; i < boxes_width; i++){
-			//ROS_INFO_STREAM("start: " << start);
-			vector<int> col;
-			for(int j = start; j < current_crowd_risk.data.size(); j+=boxes_width){
-				//ROS_INFO_STREAM("j: " << j << " risk: " << (int)(unsigned char)current_crowd_risk.data[j]);
-				col.push_back((int)(unsigned char)current_crowd_risk.data[j]);
-			}
-			risks.push_back(col);
-			start++;
-		}
-
-		ROS_INFO_STREAM("Initial plan risk: " << planCrowdRisk);
-		for(int i = 0; i < current_plan.size()-1; i++){
-			planCrowdRisk += getGridValue(current_plan[i][0], current_plan[i][1], map_width, map_height, boxes_width, boxes_height, risks);
-		}
-		ROS_INFO_STREAM("Plan risk after loop: " << planCrowdRisk);
-
-		ROS_INFO_STREAM("Initial orig plan risk: " << originalPlanCrowdRisk);
-		for(int i = 0; i < current_original_plan.size()-1; i++){
-			originalPlanCrowdRisk += getGridValue(current_original_plan[i][0], current_original_plan[i][1], map_width, map_height, boxes_width, boxes_height, risks);
-		}
-		ROS_INFO_STREAM("Plan orig risk after loop: " << originalPlanCrowdRisk);
-	}
-
-	int getGridValue(double map_x, double map_y, int map_width, int map_height, int boxes_width, int boxes_height, vector< vector<int> > densities){
-		if(map_x < 0) map_x=0;
-		if(map_x > map_width) map_x=map_width;
-		if(map_y < 0) map_y=0;
-		if(map_y > map_height) map_y=map_height;
-		pair<int,int> grid_coords = make_pair((int)((map_x/(map_width*1.0)) * boxes_width), (int)((map_y/(map_height * 1.0)) * boxes_height));
-		return densities[grid_coords.first][grid_coords.second];
+		vector<double> risks = current_crowd_risk.planSums(currentPlans());
+		planCrowdRisk += risks[0];
+		originalPlanCrowdRisk += risks[1];
+		ROS_INFO_STREAM("Plan risk: " << planCrowdRisk << " Orig plan risk: " << originalPlanCrowdRisk);
 	}
 
 	bool comparePlans(){
@@ -1045,10 +1099,9 @@ public:
 	void logExplanationData() {
 		//ROS_INFO_STREAM("Inside log explanation data");
 		std_msgs::String logData;
-		vector<string> vstrings = parseText(current_log, '\t');
 
 		stringstream output;
-		output << atof(vstrings[0].c_str()) << "\t" << atof(vstrings[1].c_str()) << "\t" << atof(vstrings[2].c_str()) << "\t" << computationTimeSec << "\t" << sameplan << "\t" << alt_planner << "\t" << planDistance << "\t" << originalPlanDistance << "\t" << (planDistance - originalPlanDistance) << "\t" << selected_planner << "\t" << planCost << "\t" << originalPlanCost << "\t" << (planCost - originalPlanCost) << "\t" << vstrings[16] << "\t" << vstrings[17];
+		output << current_log.task << "\t" << current_log.decision_count << "\t" << current_log.overall_time << "\t" << computationTimeSec << "\t" << sameplan << "\t" << alt_planner << "\t" << planDistance << "\t" << originalPlanDistance << "\t" << (planDistance - originalPlanDistance) << "\t" << selected_planner << "\t" << planCost << "\t" << originalPlanCost << "\t" << (planCost - originalPlanCost) << "\t" << planText(current_log.plan_path_costs, current_log.plan_waypoints) << "\t" << planText(current_log.original_plan_path_costs, current_log.original_plan_waypoints);
 		
 		logData.data = output.str();
 		plan_explanations_log_pub_.publish(logData);